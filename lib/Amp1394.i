@@ -153,6 +153,7 @@ uint32_t bswap32(uint32_t in);
 %ignore AmpIO::WriteKSZ8851Reg(AmpIO_UInt8,AmpIO_UInt8 const &);
 
 %import "AmpIORevision.h"
+%import "BoardLayout.h"
 
 %constant int VERSION_MAJOR = Amp1394_VERSION_MAJOR;
 %constant int VERSION_MINOR = Amp1394_VERSION_MINOR;
@@ -160,6 +161,8 @@ uint32_t bswap32(uint32_t in);
 %constant std::string VERSION = Amp1394_VERSION;
 
 %include "BoardIO.h"
+%include "RealTimeBoard.h"
+%template(RealTimeBoardQLA) RealTimeBoard<QLA_Layout>;
 %include "AmpIO.h"
 
 %apply (int* IN_ARRAY1, int DIM1) {(int* data, int size)};
@@ -20,11 +20,27 @@ http://www.cisst.org/cisst/license.txt.
 #ifndef __AMP1394TIME_H__
 #define __AMP1394TIME_H__
 
+#ifdef _MSC_VER
+typedef __int64 int64_t;
+#else
+#include <stdint.h>
+#endif
+
 // Return the time in seconds
 double Amp1394_GetTime(void);
 
+// Return the time of a monotonic clock in nanoseconds (arbitrary starting point).
+// Unlike Amp1394_GetTime, this is not affected by changes to the system time and
+// does not lose resolution over long runs.
+int64_t Amp1394_GetMonotonicTime(void);
+
 // Sleep for the desired number of seconds
 void Amp1394_Sleep(double sec);
 
+// Sleep until the monotonic clock (see Amp1394_GetMonotonicTime) reaches the specified
+// time in nanoseconds. Returns immediately if the time has already passed. Where supported,
+// this uses an absolute sleep, so that periodic loops do not accumulate drift.
+void Amp1394_SleepUntil(int64_t monotonicTime);
+
 #endif
 
@@ -21,7 +21,7 @@ http://www.cisst.org/cisst/license.txt.
 
 #include <Amp1394/AmpIORevision.h>
 
-#include "BoardIO.h"
+#include "RealTimeBoard.h"
 #ifdef _MSC_VER
 typedef unsigned __int8  uint8_t;
 typedef unsigned __int16 uint16_t;
@@ -31,6 +31,7 @@ typedef __int32          int32_t;
 #include <stdint.h>
 #endif
 #include <iostream>
+#include <string>
 
 class ostream;
 
@@ -45,7 +46,7 @@ typedef uint8_t  AmpIO_UInt8;
 
 #ifndef SWIG
 /*! See Interface Spec: https://github.com/jhu-cisst/mechatronics-software/wiki/InterfaceSpec */
-class AmpIO : public BoardIO
+class AmpIO : public RealTimeBoard<QLA_Layout>
 {
 public:
 #endif
@@ -76,9 +77,24 @@ public:
         void Init();
     };
 
+    // Board identity information, which does not change until the board is rebooted.
+    // See GetBoardInfo and ReadBoardInfoAll.
+    struct BoardInfo {
+        bool valid;                    // true if information has been read
+        AmpIO_UInt32 firmwareVersion;  // FPGA firmware version
+        std::string fpgaSerial;        // FPGA serial number (empty if not found)
+        std::string qlaSerial;         // QLA serial number (empty if not found)
+        bool hasEthernet;              // true if FPGA has Ethernet (Rev 2.0+)
+        AmpIO_UInt32 ipv4Address;      // IPv4 address (0 if not available, Firmware V7+)
+        unsigned int busGeneration;    // bus generation when information was read
+
+        BoardInfo() : valid(false), firmwareVersion(0), hasEthernet(false), ipv4Address(0),
+                      busGeneration(0) {}
+    };
+
 #ifdef SWIG
 /*! See Interface Spec: https://github.com/jhu-cisst/mechatronics-software/wiki/InterfaceSpec */
-class AmpIO : public BoardIO
+class AmpIO : public RealTimeBoard<QLA_Layout>
 {
 public:
 #endif
@@ -98,15 +114,40 @@ public:
     // Returns true if FPGA has Ethernet (Rev 2.0+)
     bool HasEthernet(void) const;
 
+    // Returns the cached board identity information, reading it from the board if it has not
+    // yet been read, or if the board may have been rebooted (i.e., after WriteReboot or a bus reset).
+    const BoardInfo &GetBoardInfo(void);
+
+    // Force the board identity information to be read again on the next call to GetBoardInfo
+    void InvalidateBoardInfo(void) { boardInfo.valid = false; }
+
+    // Read the identity information for all boards on the port (that need to be refreshed),
+    // using broadcast PROM commands so that the PROM access time is incurred once, rather than
+    // once per board. Returns the number of boards read.
+    static unsigned int ReadBoardInfoAll(BasePort *port, bool forceRead = false);
+
+    // Real-time read profiles, which specify the prefix of the real-time read block that is
+    // needed by the application:
+    //   READ_PROFILE_FULL      all data (default)
+    //   READ_PROFILE_VELOCITY  up to encoder velocity (no encoder acceleration/running counter data)
+    //   READ_PROFILE_POSITION  up to encoder position (no encoder velocity/acceleration data)
+    // With the sequential read protocols, only the prefix is read from the board (e.g., 12 instead
+    // of 28 quadlets for READ_PROFILE_POSITION with Firmware Rev 7+). With the broadcast read
+    // protocol, the hub always contains the full data, but only the prefix is processed. The
+    // data that is not in the profile is 0 (e.g., GetEncoderVelocity returns 0 for
+    // READ_PROFILE_POSITION and GetEncoderAcceleration returns 0 for READ_PROFILE_VELOCITY).
+    enum ReadProfile { READ_PROFILE_FULL, READ_PROFILE_VELOCITY, READ_PROFILE_POSITION };
+
+    void SetReadProfile(ReadProfile profile);
+    ReadProfile GetReadProfile(void) const { return readProfile; }
+
     // *********************** GET Methods ***********************************
     // The GetXXX methods below return data from local buffers that were filled
     // by FirewirePort::ReadAllBoards. To read data immediately from the boards,
     // use the ReadXXX methods, but note that individual reads via IEEE-1394 are
-    // less efficient than block transfers.
-
-    AmpIO_UInt32 GetStatus(void) const;
-
-    AmpIO_UInt32 GetTimestamp(void) const;
+    // less efficient than block transfers. GetStatus, GetTimestamp, GetDigitalInput,
+    // GetMotorCurrent, GetAnalogInput and GetEncoderPosition are provided by
+    // RealTimeBoard.
 
     // Get timestamp in seconds (time between two consecutive reads)
     double GetTimestampSeconds(void) const;
@@ -114,10 +155,16 @@ public:
     // Get elapsed time, in seconds, based on FPGA clock. This is computed by accumulating
     // the timestamp values in the real-time read packet; thus, it is only accurate when
     // there are periodic calls to ReadAllBoards or ReadAllBoardsBroadcast.
-    double GetFirmwareTime(void) const { return firmwareTime; }
+    double GetFirmwareTime(void) const
+    { return firmwareTimeBase + (firmwareTicks-firmwareTicksBase)*GetFPGAClockPeriod(); }
 
     // Set firmware time
-    void SetFirmwareTime(double newTime = 0.0) { firmwareTime = newTime; }
+    void SetFirmwareTime(double newTime = 0.0)
+    { firmwareTimeBase = newTime; firmwareTicksBase = firmwareTicks; }
+
+    // Get elapsed time in FPGA clock ticks, accumulated in the same way as GetFirmwareTime.
+    // This is not affected by SetFirmwareTime and does not lose resolution (see ClockSync).
+    uint64_t GetFirmwareTicks(void) const { return firmwareTicks; }
 
     // Return digital output state
     AmpIO_UInt8 GetDigitalOutput(void) const;
@@ -146,22 +193,30 @@ public:
     AmpIO_UInt8 GetEncoderIndex(void) const;
     //@}
 
-    AmpIO_UInt32 GetDigitalInput(void) const;
-
     AmpIO_UInt8 GetAmpTemperature(unsigned int index) const;
 
-    AmpIO_UInt32 GetMotorCurrent(unsigned int index) const;
-
-    AmpIO_UInt32 GetAnalogInput(unsigned int index) const;
-
     //********************** Encoder position/velocity/acceleration *****************************
 
-    /*! Returns the encoder position in counts. */
-    AmpIO_Int32 GetEncoderPosition(unsigned int index) const;
-
     /*! Returns true if encoder position has overflowed. */
     bool GetEncoderOverflow(unsigned int index) const;
 
+    /*! Returns the encoder position in counts, extended to 64 bits in software. The
+        extended position is updated by each real-time read from the change of the
+        24-bit firmware counter (modulo 2^24), so it does not wrap and does not require
+        WriteEncoderPreload for continuous axes, provided that the axis moves less than
+        2^23 counts between reads. It is initialized from GetEncoderPosition by the first
+        read (and the first read after WriteEncoderPreload), and includes the offset set
+        by SetEncoderPositionExtended. */
+    int64_t GetEncoderPositionExtended(unsigned int index) const;
+
+    /*! Sets the extended encoder position (e.g., when homing) by changing the software
+        offset; this does not require any bus transactions. */
+    void SetEncoderPositionExtended(unsigned int index, int64_t pos);
+
+    /*! Returns the offset added to the accumulated encoder counts (see
+        SetEncoderPositionExtended). */
+    int64_t GetEncoderHomeOffset(unsigned int index) const;
+
     /*! Returns the encoder clock period, in seconds. Note that this value depends on the
         firmware version. */
     double GetEncoderClockPeriod(void) const;
@@ -354,6 +409,9 @@ public:
 
     bool WriteSafetyRelay(bool state);
 
+    // Preload the encoder counter. This is always sent immediately (never deferred), so that
+    // the next read re-seeds the extended position (GetEncoderPositionExtended) from the
+    // preloaded counter.
     bool WriteEncoderPreload(unsigned int index, AmpIO_Int32 enc);
 
     // Reset DOUT configuration bit, which causes firmware to repeat DOUT configuration check
@@ -636,23 +694,15 @@ public:
 protected:
     unsigned int NumAxes;   // not currently used
 
-    // Number of channels in the node (4 for QLA)
-    enum { NUM_CHANNELS = 4 };
+    // Real-time buffer layout is QLA_Layout (see RealTimeBoard and BoardLayout.h)
 
     // Sizes of real-time read and write buffers (see below for offsets into these buffers)
     // Firmware Rev 1-6 had ReadBufSize=4+4*NUM_CHANNELS. Using the larger buffer here
     // still retains compatibility with older firmware.
-    enum { ReadBufSize_Old = 4+4*NUM_CHANNELS,
-           ReadBufSize = 4+6*NUM_CHANNELS,
-           WriteBufSize = NUM_CHANNELS+1 };
-
-    // Buffer for real-time block reads. The Port class calls SetReadData to copy the
-    // most recent data into this buffer, while also byteswapping.
-    quadlet_t ReadBuffer[ReadBufSize];
-
-    // Buffer for real-time block writes. The Port class calls GetWriteData to copy from
-    // this buffer, while also byteswapping if needed.
-    quadlet_t WriteBuffer[WriteBufSize];
+    // The buffers (ReadBuffer and WriteBuffer) are in RealTimeBoard.
+    enum { ReadBufSize_Old = Layout::READ_SIZE_OLD,
+           ReadBufSize = Layout::READ_SIZE,
+           WriteBufSize = Layout::WRITE_SIZE };
 
     // Encoder velocity data (per axis)
     EncoderVelocityData encVelData[NUM_CHANNELS];
@@ -660,8 +710,49 @@ protected:
     // Counts received encoder errors
     unsigned int encErrorCount[NUM_CHANNELS];
 
-    // Accumulated firmware time
-    double firmwareTime;
+    // Real-time read profile, and corresponding number of quadlets (see SetReadProfile)
+    ReadProfile readProfile;
+    unsigned int GetReadProfileQuads(void) const;
+
+    // Extended encoder position (see GetEncoderPositionExtended): counts accumulated from
+    // the changes of the firmware counter, last firmware counter value (24 bits), home
+    // offset, and whether encExtCount has been initialized
+    int64_t encExtCount[NUM_CHANNELS];
+    AmpIO_UInt32 encExtLast[NUM_CHANNELS];
+    int64_t encHomeOffset[NUM_CHANNELS];
+    bool encExtValid[NUM_CHANNELS];
+
+    // Update extended encoder position from the real-time read data
+    void SetEncoderPositionExtendedData(unsigned int index);
+
+    // Accumulated firmware time, in FPGA clock ticks. The time in seconds is computed from
+    // the ticks since the last call to SetFirmwareTime, to avoid accumulating rounding errors.
+    uint64_t firmwareTicks;
+    uint64_t firmwareTicksBase;
+    double firmwareTimeBase;
+
+    // Write quadlet immediately or, if deferred writes are enabled, add it to the queue
+    // (see BoardIO::SetDeferredWrites). If the queue is full, it is flushed and the write
+    // is sent immediately (see WriteQuadletImmediate).
+    bool WriteQuadletDeferrable(nodeaddr_t addr, quadlet_t data);
+
+    // Write quadlet immediately, after sending any deferred writes to this board, so that
+    // an immediate write cannot overtake an earlier deferred write (e.g., WriteAmpEnable
+    // followed by WritePowerEnable). FlushDeferred should be called before other immediate
+    // transactions that write to the board (e.g., WriteBlock).
+    bool WriteQuadletImmediate(nodeaddr_t addr, quadlet_t data);
+    void FlushDeferred(void);
+    friend class AmpIOOperation;   // for WriteQuadletImmediate and FlushDeferred
+
+    // Broadcast write, after sending the deferred writes of all boards on the port
+    static bool WriteQuadletAll(BasePort *port, nodeaddr_t addr, quadlet_t data);
+
+    // Cached board identity information (see GetBoardInfo)
+    BoardInfo boardInfo;
+    bool BoardInfoIsCurrent(void) const;
+    void SetBoardInfoCommon(void);
+    static std::string ParseFPGASerialNumber(const char *data);
+    static std::string ParseQLASerialNumber(const char *data);
 
     // Data collection
     // The FPGA firmware contains a data collection buffer of 1024 quadlets.
@@ -676,19 +767,19 @@ protected:
     CollectCallback collect_cb;        // user-supplied callback (if non-zero)
     unsigned short collect_rindex;     // current read index
 
+    // Estimated completion times (seconds) for the DS2505 reset/first block (index 0) and
+    // for subsequent blocks (index 1), used by DallasReadMemory to reduce polling.
+    double dallasWaitEstimate[2];
+
+    // Similar to DallasWaitIdle, but first sleeps for most of dallasWaitEstimate[index] and then
+    // polls at a finer interval. The estimate is updated based on the measured wait time.
+    bool DallasWaitIdleAdaptive(unsigned int index);
+
     // Virtual methods
     unsigned int GetReadNumBytes() const;
+    unsigned int GetSeqReadNumBytes() const { return GetReadProfileQuads()*sizeof(quadlet_t); }
     void SetReadData(const quadlet_t *buf);
 
-    unsigned int GetWriteNumBytes() const { return WriteBufSize*sizeof(quadlet_t); }
-    bool GetWriteData(quadlet_t *buf, unsigned int offset, unsigned int numQuads, bool doSwap = true) const;
-    void InitWriteBuffer(void);
-
-    // Test if the current write buffer contains commands that will
-    // reset the watchdog on the board.  In practice, checks if
-    // there's any valid bit on the 4 requested currents.
-    bool WriteBufferResetsWatchdog(void) const;
-
     /*! Extract the data used for velocity estimation */
     bool SetEncoderVelocityData(unsigned int index);
 
@@ -711,24 +802,24 @@ protected:
     // Firmware V7 added ENC_QTR5_OFFSET and ENC_RUN_OFFSET; in V6, the QTR5 data
     // was stuffed into unused bits in other fields.
     enum {
-        TIMESTAMP_OFFSET  = 0,    // one quadlet
-        STATUS_OFFSET     = 1,    // one quadlet
-        DIGIO_OFFSET      = 2,    // digital I/O (one quadlet)
-        TEMP_OFFSET       = 3,    // temperature (one quadlet)
-        MOTOR_CURR_OFFSET = 4,    // half quadlet per channel (lower half)
-        ANALOG_POS_OFFSET = 4,    // half quadlet per channel (upper half)
-        ENC_POS_OFFSET    = 4+NUM_CHANNELS,    // one quadlet per channel
-        ENC_VEL_OFFSET    = 4+2*NUM_CHANNELS,  // one quadlet per channel
-        ENC_FRQ_OFFSET    = 4+3*NUM_CHANNELS,  // one quadlet per channel
-        ENC_QTR1_OFFSET   = 4+3*NUM_CHANNELS,  // one quadlet per channel
-        ENC_QTR5_OFFSET   = 4+4*NUM_CHANNELS,  // one quadlet per channel
-        ENC_RUN_OFFSET    = 4+5*NUM_CHANNELS   // one quadlet per channel
+        TIMESTAMP_OFFSET  = Layout::TIMESTAMP_OFFSET,
+        STATUS_OFFSET     = Layout::STATUS_OFFSET,
+        DIGIO_OFFSET      = Layout::DIGIO_OFFSET,
+        TEMP_OFFSET       = Layout::TEMP_OFFSET,
+        MOTOR_CURR_OFFSET = Layout::MOTOR_CURR_OFFSET,
+        ANALOG_POS_OFFSET = Layout::ANALOG_POS_OFFSET,
+        ENC_POS_OFFSET    = Layout::ENC_POS_OFFSET,
+        ENC_VEL_OFFSET    = Layout::ENC_VEL_OFFSET,
+        ENC_FRQ_OFFSET    = Layout::ENC_FRQ_OFFSET,
+        ENC_QTR1_OFFSET   = Layout::ENC_QTR1_OFFSET,
+        ENC_QTR5_OFFSET   = Layout::ENC_QTR5_OFFSET,
+        ENC_RUN_OFFSET    = Layout::ENC_RUN_OFFSET
     };
 
     // offsets of real-time write buffer contents
     enum {
-        WB_CURR_OFFSET = 0,             // one quadlet per channel
-        WB_CTRL_OFFSET = NUM_CHANNELS   // control register (power control)
+        WB_CURR_OFFSET = Layout::WB_CURR_OFFSET,
+        WB_CTRL_OFFSET = Layout::WB_CTRL_OFFSET
     };
 
     // Hardware device address offsets, not to be confused with buffer offsets.
@@ -0,0 +1,257 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef __AmpIOOperation_H__
+#define __AmpIOOperation_H__
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "AmpIO.h"
+
+/*
+ * AmpIOOperation
+ *
+ * Non-blocking versions of the multi-step AmpIO operations (PROM erase, program and read,
+ * Dallas 1-wire memory read, KSZ8851 reset and register read). The AmpIO methods wait for
+ * the hardware by sleeping (Amp1394_Sleep) or polling in a loop, so the calling thread is
+ * blocked for milliseconds to seconds and only one board can be serviced at a time.
+ *
+ * Each operation is a state machine that performs the same transactions as the corresponding
+ * AmpIO method. Step performs the transactions until the operation has to wait for the
+ * hardware, and then returns OP_PENDING with the wake time (GetWakeTime) set to the time at
+ * which the operation should be resumed, instead of sleeping. Calling Step before the wake
+ * time does nothing. Thus, one thread can drive the same operation on all boards at the
+ * same time (see AmpIOOperationQueue).
+ *
+ * Polling operations have a timeout (the AmpIO methods wait indefinitely for the PROM), and
+ * the error message of a failed operation is available via GetError (nothing is printed).
+ * The operations access the port directly, so they should not be used while another thread
+ * is using the port.
+ *
+ * Typical use:
+ *     AmpIOOperationQueue queue;
+ *     for (i = 0; i < numBoards; i++)
+ *         queue.Add(new PromSectorEraseOp(boards[i], addr));
+ *     queue.Run();
+ */
+
+class AmpIOOperation
+{
+public:
+    enum Status { OP_PENDING, OP_DONE, OP_FAILED };
+
+protected:
+    AmpIO *board;
+    Status status;
+    int state;                       // state of derived class state machine (0 initially)
+    int64_t startTime;               // time of first Step (ns, see Amp1394_GetMonotonicTime; -1 if none)
+    int64_t endTime;                 // time at which operation finished
+    int64_t wakeTime;                // time at which Step should be called again
+    int64_t waitStart;               // start time of current wait (for timeout)
+    std::string errorMsg;
+
+    // Perform the transactions for the current state. Derived classes should call
+    // WaitFor, Done or Fail before returning.
+    virtual Status Execute(int64_t now) = 0;
+
+    // Resume after the specified time (seconds)
+    Status WaitFor(double sec);
+    // Start timing a wait (e.g., before polling a status register)
+    void StartWait(int64_t now) { waitStart = now; }
+    // Whether more than the specified time (seconds) has elapsed since StartWait
+    bool WaitTimedOut(int64_t now, double sec) const
+    { return (now-waitStart) > static_cast<int64_t>(sec*1.0e9); }
+
+    Status Done(int64_t now);
+    Status Fail(int64_t now, const std::string &msg);
+
+    // Write to the board, after sending its deferred writes (see AmpIO::WriteQuadletImmediate)
+    bool WriteQuadlet(nodeaddr_t addr, quadlet_t data);
+    bool WriteBlock(nodeaddr_t addr, quadlet_t *data, unsigned int nbytes);
+
+public:
+    AmpIOOperation(AmpIO *brd);
+    virtual ~AmpIOOperation() {}
+
+    // Name of operation (for messages)
+    virtual const char *GetName(void) const = 0;
+
+    // Perform the next step of the operation, if the wake time has been reached.
+    // Returns the status of the operation.
+    Status Step(void);
+
+    // Perform the operation (blocking), i.e., call Step and sleep until the wake time.
+    // Returns true if successful.
+    bool Run(void);
+
+    AmpIO *GetBoard(void) const { return board; }
+    Status GetStatus(void) const { return status; }
+    bool IsPending(void) const { return (status == OP_PENDING); }
+    bool IsDone(void) const { return (status == OP_DONE); }
+    int64_t GetWakeTime(void) const { return wakeTime; }
+    const std::string &GetError(void) const { return errorMsg; }
+
+    // Time from first Step until operation finished (or until now, if pending), in seconds
+    double GetElapsedTime(void) const;
+};
+
+// Erase a PROM sector (64K) at the specified address (see AmpIO::PromSectorErase)
+class PromSectorEraseOp : public AmpIOOperation
+{
+protected:
+    AmpIO_UInt32 addr;
+    Status Execute(int64_t now);
+
+public:
+    PromSectorEraseOp(AmpIO *brd, AmpIO_UInt32 address) : AmpIOOperation(brd), addr(address) {}
+    const char *GetName(void) const { return "PromSectorErase"; }
+};
+
+// Program a PROM page (up to 256 bytes) at the specified address (see AmpIO::PromProgramPage).
+// The data is copied, so the caller's buffer does not have to remain valid.
+class PromProgramPageOp : public AmpIOOperation
+{
+public:
+    enum { MAX_PAGE = 256 };
+
+protected:
+    AmpIO_UInt32 addr;
+    unsigned int nbytes;
+    quadlet_t pageData[MAX_PAGE/sizeof(quadlet_t)+1];   // command and data
+    Status Execute(int64_t now);
+
+public:
+    PromProgramPageOp(AmpIO *brd, AmpIO_UInt32 address, const AmpIO_UInt8 *bytes, unsigned int numBytes);
+    const char *GetName(void) const { return "PromProgramPage"; }
+};
+
+// Read data from the PROM (see AmpIO::PromReadData). The data buffer must remain valid
+// until the operation has finished.
+class PromReadDataOp : public AmpIOOperation
+{
+protected:
+    AmpIO_UInt32 addr;
+    AmpIO_UInt8 *data;
+    unsigned int nbytes;
+    unsigned int page;               // number of bytes read
+    unsigned int numPolls;
+    Status Execute(int64_t now);
+
+public:
+    PromReadDataOp(AmpIO *brd, AmpIO_UInt32 address, AmpIO_UInt8 *buffer, unsigned int numBytes) :
+        AmpIOOperation(brd), addr(address), data(buffer), nbytes(numBytes), page(0), numPolls(0) {}
+    const char *GetName(void) const { return "PromReadData"; }
+};
+
+// Read memory of the Dallas DS2505 1-wire interface (see AmpIO::DallasReadMemory). The data
+// buffer must remain valid until the operation has finished.
+class DallasReadMemoryOp : public AmpIOOperation
+{
+protected:
+    unsigned short addr;
+    unsigned char *data;
+    unsigned int nbytes;
+    unsigned int nread;              // number of bytes read
+    Status Execute(int64_t now);
+
+public:
+    DallasReadMemoryOp(AmpIO *brd, unsigned short address, unsigned char *buffer, unsigned int numBytes) :
+        AmpIOOperation(brd), addr(address), data(buffer), nbytes(numBytes), nread(0) {}
+    const char *GetName(void) const { return "DallasReadMemory"; }
+};
+
+// Reset the KSZ8851 Ethernet controller (see AmpIO::ResetKSZ8851) and wait until it is
+// ready, i.e., until the status indicates that Ethernet is present and the FPGA state
+// machine is idle.
+class ResetKSZ8851Op : public AmpIOOperation
+{
+protected:
+    AmpIO_UInt16 ethStatus;
+    Status Execute(int64_t now);
+
+public:
+    ResetKSZ8851Op(AmpIO *brd) : AmpIOOperation(brd), ethStatus(0) {}
+    const char *GetName(void) const { return "ResetKSZ8851"; }
+    // KSZ8851 status after reset (see AmpIO::ReadKSZ8851Status)
+    AmpIO_UInt16 GetEthStatus(void) const { return ethStatus; }
+};
+
+// Read a KSZ8851 register (see AmpIO::ReadKSZ8851Reg). This does not wait, but is provided
+// so that it can be queued after ResetKSZ8851Op.
+class ReadKSZ8851RegOp : public AmpIOOperation
+{
+protected:
+    AmpIO_UInt8 addr;
+    bool is16bit;
+    AmpIO_UInt16 value;
+    Status Execute(int64_t now);
+
+public:
+    ReadKSZ8851RegOp(AmpIO *brd, AmpIO_UInt8 address, bool read16bit = true) :
+        AmpIOOperation(brd), addr(address), is16bit(read16bit), value(0) {}
+    const char *GetName(void) const { return "ReadKSZ8851Reg"; }
+    AmpIO_UInt16 GetValue(void) const { return value; }
+};
+
+/*
+ * AmpIOOperationQueue
+ *
+ * Runs operations on any number of boards from one thread. Operations added for the same
+ * board are run in sequence (in the order added); operations for different boards are run
+ * concurrently, i.e., while one board is waiting for the hardware, the other boards are
+ * serviced. The queue takes ownership of the operations.
+ */
+
+class AmpIOOperationQueue
+{
+public:
+    // Same as AmpIO::ProgressCallback; called (with NULL) each time Run sleeps, and with
+    // the error message when an operation fails. If it returns false, Run is aborted.
+    typedef AmpIO::ProgressCallback ProgressCallback;
+
+protected:
+    std::vector<AmpIOOperation *> ops;
+    std::ostream &outStr;
+    unsigned int numFailed;
+
+    // Whether an earlier operation for the same board is still pending
+    bool IsBlocked(size_t index) const;
+
+public:
+    AmpIOOperationQueue(std::ostream &debugStream = std::cerr) : outStr(debugStream), numFailed(0) {}
+    ~AmpIOOperationQueue() { Clear(); }
+
+    void Add(AmpIOOperation *op);
+
+    // Delete all operations
+    void Clear(void);
+
+    // Step all operations that are ready. Returns the number of pending operations and
+    // sets nextWake to the earliest wake time of the pending operations. Failed operations
+    // are reported to the callback (or debug stream, if no callback).
+    unsigned int Poll(int64_t &nextWake, const ProgressCallback cb = 0);
+
+    // Call Poll and sleep until the next wake time, until all operations have finished.
+    // Returns true if all operations were successful.
+    bool Run(const ProgressCallback cb = 0);
+
+    size_t GetNumOperations(void) const { return ops.size(); }
+    AmpIOOperation *GetOperation(size_t index) const { return (index < ops.size()) ? ops[index] : 0; }
+    // Number of failed operations (since Clear)
+    unsigned int GetNumFailed(void) const { return numFailed; }
+};
+
+#endif // __AmpIOOperation_H__
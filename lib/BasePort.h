@@ -20,6 +20,10 @@ http://www.cisst.org/cisst/license.txt.
 
 #include <iostream>
 #include "BoardIO.h"
+#include "PortCounters.h"
+#include "PortArena.h"
+
+class CycleLog;
 
 /*
  * BasePort
@@ -70,6 +74,10 @@ const unsigned char FW_TL_MASK                 = 0x3f;
 
 class BasePort
 {
+    // RecordingPort and ImpairedPort forward transactions to the protected methods of another port
+    friend class RecordingPort;
+    friend class ImpairedPort;
+
 public:
 
     enum { MAX_NODES = 64 };     // maximum number of nodes (IEEE-1394 limit)
@@ -87,6 +95,7 @@ public:
     // sent by the host PC. The following times are relative to this timer.
     struct BroadcastReadInfo {
         unsigned int readSequence;    // The sequence number sent with the broadcast query command
+        unsigned int queryMask;       // Boards included in the broadcast query (see SetBoardRateDivisor)
         double readStartTime;         // When the PC started reading the hub feedback data
         double readFinishTime;        // When the PC finished reading the hub feedback data
         struct BroadcastBoardInfo {   // For each board:
@@ -99,11 +108,26 @@ public:
         };
         BroadcastBoardInfo boardInfo[BoardIO::MAX_BOARDS];
 
-        BroadcastReadInfo() : readSequence(0), readStartTime(0.0), readFinishTime(0.0) {}
+        BroadcastReadInfo() : readSequence(0), queryMask(0), readStartTime(0.0), readFinishTime(0.0) {}
         ~BroadcastReadInfo() {}
         void PrintTiming(std::ostream &outStr, bool newLine = true) const;
     };
 
+    enum { NUM_PROTOCOLS = 3 };
+
+    // Results of timed protocol trial (see AutoSelectProtocol)
+    struct ProtocolTrial {
+        bool valid;                   // Whether protocol was tested
+        unsigned int numCycles;       // Number of cycles (ReadAllBoards followed by WriteAllBoards)
+        unsigned int numFailures;     // Number of cycles where read or write failed
+        double p50;                   // Cycle time statistics, in seconds
+        double p99;
+        double max;
+
+        ProtocolTrial() : valid(false), numCycles(0), numFailures(0), p50(0.0), p99(0.0), max(0.0) {}
+        ~ProtocolTrial() {}
+    };
+
 protected:
     // Stream for debugging output (default is std::cerr)
     std::ostream &outStr;
@@ -130,6 +154,10 @@ protected:
     BoardIO *BoardList[BoardIO::MAX_BOARDS];
     unsigned int NumOfBoards_;      // number of boards in use
     unsigned int BoardInUseMask_;   // mask indicating whether board in use
+    unsigned int BoardQueryMask_;   // boards read in current cycle (see SetBoardRateDivisor)
+    unsigned int NumOfBoardsQueried_;  // number of boards in BoardQueryMask_
+    unsigned int BoardRateDivisor_[BoardIO::MAX_BOARDS];
+    unsigned long ReadCycle_;       // number of ReadAllBoards calls, for BoardRateDivisor_
     unsigned int max_board;         // highest index of used (non-zero) entry in BoardList
     unsigned char HubBoard;         // board number of hub/bridge
 
@@ -139,6 +167,8 @@ protected:
     unsigned char *ReadBufferBroadcast;
     // Memory for generic use
     unsigned char *GenericBuffer;
+    // Memory block for above buffers (see AllocateBuffers)
+    PortArena Arena;
 
     // For debugging
     bool rtWrite;
@@ -147,6 +177,25 @@ protected:
     // Information about broadcast read
     BroadcastReadInfo bcReadInfo;
 
+    // Performance and error counters
+    PortCounters Counters;
+
+    // Log of raw broadcast buffers (0 if not logging)
+    CycleLog *cycleLog;
+
+    // Results of last AutoSelectProtocol trial
+    ProtocolTrial ProtocolTrials_[NUM_PROTOCOLS];
+
+    // Returns true if the protocol can be used with the current boards
+    bool IsProtocolSupported(ProtocolType prot) const;
+
+    // Number of bytes read from the hub by ReadAllBoardsBroadcast for the boards in queryMask
+    // (default: all boards in use). This must not exceed GetMaxReadDataSize.
+    unsigned int GetBroadcastReadNumBytes(unsigned int queryMask = 0xffff) const;
+
+    // Run timed trial of specified protocol (which must be supported)
+    ProtocolTrial RunProtocolTrial(ProtocolType prot, unsigned int numCycles);
+
     // Firmware versions
     unsigned long FirmwareVersion[BoardIO::MAX_BOARDS];
 
@@ -163,6 +212,11 @@ protected:
     // Sets default protocol based on firmware
     void SetDefaultProtocol(void);
 
+    // Allocates all packet buffers (GenericBuffer, ReadBufferBroadcast and WriteBufferBroadcast)
+    // in one cache-line aligned block, if not already allocated. The sizes are based on the
+    // port-specific prefix/postfix sizes and the maximum data sizes.
+    void AllocateBuffers(void);
+
     // Following initializes the generic buffer, if needed
     void SetGenericBuffer(void);
 
@@ -174,6 +228,9 @@ protected:
     // Convenience function
     void SetReadInvalid(void);
 
+    // Update BoardQueryMask_ for the next read cycle, based on BoardRateDivisor_
+    void UpdateBoardQueryMask(void);
+
     // Initialize nodes on the bus; called by ScanNodes
     // \return Maximum number of nodes on bus (0 if error)
     virtual nodeid_t InitNodes(void) = 0;
@@ -217,6 +274,25 @@ public:
     // Set protocol type
     bool SetProtocol(ProtocolType prot);
 
+    // Returns protocol name (e.g., "SEQ_RW")
+    static std::string ProtocolString(ProtocolType prot);
+
+    // Select the protocol with the lowest 99th percentile cycle time (opt-in alternative to the
+    // default protocol, which is based only on the firmware capabilities). This should be called
+    // after all boards have been added, and before the amplifiers are enabled, because it calls
+    // ReadAllBoards and WriteAllBoards for numCycles with each supported protocol.
+    // If cacheFile is not empty, the selected protocol is stored for the current topology (see
+    // GetTopologyString) and subsequent calls use the stored protocol, unless forceTrial is true.
+    bool AutoSelectProtocol(unsigned int numCycles = 500, const std::string &cacheFile = "",
+                            bool forceTrial = false);
+
+    // Results of the last protocol trial
+    const ProtocolTrial &GetProtocolTrial(ProtocolType prot) const
+    { return ProtocolTrials_[(static_cast<int>(prot) < NUM_PROTOCOLS) ? prot : 0]; }
+
+    // String that identifies the port type, boards in use and their firmware versions
+    std::string GetTopologyString(void) const;
+
     // Reset the port (call Cleanup, then Init)
     virtual void Reset(void);
 
@@ -230,6 +306,20 @@ public:
     // Get number of boards that were added to BoardList
     unsigned int GetNumOfBoards(void) const { return NumOfBoards_; }
 
+    // Read the board only every divisor cycles (ReadAllBoards calls), e.g., for boards that only
+    // provide slow I/O; the default is 1 (every cycle). With the broadcast protocol (Firmware Rev 7+),
+    // the boards that are not due are not included in the broadcast query, which reduces the
+    // hub read size and wait time. Boards with the same divisor are read in different cycles
+    // (based on the board number), to spread the load. The read data of a board that is not
+    // due keeps its previous value and validity, but is marked stale (see BoardIO::IsReadStale).
+    // Writes are not affected. The divisor is reset to 1 when the board is added.
+    bool SetBoardRateDivisor(unsigned char boardId, unsigned int divisor);
+    unsigned int GetBoardRateDivisor(unsigned char boardId) const
+    { return (boardId < BoardIO::MAX_BOARDS) ? BoardRateDivisor_[boardId] : 0; }
+
+    // Get mask of boards read by the last ReadAllBoards
+    unsigned int GetBoardQueryMask(void) const { return BoardQueryMask_; }
+
     // Get highest board number present in BoardList
     unsigned int GetMaxBoardNum(void) const { return max_board; }
 
@@ -268,6 +358,25 @@ public:
     BroadcastReadInfo GetBroadcastReadInfo(void) const
     { return bcReadInfo; }
 
+    // Get performance and error counters
+    const PortCounters &GetCounters(void) const
+    { return Counters; }
+
+    void ClearCounters(void)
+    { Counters.Clear(); }
+
+    // Set log for raw broadcast read/write buffers (0 to disable). The log must be opened
+    // by the caller (see CycleLog::Open) and is not deleted by the port.
+    void SetCycleLog(CycleLog *log)
+    { cycleLog = log; }
+
+    CycleLog *GetCycleLog(void) const
+    { return cycleLog; }
+
+    // Return port number (e.g., 0 for fw0 or eth0)
+    int GetPortNum(void) const
+    { return PortNum; }
+
     // Return string version of PortType
     static std::string PortTypeString(PortType portType);
 
@@ -359,6 +468,16 @@ public:
     // Write a quadlet to the specified board
     virtual bool WriteQuadlet(unsigned char boardId, nodeaddr_t addr, quadlet_t data);
 
+    // Send deferred (non-real-time) writes for all boards (see BoardIO::SetDeferredWrites).
+    // This is called at the end of WriteAllBoards/WriteAllBoardsBroadcast.
+    // Returns false if any write failed (the board's write valid flag is also cleared).
+    virtual bool FlushDeferredWrites(void);
+
+    // Send deferred writes for the specified board. This is called by AmpIO before any
+    // immediate (non-deferred) write to the board, so that the writes reach the board in the
+    // order in which they were issued.
+    bool FlushDeferredWrites(BoardIO *board);
+
     // Write a No-op quadlet to reset watchdog counters on boards.
     // This is used by WriteAllBoards if no other valid command is written
     virtual bool WriteNoOp(unsigned char boardId)
@@ -26,6 +26,7 @@ typedef unsigned __int8  uint8_t;
 typedef unsigned __int16 uint16_t;
 typedef unsigned __int32 uint32_t;
 typedef unsigned __int64 uint64_t;
+typedef __int64          int64_t;
 #else
 #include <stdint.h>
 #endif
@@ -40,6 +41,9 @@ class FirewirePort;
 class EthBasePort;
 class EthRawPort;
 class EthUdpPort;
+class FailoverPort;
+class CycleLogPort;
+class CycleCostModel;
 
 class BoardIO
 {
@@ -62,6 +66,9 @@ protected:
     friend class EthBasePort;
     friend class EthRawPort;
     friend class EthUdpPort;
+    friend class FailoverPort;
+    friend class CycleLogPort;
+    friend class CycleCostModel;
 
     // For real-time block reads and writes, the board class (i.e., derived classes from BoardIO)
     // determines the data size (NumBytes), but the port classes (i.e., derived classes from BasePort)
@@ -71,8 +78,22 @@ protected:
     void SetReadValid(bool flag)
     { readValid = flag; if (!readValid) numReadErrors++; }
     virtual unsigned int GetReadNumBytes() const = 0;
+    // Number of bytes read by the sequential protocols, which can be less than GetReadNumBytes
+    // if not all data is needed (the broadcast hub data always has GetReadNumBytes per board)
+    virtual unsigned int GetSeqReadNumBytes() const { return GetReadNumBytes(); }
     virtual void SetReadData(const quadlet_t *buf) = 0;
 
+    // Host time (see Amp1394_GetMonotonicTime) immediately before and after the real-time read
+    // that provided the current data, in nanoseconds; the FPGA sampled the data between these times.
+    int64_t readHostTimeBefore;
+    int64_t readHostTimeAfter;
+    void SetReadHostTime(int64_t before, int64_t after)
+    { readHostTimeBefore = before; readHostTimeAfter = after; }
+
+    // Number of real-time reads since the read data was last updated (0 if updated by the last
+    // read), e.g., when the board is not read every cycle (see BasePort::SetBoardRateDivisor)
+    unsigned int readAge;
+
     // Following methods are for real-time block writes
     void SetWriteValid(bool flag)
     { writeValid = flag; if (!writeValid) numWriteErrors++; }
@@ -83,15 +104,56 @@ protected:
     virtual bool WriteBufferResetsWatchdog(void) const = 0;
     virtual void CheckCollectCallback() = 0;
 
+    // Deferred (non-real-time) quadlet writes. When enabled (see SetDeferredWrites), register writes
+    // such as AmpIO::WriteDigitalOutput are placed in this queue rather than being sent immediately;
+    // the port then sends them at the end of WriteAllBoards, so that they do not add unpredictable
+    // latency to the real-time loop.
+    enum { DEFERRED_QUEUE_SIZE = 32 };
+    struct DeferredWrite {
+        nodeaddr_t addr;
+        quadlet_t data;
+    };
+    DeferredWrite deferredQueue[DEFERRED_QUEUE_SIZE];
+    unsigned int deferredHead;       // index of oldest entry
+    unsigned int deferredCount;      // number of entries in queue
+    bool deferWrites;
+    unsigned int numDeferredOverflows;
+
+    // Add write to queue; returns false if queue is full. A write that is identical to the
+    // most recently queued write is dropped, except for the status/control register (0),
+    // where the order of writes matters (e.g., amplifier and power enable).
+    bool QueueDeferredWrite(nodeaddr_t addr, quadlet_t data)
+    {
+        if ((deferredCount > 0) && (addr != 0)) {
+            const DeferredWrite &last = deferredQueue[(deferredHead+deferredCount-1)%DEFERRED_QUEUE_SIZE];
+            if ((last.addr == addr) && (last.data == data))
+                return true;
+        }
+        if (deferredCount >= DEFERRED_QUEUE_SIZE) {
+            numDeferredOverflows++;
+            return false;
+        }
+        DeferredWrite &entry = deferredQueue[(deferredHead+deferredCount)%DEFERRED_QUEUE_SIZE];
+        entry.addr = addr;
+        entry.data = data;
+        deferredCount++;
+        return true;
+    }
+
 public:
     enum {MAX_BOARDS = 16};   // Maximum number of boards
+    enum {MAX_CHANNELS = 15}; // Maximum number of channels per board (4-bit count in status)
 
     BoardIO(unsigned char board_id) : BoardId(board_id), port(0), readValid(false), writeValid(false),
-                                      numReadErrors(0), numWriteErrors(0) {}
+                                      numReadErrors(0), numWriteErrors(0), readHostTimeBefore(0), readHostTimeAfter(0), readAge(0),
+                                      deferredHead(0), deferredCount(0), deferWrites(false), numDeferredOverflows(0) {}
     virtual ~BoardIO() {}
 
     inline unsigned char GetBoardId() const { return BoardId; }
 
+    // Returns port to which board has been added (0 if none)
+    inline BasePort *GetPort() const { return port; }
+
     // Returns true if a valid board
     inline bool IsValid() const { return (BoardId < MAX_BOARDS); }
 
@@ -101,11 +163,45 @@ public:
     inline unsigned int GetReadErrors() const { return numReadErrors; }
     inline unsigned int GetWriteErrors() const { return numWriteErrors; }
 
+    // Host time interval (nanoseconds) of the last valid real-time read (see ClockSync)
+    inline int64_t GetReadHostTimeBefore() const { return readHostTimeBefore; }
+    inline int64_t GetReadHostTimeAfter() const { return readHostTimeAfter; }
+
+    // Returns true if the read data was not updated by the last real-time read, either because
+    // the board was not scheduled for that cycle (see BasePort::SetBoardRateDivisor) or because
+    // the read failed; GetReadAge returns the number of reads since the data was updated.
+    inline bool IsReadStale() const { return (readAge > 0); }
+    inline unsigned int GetReadAge() const { return readAge; }
+
     inline void ClearReadErrors() { numReadErrors = 0; }
     inline void ClearWriteErrors() { numWriteErrors = 0; }
 
+    // Enable or disable deferred (non-real-time) writes. Disabling does not discard writes
+    // that are already queued; these are sent by the next WriteAllBoards (or by calling
+    // BasePort::FlushDeferredWrites).
+    inline void SetDeferredWrites(bool enable) { deferWrites = enable; }
+    inline bool GetDeferredWrites() const { return deferWrites; }
+
+    // Number of writes currently queued
+    inline unsigned int GetNumDeferredWrites() const { return deferredCount; }
+
+    // Number of times the queue was full (in which case the queue is flushed and the write
+    // is sent immediately)
+    inline unsigned int GetDeferredOverflows() const { return numDeferredOverflows; }
+
     // Returns FPGA clock period in seconds
     virtual double GetFPGAClockPeriod(void) const = 0;
+
+    // Returns number of channels (axes); this must match the value reported in the
+    // status register, which also determines the size of the real-time read data
+    virtual unsigned int GetNumChannels(void) const = 0;
+
+    // Encoder position (counts, relative to midrange), velocity (counts/sec) and acceleration
+    // (counts/sec^2) from the last real-time read, for classes that do not depend on the board
+    // type (e.g., SampleAligner). Boards that do not estimate velocity or acceleration return 0.
+    virtual int32_t GetEncoderPosition(unsigned int index) const = 0;
+    virtual double GetEncoderVelocityPredicted(unsigned int, double = 1.0) const { return 0.0; }
+    virtual double GetEncoderAcceleration(unsigned int, double = 1.0) const { return 0.0; }
 };
 
 #endif // __BOARDIO_H__
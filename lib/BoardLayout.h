@@ -0,0 +1,78 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef __BoardLayout_H__
+#define __BoardLayout_H__
+
+/*
+ * RealTimeLayout
+ *
+ * Layout of the real-time block read and write buffers for a board with NCH channels.
+ * All values are compile-time constants (in quadlets), so that board classes for
+ * different channel counts can share the same decoding code without runtime overhead
+ * (see RealTimeBoard, which is the base class of AmpIO and RealTimeIO8).
+ *
+ * The read buffer consists of 4 header quadlets (timestamp, status, digital I/O and
+ * temperature), followed by 6 groups of NCH quadlets (motor current/analog pot, encoder
+ * position, velocity, quarter-cycle periods and running counter). Prior to Firmware Rev 7,
+ * the last 2 groups were not present.
+ *
+ * The write buffer consists of one quadlet per channel (motor current), followed by the
+ * control register (power control).
+ *
+ * For the broadcast read (Rev 7+), the hub contains one block per board, consisting of
+ * a sequence/timing quadlet followed by the read buffer (HUB_BLOCK_SIZE).
+ */
+
+template <unsigned int NCH>
+struct RealTimeLayout
+{
+    enum {
+        NUM_CHANNELS      = NCH,
+
+        // Offsets of real-time read buffer contents
+        TIMESTAMP_OFFSET  = 0,        // one quadlet
+        STATUS_OFFSET     = 1,        // one quadlet
+        DIGIO_OFFSET      = 2,        // digital I/O (one quadlet)
+        TEMP_OFFSET       = 3,        // temperature (one quadlet)
+        MOTOR_CURR_OFFSET = 4,        // half quadlet per channel (lower half)
+        ANALOG_POS_OFFSET = 4,        // half quadlet per channel (upper half)
+        ENC_POS_OFFSET    = 4+NCH,    // one quadlet per channel
+        ENC_VEL_OFFSET    = 4+2*NCH,  // one quadlet per channel
+        ENC_FRQ_OFFSET    = 4+3*NCH,  // one quadlet per channel
+        ENC_QTR1_OFFSET   = 4+3*NCH,  // one quadlet per channel
+        ENC_QTR5_OFFSET   = 4+4*NCH,  // one quadlet per channel
+        ENC_RUN_OFFSET    = 4+5*NCH,  // one quadlet per channel
+
+        // Sizes of real-time read buffer
+        READ_SIZE_OLD     = 4+4*NCH,  // Firmware Rev 1-6
+        READ_SIZE         = 4+6*NCH,  // Firmware Rev 7+
+
+        // Offsets of real-time write buffer contents
+        WB_CURR_OFFSET    = 0,        // one quadlet per channel
+        WB_CTRL_OFFSET    = NCH,      // control register (power control)
+
+        // Size of real-time write buffer
+        WRITE_SIZE        = NCH+1,
+
+        // Size of per-board block in broadcast hub data (Rev 7+)
+        HUB_BLOCK_SIZE    = 1+READ_SIZE
+    };
+};
+
+// Layout for QLA (4 channels)
+typedef RealTimeLayout<4> QLA_Layout;
+
+#endif // __BoardLayout_H__
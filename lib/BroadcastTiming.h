@@ -0,0 +1,131 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef __BroadcastTiming_H__
+#define __BroadcastTiming_H__
+
+#include <iostream>
+#include <vector>
+#include "BasePort.h"
+
+/*
+ * BroadcastTimingAnalyzer
+ *
+ * Collects the BroadcastReadInfo from each ReadAllBoardsBroadcast cycle (Firmware Rev 7+)
+ * into a rolling window of fixed size and computes distributions of:
+ *
+ *   - hub fill time: time (after the broadcast query) when the last board updated its
+ *     data in the hub, i.e., the maximum BroadcastBoardInfo::updateTime
+ *   - read slack: readStartTime minus the hub fill time; negative values indicate that
+ *     the PC started reading the hub before all boards had updated (see WaitBroadcastRead)
+ *     (hub fill time and read slack are not available for cycles where no board returned
+ *     the current sequence number)
+ *   - read time: readFinishTime minus readStartTime
+ *   - per-board update skew: updateTime of each board minus the earliest updateTime
+ *
+ * It also counts sequence gaps (received sequence number different from readSequence) and
+ * flags boards that are "late" (data updated after the PC started reading, or a sequence gap)
+ * in more than a specified fraction of the cycles in the window. Boards that were not included
+ * in the broadcast query (BroadcastReadInfo::queryMask) are not counted for that cycle.
+ *
+ * Typical use:
+ *     port->ReadAllBoards();
+ *     analyzer.Update(port->GetBroadcastReadInfo());
+ *     ...
+ *     analyzer.Print(std::cout);    // e.g., once per second
+ */
+
+class BroadcastTimingAnalyzer
+{
+public:
+    struct Stats {
+        unsigned int count;
+        double min;
+        double max;
+        double mean;
+        double p50;
+        double p95;
+        double p99;
+
+        Stats() : count(0), min(0.0), max(0.0), mean(0.0), p50(0.0), p95(0.0), p99(0.0) {}
+        // Print statistics, scaled by factor (e.g., 1e6 for microseconds)
+        void Print(std::ostream &out, double factor = 1e6) const;
+    };
+
+    BroadcastTimingAnalyzer(unsigned int windowSize = 1000);
+    ~BroadcastTimingAnalyzer() {}
+
+    void Reset(void);
+
+    // Add data from the latest broadcast read. Repeated calls with the same readSequence
+    // (i.e., without a new broadcast read) are ignored.
+    void Update(const BasePort::BroadcastReadInfo &info);
+
+    // Number of cycles in the window and since Reset
+    unsigned int GetNumCycles(void) const { return numInWindow; }
+    unsigned long GetTotalCycles(void) const { return totalCycles; }
+
+    Stats GetHubFillTime(void) const;
+    Stats GetReadSlack(void) const;
+    Stats GetReadTime(void) const;
+    Stats GetBoardSkew(unsigned int boardNum) const;
+
+    // Number of sequence gaps for the specified board in the window and since Reset
+    unsigned int GetSequenceGaps(unsigned int boardNum) const;
+    unsigned long GetTotalSequenceGaps(unsigned int boardNum) const;
+
+    // Fraction of cycles in the window where the specified board was late
+    double GetLateFraction(unsigned int boardNum) const;
+
+    // A board is flagged as consistently late if GetLateFraction exceeds this threshold (default 0.01)
+    void SetLateThreshold(double fraction) { lateThreshold = fraction; }
+    bool IsBoardLate(unsigned int boardNum) const;
+
+    // Returns mask of boards that are consistently late
+    unsigned int GetLateBoardMask(void) const;
+
+    void Print(std::ostream &out) const;
+
+protected:
+    unsigned int windowSize;
+    unsigned int nextIndex;       // next entry in circular buffers
+    unsigned int numInWindow;
+    unsigned long totalCycles;
+    unsigned int lastSequence;
+    double lateThreshold;
+
+    unsigned int boardMask;       // boards that have been seen in the window
+
+    // Circular buffers (windowSize entries)
+    std::vector<double> hubFill;
+    std::vector<double> readSlack;
+    std::vector<double> readTime;
+    std::vector<unsigned char> cycleFlags;   // FLAG_VALID if hubFill and readSlack are valid
+    std::vector<float> skew[BoardIO::MAX_BOARDS];
+    std::vector<unsigned char> flags[BoardIO::MAX_BOARDS];   // FLAG_xxx
+
+    enum { FLAG_VALID = 0x01, FLAG_GAP = 0x02, FLAG_LATE = 0x04 };
+
+    // Running counts over the window
+    unsigned int numGaps[BoardIO::MAX_BOARDS];
+    unsigned int numLate[BoardIO::MAX_BOARDS];
+    unsigned int numValid[BoardIO::MAX_BOARDS];
+    unsigned long totalGaps[BoardIO::MAX_BOARDS];
+
+    template <class T>
+    Stats ComputeStats(const std::vector<T> &data, const std::vector<unsigned char> *valid = 0) const;
+};
+
+#endif // __BroadcastTiming_H__
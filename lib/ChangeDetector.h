@@ -0,0 +1,153 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef __ChangeDetector_H__
+#define __ChangeDetector_H__
+
+#include <iostream>
+#include <vector>
+#include "BoardIO.h"
+
+class BasePort;
+class AmpIO;
+
+/*
+ * ChangeDetector
+ *
+ * Detects changes (edges) in the status and digital input words of all boards on a port,
+ * so that applications do not have to poll GetStatus, GetDigitalInput, GetPowerStatus,
+ * GetAmpStatus, the limit/home switch getters, etc., for every board in every cycle.
+ *
+ * Update should be called after each ReadAllBoards. It compares the words of all boards
+ * with the previous cycle in one pass over a contiguous array (XOR with the previous value,
+ * AND with the word mask, OR over all boards), so a cycle without changes costs little more
+ * than copying the words. For each changed word, an event (see StatusEdge) is added to the
+ * event queue and passed to the callbacks whose board, word and bit mask match.
+ *
+ * Boards without valid read data are skipped (their previous value is kept), and the first
+ * valid read of a board only sets the previous value (i.e., does not generate an event).
+ *
+ * By default, the digital input mask excludes the encoder A, B and index bits, which change
+ * whenever an axis moves (see SetMask).
+ *
+ * The event queue is a fixed-size ring buffer; when it is full, new events are dropped
+ * (see GetNumDropped), but callbacks are still called. The queue and callbacks are not
+ * thread-safe; Update, GetEvent and the callback registration should be called from the
+ * thread that calls ReadAllBoards.
+ *
+ * Typical use:
+ *     port->ReadAllBoards();
+ *     detector.Update();
+ *     StatusEdge edge;
+ *     while (detector.GetEvent(edge)) { ... }
+ */
+
+// Words that are compared
+enum StatusWord { WORD_STATUS, WORD_DIGITAL_INPUT, NUM_STATUS_WORDS };
+
+struct StatusEdge {
+    unsigned char boardNum;
+    StatusWord word;
+    quadlet_t previous;              // previous value (masked)
+    quadlet_t current;               // current value (masked)
+    double firmwareTime;             // AmpIO::GetFirmwareTime of the read (seconds)
+    int64_t hostTime;                // host time after the read (ns, see Amp1394_GetMonotonicTime)
+
+    StatusEdge() : boardNum(0), word(WORD_STATUS), previous(0), current(0), firmwareTime(0.0), hostTime(0) {}
+
+    quadlet_t Changed(void) const { return previous^current; }
+    quadlet_t Rising(void) const { return ~previous&current; }
+    quadlet_t Falling(void) const { return previous&~current; }
+};
+
+class ChangeDetector
+{
+public:
+    enum { ALL_BOARDS = BoardIO::MAX_BOARDS };
+    enum { EVENT_QUEUE_SIZE = 64 };
+
+    // Callback for edges; called by Update
+    typedef void (*EdgeCallback)(const StatusEdge &edge, void *userData);
+
+protected:
+    BasePort *port;
+    std::ostream &outStr;
+
+    // Boards on port (cached, so that dynamic_cast is only needed when boards change)
+    const BoardIO *boardIO[BoardIO::MAX_BOARDS];
+    const AmpIO *boards[BoardIO::MAX_BOARDS];
+
+    quadlet_t mask[NUM_STATUS_WORDS];
+    // Current and previous words, indexed by word and board number
+    quadlet_t cur[NUM_STATUS_WORDS][BoardIO::MAX_BOARDS];
+    quadlet_t prev[NUM_STATUS_WORDS][BoardIO::MAX_BOARDS];
+    unsigned int prevValidMask;      // boards with valid previous value
+
+    struct Subscription {
+        EdgeCallback callback;
+        void *userData;
+        unsigned int boardNum;       // or ALL_BOARDS
+        StatusWord word;
+        quadlet_t bits;              // callback only called if one of these bits changed
+    };
+    std::vector<Subscription> subscriptions;
+
+    StatusEdge eventQueue[EVENT_QUEUE_SIZE];
+    unsigned int eventHead;          // index of oldest entry
+    unsigned int eventCount;         // number of entries in queue
+    unsigned long numEvents;
+    unsigned long numDropped;
+
+    void AddEvent(const StatusEdge &edge);
+
+public:
+    ChangeDetector(BasePort *port, std::ostream &debugStream = std::cerr);
+    ~ChangeDetector() {}
+
+    // Mask of bits that are compared (default 0xffffffff for status and 0x0000ffff for digital
+    // input, i.e., home, limit switches and digital outputs)
+    void SetMask(StatusWord word, quadlet_t bits);
+    quadlet_t GetMask(StatusWord word) const;
+
+    // Register callback for changes of the specified bits (all bits in mask by default) of
+    // the specified word, on the specified board (or all boards). Returns false if invalid.
+    bool AddCallback(EdgeCallback cb, void *userData, unsigned int boardNum = ALL_BOARDS,
+                     StatusWord word = WORD_STATUS, quadlet_t bits = 0xffffffff);
+    // Remove all registrations of the callback with the specified user data
+    void RemoveCallback(EdgeCallback cb, void *userData);
+
+    // Compare the data from the last real-time read with the previous read. Returns the
+    // number of edges (changed words) detected.
+    unsigned int Update(void);
+
+    // Forget the previous values (not needed when boards are added or removed)
+    void Reset(void) { prevValidMask = 0; }
+
+    // Get the oldest event from the queue; returns false if empty
+    bool GetEvent(StatusEdge &edge);
+    unsigned int GetNumQueued(void) const { return eventCount; }
+    void ClearEvents(void) { eventHead = 0; eventCount = 0; }
+
+    // Total number of events detected, and number not queued because the queue was full
+    unsigned long GetNumEvents(void) const { return numEvents; }
+    unsigned long GetNumDropped(void) const { return numDropped; }
+
+    static const char *WordString(StatusWord word);
+
+    // Print description of edge
+    static void PrintEdge(std::ostream &outStr, const StatusEdge &edge);
+};
+
+#endif // __ChangeDetector_H__
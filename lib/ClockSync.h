@@ -0,0 +1,133 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef __ClockSync_H__
+#define __ClockSync_H__
+
+#include <iostream>
+#include <vector>
+#include "BoardIO.h"
+
+class AmpIO;
+
+/*
+ * ClockSync
+ *
+ * Estimates the offset and drift between the FPGA clock of a board and the host monotonic
+ * clock (Amp1394_GetMonotonicTime), so that the data from different boards (and other
+ * host-timestamped data) can be aligned.
+ *
+ * Each real-time read provides one observation: the FPGA tick count of the sample
+ * (AmpIO::GetFirmwareTicks) and the host time interval during which the sample was taken
+ * (BoardIO::GetReadHostTimeBefore/After). Because the interval width varies with OS and
+ * bus latency, only the observation with the narrowest interval in each block of
+ * consecutive observations is kept (min filter). A least-squares line through the kept
+ * points (midpoint of interval vs. ticks) gives the drift and offset.
+ *
+ * All times are integers (FPGA ticks and host nanoseconds); the fit is computed relative
+ * to the most recent kept point, so the conversion does not lose resolution over long runs.
+ *
+ * A step in the relationship (e.g., if a read was lost after the FPGA cleared its timestamp
+ * counter, or the board was rebooted) is detected when a new point is far from the fit;
+ * the estimator then restarts from that point.
+ *
+ * Typical use (one ClockSync per board):
+ *     port->ReadAllBoards();
+ *     sync.Update(board);
+ *     int64_t hostTime, errorBound;
+ *     sync.GetHostTime(board, hostTime, errorBound);
+ */
+
+class ClockSync
+{
+public:
+    // tickPeriod: nominal FPGA clock period, in seconds (see BoardIO::GetFPGAClockPeriod)
+    // blockSize: number of observations in each min-filter block
+    // numPoints: number of min-filtered points used for the fit
+    ClockSync(double tickPeriod = 1.0/49.152e6, unsigned int blockSize = 16, unsigned int numPoints = 64);
+    ~ClockSync() {}
+
+    void Reset(void);
+
+    // Add an observation: FPGA ticks of the sample and host time (ns) before and after the read.
+    // Returns true if a new point was added to the fit.
+    bool AddObservation(uint64_t ticks, int64_t hostBefore, int64_t hostAfter);
+
+    // Add the observation from the last real-time read of the board (ignored if the read was not valid)
+    bool Update(const AmpIO &board);
+
+    // Returns true if there is at least one point (i.e., conversions are possible)
+    bool IsValid(void) const { return !points.empty(); }
+
+    // Convert FPGA ticks to host time (ns). The errorBound (ns) is an estimate of the maximum error,
+    // based on the interval widths, the fit residuals and the time since the last point.
+    bool ToHostTime(uint64_t ticks, int64_t &hostTime, int64_t &errorBound) const;
+
+    // Host time of the last real-time read of the board
+    bool GetHostTime(const AmpIO &board, int64_t &hostTime, int64_t &errorBound) const;
+
+    // Estimated drift of the FPGA clock relative to the host clock, in ppm (positive if FPGA is slow)
+    double GetDrift(void) const;
+
+    // Estimated FPGA clock period in seconds, in host time
+    double GetTickPeriod(void) const { return slope*1e-9; }
+
+    // Time step threshold (ns) for restarting the estimator (default is 200 usec)
+    void SetStepThreshold(int64_t ns) { stepThreshold = ns; }
+
+    unsigned int GetNumPoints(void) const { return static_cast<unsigned int>(points.size()); }
+    unsigned long GetNumObservations(void) const { return numObservations; }
+    unsigned int GetNumRestarts(void) const { return numRestarts; }
+
+    // Interval half-width (ns) of the most accurate point
+    int64_t GetMinHalfWidth(void) const;
+
+    void Print(std::ostream &out) const;
+
+protected:
+    struct Point {
+        uint64_t ticks;
+        int64_t host;        // midpoint of host time interval
+        int64_t halfWidth;   // half-width of host time interval
+    };
+
+    double nominalSlope;         // nominal ns per tick
+    unsigned int blockSize;
+    unsigned int maxPoints;
+    int64_t stepThreshold;
+
+    uint64_t lastTicks;          // ticks of last observation
+    Point blockBest;             // best observation in current block
+    unsigned int blockCount;     // number of observations in current block
+
+    std::vector<Point> points;   // circular buffer of min-filtered points
+    unsigned int nextIndex;
+    unsigned int newestIndex;
+
+    // Fit: host = points[newestIndex].host + offset + slope*(ticks-points[newestIndex].ticks)
+    double offset;
+    double slope;
+    int64_t maxResidual;
+    int64_t maxHalfWidth;
+    double tickSpan;             // ticks between oldest and newest point
+
+    unsigned long numObservations;
+    unsigned int numRestarts;
+
+    void AddPoint(const Point &pt);
+    void ComputeFit(void);
+};
+
+#endif // __ClockSync_H__
@@ -0,0 +1,164 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef __ControlLoop_H__
+#define __ControlLoop_H__
+
+#include <iostream>
+#include "BasePort.h"
+
+/*
+ * ControlLoop
+ *
+ * Runs the cycle ReadAllBoards, user callback, WriteAllBoards on a port at a fixed period.
+ * The start of each cycle is scheduled at an absolute deadline on the monotonic clock
+ * (deadline[k+1] = deadline[k] + period), so that the rate does not drift due to the time
+ * spent in the cycle or sleep inaccuracies. A period of 0 runs the cycle as fast as possible.
+ *
+ * An overrun occurs when a cycle ends after the deadline of the next cycle. The overrun
+ * policy determines how the schedule is adjusted:
+ *   OVERRUN_SKIP      The missed deadlines are skipped, so the next cycle starts at the next
+ *                     deadline that is in the future (i.e., the loop stays on the original
+ *                     time grid, but some periods have no cycle).
+ *   OVERRUN_CATCH_UP  The missed cycles are run immediately, back-to-back, until the loop is
+ *                     back on schedule. If the loop is more than maxCatchUp periods late,
+ *                     the remaining missed deadlines are skipped.
+ *   OVERRUN_DEGRADE   The period is increased by degradeFactor (up to maxDegrade times the
+ *                     nominal period) and the schedule restarts from the current time. The
+ *                     period is decreased again by the same factor after recoverCycles
+ *                     consecutive cycles without overrun.
+ *
+ * The statistics (see ControlLoopStats) include the wakeup latency (cycle start time minus
+ * deadline, not including late starts, e.g., when catching up), the period error (time
+ * between cycle starts minus the current period), the cycle execution time and the overruns.
+ *
+ * The loop runs in the calling thread, and can be stopped by the callback (by returning false
+ * or by calling Stop).
+ */
+
+struct ControlLoopStats {
+    unsigned long numCycles;
+    unsigned long numReadFailures;     // ReadAllBoards returned false
+    unsigned long numWriteFailures;    // WriteAllBoards returned false
+    unsigned long numOverruns;         // cycles that ended after the next deadline (for
+                                       // OVERRUN_CATCH_UP, each missed deadline is counted once)
+    unsigned long numSkipped;          // deadlines skipped (OVERRUN_SKIP or OVERRUN_CATCH_UP)
+    unsigned long numLateStarts;       // cycles started more than one period after their deadline
+    unsigned long numDegrades;         // period increases (OVERRUN_DEGRADE)
+    double maxOverrun;                 // longest overrun (seconds)
+    double sumOverrun;                 // sum of overruns (seconds)
+    double maxLatency;                 // maximum wakeup latency (seconds)
+    double sumLatency;                 // sum of wakeup latencies (seconds)
+    double minPeriodError;             // minimum period error (seconds)
+    double maxPeriodError;             // maximum period error (seconds)
+    double sumSqPeriodError;           // sum of squared period errors (seconds^2)
+    unsigned long numPeriods;          // number of period measurements
+    double maxCycleTime;               // maximum time from cycle start to end of write (seconds)
+    double sumCycleTime;               // sum of cycle times (seconds)
+
+    ControlLoopStats() { Clear(); }
+    void Clear(void);
+
+    double GetMeanLatency(void) const
+    { return (numCycles > numLateStarts) ? sumLatency/(numCycles-numLateStarts) : 0.0; }
+    double GetMeanCycleTime(void) const { return numCycles ? sumCycleTime/numCycles : 0.0; }
+    double GetMeanOverrun(void) const { return numOverruns ? sumOverrun/numOverruns : 0.0; }
+    // RMS period error (jitter)
+    double GetPeriodJitter(void) const;
+
+    // Print summary of statistics
+    void Print(std::ostream &outStr) const;
+};
+
+class ControlLoop
+{
+public:
+    enum OverrunPolicy { OVERRUN_SKIP, OVERRUN_CATCH_UP, OVERRUN_DEGRADE };
+
+    // Callback, called each cycle between ReadAllBoards and WriteAllBoards.
+    // Returns false to stop the loop (after WriteAllBoards).
+    typedef bool (*CycleCallback)(ControlLoop &loop, void *userData);
+
+protected:
+    BasePort *port;
+    std::ostream &outStr;
+    CycleCallback callback;
+    void *callbackData;
+    int64_t period;                 // nominal period (ns)
+    int64_t curPeriod;              // current period (ns), differs from period if degraded
+    OverrunPolicy policy;
+    unsigned int maxCatchUp;
+    double degradeFactor;
+    double maxDegrade;
+    unsigned int recoverCycles;
+    unsigned int goodCycles;        // consecutive cycles without overrun
+    bool running;
+    int64_t deadline;               // deadline of current cycle (ns)
+    int64_t backlogEnd;             // latest deadline already counted as missed (ns)
+    int64_t cycleStart;             // start time of current cycle (ns)
+    int64_t lastStart;              // start time of previous cycle (ns), 0 if none
+    ControlLoopStats stats;
+
+    // Update schedule after cycle that ended at endTime
+    void UpdateSchedule(int64_t endTime);
+
+public:
+    // period in seconds (0 to run as fast as possible)
+    ControlLoop(BasePort *port, double period, std::ostream &debugStream = std::cerr);
+    ~ControlLoop() {}
+
+    void SetCallback(CycleCallback cb, void *userData = 0)
+    { callback = cb; callbackData = userData; }
+
+    // Nominal period, in seconds
+    void SetPeriod(double sec);
+    double GetPeriod(void) const { return period*1.0e-9; }
+    // Current period (larger than nominal period if degraded), in seconds
+    double GetCurrentPeriod(void) const { return curPeriod*1.0e-9; }
+
+    void SetOverrunPolicy(OverrunPolicy newPolicy) { policy = newPolicy; }
+    OverrunPolicy GetOverrunPolicy(void) const { return policy; }
+
+    // Maximum number of missed cycles to run for OVERRUN_CATCH_UP (default 10)
+    void SetMaxCatchUp(unsigned int num) { maxCatchUp = num; }
+
+    // Parameters for OVERRUN_DEGRADE: period is multiplied by factor on overrun, up to
+    // maxFactor times the nominal period, and divided by factor after numCycles without
+    // overrun (defaults: 1.25, 4.0, 1000)
+    void SetDegradeParameters(double factor, double maxFactor, unsigned int numCycles);
+
+    // Run the loop for the specified number of cycles (0 until stopped). Returns false
+    // if the port is not valid.
+    bool Run(unsigned long numCycles = 0);
+
+    // Stop the loop (e.g., from the callback); takes effect at the end of the current cycle
+    void Stop(void) { running = false; }
+    bool IsRunning(void) const { return running; }
+
+    BasePort *GetPort(void) const { return port; }
+
+    // Number of current cycle (starting at 0), and its start time and deadline on the
+    // monotonic clock (ns)
+    unsigned long GetCycleNumber(void) const { return stats.numCycles; }
+    int64_t GetCycleStartTime(void) const { return cycleStart; }
+    int64_t GetCycleDeadline(void) const { return deadline; }
+
+    const ControlLoopStats &GetStats(void) const { return stats; }
+    void ClearStats(void) { stats.Clear(); lastStart = 0; }
+
+    static std::string OverrunPolicyString(OverrunPolicy policy);
+};
+
+#endif // __ControlLoop_H__
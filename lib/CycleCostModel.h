@@ -0,0 +1,144 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef __CycleCostModel_H__
+#define __CycleCostModel_H__
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "BasePort.h"
+
+/*
+ * CycleCostModel
+ *
+ * Model of the time required for one control cycle (ReadAllBoards followed by WriteAllBoards),
+ * based on the cost of the individual transactions, which are measured on the current host
+ * and port (Measure). The model can then predict the cycle time of other configurations
+ * (Predict), i.e., different number of boards, firmware versions, protocols and number of
+ * ports, so that it can be used for capacity planning. The model can be saved and loaded,
+ * so that predictions can also be made without the hardware.
+ *
+ * The cost of block transactions is modeled as a fixed cost plus a cost per byte, which is
+ * fit to measurements with different sizes. The model for each protocol is:
+ *   SEQ_RW:      read:  block read per board
+ *                write: block write per board (plus control quadlet for firmware < Rev 7)
+ *   SEQ_R_BC_W:  read:  block read per board
+ *                write: one broadcast write (plus control quadlet for firmware < Rev 7)
+ *   BC_QRW:      read:  broadcast read request, wait (the larger of WaitBroadcastRead,
+ *                       including the sleep overhead, and the firmware hub fill time),
+ *                       and one block read of the hub data
+ *                write: same as SEQ_R_BC_W
+ * In all cases, the host decode (read) and encode (write) times per board are added; these
+ * are measured directly, without transactions. When there are multiple ports, the
+ * boards are distributed evenly and the ports are assumed to be serviced sequentially (i.e.,
+ * from one thread), so the cycle time is the sum over the ports.
+ *
+ * All times are in seconds, and are median values.
+ */
+
+// Cost that depends linearly on the number of bytes
+struct LinearCost {
+    double fixed;
+    double perByte;
+
+    LinearCost() : fixed(0.0), perByte(0.0) {}
+    double Eval(unsigned int nbytes) const { return fixed + perByte*nbytes; }
+
+    // Least-squares fit to samples; if only one size was measured, perByte is 0
+    bool Fit(const std::vector<unsigned int> &nbytes, const std::vector<double> &times);
+};
+
+// Configuration for which cycle time is predicted
+struct CyclePlanConfig {
+    unsigned int numBoards;          // total number of boards
+    unsigned int numOldBoards;       // number of boards with firmware prior to Rev 7
+    unsigned int numPorts;
+    BasePort::ProtocolType protocol;
+
+    CyclePlanConfig(unsigned int boards = 1, unsigned int oldBoards = 0, unsigned int ports = 1,
+                    BasePort::ProtocolType prot = BasePort::PROTOCOL_SEQ_RW) :
+        numBoards(boards), numOldBoards(oldBoards), numPorts(ports), protocol(prot) {}
+};
+
+// Predicted cycle time
+struct CyclePrediction {
+    bool valid;
+    std::string reason;              // why configuration is not valid
+    double readTime;                 // ReadAllBoards time for the slowest port
+    double writeTime;                // WriteAllBoards time for the slowest port
+    double cycleTime;                // total cycle time (all ports)
+
+    CyclePrediction() : valid(false), readTime(0.0), writeTime(0.0), cycleTime(0.0) {}
+};
+
+class CycleCostModel
+{
+public:
+    struct Costs {
+        std::string portType;        // port used for measurements (e.g., "Ethernet-UDP")
+        unsigned int maxReadDataSize;
+        unsigned int maxWriteDataSize;
+        double quadRead;             // quadlet read (round trip)
+        double quadWrite;            // quadlet write
+        LinearCost blockRead;        // block read (round trip)
+        LinearCost blockWrite;       // block write to one board
+        LinearCost bcWrite;          // broadcast write (WriteBroadcastOutput)
+        double bcReadRequest;        // broadcast read request (WriteBroadcastReadRequest)
+        double sleepOverhead;        // actual minus requested time for WaitBroadcastRead sleep
+        bool bcWaitSleeps;           // whether WaitBroadcastRead sleeps (false for SimulatedPort)
+        double hubFillPerBoard;      // firmware time to fill hub, per board
+        double decodePerBoard;       // host time to process the read data (SetReadData), per board
+        double encodePerBoard;       // host time to prepare the write data (GetWriteData), per board
+
+        Costs();
+    };
+
+protected:
+    Costs costs;
+    bool isValid;
+
+public:
+    CycleCostModel() : isValid(false) {}
+    ~CycleCostModel() {}
+
+    // Measure the transaction costs, using the boards that have been added to the port.
+    // Each cost is measured numSamples times. The broadcast costs are only measured if all
+    // boards have firmware Rev 7+. This temporarily changes the protocol of the port (it is
+    // restored), and should not be used while the amplifiers are enabled. The decode time is
+    // measured by replaying stored real-time data, which also adds the replayed timestamps to
+    // the firmware time of the boards (e.g., AmpIO::GetFirmwareTime).
+    bool Measure(BasePort *port, unsigned int numSamples = 200, std::ostream &debugStream = std::cerr);
+
+    bool IsValid(void) const { return isValid; }
+
+    const Costs &GetCosts(void) const { return costs; }
+    void SetCosts(const Costs &newCosts) { costs = newCosts; isValid = true; }
+
+    // Predict cycle time for the specified configuration
+    CyclePrediction Predict(const CyclePlanConfig &config) const;
+
+    // Save/load costs (text file)
+    bool Save(const std::string &fileName) const;
+    bool Load(const std::string &fileName, std::ostream &debugStream = std::cerr);
+
+    void Print(std::ostream &outStr) const;
+
+    // Time requested by WaitBroadcastRead for the specified number of boards (shorter wait)
+    static double NominalBroadcastWait(unsigned int numBoards)
+    { return (10.0 + 5.0*numBoards)*1.0e-6; }
+};
+
+#endif // __CycleCostModel_H__
@@ -0,0 +1,144 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef __CycleLog_H__
+#define __CycleLog_H__
+
+#include <iostream>
+#include <string>
+#include "BoardIO.h"
+#include "BoardLayout.h"
+
+class BasePort;
+
+/*
+ * CycleLog
+ *
+ * Binary log of the raw buffers of the broadcast protocol: for each cycle, the hub read data
+ * (as read by ReadAllBoardsBroadcast, before decoding) and the broadcast write data (as sent by
+ * WriteAllBoardsBroadcast), together with host times (see Amp1394_GetMonotonicTime). The log is
+ * enabled via BasePort::SetCycleLog.
+ *
+ * The log file is preallocated and memory-mapped when it is opened, and is organized as a ring
+ * of numSlots fixed-size slots (rolling window), so that logging a cycle only copies the buffers
+ * to memory and the file size does not grow. The kernel writes the mapped pages to disk; Flush
+ * (msync) can be called to force this, but should not be called from the real-time thread.
+ *
+ * The log can be read back with CycleLogPort. Memory mapping is currently only implemented
+ * for Linux/Unix.
+ */
+
+// File header (the first slot starts at headerSize, which is a multiple of the page size)
+struct CycleLogHeader {
+    char magic[8];                 // "AMPCYCLE"
+    uint32_t version;              // CycleLog::VERSION
+    uint32_t headerSize;           // offset of first slot, in bytes
+    uint32_t slotSize;             // size of each slot (entry + data), in bytes
+    uint32_t numSlots;             // number of slots in ring
+    uint32_t maxReadQuads;         // maximum hub read data per slot
+    uint32_t maxWriteQuads;        // maximum broadcast write data per slot
+    uint32_t portType;             // BasePort::PortType
+    uint32_t reserved;
+    uint32_t firmwareVersion[BoardIO::MAX_BOARDS];   // 0 if board not present
+    volatile uint64_t numCycles;   // number of cycles logged (cycle n is in slot n%numSlots)
+};
+
+// Entry at start of each slot, followed by maxReadQuads of hub read data and maxWriteQuads
+// of broadcast write data (in the byte order sent/received on the bus)
+struct CycleLogEntry {
+    volatile uint64_t cycle;       // cycle number (CycleLog::CYCLE_INVALID while slot is written)
+    int64_t readStartTime;         // host time before broadcast read request
+    int64_t readEndTime;           // host time after hub data read
+    int64_t writeTime;             // host time after broadcast write
+    uint32_t readQuads;            // hub read data size (0 if no read this cycle)
+    uint32_t writeQuads;           // broadcast write data size (0 if no write this cycle)
+    uint32_t sequence;             // broadcast read sequence number
+    uint8_t readOK;
+    uint8_t writeOK;
+    uint8_t reserved[2];
+    uint8_t blockQuads[BoardIO::MAX_BOARDS];   // size of each board's block in hub data
+};
+
+class CycleLog
+{
+public:
+    enum { VERSION = 1 };
+
+    // Default maximum buffer sizes (16 QLA boards)
+    enum { DEFAULT_READ_QUADS = 1+BoardIO::MAX_BOARDS*QLA_Layout::HUB_BLOCK_SIZE,
+           DEFAULT_WRITE_QUADS = BoardIO::MAX_BOARDS*QLA_Layout::WRITE_SIZE };
+
+    static const uint64_t CYCLE_INVALID;
+    static const char Magic[8];
+
+    CycleLog(std::ostream &debugStream = std::cerr);
+    ~CycleLog();
+
+    // Create (or overwrite) the log file, with numSlots cycles. The port is used to record the
+    // port type and firmware versions, which are needed to decode the data.
+    bool Open(const std::string &fileName, const BasePort &port, unsigned long numSlots,
+              unsigned int maxReadQuads = DEFAULT_READ_QUADS,
+              unsigned int maxWriteQuads = DEFAULT_WRITE_QUADS);
+
+    // Unmap and close the file
+    void Close(void);
+
+    bool IsOpen(void) const { return (header != 0); }
+
+    const std::string &GetFileName(void) const { return FileName; }
+
+    // Log hub read data; starts a new cycle. Called by ReadAllBoardsBroadcast.
+    // blockQuads contains the size of each board's block in the hub data (MAX_BOARDS entries).
+    void LogRead(const quadlet_t *hubData, unsigned int numQuads, const unsigned int *blockQuads,
+                 unsigned int sequence, int64_t startTime, int64_t endTime, bool ok);
+
+    // Log broadcast write data for the current cycle (starts a new cycle if the current cycle
+    // already has write data). Called by WriteAllBoardsBroadcast.
+    void LogWrite(const quadlet_t *bcData, unsigned int nbytes, int64_t time, bool ok);
+
+    // Write mapped pages to disk (msync); if wait is false, the write is only scheduled.
+    // This should be called from a non real-time thread.
+    bool Flush(bool wait = false);
+
+    // Total number of cycles logged (including those that have been overwritten)
+    uint64_t GetNumCycles(void) const { return header ? header->numCycles : 0; }
+
+    unsigned long GetNumSlots(void) const { return header ? header->numSlots : 0; }
+
+    // Number of buffers that were truncated because they exceeded the maximum size
+    unsigned long GetNumTruncated(void) const { return numTruncated; }
+
+    // Memory mapping of log files (also used by CycleLogPort); returns 0 on failure
+    static void *MapFile(const std::string &fileName, size_t &mapSize, bool create, std::ostream &outStr);
+    static void UnmapFile(void *addr, size_t mapSize);
+
+protected:
+    // Prevent copies
+    CycleLog(const CycleLog &);
+    CycleLog &operator=(const CycleLog &);
+
+    std::ostream &outStr;
+    std::string FileName;
+    CycleLogHeader *header;
+    size_t mapSize;
+    CycleLogEntry *curEntry;
+    unsigned long numTruncated;
+
+    // Start new cycle; returns entry (marked invalid until EndEntry)
+    CycleLogEntry *NewEntry(void);
+    void EndEntry(CycleLogEntry *entry);
+};
+
+#endif // __CycleLog_H__
@@ -0,0 +1,116 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef __CycleLogPort_H__
+#define __CycleLogPort_H__
+
+#include "BasePort.h"
+#include "CycleLog.h"
+
+/*
+ * CycleLogPort
+ *
+ * Offline port for reading a log written by CycleLog. The boards (e.g., AmpIO objects with the
+ * board numbers that were logged) are added to this port as usual; each call to ReadAllBoards
+ * then decodes the next logged cycle into the boards via SetReadData, so that the usual AmpIO
+ * methods (GetEncoderPosition, GetMotorCurrent, etc.) can be used for analysis. The firmware
+ * versions are taken from the log. Cycles without hub read data (e.g., only a broadcast write
+ * was logged) are skipped.
+ *
+ * The cycles are read from the oldest to the newest cycle in the rolling window. All other
+ * transactions (e.g., ReadQuadlet) fail, since there is no hardware.
+ */
+
+class CycleLogPort : public BasePort
+{
+protected:
+    std::string FileName;
+    const CycleLogHeader *header;
+    size_t mapSize;
+    uint64_t curCycle;             // next cycle to be decoded by ReadAllBoards
+    uint64_t lastCycle;            // cycle decoded by last ReadAllBoards
+
+    //****************** BasePort pure virtual methods ***********************
+
+    bool Init(void);
+    void Cleanup(void);
+    nodeid_t InitNodes(void) { return 0; }
+
+    // Sets up node map from log header (instead of scanning the bus)
+    bool ScanNodes(void);
+
+    bool ReadQuadletNode(nodeid_t, nodeaddr_t, quadlet_t &, unsigned char = 0) { return false; }
+    bool WriteQuadletNode(nodeid_t, nodeaddr_t, quadlet_t, unsigned char = 0) { return false; }
+    bool ReadBlockNode(nodeid_t, nodeaddr_t, quadlet_t *, unsigned int, unsigned char = 0) { return false; }
+    bool WriteBlockNode(nodeid_t, nodeaddr_t, quadlet_t *, unsigned int, unsigned char = 0) { return false; }
+
+public:
+    CycleLogPort(const std::string &fileName, std::ostream &debugStream = std::cerr);
+    ~CycleLogPort();
+
+    const CycleLogHeader *GetHeader(void) const { return header; }
+
+    // Range of cycles available in the log (first is the oldest cycle not yet overwritten)
+    uint64_t GetFirstCycle(void) const;
+    uint64_t GetNumCycles(void) const { return header ? header->numCycles : 0; }
+
+    // Returns entry for specified cycle (0 if cycle not available)
+    const CycleLogEntry *GetEntry(uint64_t cycle) const;
+    const quadlet_t *GetReadData(uint64_t cycle) const;
+    const quadlet_t *GetWriteData(uint64_t cycle) const;
+
+    // Set next cycle to be decoded by ReadAllBoards
+    bool Seek(uint64_t cycle);
+
+    // Cycle decoded by the last ReadAllBoards
+    uint64_t GetCurrentCycle(void) const { return lastCycle; }
+
+    bool IsEndOfLog(void) const { return (curCycle >= GetNumCycles()); }
+
+    // Decode the next logged cycle into the boards; returns false at end of log
+    bool ReadAllBoards(void);
+    bool ReadAllBoardsBroadcast(void) { return ReadAllBoards(); }
+
+    // Nothing is written (returns true)
+    bool WriteAllBoards(void) { return true; }
+    bool WriteAllBoardsBroadcast(void) { return true; }
+
+    //****************** BasePort pure virtual methods ***********************
+
+    PortType GetPortType(void) const { return header ? static_cast<PortType>(header->portType) : PORT_ETH_UDP; }
+
+    int NumberOfUsers(void) { return 1; }
+
+    bool IsOK(void) { return (header != 0); }
+
+    unsigned int GetBusGeneration(void) const { return FwBusGeneration; }
+    void UpdateBusGeneration(unsigned int gen) { FwBusGeneration = gen; }
+
+    unsigned int GetPrefixOffset(MsgType) const { return 0; }
+    unsigned int GetWritePostfixSize(void) const { return 0; }
+    unsigned int GetReadPostfixSize(void) const { return 0; }
+    unsigned int GetWriteQuadAlign(void) const { return 0; }
+    unsigned int GetReadQuadAlign(void) const { return 0; }
+
+    unsigned int GetMaxReadDataSize(void) const { return header ? header->maxReadQuads*sizeof(quadlet_t) : 0; }
+    unsigned int GetMaxWriteDataSize(void) const { return header ? header->maxWriteQuads*sizeof(quadlet_t) : 0; }
+
+    bool WriteBroadcastOutput(quadlet_t *, unsigned int) { return false; }
+    bool WriteBroadcastReadRequest(unsigned int) { return false; }
+    void WaitBroadcastRead(void) {}
+    void PromDelay(void) const {}
+};
+
+#endif // __CycleLogPort_H__
@@ -0,0 +1,110 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef __DallasCache_H__
+#define __DallasCache_H__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class AmpIO;
+
+/*
+ * DallasCache
+ *
+ * Persistent (file-based) cache of DS2505 memory contents, as read from an instrument
+ * via AmpIO::DallasReadMemory. Reading the entire 2 Kbyte memory requires 8 one-wire
+ * transactions of 256 bytes each, whereas reading only the first 256 bytes requires one.
+ *
+ * The FPGA does not provide the 48-bit serial number from the DS2505 ROM, so an entry
+ * is identified by the family code (from the Dallas status register) and the contents
+ * of the first 256-byte page, which contains the instrument identification data.
+ * Because the first page does not necessarily identify the chip (e.g., two instruments
+ * of the same type, or an instrument whose calibration data was rewritten), a cached
+ * entry is only used if the last requested page also matches (see Lookup). When an
+ * instrument is re-inserted, ReadMemory therefore only reads two pages.
+ *
+ * Each entry is the complete memory image and its CRC-32. Store only replaces an entry
+ * with an identical image, so different images that share the first page are kept as
+ * separate entries. Entries whose CRC does not match their data are discarded on load.
+ *
+ * The cache file is a sequence of binary records:
+ *     | family code (1) | number of bytes (2) | CRC-32 (4) | data (number of bytes) |
+ * (integers little-endian) following an 8-character file header ("DS2505C2").
+ */
+
+class DallasCache
+{
+public:
+    enum { PAGE_SIZE = 256, MEMORY_SIZE = 2048 };
+
+    DallasCache(const std::string &fileName);
+    ~DallasCache();
+
+    // Read nbytes (not more than MEMORY_SIZE) of DS2505 memory, starting at address 0.
+    // If the instrument is found in the cache, only the first and last pages are read from
+    // the board (to validate the cached entry). Otherwise, the entire memory is read and added
+    // to the cache. If fromCache is not null,
+    // it is set to indicate whether the data was obtained from the cache.
+    bool ReadMemory(AmpIO &board, unsigned char *data, unsigned int nbytes, bool *fromCache = 0);
+
+    // Look up an entry by family code, first page and last page of the nbytes of data, i.e.,
+    // the (possibly partial) page at GetLastPageOffset(nbytes). If found, copies nbytes of
+    // data and returns true. The pages in between are not compared.
+    bool Lookup(unsigned char familyCode, const unsigned char *firstPage, const unsigned char *lastPage,
+                unsigned char *data, unsigned int nbytes);
+
+    // Add an entry and save it to the file, unless an identical entry (same family code
+    // and image) already exists.
+    bool Store(unsigned char familyCode, const unsigned char *data, unsigned int nbytes);
+
+    // Offset of the last (possibly partial) page of nbytes of data (0 if nbytes <= PAGE_SIZE)
+    static unsigned int GetLastPageOffset(unsigned int nbytes)
+    { return (nbytes > 0) ? ((nbytes-1)/PAGE_SIZE)*PAGE_SIZE : 0; }
+
+    // Remove all entries and truncate the file
+    bool Clear(void);
+
+    unsigned int GetNumEntries(void);
+    const std::string &GetFileName(void) const { return FileName; }
+
+protected:
+    struct Entry {
+        unsigned char familyCode;
+        uint32_t checksum;                 // CRC-32 of data
+        std::vector<unsigned char> data;
+    };
+
+    std::string FileName;
+    std::vector<Entry> Entries;
+    bool loaded;
+
+    // Load entries from the file (if not already loaded)
+    void Load(void);
+    // Write all entries to the file
+    bool Save(void) const;
+    // Returns index of the entry with the specified family code whose first page and
+    // tailBytes bytes at tailOffset match, or -1 if not found
+    int Find(unsigned char familyCode, const unsigned char *firstPage, const unsigned char *tail,
+             unsigned int tailOffset, unsigned int tailBytes) const;
+    // Returns index of the entry with the specified family code and image, or -1 if not found
+    int FindImage(unsigned char familyCode, const unsigned char *data, unsigned int nbytes,
+                  uint32_t checksum) const;
+
+    static uint32_t ComputeChecksum(const unsigned char *data, unsigned int nbytes);
+};
+
+#endif // __DallasCache_H__
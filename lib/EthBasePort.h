@@ -218,6 +218,10 @@ public:
 
     static bool checkCRC(const unsigned char *packet);
 
+    // Check FireWire CRC of nbytes of data (header or block data), which must be
+    // followed by the CRC quadlet. Unlike checkCRC, this always computes the CRC.
+    static bool checkCRC32(const unsigned char *data, size_t nbytes);
+
     // Print FireWire packet
     static void PrintFirewirePacket(std::ostream &out, const quadlet_t *packet, unsigned int max_quads);
 
@@ -0,0 +1,126 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef __FailoverPort_H__
+#define __FailoverPort_H__
+
+#include <iostream>
+#include "BoardIO.h"
+
+class BasePort;
+
+/*
+ * FailoverPort
+ *
+ * Redundant link between the PC and a set of boards, for example a FirewirePort and an
+ * EthUdpPort (via an Ethernet-capable board acting as hub) connected to the same boards.
+ * The boards are added to both ports; the real-time cycle (ReadAllBoards/WriteAllBoards)
+ * uses the active port. When the number of consecutive failed reads reaches the failure
+ * threshold (default 2), the other port becomes active and the read is repeated on it,
+ * so that the cycle still returns data.
+ *
+ * The failed port is rescanned by Service, at most once per recovery period, and is then
+ * available as the standby port again. If auto-failback is enabled, the primary port is
+ * reactivated when it has recovered. A rescan (ReScanNodes) can take much longer than a
+ * cycle, so Service is not called by ReadAllBoards or WriteAllBoards; the application
+ * should call it outside the real-time cycle, from the same thread (e.g., between cycles
+ * when there is slack, or at a lower rate). There is no separate thread because Service
+ * also changes the active port.
+ *
+ * Typical use:
+ *     while (running) {
+ *         failover.ReadAllBoards();
+ *         ...
+ *         failover.WriteAllBoards();
+ *         if (slack)
+ *             failover.Service();
+ *     }
+ *
+ * The boards should be removed via RemoveBoard (or the FailoverPort deleted) before
+ * the boards are deleted, since the inactive port also references them.
+ */
+
+class FailoverPort
+{
+public:
+    FailoverPort(BasePort *primary, BasePort *standby, std::ostream &debugStream = std::cerr);
+    ~FailoverPort();
+
+    // Add board to both ports
+    bool AddBoard(BoardIO *board);
+
+    // Remove board from both ports
+    bool RemoveBoard(unsigned char boardId);
+
+    BasePort *GetPrimaryPort(void) const { return ports[0]; }
+    BasePort *GetStandbyPort(void) const { return ports[1]; }
+
+    // Port currently used for the real-time cycle
+    BasePort *GetActivePort(void) const { return ports[activeIndex]; }
+
+    // Returns true if the standby port is active
+    bool IsFailedOver(void) const { return (activeIndex != 0); }
+
+    // Returns true if the inactive port has failed and not yet recovered
+    bool IsInactiveFailed(void) const { return inactiveFailed; }
+
+    // Read all boards via active port; switches port if failure threshold reached
+    bool ReadAllBoards(void);
+
+    // Write all boards via active port
+    bool WriteAllBoards(void);
+
+    // Rescan the failed port if the recovery period has elapsed (not real-time, see above)
+    void Service(void);
+
+    // Make the other port active (returns false if it has failed)
+    bool SwitchPort(void);
+
+    // Number of consecutive failed reads before switching port (default 2)
+    void SetFailureThreshold(unsigned int num) { failureThreshold = (num > 0) ? num : 1; }
+    unsigned int GetFailureThreshold(void) const { return failureThreshold; }
+
+    // Minimum time between rescans of the failed port, in seconds (default 0.5)
+    void SetRecoveryPeriod(double sec) { recoveryPeriod = sec; }
+
+    // Whether to switch back to the primary port when it has recovered (default false)
+    void SetAutoFailback(bool flag) { autoFailback = flag; }
+
+    unsigned int GetNumSwitches(void) const { return numSwitches; }
+    unsigned int GetNumRecoveries(void) const { return numRecoveries; }
+
+protected:
+    std::ostream &outStr;
+    BasePort *ports[2];           // primary, standby
+    unsigned int activeIndex;
+    bool inactiveFailed;
+    unsigned int failureThreshold;
+    unsigned int consecutiveFailures;
+    double recoveryPeriod;
+    double lastRecoveryTime;
+    bool autoFailback;
+    unsigned int numSwitches;
+    unsigned int numRecoveries;
+
+    BoardIO *BoardList[BoardIO::MAX_BOARDS];
+
+    // Make the specified port active (updates BoardIO port pointers)
+    void SetActive(unsigned int index);
+
+    // Rescan the port and check that all boards respond
+    bool CheckPort(BasePort *port);
+};
+
+#endif // __FailoverPort_H__
@@ -0,0 +1,204 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef __ImpairedPort_H__
+#define __ImpairedPort_H__
+
+#include <map>
+#include <vector>
+#include "BasePort.h"
+
+/*
+ * ImpairedPort
+ *
+ * Port that forwards all transactions to another (inner) port, such as a SimulatedPort,
+ * after applying network impairments: delay (with a configurable distribution), loss,
+ * duplication, reordering and corruption. This is intended for testing how the higher
+ * levels (e.g., ReadAllBoardsBroadcast and its sequence check) behave under network
+ * problems. As with RecordingPort, boards are added to the ImpairedPort rather than to
+ * the inner port.
+ *
+ * The impairments are applied at the transaction level (i.e., above the packet level),
+ * with the following semantics:
+ *   - Reads: a lost response is reported as a failed read after the timeout. A delay
+ *     larger than the timeout has the same effect. A duplicated response is returned
+ *     again (instead of the new response) on the next read of the same address, and a
+ *     reordered response is swapped with the previous response from the same address;
+ *     thus, both return stale data.
+ *   - Writes (including broadcast writes): a lost write is not forwarded, but still
+ *     returns true (as for unacknowledged writes). A duplicated write is forwarded twice,
+ *     and a reordered write is held back and forwarded after the next write.
+ *   - Corruption flips one random bit of the data (or broadcast read sequence number).
+ *     Note that this emulates corruption that is not detected by the CRC.
+ *
+ * The impairments are random, using a seeded generator so that test runs are repeatable.
+ * The default profile has no impairments, so that the port can be initialized reliably.
+ *
+ * The inner port is not deleted by ImpairedPort, and is not accessed by its destructor,
+ * so the inner port may be deleted first. A write that is held back (reordered) when the
+ * ImpairedPort is deleted is discarded; call SetProfile to forward it before deleting.
+ */
+
+struct ImpairmentProfile {
+    enum DelayDistribution {
+        DELAY_UNIFORM,       // uniform in [delayMean-delayJitter, delayMean+delayJitter]
+        DELAY_NORMAL,        // normal with standard deviation delayJitter
+        DELAY_EXPONENTIAL    // delayMean plus exponential tail with mean delayJitter
+    };
+
+    double delayMean;               // delay added to each transaction (seconds)
+    double delayJitter;             // delay variation (seconds), see DelayDistribution
+    DelayDistribution delayDist;
+    double timeout;                 // read timeout (seconds), used for lost or late responses
+    double lossProb;                // probability that a transaction is lost
+    double duplicateProb;           // probability that a transaction is duplicated
+    double reorderProb;             // probability that a transaction is reordered
+    double corruptProb;             // probability that the data of a transaction is corrupted
+
+    ImpairmentProfile();
+};
+
+class ImpairedPort : public BasePort
+{
+public:
+    // Impairment counters
+    enum CounterType {
+        FORWARDED,       // transactions forwarded to inner port
+        DELAYED,         // transactions with non-zero delay
+        LOST,            // transactions lost (not including late responses)
+        LATE,            // read responses that exceeded the timeout
+        DUPLICATED,      // duplicated transactions
+        REORDERED,       // reordered transactions
+        CORRUPTED,       // corrupted transactions
+        NUM_COUNTERS
+    };
+
+protected:
+    BasePort *inner;
+    ImpairmentProfile profile;
+    uint64_t rngState;
+    unsigned long counters[NUM_COUNTERS];
+    double totalDelay;              // sum of all delays (seconds)
+
+    // Read responses, indexed by node and address
+    typedef std::map<uint64_t, std::vector<quadlet_t> > ResponseMap;
+    ResponseMap lastResponse;       // previous response (for reordering)
+    ResponseMap dupResponse;        // duplicated response, returned by next read
+
+    // Write transaction (node-level or broadcast), used for held (reordered) writes
+    struct WriteTransaction {
+        unsigned int type;          // PortTrace::RecordType (write types only)
+        nodeid_t node;
+        nodeaddr_t addr;
+        unsigned char flags;
+        std::vector<quadlet_t> data;
+        unsigned int nbytes;
+        unsigned int seq;           // for broadcast read request
+        unsigned int queryMask;     // for broadcast read request: BoardQueryMask_ when issued
+        unsigned int numQueried;    // for broadcast read request: NumOfBoardsQueried_ when issued
+    };
+    bool haveHeldWrite;
+    WriteTransaction heldWrite;
+
+    // Random number in [0,1)
+    double Random(void);
+    // Returns true with specified probability
+    bool Chance(double prob);
+    // Returns delay for next transaction, based on profile (seconds)
+    double GetDelay(void);
+    // Flip one random bit in data
+    void CorruptData(quadlet_t *data, unsigned int numQuads);
+
+    static uint64_t ResponseKey(nodeid_t node, nodeaddr_t addr)
+    { return (static_cast<uint64_t>(node) << 56) ^ static_cast<uint64_t>(addr); }
+
+    // Impair read transaction (quadlet or block) of nbytes into rdata
+    bool ImpairRead(unsigned int type, nodeid_t node, nodeaddr_t addr, quadlet_t *rdata,
+                    unsigned int nbytes, unsigned char flags);
+
+    // Impair write transaction (node-level or broadcast)
+    bool ImpairWrite(WriteTransaction &wr);
+
+    // Forward write transaction to inner port
+    bool ForwardWrite(WriteTransaction &wr);
+
+    // Copy board configuration to inner port (used by its broadcast methods)
+    void UpdateInnerBoards(void);
+
+    //****************** BasePort pure virtual methods ***********************
+
+    bool Init(void);
+    void Cleanup(void);
+    nodeid_t InitNodes(void);
+
+    bool ReadQuadletNode(nodeid_t node, nodeaddr_t addr, quadlet_t &data, unsigned char flags = 0);
+    bool WriteQuadletNode(nodeid_t node, nodeaddr_t addr, quadlet_t data, unsigned char flags = 0);
+    bool ReadBlockNode(nodeid_t node, nodeaddr_t addr, quadlet_t *rdata, unsigned int nbytes, unsigned char flags = 0);
+    bool WriteBlockNode(nodeid_t node, nodeaddr_t addr, quadlet_t *wdata, unsigned int nbytes, unsigned char flags = 0);
+
+public:
+    ImpairedPort(BasePort *innerPort, std::ostream &debugStream = std::cerr);
+    ~ImpairedPort();
+
+    BasePort *GetInnerPort(void) const { return inner; }
+
+    // Set impairment profile (also clears held writes and stale responses)
+    void SetProfile(const ImpairmentProfile &newProfile);
+    const ImpairmentProfile &GetProfile(void) const { return profile; }
+
+    // Seed for the random number generator
+    void SetSeed(uint64_t seed);
+
+    unsigned long GetCounter(CounterType type) const { return counters[type]; }
+    double GetTotalDelay(void) const { return totalDelay; }
+    void ClearImpairmentCounters(void);
+
+    // Returns counter name (e.g., "LOST")
+    static const char *GetCounterName(CounterType type);
+
+    bool AddBoard(BoardIO *board);
+    bool RemoveBoard(unsigned char boardId);
+
+    bool CheckFwBusGeneration(const std::string &caller, bool doScan = false);
+
+    //****************** BasePort pure virtual methods ***********************
+
+    PortType GetPortType(void) const { return inner->GetPortType(); }
+
+    int NumberOfUsers(void) { return inner->NumberOfUsers(); }
+
+    bool IsOK(void) { return (inner && inner->IsOK()); }
+
+    unsigned int GetBusGeneration(void) const { return FwBusGeneration; }
+
+    void UpdateBusGeneration(unsigned int gen);
+
+    // No packet prefix/postfix, since packets are formed by the inner port
+    unsigned int GetPrefixOffset(MsgType) const { return 0; }
+    unsigned int GetWritePostfixSize(void) const { return 0; }
+    unsigned int GetReadPostfixSize(void) const { return 0; }
+    unsigned int GetWriteQuadAlign(void) const { return 0; }
+    unsigned int GetReadQuadAlign(void) const { return 0; }
+
+    unsigned int GetMaxReadDataSize(void) const { return inner->GetMaxReadDataSize(); }
+    unsigned int GetMaxWriteDataSize(void) const { return inner->GetMaxWriteDataSize(); }
+
+    bool WriteBroadcastOutput(quadlet_t *buffer, unsigned int size);
+    bool WriteBroadcastReadRequest(unsigned int seq);
+    void WaitBroadcastRead(void) { inner->WaitBroadcastRead(); }
+    void PromDelay(void) const { inner->PromDelay(); }
+};
+
+#endif // __ImpairedPort_H__
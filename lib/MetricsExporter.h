@@ -0,0 +1,108 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef __MetricsExporter_H__
+#define __MetricsExporter_H__
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+class BasePort;
+
+/*
+ * MetricsExporter
+ *
+ * Periodically exports the counters of one or more ports (see PortCounters) in the
+ * Prometheus text exposition format, together with the error counts that are maintained
+ * elsewhere in the library (BoardIO read/write errors, AmpIO encoder errors and the
+ * EthBasePort FPGA status).
+ *
+ * The output can be written to a file (e.g., for the node_exporter textfile collector),
+ * which is replaced atomically, or served on a Unix domain socket, where each client
+ * connection receives the current metrics and is then closed.
+ *
+ * The exporter does not create a thread; Update should be called periodically, for
+ * example at the end of the control loop. It only writes output or checks for client
+ * connections when the export period has elapsed. Client sockets are non-blocking; if a
+ * client does not accept all of the output at once, the remainder is sent by the following
+ * exports, so a slow client cannot stall the caller.
+ */
+
+class MetricsExporter
+{
+public:
+    MetricsExporter(std::ostream &debugStream = std::cerr);
+    ~MetricsExporter();
+
+    // Add a port. If label is empty, it is set to the port type and number (e.g., "udp0").
+    void AddPort(BasePort *port, const std::string &label = "");
+
+    // Export to the specified file (closes Unix socket, if open)
+    bool OpenFile(const std::string &fileName);
+
+    // Export on a Unix domain socket at the specified path (not available on Windows)
+    bool OpenUnixSocket(const std::string &path);
+
+    void Close(void);
+
+    // Set the minimum time between exports, in seconds (default is 1 second)
+    void SetPeriod(double sec) { period = sec; }
+    double GetPeriod(void) const { return period; }
+
+    // Export if the period has elapsed, i.e., write the file or respond to pending client
+    // connections (socket).
+    // Returns false if there was an error.
+    bool Update(void);
+
+    // Export immediately
+    bool Export(void);
+
+    // Write the current metrics in Prometheus text format
+    void WritePrometheus(std::ostream &out) const;
+
+protected:
+    std::ostream &outStr;
+
+    struct PortEntry {
+        BasePort *port;
+        std::string label;
+    };
+    std::vector<PortEntry> Ports;
+
+    std::string FileName;
+    std::string SocketPath;
+    int SocketFd;
+
+    // Connected clients with unsent output (socket)
+    enum { MAX_CLIENTS = 8 };
+    struct ClientEntry {
+        int fd;
+        std::string text;
+        size_t offset;               // number of bytes sent
+    };
+    std::vector<ClientEntry> Clients;
+    double period;
+    double lastExportTime;
+
+    bool ExportFile(void);
+    bool ExportSocket(void);
+    // Send as much of the remaining output as possible without blocking. Returns true when
+    // the client is finished (all output sent, or error).
+    bool SendToClient(ClientEntry &client, bool &error);
+    void CloseClients(void);
+};
+
+#endif // __MetricsExporter_H__
@@ -0,0 +1,89 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef __PortArena_H__
+#define __PortArena_H__
+
+#include <stddef.h>
+#include <vector>
+
+/*
+ * PortArena
+ *
+ * Single memory block for the packet buffers of a port (see BasePort::AllocateBuffers).
+ * The regions are defined first (AddRegion) and then allocated together (Allocate).
+ * Each region starts on its own cache line and is padded to a whole number of cache
+ * lines, so that buffers used on the read and write sides do not share cache lines.
+ * Within each region, the byte at alignOffset is placed on a cache line boundary; for
+ * a packet buffer, this is typically the start of the data (after the packet prefix).
+ *
+ * If huge pages are requested (see SetDefaultHugePages), the block is allocated with
+ * mmap(MAP_HUGETLB) on Linux; if that fails, or on other platforms, it falls back to
+ * a cache-line aligned allocation.
+ */
+
+class PortArena
+{
+public:
+    enum { CACHE_LINE_SIZE = 64 };
+
+    PortArena();
+    ~PortArena();
+
+    // Add a region of nbytes; returns the region index
+    unsigned int AddRegion(size_t nbytes, size_t alignOffset = 0);
+
+    // Allocate memory for all regions (zero-initialized). Returns false on failure.
+    bool Allocate(void);
+
+    // Free memory and remove all regions
+    void Free(void);
+
+    bool IsAllocated(void) const { return (block != 0); }
+
+    // Returns pointer to region (0 if not allocated or invalid index)
+    unsigned char *GetRegion(unsigned int index) const;
+    size_t GetRegionSize(unsigned int index) const;
+
+    // Total size of allocated block
+    size_t GetSize(void) const { return blockSize; }
+
+    // Returns true if block was allocated using huge pages
+    bool IsHugePage(void) const { return hugePage; }
+
+    // Whether subsequent allocations should try to use huge pages (default false)
+    static void SetDefaultHugePages(bool flag) { useHugePages = flag; }
+    static bool GetDefaultHugePages(void) { return useHugePages; }
+
+protected:
+    // Prevent copies
+    PortArena(const PortArena &);
+    PortArena &operator=(const PortArena &);
+
+    struct Region {
+        size_t size;
+        size_t alignOffset;
+        size_t offset;       // offset from start of block (set by Allocate)
+    };
+    std::vector<Region> regions;
+
+    unsigned char *block;
+    size_t blockSize;
+    bool hugePage;
+
+    static bool useHugePages;
+};
+
+#endif // __PortArena_H__
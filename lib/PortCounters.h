@@ -0,0 +1,95 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef __PortCounters_H__
+#define __PortCounters_H__
+
+#include "BoardIO.h"
+
+/*
+ * PortCounters
+ *
+ * Cumulative performance and error counters for a port and the boards connected to it.
+ * The counters are updated by the port classes (BasePort, EthBasePort) on every transaction
+ * and are never reset by the library (except via Clear), so rates can be computed by
+ * sampling them periodically (see MetricsExporter).
+ *
+ * Note that the counters are not protected against concurrent access; as with the rest of
+ * the port interface, they should be updated and read from the same thread.
+ */
+
+class PortCounters
+{
+public:
+    typedef uint64_t CounterType;
+
+    // Port counters
+    enum PortCounterType {
+        TRANSACTIONS,          // Number of read/write transactions (quadlet or block)
+        TX_BYTES,              // Data bytes written
+        RX_BYTES,              // Data bytes read
+        FAILURES,              // Failed transactions
+        TIMEOUTS,              // Read responses not received (Ethernet)
+        FLUSHED_PACKETS,       // Unexpected packets flushed before a read (Ethernet)
+        BUS_RESETS,            // Bus resets handled by rescanning nodes
+        BROADCAST_READS,       // Broadcast read cycles (ReadAllBoardsBroadcast)
+        NUM_PORT_COUNTERS
+    };
+
+    // Per-board counters
+    enum BoardCounterType {
+        BOARD_READS,           // Read transactions
+        BOARD_WRITES,          // Write transactions
+        BOARD_RX_BYTES,        // Data bytes read
+        BOARD_TX_BYTES,        // Data bytes written
+        BOARD_READ_FAILURES,   // Failed read transactions
+        BOARD_WRITE_FAILURES,  // Failed write transactions
+        BOARD_SEQ_MISMATCHES,  // Broadcast read sequence number mismatches
+        BOARD_STALE_DATA,      // Broadcast read data from the previous cycle (subset of BOARD_SEQ_MISMATCHES)
+        NUM_BOARD_COUNTERS
+    };
+
+    PortCounters() { Clear(); }
+    ~PortCounters() {}
+
+    void Clear(void);
+
+    inline void IncPort(PortCounterType type, CounterType n = 1)
+    { portCounters[type] += n; }
+
+    inline void IncBoard(unsigned int boardNum, BoardCounterType type, CounterType n = 1)
+    { if (boardNum < BoardIO::MAX_BOARDS) boardCounters[boardNum][type] += n; }
+
+    inline CounterType GetPort(PortCounterType type) const
+    { return portCounters[type]; }
+
+    inline CounterType GetBoard(unsigned int boardNum, BoardCounterType type) const
+    { return (boardNum < BoardIO::MAX_BOARDS) ? boardCounters[boardNum][type] : 0; }
+
+    // Update counters for a transaction (boardId can include flags or be the broadcast address)
+    void UpdateTransaction(unsigned char boardId, bool isRead, unsigned int nbytes, bool ok);
+
+    // Metric name (suffix) and description, e.g., for Prometheus export
+    static const char *GetName(PortCounterType type);
+    static const char *GetDescription(PortCounterType type);
+    static const char *GetName(BoardCounterType type);
+    static const char *GetDescription(BoardCounterType type);
+
+protected:
+    CounterType portCounters[NUM_PORT_COUNTERS];
+    CounterType boardCounters[BoardIO::MAX_BOARDS][NUM_BOARD_COUNTERS];
+};
+
+#endif // __PortCounters_H__
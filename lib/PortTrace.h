@@ -0,0 +1,112 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef __PortTrace_H__
+#define __PortTrace_H__
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "BoardIO.h"
+
+/*
+ * PortTrace
+ *
+ * Binary file format for transaction traces, written by RecordingPort and read by ReplayPort.
+ * The file consists of a header (PortTraceHeader), followed by a sequence of records.
+ * Each record consists of a fixed-size PortTraceRecord, followed by nbytes of data:
+ *     READ_QUADLET, READ_BLOCK       data returned by the board (zero-filled if the read failed)
+ *     WRITE_QUADLET, WRITE_BLOCK     data written to the board
+ *     BC_OUTPUT                      broadcast write data
+ * The other record types have no data. All values are in host byte order, and times are in
+ * nanoseconds (see Amp1394_GetMonotonicTime), measured before and after the transaction.
+ */
+
+struct PortTraceHeader {
+    char magic[8];                // "AMP1394T"
+    uint32_t version;             // PortTrace::VERSION
+    uint32_t portType;            // BasePort::PortType of recorded port
+    int portNum;                  // port number of recorded port
+    uint32_t maxReadDataSize;     // from recorded port
+    uint32_t maxWriteDataSize;    // from recorded port
+    uint32_t reserved;
+};
+
+struct PortTraceRecord {
+    uint8_t type;                 // PortTrace::RecordType
+    uint8_t ok;                   // return value of transaction
+    uint8_t flags;                // flags parameter (FW_NODE_xxx)
+    uint8_t reserved;
+    uint32_t node;                // node id (for INIT_NODES: number of nodes returned)
+    uint64_t addr;                // address (for INIT_NODES: hub board)
+    uint32_t nbytes;              // number of data bytes following this record
+    uint32_t value;               // sequence number (BC_READ_REQUEST) or bus generation
+    int64_t startTime;            // host time before transaction
+    int64_t endTime;              // host time after transaction
+};
+
+class PortTrace
+{
+public:
+    enum { VERSION = 1 };
+
+    enum RecordType {
+        READ_QUADLET,
+        WRITE_QUADLET,
+        READ_BLOCK,
+        WRITE_BLOCK,
+        BC_OUTPUT,                // WriteBroadcastOutput
+        BC_READ_REQUEST,          // WriteBroadcastReadRequest
+        INIT_NODES,               // InitNodes (also records hub board and bus generation)
+        BUS_GENERATION            // Bus generation changed (e.g., bus reset)
+    };
+
+    static const char Magic[8];
+
+    // Returns record type name (e.g., "READ_BLOCK")
+    static std::string RecordTypeString(unsigned int type);
+
+    PortTrace();
+    ~PortTrace();
+
+    // Load trace file into memory; returns false if file could not be read or is invalid
+    bool Load(const std::string &fileName, std::ostream &outStr = std::cerr);
+
+    bool IsLoaded(void) const { return !buffer.empty(); }
+
+    const PortTraceHeader &GetHeader(void) const { return header; }
+
+    size_t GetNumRecords(void) const { return offsets.size(); }
+
+    // Returns record i and its data (0 if index out of range)
+    const PortTraceRecord *GetRecord(size_t i) const;
+    const unsigned char *GetRecordData(size_t i) const;
+
+    // Time span of trace, in seconds
+    double GetDuration(void) const;
+
+    // Print summary (number of records of each type, duration)
+    void PrintSummary(std::ostream &outStr) const;
+
+protected:
+    PortTraceHeader header;
+    std::vector<unsigned char> buffer;   // records (excluding header)
+    std::vector<size_t> offsets;         // offset of each record in buffer
+    // Copy of each record header. Records in buffer follow variable-length data, so they are
+    // only 4-byte aligned and must not be accessed in place (64-bit fields).
+    std::vector<PortTraceRecord> records;
+};
+
+#endif // __PortTrace_H__
@@ -0,0 +1,190 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef __RealTimeBoard_H__
+#define __RealTimeBoard_H__
+
+#include <string.h>  // for memset
+#include <iostream>
+#include "BoardIO.h"
+#include "BoardLayout.h"
+#include "Amp1394BSwap.h"
+
+/*
+ * RealTimeBoard
+ *
+ * Base class for boards whose real-time block read and write buffers follow RealTimeLayout
+ * (see BoardLayout.h). It owns the read and write buffers, sized at compile time from the
+ * layout, and implements the BoardIO methods used by the port classes for the real-time
+ * transfers, as well as the decoding of the raw data that does not depend on the board type
+ * (timestamp, status, digital I/O, motor current, analog input and encoder position).
+ *
+ * AmpIO (QLA, 4 channels) derives from RealTimeBoard<QLA_Layout> and adds the QLA-specific
+ * features; RealTimeIO8 is a board with 8 channels. Because GetNumChannels, GetReadNumBytes
+ * and GetWriteNumBytes come from the layout, boards with different channel counts can be
+ * added to the same port.
+ */
+
+template <class LayoutType>
+class RealTimeBoard : public BoardIO
+{
+public:
+    typedef LayoutType Layout;
+
+    // Number of channels in the node
+    enum { NUM_CHANNELS = Layout::NUM_CHANNELS };
+
+    // Compile-time check that NUM_CHANNELS does not exceed BoardIO::MAX_CHANNELS
+    typedef char NumChannelsCheck[(static_cast<unsigned int>(NUM_CHANNELS) <=
+                                   static_cast<unsigned int>(MAX_CHANNELS)) ? 1 : -1];
+
+    RealTimeBoard(unsigned char board_id) : BoardIO(board_id)
+    {
+        memset(ReadBuffer, 0, sizeof(ReadBuffer));
+        InitWriteBuffer();
+    }
+    ~RealTimeBoard() {}
+
+    // Return number of channels (axes) supported by the board
+    unsigned int GetNumChannels(void) const { return NUM_CHANNELS; }
+
+    // The GetXXX methods below return data from the read buffer that was filled
+    // by BasePort::ReadAllBoards or BasePort::ReadAllBoardsBroadcast.
+
+    uint32_t GetStatus(void) const
+    { return ReadBuffer[Layout::STATUS_OFFSET]; }
+
+    uint32_t GetTimestamp(void) const
+    { return ReadBuffer[Layout::TIMESTAMP_OFFSET]; }
+
+    uint32_t GetDigitalInput(void) const
+    { return ReadBuffer[Layout::DIGIO_OFFSET]; }
+
+    // Motor current feedback (lower 16 bits)
+    uint32_t GetMotorCurrent(unsigned int index) const
+    {
+        if (index >= NUM_CHANNELS)
+            return 0L;
+        return ReadBuffer[index+Layout::MOTOR_CURR_OFFSET] & 0x0000ffff;
+    }
+
+    // Analog input, e.g., potentiometer (upper 16 bits)
+    uint32_t GetAnalogInput(unsigned int index) const
+    {
+        if (index >= NUM_CHANNELS)
+            return 0L;
+        return (ReadBuffer[index+Layout::ANALOG_POS_OFFSET] & 0xffff0000) >> 16;
+    }
+
+    /*! Returns the encoder position in counts (24 bits, relative to midrange). */
+    int32_t GetEncoderPosition(unsigned int index) const
+    {
+        if (index >= NUM_CHANNELS)
+            return 0;
+        return static_cast<int32_t>(ReadBuffer[index+Layout::ENC_POS_OFFSET] & 0x00ffffff) - 0x00800000;
+    }
+
+protected:
+    // Buffer for real-time block reads. The Port class calls SetReadData to copy the
+    // most recent data into this buffer, while also byteswapping.
+    quadlet_t ReadBuffer[Layout::READ_SIZE];
+
+    // Buffer for real-time block writes. The Port class calls GetWriteData to copy from
+    // this buffer, while also byteswapping if needed.
+    quadlet_t WriteBuffer[Layout::WRITE_SIZE];
+
+    // Virtual methods
+    unsigned int GetReadNumBytes() const { return Layout::READ_SIZE*sizeof(quadlet_t); }
+
+    // Copies (and byteswaps) the number of quadlets given by GetSeqReadNumBytes, which is
+    // never more than the full read buffer.
+    void SetReadData(const quadlet_t *buf)
+    {
+        unsigned int numQuads = GetSeqReadNumBytes()/sizeof(quadlet_t);
+        for (unsigned int i = 0; i < numQuads; i++)
+            ReadBuffer[i] = bswap_32(buf[i]);
+    }
+
+    unsigned int GetWriteNumBytes() const { return Layout::WRITE_SIZE*sizeof(quadlet_t); }
+
+    bool GetWriteData(quadlet_t *buf, unsigned int offset, unsigned int numQuads, bool doSwap = true) const
+    {
+        if ((offset+numQuads) > Layout::WRITE_SIZE) {
+            std::cerr << "RealTimeBoard:GetWriteData: invalid args: " << offset << ", " << numQuads << std::endl;
+            return false;
+        }
+        for (unsigned int i = 0; i < numQuads; i++)
+            buf[i] = doSwap ? bswap_32(WriteBuffer[offset+i]) : WriteBuffer[offset+i];
+        return true;
+    }
+
+    // Motor currents are not valid (board id only) and control register is 0
+    void InitWriteBuffer(void)
+    {
+        quadlet_t data = (BoardId & 0x0F) << 24;
+        for (unsigned int i = 0; i < NUM_CHANNELS; i++)
+            WriteBuffer[Layout::WB_CURR_OFFSET+i] = data;
+        WriteBuffer[Layout::WB_CTRL_OFFSET] = 0;
+    }
+
+    // Test if the current write buffer contains commands that will
+    // reset the watchdog on the board, i.e., if there is any valid bit
+    // on the requested currents.
+    bool WriteBufferResetsWatchdog(void) const
+    {
+        for (unsigned int i = 0; i < NUM_CHANNELS; i++) {
+            if (WriteBuffer[Layout::WB_CURR_OFFSET+i] & 0x80000000)
+                return true;
+        }
+        return false;
+    }
+};
+
+/*
+ * RealTimeIO8
+ *
+ * Board with 8 channels (RealTimeLayout<8>), for firmware that provides the same real-time
+ * data as the QLA for twice as many channels. Only the real-time interface is provided
+ * (no QLA-specific registers), i.e., the raw feedback via the RealTimeBoard GetXXX methods
+ * and the motor current commands via SetMotorCurrent and SetControl.
+ */
+
+class RealTimeIO8 : public RealTimeBoard<RealTimeLayout<8> >
+{
+public:
+    RealTimeIO8(unsigned char board_id) : RealTimeBoard<RealTimeLayout<8> >(board_id) {}
+    ~RealTimeIO8() {}
+
+    // FPGA sysclk (49.152 MHz), same as QLA
+    double GetFPGAClockPeriod(void) const { return 1.0/49.152e6; }
+
+    // Set motor current command (16-bit DAC value) for the next WriteAllBoards
+    bool SetMotorCurrent(unsigned int index, uint32_t sdata)
+    {
+        if (index >= NUM_CHANNELS)
+            return false;
+        WriteBuffer[Layout::WB_CURR_OFFSET+index] = 0x80000000 | ((BoardId & 0x0F) << 24) | (sdata & 0x0000ffff);
+        return true;
+    }
+
+    // Set control register (e.g., power and amplifier enable) for the next WriteAllBoards
+    void SetControl(quadlet_t ctrl) { WriteBuffer[Layout::WB_CTRL_OFFSET] = ctrl; }
+
+protected:
+    // No data collection
+    void CheckCollectCallback() {}
+};
+
+#endif // __RealTimeBoard_H__
@@ -0,0 +1,113 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef __RecordingPort_H__
+#define __RecordingPort_H__
+
+#include <fstream>
+#include "BasePort.h"
+#include "PortTrace.h"
+
+/*
+ * RecordingPort
+ *
+ * Port that forwards all transactions to another (inner) port and appends each transaction
+ * to a trace file (see PortTrace), so that it can later be replayed by ReplayPort. Boards are
+ * added to the RecordingPort rather than to the inner port; all node-level reads and writes
+ * (ReadQuadletNode, WriteQuadletNode, ReadBlockNode, WriteBlockNode) are recorded, together
+ * with the broadcast requests (WriteBroadcastOutput, WriteBroadcastReadRequest), which are
+ * recorded as single records even though the inner port implements them with node-level
+ * writes. The recording is done in the calling thread; records are buffered by the file
+ * stream, which is flushed by Flush and when the port is deleted.
+ *
+ * The inner port is not deleted by RecordingPort.
+ */
+
+class RecordingPort : public BasePort
+{
+protected:
+    BasePort *inner;
+    std::string FileName;
+    std::ofstream traceFile;
+    unsigned long numRecords;
+    unsigned int lastBusGeneration;   // last bus generation written to trace
+
+    // Write record to trace file
+    void WriteRecord(unsigned int type, bool ok, nodeid_t node, nodeaddr_t addr, unsigned char flags,
+                     const void *data, unsigned int nbytes, unsigned int value,
+                     int64_t startTime, int64_t endTime);
+
+    // Copy board configuration to inner port (used by its broadcast methods)
+    void UpdateInnerBoards(void);
+
+    //****************** BasePort pure virtual methods ***********************
+
+    bool Init(void);
+    void Cleanup(void);
+    nodeid_t InitNodes(void);
+
+    bool ReadQuadletNode(nodeid_t node, nodeaddr_t addr, quadlet_t &data, unsigned char flags = 0);
+    bool WriteQuadletNode(nodeid_t node, nodeaddr_t addr, quadlet_t data, unsigned char flags = 0);
+    bool ReadBlockNode(nodeid_t node, nodeaddr_t addr, quadlet_t *rdata, unsigned int nbytes, unsigned char flags = 0);
+    bool WriteBlockNode(nodeid_t node, nodeaddr_t addr, quadlet_t *wdata, unsigned int nbytes, unsigned char flags = 0);
+
+public:
+    // Record transactions of innerPort to fileName (an existing file is overwritten)
+    RecordingPort(BasePort *innerPort, const std::string &fileName, std::ostream &debugStream = std::cerr);
+    ~RecordingPort();
+
+    BasePort *GetInnerPort(void) const { return inner; }
+
+    const std::string &GetFileName(void) const { return FileName; }
+
+    unsigned long GetNumRecords(void) const { return numRecords; }
+
+    // Flush trace file
+    void Flush(void);
+
+    bool AddBoard(BoardIO *board);
+    bool RemoveBoard(unsigned char boardId);
+
+    bool CheckFwBusGeneration(const std::string &caller, bool doScan = false);
+
+    //****************** BasePort pure virtual methods ***********************
+
+    PortType GetPortType(void) const { return inner->GetPortType(); }
+
+    int NumberOfUsers(void) { return inner->NumberOfUsers(); }
+
+    bool IsOK(void);
+
+    unsigned int GetBusGeneration(void) const { return FwBusGeneration; }
+
+    void UpdateBusGeneration(unsigned int gen);
+
+    // No packet prefix/postfix, since packets are formed by the inner port
+    unsigned int GetPrefixOffset(MsgType) const { return 0; }
+    unsigned int GetWritePostfixSize(void) const { return 0; }
+    unsigned int GetReadPostfixSize(void) const { return 0; }
+    unsigned int GetWriteQuadAlign(void) const { return 0; }
+    unsigned int GetReadQuadAlign(void) const { return 0; }
+
+    unsigned int GetMaxReadDataSize(void) const { return inner->GetMaxReadDataSize(); }
+    unsigned int GetMaxWriteDataSize(void) const { return inner->GetMaxWriteDataSize(); }
+
+    bool WriteBroadcastOutput(quadlet_t *buffer, unsigned int size);
+    bool WriteBroadcastReadRequest(unsigned int seq);
+    void WaitBroadcastRead(void) { inner->WaitBroadcastRead(); }
+    void PromDelay(void) const { inner->PromDelay(); }
+};
+
+#endif // __RecordingPort_H__
@@ -0,0 +1,135 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef __ReplayPort_H__
+#define __ReplayPort_H__
+
+#include "BasePort.h"
+#include "PortTrace.h"
+
+/*
+ * ReplayPort
+ *
+ * Port that replays a trace recorded by RecordingPort, without any hardware. Each transaction
+ * requested by the upper layers (e.g., AmpIO, ReadAllBoards) is matched against the next record
+ * in the trace; reads return the recorded data and the recorded return value. Thus, the
+ * application must issue the same sequence of transactions as when the trace was recorded
+ * (same boards, protocol and sequence of calls). If a transaction does not match the next
+ * record (type, node, address or size), a message is printed (for the first mismatch only)
+ * and the transaction fails without consuming the record. When the end of the trace is
+ * reached, all transactions fail.
+ *
+ * By default, the trace is replayed as fast as possible. If real-time mode is enabled
+ * (SetRealTime), each transaction is delayed until its recorded completion time, relative
+ * to the first transaction replayed.
+ */
+
+class ReplayPort : public BasePort
+{
+protected:
+    PortTrace Trace;
+    std::string FileName;
+    size_t curRecord;              // index of next record
+    bool realTime;
+    int64_t traceStartTime;        // recorded time of first replayed record
+    int64_t replayStartTime;       // host time when first record was replayed
+    unsigned long numMismatches;
+    unsigned long numWriteDataMismatches;
+    bool endReported;
+
+    // Apply meta records (bus generation) at current position
+    void ApplyMetaRecords(void);
+
+    // Return next record if it matches the requested transaction, and advance to next record.
+    // Returns 0 if no match (or end of trace).
+    const PortTraceRecord *NextRecord(unsigned int type, nodeid_t node, nodeaddr_t addr, unsigned int nbytes,
+                                      const unsigned char *&data);
+
+    // Wait until recorded time of record (if real-time mode)
+    void WaitRecordTime(const PortTraceRecord *rec);
+
+    // Compare write data with recorded data
+    void CheckWriteData(const PortTraceRecord *rec, const unsigned char *recData, const void *wdata);
+
+    //****************** BasePort pure virtual methods ***********************
+
+    bool Init(void);
+    void Cleanup(void) {}
+    nodeid_t InitNodes(void);
+
+    bool ReadQuadletNode(nodeid_t node, nodeaddr_t addr, quadlet_t &data, unsigned char flags = 0);
+    bool WriteQuadletNode(nodeid_t node, nodeaddr_t addr, quadlet_t data, unsigned char flags = 0);
+    bool ReadBlockNode(nodeid_t node, nodeaddr_t addr, quadlet_t *rdata, unsigned int nbytes, unsigned char flags = 0);
+    bool WriteBlockNode(nodeid_t node, nodeaddr_t addr, quadlet_t *wdata, unsigned int nbytes, unsigned char flags = 0);
+
+public:
+    ReplayPort(const std::string &fileName, std::ostream &debugStream = std::cerr);
+    ~ReplayPort();
+
+    const PortTrace &GetTrace(void) const { return Trace; }
+
+    // Whether to replay at recorded timing (default false, i.e., as fast as possible)
+    void SetRealTime(bool flag) { realTime = flag; }
+    bool GetRealTime(void) const { return realTime; }
+
+    // Restart replay from beginning of trace (also rescans nodes)
+    void Rewind(void);
+
+    // Number of records replayed and remaining
+    size_t GetNumReplayed(void) const { return curRecord; }
+    size_t GetNumRemaining(void) const { return Trace.GetNumRecords()-curRecord; }
+
+    bool IsEndOfTrace(void) const { return (curRecord >= Trace.GetNumRecords()); }
+
+    // Number of transactions that did not match the trace
+    unsigned long GetNumMismatches(void) const { return numMismatches; }
+
+    // Number of writes where the data differed from the recorded data (the write still succeeds)
+    unsigned long GetNumWriteDataMismatches(void) const { return numWriteDataMismatches; }
+
+    bool AddBoard(BoardIO *board);
+
+    bool CheckFwBusGeneration(const std::string &caller, bool doScan = false);
+
+    //****************** BasePort pure virtual methods ***********************
+
+    PortType GetPortType(void) const { return static_cast<PortType>(Trace.GetHeader().portType); }
+
+    int NumberOfUsers(void) { return 1; }
+
+    bool IsOK(void) { return Trace.IsLoaded(); }
+
+    unsigned int GetBusGeneration(void) const { return FwBusGeneration; }
+
+    void UpdateBusGeneration(unsigned int gen) { FwBusGeneration = gen; }
+
+    unsigned int GetPrefixOffset(MsgType) const { return 0; }
+    unsigned int GetWritePostfixSize(void) const { return 0; }
+    unsigned int GetReadPostfixSize(void) const { return 0; }
+    unsigned int GetWriteQuadAlign(void) const { return 0; }
+    unsigned int GetReadQuadAlign(void) const { return 0; }
+
+    unsigned int GetMaxReadDataSize(void) const { return Trace.GetHeader().maxReadDataSize; }
+    unsigned int GetMaxWriteDataSize(void) const { return Trace.GetHeader().maxWriteDataSize; }
+
+    bool WriteBroadcastOutput(quadlet_t *buffer, unsigned int size);
+    bool WriteBroadcastReadRequest(unsigned int seq);
+
+    // Waiting is not needed, since the broadcast read data is in the trace
+    void WaitBroadcastRead(void) {}
+    void PromDelay(void) const {}
+};
+
+#endif // __ReplayPort_H__
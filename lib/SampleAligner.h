@@ -0,0 +1,117 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef __SampleAligner_H__
+#define __SampleAligner_H__
+
+#include <iostream>
+#include "BoardIO.h"
+
+class BasePort;
+class AmpIO;
+class ClockSync;
+
+/*
+ * SampleAligner
+ *
+ * The boards on a port are not sampled at the same instant: with PROTOCOL_SEQ_RW and
+ * PROTOCOL_SEQ_R_BC_W each board is read in turn, and with PROTOCOL_BC_QRW the boards
+ * update the hub at different times (BroadcastReadInfo::updateTime). This class estimates
+ * the sample time of each board and extrapolates the encoder positions and velocities
+ * (using the velocity and acceleration estimates) to a common instant.
+ *
+ * Only boards with new data from the last read are aligned, i.e., boards whose read was
+ * valid and not stale and, for PROTOCOL_BC_QRW, that were included in the broadcast query.
+ *
+ * The sample time of each board is obtained from (in order of preference):
+ *   1) ClockSync objects, if provided for all boards (see SetClockSync; AmpIO only)
+ *   2) BroadcastReadInfo::updateTime, when using PROTOCOL_BC_QRW with Firmware Rev 7+
+ *   3) the host time interval of the real-time read (BoardIO::GetReadHostTimeBefore/After)
+ *
+ * GetSkew returns the spread of the sample times before alignment, and GetResidualSkew
+ * the remaining uncertainty of the relative sample times after alignment.
+ *
+ * Typical use:
+ *     port->ReadAllBoards();
+ *     aligner.Update();
+ *     double pos = aligner.GetPosition(boardNum, axis);
+ */
+
+class SampleAligner
+{
+public:
+    // Common instant to which samples are aligned
+    enum TargetType { ALIGN_LATEST, ALIGN_EARLIEST, ALIGN_MEAN };
+
+    enum SourceType { SOURCE_NONE, SOURCE_CLOCK_SYNC, SOURCE_BROADCAST, SOURCE_HOST };
+
+    SampleAligner(BasePort *port);
+    ~SampleAligner() {}
+
+    void SetTarget(TargetType target) { targetType = target; }
+    TargetType GetTarget(void) const { return targetType; }
+
+    // Use the specified ClockSync (or 0 to clear) to obtain the sample time of the board
+    void SetClockSync(unsigned int boardNum, const ClockSync *sync);
+
+    // Whether to use the encoder acceleration for extrapolation (default true)
+    void SetUseAcceleration(bool flag) { useAccel = flag; }
+
+    // Compute aligned data from the last real-time read. Returns false if no valid data.
+    bool Update(void);
+
+    // Mask of boards with aligned data from the last Update
+    unsigned int GetBoardMask(void) const { return boardMask; }
+
+    // Aligned encoder position (counts) and velocity (counts/sec); axis must be less than
+    // the number of channels of the board (0 is returned otherwise)
+    double GetPosition(unsigned int boardNum, unsigned int axis) const;
+    double GetVelocity(unsigned int boardNum, unsigned int axis) const;
+
+    // Time (seconds) from the sample time of the board to the common instant
+    double GetTimeShift(unsigned int boardNum) const;
+
+    // Spread of sample times before alignment (seconds)
+    double GetSkew(void) const { return skew; }
+
+    // Uncertainty of relative sample times after alignment (seconds); this is the sum of
+    // the two largest per-board sample time uncertainties.
+    double GetResidualSkew(void) const { return residualSkew; }
+
+    SourceType GetSource(void) const { return source; }
+
+    void Print(std::ostream &out) const;
+
+protected:
+    BasePort *port;
+    TargetType targetType;
+    bool useAccel;
+    const ClockSync *clockSync[BoardIO::MAX_BOARDS];
+
+    SourceType source;
+    unsigned int boardMask;
+    double skew;
+    double residualSkew;
+
+    double timeShift[BoardIO::MAX_BOARDS];
+    unsigned int numAxes[BoardIO::MAX_BOARDS];   // number of channels of board (0 if none)
+    double position[BoardIO::MAX_BOARDS][BoardIO::MAX_CHANNELS];
+    double velocity[BoardIO::MAX_BOARDS][BoardIO::MAX_CHANNELS];
+
+    // Get sample time and uncertainty (ns) of each board in boardMask; returns source used
+    SourceType GetSampleTimes(const BoardIO *boards[], int64_t sampleTime[], int64_t uncertainty[]) const;
+};
+
+#endif // __SampleAligner_H__
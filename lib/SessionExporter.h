@@ -0,0 +1,68 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef __SessionExporter_H__
+#define __SessionExporter_H__
+
+#include "SessionFile.h"
+
+class AmpIO;
+
+/*
+ * SessionExporter
+ *
+ * Writes the decoded signals of a set of AmpIO boards to a SessionFile, one row per call
+ * to Update (typically after each ReadAllBoards, for example when reading a CycleLog via
+ * CycleLogPort). The columns are "time", followed by the following signals for each board,
+ * where N is the board number and C the channel number:
+ *     bN.valid, bN.timestamp, bN.status, bN.digio
+ *     bN.enc_pos[C], bN.enc_vel[C], bN.enc_acc[C], bN.motor_curr[C], bN.analog[C]
+ * Positions and currents are the raw values (counts, bits); velocity and acceleration are in
+ * counts/s and counts/s^2.
+ */
+
+class SessionExporter
+{
+public:
+    SessionExporter(std::ostream &debugStream = std::cerr);
+    ~SessionExporter();
+
+    // Add board to be exported (before calling Open)
+    bool AddBoard(const AmpIO *board);
+
+    // Create session file
+    bool Open(const std::string &fileName, unsigned int chunkRows = 4096);
+
+    // Add row with current data of all boards
+    bool Update(double time);
+
+    // Write index and close file
+    bool Close(void);
+
+    const std::vector<std::string> &GetColumnNames(void) const { return columnNames; }
+
+    unsigned long GetNumRows(void) const { return writer.GetNumRows(); }
+
+protected:
+    std::ostream &outStr;
+    SessionWriter writer;
+    std::vector<const AmpIO *> boards;
+    std::vector<std::string> columnNames;
+    std::vector<double> row;
+
+    void AddColumn(unsigned int boardNum, const char *signal, int chan = -1);
+};
+
+#endif // __SessionExporter_H__
@@ -0,0 +1,135 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef __SessionFile_H__
+#define __SessionFile_H__
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "BoardIO.h"
+
+/*
+ * SessionFile
+ *
+ * Columnar file format for decoded signals (see SessionExporter). All values are stored as
+ * double; column 0 is the time (in seconds), which must be non-decreasing. The rows are grouped
+ * into chunks (default 4096 rows); within a chunk, each column is stored contiguously, so that
+ * a few signals can be read without reading the others. The chunk index at the end of the file
+ * contains, for each chunk, its file offset, number of rows, time range and the minimum and
+ * maximum value of each column.
+ *
+ * File layout (host byte order):
+ *     header:   magic "AMPSES01", numColumns, chunkRows
+ *     chunks:   for each column: numRows values
+ *     index:    column names, then for each chunk: offset, numRows, tStart, tEnd, min/max per column
+ *     trailer:  offset of index, magic
+ *
+ * SessionWriter writes the file (rows are buffered until a chunk is full), and SessionReader
+ * reads the index and then the requested columns for a time range.
+ */
+
+struct SessionChunkInfo {
+    uint64_t offset;               // file offset of chunk data
+    uint32_t numRows;
+    double tStart;                 // time of first row
+    double tEnd;                   // time of last row
+    std::vector<double> minValue;  // per column
+    std::vector<double> maxValue;  // per column
+};
+
+class SessionWriter
+{
+public:
+    SessionWriter(std::ostream &debugStream = std::cerr);
+    ~SessionWriter();
+
+    // Create file with the specified columns (first column should be "time")
+    bool Open(const std::string &fileName, const std::vector<std::string> &columns,
+              unsigned int chunkRows = 4096);
+
+    // Add row (values for all columns). Returns false (and does not add the row) if the
+    // time (column 0) is less than the time of the previous row.
+    bool AddRow(const double *values);
+
+    // Write remaining rows and index, and close file
+    bool Close(void);
+
+    bool IsOpen(void) const { return outFile.is_open(); }
+
+    unsigned int GetNumColumns(void) const { return static_cast<unsigned int>(columnNames.size()); }
+    unsigned long GetNumRows(void) const { return numRows; }
+
+protected:
+    std::ostream &outStr;
+    std::ofstream outFile;
+    std::vector<std::string> columnNames;
+    unsigned int chunkRows;
+    std::vector<double> chunkData;      // column-major, chunkRows values per column
+    unsigned int curRows;               // rows in chunkData
+    unsigned long numRows;
+    double lastTime;                    // time of last row
+    std::vector<SessionChunkInfo> chunks;
+
+    bool WriteChunk(void);
+};
+
+class SessionReader
+{
+public:
+    SessionReader(std::ostream &debugStream = std::cerr);
+    ~SessionReader();
+
+    // Open file and read index
+    bool Open(const std::string &fileName);
+    void Close(void);
+
+    bool IsOpen(void) const { return inFile.is_open(); }
+
+    unsigned int GetNumColumns(void) const { return static_cast<unsigned int>(columnNames.size()); }
+    const std::string &GetColumnName(unsigned int col) const { return columnNames[col]; }
+
+    // Returns column index, or -1 if not found
+    int FindColumn(const std::string &name) const;
+
+    unsigned long GetNumRows(void) const;
+    double GetStartTime(void) const;
+    double GetEndTime(void) const;
+
+    size_t GetNumChunks(void) const { return chunks.size(); }
+    const SessionChunkInfo &GetChunkInfo(size_t i) const { return chunks[i]; }
+
+    // Read the time column and the specified columns for rows with t0 <= time <= t1.
+    // Only chunks that overlap the time range are read.
+    bool ReadColumns(const std::vector<unsigned int> &cols, double t0, double t1,
+                     std::vector<double> &time, std::vector<std::vector<double> > &data);
+
+    // Minimum and maximum value of column over chunks that overlap the time range
+    // (from the index, so the range may be larger than for the exact time range).
+    bool GetColumnRange(unsigned int col, double t0, double t1, double &minValue, double &maxValue) const;
+
+protected:
+    std::ostream &outStr;
+    std::ifstream inFile;
+    std::vector<std::string> columnNames;
+    std::vector<SessionChunkInfo> chunks;
+
+    // Read numValues values of column col from chunk, starting at row
+    bool ReadChunkColumn(const SessionChunkInfo &chunk, unsigned int col, unsigned int row,
+                         unsigned int numValues, double *values);
+};
+
+#endif // __SessionFile_H__
@@ -0,0 +1,222 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef __SimulatedPort_H__
+#define __SimulatedPort_H__
+
+#include "BasePort.h"
+#include "BoardLayout.h"
+
+/*
+ * SimulatedPort
+ *
+ * Port that simulates a set of QLA boards (Firmware Rev 7), without any hardware. Each channel
+ * drives a motor/load model (SimAxisModel): the motor current commanded via WriteAllBoards (or
+ * SetMotorCurrent quadlet writes) accelerates the motor, and the resulting motion is reported
+ * in the real-time read data with the same bit layout as the firmware: encoder position,
+ * velocity period, quarter-cycle periods (QTR1/QTR5) and running counter, measured in ticks of
+ * the 49.152 MHz FPGA clock, as well as the measured motor current and the board status.
+ * Thus, the AmpIO boards added to this port can be used exactly as with real hardware, and the
+ * whole stack (including velocity and acceleration estimation) can be tested at any rate.
+ *
+ * Both the sequential and broadcast protocols are supported. Current only flows when power
+ * and the amplifier for that channel are enabled (e.g., via SetPowerEnable/SetAmpEnable).
+ *
+ * By default, the simulation runs in real time (i.e., the model is advanced to the host time
+ * whenever the boards are read). If a time step is set (SetTimeStep), the simulation time
+ * instead advances by the time step on each read cycle, which gives deterministic results
+ * and allows the stack to be run as fast as possible.
+ *
+ * GetPortType returns PORT_FIREWIRE because, as for FireWire, there are no packet headers.
+ */
+
+// Motor/load model for one channel. The motor position (rad) follows
+//     inertia*acc = torqueConstant*current - damping*vel - stiffness*pos - friction*sign(vel)
+// where the current follows the commanded current with first-order lag currentTimeConstant.
+struct SimAxisModel {
+    double inertia;              // motor and load inertia (kg*m^2)
+    double damping;              // viscous friction (N*m*s/rad)
+    double friction;             // Coulomb friction (N*m)
+    double stiffness;            // spring to zero position (N*m/rad)
+    double torqueConstant;       // motor torque constant (N*m/A)
+    double currentTimeConstant;  // current loop time constant (s), 0 for ideal current control
+    double countsPerRev;         // encoder quadrature counts per motor revolution
+    double ampsPerBit;           // current per DAC/ADC bit, relative to midrange (A)
+    double potBitsPerRev;        // change of analog input per motor revolution (bits)
+
+    SimAxisModel();
+};
+
+// State of one simulated channel
+struct SimAxisState {
+    double time;                 // simulation time (s)
+    double position;             // motor position (rad)
+    double velocity;             // motor velocity (rad/s)
+    double acceleration;         // motor acceleration (rad/s^2)
+    double current;              // actual motor current (A)
+    double commandedCurrent;     // commanded motor current (A), 0 if amplifier disabled
+    double encoderPosition;      // continuous encoder position (counts, including preload)
+    double encoderVelocity;      // encoder velocity (counts/s)
+    double encoderAcceleration;  // encoder acceleration (counts/s^2)
+
+    SimAxisState();
+};
+
+class SimulatedPort : public BasePort
+{
+public:
+    typedef QLA_Layout Layout;
+    enum { NUM_CHANNELS = Layout::NUM_CHANNELS };
+
+protected:
+
+    // Number of encoder edges kept for the period measurements
+    enum { EDGE_HISTORY = 8 };
+
+    struct SimAxis {
+        SimAxisModel model;
+        SimAxisState state;
+        double countsPerRad;
+        int32_t encoderOffset;      // added to encoder count (set by preload)
+        quadlet_t encoderPreload;   // last preload value written
+        uint16_t dac;               // commanded DAC value
+        // Encoder edge history (ring buffer)
+        int64_t edgeTicks[EDGE_HISTORY];
+        bool edgeDir[EDGE_HISTORY];
+        unsigned char edgeType[EDGE_HISTORY];
+        unsigned long numEdges;
+        unsigned long sameDirEdges;   // consecutive edges in the current direction
+        SimAxisState sampledState;    // state when the read data was last sampled
+    };
+
+    struct SimBoard {
+        bool present;
+        nodeid_t node;
+        bool powerEnable;
+        bool relay;
+        unsigned char ampEnableMask;
+        int64_t lastSampleTicks;      // FPGA clock ticks at last sample
+        double lastSampleTime;        // simulation time of last sample (-1 if none)
+        quadlet_t readBuffer[Layout::READ_SIZE];   // last sampled data (host byte order)
+        unsigned int bcSequence;      // sequence number of broadcast read sampled into readBuffer
+        SimAxis axis[NUM_CHANNELS];
+    };
+
+    SimBoard simBoards[BoardIO::MAX_BOARDS];
+    unsigned char simNodeBoard[MAX_NODES];   // board number for each simulated node
+    nodeid_t numSimNodes;
+    double timeStep;               // 0 for real-time simulation
+    double maxIntegrationStep;
+    double simTime;                // current simulation time (s)
+    int64_t startTime;             // host time at start (real-time simulation)
+    bool isInitialized;
+
+    // Advance the simulation to the specified time
+    void AdvanceTo(double t);
+
+    // Advance one channel by h seconds
+    void StepAxis(SimBoard &board, unsigned int chan, double h);
+
+    // Record encoder edges between encoder positions p0 and p1 (counts), which occurred
+    // during the interval [t0, t0+h]
+    void AddEdges(SimAxis &axis, double t0, double h, double p0, double p1);
+
+    // Advance simulation time for a new read cycle (based on time step or host time)
+    void UpdateTime(bool newCycle);
+
+    // Sample the current state into the read buffer of the board
+    void SampleBoard(unsigned int boardNum);
+
+    // Quadlet values for the read buffer
+    quadlet_t GetStatusQuadlet(unsigned int boardNum) const;
+    quadlet_t GetDigitalQuadlet(const SimBoard &board) const;
+    quadlet_t GetAdcQuadlet(const SimAxis &axis) const;
+    int32_t GetEncoderCount(const SimAxis &axis) const;
+
+    // Apply write data (host byte order)
+    void WriteMotorCurrent(SimBoard &board, unsigned int chan, quadlet_t data);
+    void WriteControl(SimBoard &board, quadlet_t ctrl);
+    bool WriteBoardQuadlet(unsigned int boardNum, nodeaddr_t addr, quadlet_t data);
+
+    //****************** BasePort pure virtual methods ***********************
+
+    bool Init(void);
+    void Cleanup(void) {}
+    nodeid_t InitNodes(void);
+
+    bool ReadQuadletNode(nodeid_t node, nodeaddr_t addr, quadlet_t &data, unsigned char flags = 0);
+    bool WriteQuadletNode(nodeid_t node, nodeaddr_t addr, quadlet_t data, unsigned char flags = 0);
+    bool ReadBlockNode(nodeid_t node, nodeaddr_t addr, quadlet_t *rdata, unsigned int nbytes, unsigned char flags = 0);
+    bool WriteBlockNode(nodeid_t node, nodeaddr_t addr, quadlet_t *wdata, unsigned int nbytes, unsigned char flags = 0);
+
+public:
+    // boardMask:  bit N set to simulate board N (e.g., 0x00c0 for boards 6 and 7)
+    SimulatedPort(unsigned int boardMask = 0x0001, std::ostream &debugStream = std::cerr);
+    ~SimulatedPort();
+
+    // Set model of specified channel (resets the state of the channel)
+    bool SetAxisModel(unsigned char boardId, unsigned int chan, const SimAxisModel &model);
+    bool GetAxisModel(unsigned char boardId, unsigned int chan, SimAxisModel &model) const;
+
+    // Set motor position (rad), with zero velocity
+    bool SetAxisPosition(unsigned char boardId, unsigned int chan, double position);
+
+    // Current state of specified channel
+    bool GetAxisState(unsigned char boardId, unsigned int chan, SimAxisState &state) const;
+
+    // State of specified channel when the read data was last sampled, i.e., the true
+    // values that correspond to the data returned by the last ReadAllBoards.
+    bool GetSampledAxisState(unsigned char boardId, unsigned int chan, SimAxisState &state) const;
+
+    // Simulation time step per read cycle (0 for real-time simulation, which is the default)
+    void SetTimeStep(double dt) { timeStep = (dt > 0.0) ? dt : 0.0; }
+    double GetTimeStep(void) const { return timeStep; }
+
+    // Maximum integration step (default 10 microseconds)
+    void SetMaxIntegrationStep(double h) { if (h > 0.0) maxIntegrationStep = h; }
+    double GetMaxIntegrationStep(void) const { return maxIntegrationStep; }
+
+    double GetSimulationTime(void) const { return simTime; }
+
+    //****************** BasePort pure virtual methods ***********************
+
+    PortType GetPortType(void) const { return PORT_FIREWIRE; }
+
+    int NumberOfUsers(void) { return 1; }
+
+    bool IsOK(void) { return isInitialized; }
+
+    unsigned int GetBusGeneration(void) const { return FwBusGeneration; }
+
+    void UpdateBusGeneration(unsigned int gen) { FwBusGeneration = gen; }
+
+    unsigned int GetPrefixOffset(MsgType) const { return 0; }
+    unsigned int GetWritePostfixSize(void) const { return 0; }
+    unsigned int GetReadPostfixSize(void) const { return 0; }
+    unsigned int GetWriteQuadAlign(void) const { return 0; }
+    unsigned int GetReadQuadAlign(void) const { return 0; }
+
+    unsigned int GetMaxReadDataSize(void) const { return MAX_POSSIBLE_DATA_SIZE; }
+    unsigned int GetMaxWriteDataSize(void) const { return MAX_POSSIBLE_DATA_SIZE; }
+
+    bool WriteBroadcastOutput(quadlet_t *buffer, unsigned int size);
+    bool WriteBroadcastReadRequest(unsigned int seq);
+
+    // The broadcast read data is available immediately
+    void WaitBroadcastRead(void) {}
+    void PromDelay(void) const {}
+};
+
+#endif // __SimulatedPort_H__
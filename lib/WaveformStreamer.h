@@ -0,0 +1,138 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef __WaveformStreamer_H__
+#define __WaveformStreamer_H__
+
+#include "AmpIO.h"
+
+/*
+ * WaveformStreamer
+ *
+ * Streams an arbitrarily long waveform through the 1024-entry FPGA waveform table
+ * (Firmware Rev 7+). The table is treated as two halves of 512 entries: while the
+ * FPGA plays one half, the other half is refilled from the host-side source.
+ *
+ * Each table entry has the format used by WriteWaveformTable:
+ *     | Valid (1) | Ticks (23) | Unused (4) | DOUT4-DOUT1 (4) |
+ * where Ticks is the number of FPGA clocks to hold the digital outputs. An entry
+ * without the valid bit (e.g., 0) terminates the waveform.
+ *
+ * Typical use:
+ *     WaveformStreamer streamer(&board);
+ *     streamer.SetSource(samples, numSamples);
+ *     streamer.Start(0x03);
+ *     while (!streamer.IsFinished()) {
+ *         port->ReadAllBoards();
+ *         ...
+ *         port->WriteAllBoards();
+ *         streamer.Service();    // uses slack at end of cycle
+ *     }
+ *
+ * Service performs one quadlet read (ReadWaveformStatus) and at most one block write,
+ * so that the added time per cycle is bounded. A half is refilled once the FPGA has
+ * finished playing it, using HALF_SIZE/GetMaxChunk block writes (one per call), which
+ * must complete before the FPGA has played the other half (HALF_SIZE table entries);
+ * otherwise, the FPGA plays stale data (see GetUnderrunCount). In addition, the FPGA
+ * read index wraps at TABLE_SIZE, so Service must be called before the FPGA has played
+ * TABLE_SIZE entries; otherwise, the wrap-around is not detected.
+ *
+ * Derived classes can override GetSamples to generate the waveform on the fly, rather
+ * than providing a buffer via SetSource.
+ */
+
+class WaveformStreamer
+{
+public:
+    enum { TABLE_SIZE = 1024,            // must match firmware table size
+           HALF_SIZE = TABLE_SIZE/2 };
+
+    WaveformStreamer(AmpIO *board);
+    virtual ~WaveformStreamer();
+
+    // Set the source buffer (not copied, so it must remain valid while streaming).
+    // If repeat is true, the buffer is played continuously until Stop is called.
+    void SetSource(const quadlet_t *samples, unsigned int numSamples, bool repeat = false);
+
+    // Fill the entire table from the source and start driving the digital outputs
+    // specified by mask. Returns false if the board does not support the waveform
+    // table (Firmware Rev 7+) or if a write fails.
+    bool Start(AmpIO_UInt8 mask);
+
+    // Stop driving the digital outputs. The outputs are left in the state given by bits.
+    bool Stop(AmpIO_UInt8 bits = 0);
+
+    // Update the FPGA read index and refill the consumed half of the table (if any).
+    // Should be called once per real-time cycle, typically after WriteAllBoards.
+    // Returns false if the board could not be accessed.
+    bool Service(void);
+
+    // Returns true if the streamer has been started and the FPGA has not finished playing
+    bool IsActive(void) const { return active; }
+
+    // Returns true if the entire source has been played (or Stop was called)
+    bool IsFinished(void) const { return !active; }
+
+    // Number of times the FPGA read data that had not yet been refilled
+    unsigned int GetUnderrunCount(void) const { return numUnderruns; }
+    void ClearUnderrunCount(void) { numUnderruns = 0; }
+
+    // Total number of table entries played by the FPGA since Start
+    unsigned long GetNumPlayed(void) const { return static_cast<unsigned long>(readPos); }
+
+    // Total number of table entries written since Start
+    unsigned long GetNumWritten(void) const { return static_cast<unsigned long>(writePos); }
+
+    // Most recent FPGA read index (0 to TABLE_SIZE-1)
+    unsigned int GetTableIndex(void) const { return tableIndex; }
+
+protected:
+    AmpIO *Board;
+
+    // Source buffer (see SetSource)
+    const quadlet_t *srcSamples;
+    unsigned int srcSize;
+    unsigned int srcIndex;
+    bool srcRepeat;
+
+    bool active;               // true if waveform is running
+    bool srcDone;              // true if source has no more data
+    AmpIO_UInt8 doutMask;      // digital outputs driven by waveform
+
+    // Positions are measured in table entries since Start. The table holds
+    // entries in the range [writePos-TABLE_SIZE, writePos).
+    uint64_t readPos;          // current FPGA read position
+    uint64_t writePos;         // next position to be written
+    uint64_t endPos;           // position of terminating entry (if srcDone)
+    unsigned int fillRemaining;  // entries remaining to refill current half
+    unsigned int tableIndex;   // last FPGA read index
+    unsigned int numUnderruns;
+
+    // Buffer for one block write to the waveform table
+    quadlet_t writeBuf[HALF_SIZE];
+
+    // Get up to nquads samples from the source. Returns the number of samples
+    // placed in buf; a value less than nquads indicates the end of the waveform.
+    // The default implementation copies from the buffer provided by SetSource.
+    virtual unsigned int GetSamples(quadlet_t *buf, unsigned int nquads);
+
+    // Write nquads entries to the table, starting at writePos (handles end of source)
+    bool WriteEntries(unsigned int nquads);
+
+    // Maximum number of entries that can be written in one block
+    unsigned int GetMaxChunk(void) const;
+};
+
+#endif // __WaveformStreamer_H__
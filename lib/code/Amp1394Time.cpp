@@ -16,6 +16,7 @@ http://www.cisst.org/cisst/license.txt.
 #include "Amp1394Time.h"
 
 #include <time.h>
+#include <errno.h>
 
 #ifdef _MSC_VER   // Windows
 #include <windows.h>
@@ -50,6 +51,30 @@ double Amp1394_GetTime(void)
 #endif
 }
 
+int64_t Amp1394_GetMonotonicTime(void)
+{
+#ifdef _MSC_VER
+    LARGE_INTEGER liTimerFrequency, liTimeNow;
+    if ((QueryPerformanceCounter(&liTimeNow) == 0) ||
+        (QueryPerformanceFrequency(&liTimerFrequency) == 0) ||
+        (liTimerFrequency.QuadPart == 0))
+        return 0;
+    // Split into seconds and remainder to avoid overflow
+    int64_t sec = liTimeNow.QuadPart/liTimerFrequency.QuadPart;
+    int64_t rem = liTimeNow.QuadPart%liTimerFrequency.QuadPart;
+    return sec*1000000000 + (rem*1000000000)/liTimerFrequency.QuadPart;
+#elif defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec)*1000000000 + ts.tv_nsec;
+#else
+    // Fallback (not monotonic)
+    struct timeval currentTime;
+    gettimeofday(&currentTime, NULL);
+    return static_cast<int64_t>(currentTime.tv_sec)*1000000000 + static_cast<int64_t>(currentTime.tv_usec)*1000;
+#endif
+}
+
 // See osaSleep.cpp (cisstOSAbstraction) if support for other platforms needed.
 
 void Amp1394_Sleep(double sec)
@@ -74,3 +99,18 @@ void Amp1394_Sleep(double sec)
     nanosleep(&ts, NULL);
 #endif
 }
+
+void Amp1394_SleepUntil(int64_t monotonicTime)
+{
+#if !defined(_MSC_VER) && defined(CLOCK_MONOTONIC) && defined(TIMER_ABSTIME)
+    struct timespec ts;
+    ts.tv_sec = static_cast<time_t>(monotonicTime/1000000000);
+    ts.tv_nsec = static_cast<long>(monotonicTime%1000000000);
+    // Restart if interrupted by a signal
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+#else
+    int64_t delta = monotonicTime - Amp1394_GetMonotonicTime();
+    if (delta > 0)
+        Amp1394_Sleep(delta*1.0e-9);
+#endif
+}
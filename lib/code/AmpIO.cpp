@@ -113,15 +113,22 @@ void AmpIO::EncoderVelocityData::Init()
     runOverflow = false;
 }
 
-AmpIO::AmpIO(AmpIO_UInt8 board_id, unsigned int numAxes) : BoardIO(board_id), NumAxes(numAxes),
-                                                           firmwareTime(0.0), collect_state(false), collect_cb(0)
+AmpIO::AmpIO(AmpIO_UInt8 board_id, unsigned int numAxes) : RealTimeBoard<QLA_Layout>(board_id), NumAxes(numAxes), readProfile(READ_PROFILE_FULL),
+                                                           firmwareTicks(0), firmwareTicksBase(0), firmwareTimeBase(0.0),
+                                                           collect_state(false), collect_cb(0)
 {
-    memset(ReadBuffer, 0, sizeof(ReadBuffer));
-    InitWriteBuffer();
     for (size_t i = 0; i < NUM_CHANNELS; i++) {
         encVelData[i].Init();
         encErrorCount[i] = 0;
+        encExtCount[i] = 0;
+        encExtLast[i] = 0;
+        encHomeOffset[i] = 0;
+        encExtValid[i] = false;
     }
+    // Based on measurements, approximate wait time is 250-300 msec for the first block;
+    // subsequent blocks are learned on first use.
+    dallasWaitEstimate[0] = 0.25;
+    dallasWaitEstimate[1] = 0.0;
 }
 
 AmpIO::~AmpIO()
@@ -138,45 +145,40 @@ unsigned int AmpIO::GetReadNumBytes() const
     return (GetFirmwareVersion() < 7) ? (ReadBufSize_Old*sizeof(quadlet_t)) : (ReadBufSize*sizeof(quadlet_t));
 }
 
-void AmpIO::SetReadData(const quadlet_t *buf)
+unsigned int AmpIO::GetReadProfileQuads(void) const
 {
     unsigned int numQuads = (GetFirmwareVersion() < 7) ? ReadBufSize_Old : ReadBufSize;
-    size_t i;
-    for (i = 0; i < numQuads; i++)
-        ReadBuffer[i] = bswap_32(buf[i]);
-    for (i = 0; i < NUM_CHANNELS; i++)
-        SetEncoderVelocityData(i);
-    // Add 1 to timestamp because block read clears counter, rather than incrementing
-    firmwareTime += (GetTimestamp()+1)*GetFPGAClockPeriod();
+    if (readProfile == READ_PROFILE_VELOCITY)
+        numQuads = ENC_VEL_OFFSET+NUM_CHANNELS;
+    else if (readProfile == READ_PROFILE_POSITION)
+        numQuads = ENC_POS_OFFSET+NUM_CHANNELS;
+    return numQuads;
 }
 
-void AmpIO::InitWriteBuffer(void)
+void AmpIO::SetReadProfile(ReadProfile profile)
 {
-    quadlet_t data = (BoardId & 0x0F) << 24;
-    for (size_t i = 0; i < NUM_CHANNELS; i++)
-        WriteBuffer[WB_CURR_OFFSET+i] = data;
-    WriteBuffer[WB_CTRL_OFFSET] = 0;
+    readProfile = profile;
+    // Clear data that is not in the profile
+    for (unsigned int i = GetReadProfileQuads(); i < ReadBufSize; i++)
+        ReadBuffer[i] = 0;
 }
 
-bool AmpIO::GetWriteData(quadlet_t *buf, unsigned int offset, unsigned int numQuads, bool doSwap) const
+void AmpIO::SetReadData(const quadlet_t *buf)
 {
-    if ((offset+numQuads) > WriteBufSize) {
-        std::cerr << "AmpIO:GetWriteData: invalid args: " << offset << ", " << numQuads << std::endl;
-        return false;
+    // Copy GetReadProfileQuads quadlets (see GetSeqReadNumBytes)
+    RealTimeBoard<QLA_Layout>::SetReadData(buf);
+    for (size_t i = 0; i < NUM_CHANNELS; i++) {
+        if (readProfile == READ_PROFILE_POSITION) {
+            // No velocity data (overflow, so that GetEncoderVelocity returns 0)
+            encVelData[i].Init();
+            encVelData[i].velOverflow = true;
+        }
+        else
+            SetEncoderVelocityData(i);
+        SetEncoderPositionExtendedData(i);
     }
-
-    for (size_t i = 0; i < numQuads; i++)
-        buf[i] = doSwap ? bswap_32(WriteBuffer[offset+i]) : WriteBuffer[offset+i];
-    return true;
-}
-
-bool AmpIO::WriteBufferResetsWatchdog(void) const
-{
-    return
-        (WriteBuffer[WB_CURR_OFFSET + 0] & VALID_BIT)
-        | (WriteBuffer[WB_CURR_OFFSET + 1] & VALID_BIT)
-        | (WriteBuffer[WB_CURR_OFFSET + 2] & VALID_BIT)
-        | (WriteBuffer[WB_CURR_OFFSET + 3] & VALID_BIT);
+    // Add 1 to timestamp because block read clears counter, rather than incrementing
+    firmwareTicks += GetTimestamp()+1;
 }
 
 AmpIO_UInt32 AmpIO::GetFirmwareVersion(void) const
@@ -184,54 +186,170 @@ AmpIO_UInt32 AmpIO::GetFirmwareVersion(void) const
     return (port ? port->GetFirmwareVersion(BoardId) : 0);
 }
 
-std::string AmpIO::GetFPGASerialNumber(void)
+std::string AmpIO::ParseFPGASerialNumber(const char *data)
 {
     // Format: FPGA 1234-56 (12 bytes) or FPGA 1234-567 (13 bytes).
     // Note that on PROM, the string is terminated by 0xff because the sector
     // is first erased (all bytes set to 0xff) before the string is written.
-    AmpIO_UInt32 address = 0x001FFF00;
-    char data[20];
-    std::string sn;
     const size_t FPGASNSize = 13;
-    const size_t bytesToRead = (FPGASNSize+3)&0xFC;  // must be multiple of 4
-
-    data[FPGASNSize] = 0;    // Make sure null-terminated
-    if (PromReadData(address, (AmpIO_UInt8 *)data, bytesToRead)) {
-        if (strncmp(data, "FPGA ", 5) == 0) {
-            char *p = strchr(data+5, 0xff);
-            if (p) *p = 0;      // Null terminate at first 0xff
-            sn.assign(data+5);
-        }
+    char buf[FPGASNSize+1];
+    memcpy(buf, data, FPGASNSize);
+    buf[FPGASNSize] = 0;     // Make sure null-terminated
+    std::string sn;
+    if (strncmp(buf, "FPGA ", 5) == 0) {
+        char *p = strchr(buf+5, 0xff);
+        if (p) *p = 0;      // Null terminate at first 0xff
+        sn.assign(buf+5);
     }
-    else
-        std::cerr << "AmpIO::GetFPGASerialNumber: failed to read FPGA Serial Number" << std::endl;
     return sn;
 }
 
-std::string AmpIO::GetQLASerialNumber(void)
+std::string AmpIO::ParseQLASerialNumber(const char *data)
 {
     // Format: QLA 1234-56 or QLA 1234-567.
     // String is terminated by 0 or 0xff.
-    AmpIO_UInt16 address = 0x0000;
-    AmpIO_UInt8 data[20];
     const size_t QLASNSize = 12;
+    char buf[QLASNSize+1];
+    for (size_t i = 0; i < QLASNSize; i++)
+        buf[i] = (static_cast<unsigned char>(data[i]) == 0xff) ? 0 : data[i];
+    buf[QLASNSize] = 0;  // make sure null-terminated
     std::string sn;
+    if (strncmp(buf, "QLA ", 4) == 0)
+        sn.assign(buf+4);
+    return sn;
+}
 
-    data[QLASNSize] = 0;  // make sure null-terminated
-    for (size_t i = 0; i < QLASNSize; i++) {
-        if (!PromReadByte25AA128(address, data[i])) {
-            std::cerr << "AmpIO::GetQLASerialNumber: failed to get QLA Serial Number" << std::endl;
-            break;
+std::string AmpIO::GetFPGASerialNumber(void)
+{
+    AmpIO_UInt32 address = 0x001FFF00;
+    char data[16];
+    std::string sn;
+    const size_t bytesToRead = sizeof(data);  // must be multiple of 4
+
+    if (PromReadData(address, (AmpIO_UInt8 *)data, bytesToRead))
+        sn = ParseFPGASerialNumber(data);
+    else
+        std::cerr << "AmpIO::GetFPGASerialNumber: failed to read FPGA Serial Number" << std::endl;
+    return sn;
+}
+
+std::string AmpIO::GetQLASerialNumber(void)
+{
+    AmpIO_UInt16 address = 0x0000;
+    quadlet_t data[4];   // 16 bytes, serial number is at most 12
+    AmpIO_UInt8 *bytes = reinterpret_cast<AmpIO_UInt8 *>(data);
+
+    // Use a single block read; if that fails, or does not contain a valid serial number
+    // (the "QLA " prefix also checks the byte order of the block data), read one byte at a time
+    std::string sn;
+    if (PromReadBlock25AA128(address, data, sizeof(data)/sizeof(quadlet_t)))
+        sn = ParseQLASerialNumber(reinterpret_cast<const char *>(bytes));
+    if (sn.empty()) {
+        for (size_t i = 0; i < 12; i++) {
+            if (!PromReadByte25AA128(address, bytes[i])) {
+                std::cerr << "AmpIO::GetQLASerialNumber: failed to get QLA Serial Number" << std::endl;
+                return std::string();
+            }
+            address += 1;
         }
-        if (data[i] == 0xff)
-            data[i] = 0;
-        address += 1;
+        sn = ParseQLASerialNumber(reinterpret_cast<const char *>(bytes));
     }
-    if (strncmp((char *)data, "QLA ", 4) == 0)
-        sn.assign((char *)data+4);
     return sn;
 }
 
+bool AmpIO::BoardInfoIsCurrent(void) const
+{
+    return boardInfo.valid && port && (boardInfo.busGeneration == port->GetBusGeneration());
+}
+
+void AmpIO::SetBoardInfoCommon(void)
+{
+    // Firmware version is already known by the port; Ethernet presence and IP address
+    // each require a quadlet read.
+    boardInfo.firmwareVersion = GetFirmwareVersion();
+    boardInfo.hasEthernet = HasEthernet();
+    boardInfo.ipv4Address = (boardInfo.hasEthernet && (boardInfo.firmwareVersion >= 7)) ? ReadIPv4Address() : 0;
+    boardInfo.busGeneration = port->GetBusGeneration();
+    boardInfo.valid = true;
+}
+
+const AmpIO::BoardInfo &AmpIO::GetBoardInfo(void)
+{
+    if (port && !BoardInfoIsCurrent()) {
+        boardInfo.fpgaSerial = GetFPGASerialNumber();
+        boardInfo.qlaSerial = GetQLASerialNumber();
+        SetBoardInfoCommon();
+    }
+    return boardInfo;
+}
+
+unsigned int AmpIO::ReadBoardInfoAll(BasePort *port, bool forceRead)
+{
+    if (!port) return 0;
+
+    AmpIO *boards[BoardIO::MAX_BOARDS];
+    unsigned int numBoards = 0;
+    unsigned int bnum;
+    for (bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+        AmpIO *board = dynamic_cast<AmpIO *>(port->GetBoard(bnum));
+        if (board && (forceRead || !board->BoardInfoIsCurrent()))
+            boards[numBoards++] = board;
+    }
+    if (numBoards == 0)
+        return 0;
+
+    // If there is only one board, the broadcast commands do not save any time
+    if (numBoards == 1) {
+        boards[0]->InvalidateBoardInfo();
+        boards[0]->GetBoardInfo();
+        return 1;
+    }
+
+    unsigned int i;
+    char data[16];
+    // FPGA serial number: broadcast the PROM read command (see PromReadData) and then
+    // read the result from each board. Boards that do not respond are read individually.
+    bool bcOK = WriteQuadletAll(port, 0x08, 0x03000000|0x001FFF00);
+    if (bcOK)
+        Amp1394_Sleep(0.0001);  // approximately 83 usec to read 256 bytes
+    for (i = 0; i < numBoards; i++) {
+        AmpIO *board = boards[i];
+        bool ok = false;
+        if (bcOK) {
+            quadlet_t status = 0x000f;
+            for (int j = 0; (j < 8) && (status&0x000f); j++) {
+                if (j > 0) Amp1394_Sleep(0.00001);
+                if (!port->ReadQuadlet(board->BoardId, 0x08, status))
+                    break;
+            }
+            // Result should be the number of quadlets read (see PromReadData)
+            AmpIO_UInt32 nRead = 0;
+            nodeaddr_t address = (board->GetFirmwareVersion() >= 4) ? 0x2000 : 0xc0;
+            ok = ((status&0x000f) == 0) && board->PromGetResult(nRead) && (nRead*4 == 256) &&
+                 port->ReadBlock(board->BoardId, address, reinterpret_cast<quadlet_t *>(data), sizeof(data));
+        }
+        board->boardInfo.fpgaSerial = ok ? ParseFPGASerialNumber(data) : board->GetFPGASerialNumber();
+    }
+
+    // QLA serial number: broadcast the 25AA128 block read command (see PromReadBlock25AA128)
+    quadlet_t write_data = 0xFE000000|(sizeof(data)/sizeof(quadlet_t)-1);
+    bcOK = WriteQuadletAll(port, boards[0]->GetPromAddress(PROM_25AA128, true), write_data);
+    if (bcOK)
+        port->PromDelay();
+    for (i = 0; i < numBoards; i++) {
+        AmpIO *board = boards[i];
+        bool ok = bcOK && port->ReadBlock(board->BoardId, board->GetPromAddress(PROM_25AA128, true),
+                                          reinterpret_cast<quadlet_t *>(data), sizeof(data));
+        if (ok)
+            board->boardInfo.qlaSerial = ParseQLASerialNumber(data);
+        // If not valid, read individually (which falls back to byte reads)
+        if (!ok || board->boardInfo.qlaSerial.empty())
+            board->boardInfo.qlaSerial = board->GetQLASerialNumber();
+        board->SetBoardInfoCommon();
+    }
+    return numBoards;
+}
+
 void AmpIO::DisplayReadBuffer(std::ostream &out) const
 {
     // first two quadlets are timestamp and status, resp.
@@ -268,26 +386,11 @@ bool AmpIO::HasEthernet(void) const
     return (read_data&0x80000000);
 }
 
-AmpIO_UInt32 AmpIO::GetStatus(void) const
-{
-    return ReadBuffer[STATUS_OFFSET];
-}
-
-AmpIO_UInt32 AmpIO::GetTimestamp(void) const
-{
-    return ReadBuffer[TIMESTAMP_OFFSET];
-}
-
 double AmpIO::GetTimestampSeconds(void) const
 {
     return GetTimestamp()*GetFPGAClockPeriod();
 }
 
-AmpIO_UInt32 AmpIO::GetDigitalInput(void) const
-{
-    return ReadBuffer[DIGIO_OFFSET];
-}
-
 AmpIO_UInt8 AmpIO::GetDigitalOutput(void) const
 {
     // Starting with Version 1.3.0 of this library, the digital outputs are inverted
@@ -353,37 +456,36 @@ AmpIO_UInt8 AmpIO::GetAmpTemperature(unsigned int index) const
     return temp;
 }
 
-AmpIO_UInt32 AmpIO::GetMotorCurrent(unsigned int index) const
+void AmpIO::SetEncoderPositionExtendedData(unsigned int index)
 {
-    if (index >= NUM_CHANNELS)
-        return 0L;
-
-    quadlet_t buff;
-    buff = ReadBuffer[index+MOTOR_CURR_OFFSET];
-    buff &= MOTOR_CURR_MASK;       // mask for applicable bits
-
-    return static_cast<AmpIO_UInt32>(buff) & ADC_MASK;
+    AmpIO_UInt32 raw = ReadBuffer[index+ENC_POS_OFFSET] & ENC_POS_MASK;
+    if (encExtValid[index]) {
+        // Change since last read, modulo 2^24 (sign-extended from 24 bits). The overflow
+        // bit is not needed, since the wrap is detected from the change.
+        AmpIO_Int32 delta = static_cast<AmpIO_Int32>(((raw-encExtLast[index]) & ENC_POS_MASK) ^ ENC_MIDRANGE) - ENC_MIDRANGE;
+        encExtCount[index] += delta;
+    }
+    else {
+        encExtCount[index] = static_cast<AmpIO_Int32>(raw) - ENC_MIDRANGE;
+        encExtValid[index] = true;
+    }
+    encExtLast[index] = raw;
 }
 
-AmpIO_UInt32 AmpIO::GetAnalogInput(unsigned int index) const
+int64_t AmpIO::GetEncoderPositionExtended(unsigned int index) const
 {
-    if (index >= NUM_CHANNELS)
-        return 0L;
-
-    quadlet_t buff;
-    buff = ReadBuffer[index+ANALOG_POS_OFFSET];
-    buff &= ANALOG_POS_MASK;       // mask for applicable bits
-    buff >>= 16;                   // shift to lsb alignment
+    return (index < NUM_CHANNELS) ? encExtCount[index] + encHomeOffset[index] : 0;
+}
 
-    return static_cast<AmpIO_UInt32>(buff) & ADC_MASK;
+void AmpIO::SetEncoderPositionExtended(unsigned int index, int64_t pos)
+{
+    if (index < NUM_CHANNELS)
+        encHomeOffset[index] = pos - encExtCount[index];
 }
 
-AmpIO_Int32 AmpIO::GetEncoderPosition(unsigned int index) const
+int64_t AmpIO::GetEncoderHomeOffset(unsigned int index) const
 {
-    if (index < NUM_CHANNELS) {
-        return static_cast<AmpIO_Int32>(ReadBuffer[index + ENC_POS_OFFSET] & ENC_POS_MASK) - ENC_MIDRANGE;
-    }
-    return 0;
+    return (index < NUM_CHANNELS) ? encHomeOffset[index] : 0;
 }
 
 bool AmpIO::GetEncoderOverflow(unsigned int index) const
@@ -947,6 +1049,27 @@ AmpIO_UInt32 AmpIO::ReadIPv4Address(void) const
  * Write commands
  */
 
+bool AmpIO::WriteQuadletDeferrable(nodeaddr_t addr, quadlet_t data)
+{
+    if (!port) return false;
+    if (deferWrites && QueueDeferredWrite(addr, data))
+        return true;
+    return WriteQuadletImmediate(addr, data);
+}
+
+void AmpIO::FlushDeferred(void)
+{
+    if (port && (deferredCount > 0))
+        port->FlushDeferredWrites(this);
+}
+
+bool AmpIO::WriteQuadletImmediate(nodeaddr_t addr, quadlet_t data)
+{
+    if (!port) return false;
+    FlushDeferred();
+    return port->WriteQuadlet(BoardId, addr, data);
+}
+
 bool AmpIO::WriteReboot(void)
 {
     if (GetFirmwareVersion() < 7) {
@@ -955,26 +1078,27 @@ bool AmpIO::WriteReboot(void)
         std::cerr << "AmpIO::WriteReboot: requires firmware 7 or above" << std::endl;
         return false;
     }
+    InvalidateBoardInfo();
     AmpIO_UInt32 write_data = REBOOT_FPGA;
-    return (port ? port->WriteQuadlet(BoardId, 0, write_data) : false);
+    return (port ? WriteQuadletImmediate(0, write_data) : false);
 }
 
 bool AmpIO::WritePowerEnable(bool state)
 {
     AmpIO_UInt32 write_data = state ? PWR_ENABLE : PWR_DISABLE;
-    return (port ? port->WriteQuadlet(BoardId, 0, write_data) : false);
+    return (port ? WriteQuadletImmediate(0, write_data) : false);
 }
 
 bool AmpIO::WriteAmpEnable(AmpIO_UInt8 mask, AmpIO_UInt8 state)
 {
     quadlet_t write_data = (mask << 8) | state;
-    return (port ? port->WriteQuadlet(BoardId, 0, write_data) : false);
+    return WriteQuadletDeferrable(0, write_data);
 }
 
 bool AmpIO::WriteSafetyRelay(bool state)
 {
     AmpIO_UInt32 write_data = state ? RELAY_ON : RELAY_OFF;
-    return (port ? port->WriteQuadlet(BoardId, 0, write_data) : false);
+    return (port ? WriteQuadletImmediate(0, write_data) : false);
 }
 
 bool AmpIO::WriteEncoderPreload(unsigned int index, AmpIO_Int32 sdata)
@@ -987,15 +1111,22 @@ bool AmpIO::WriteEncoderPreload(unsigned int index, AmpIO_Int32 sdata)
     }
     bool ret = false;
     if (port && (index < NUM_CHANNELS)) {
-        ret = port->WriteQuadlet(BoardId, channel | ENC_LOAD_OFFSET,
-                                 static_cast<AmpIO_UInt32>(sdata + ENC_MIDRANGE));
+        // Not deferred: the extended position is re-seeded by the next read, which must
+        // therefore see the preloaded counter rather than the old one.
+        ret = WriteQuadletImmediate(channel | ENC_LOAD_OFFSET,
+                                    static_cast<AmpIO_UInt32>(sdata + ENC_MIDRANGE));
+    }
+    if (ret) {
+        // Extended position is set to the preload value by the next read
+        encExtValid[index] = false;
+        encHomeOffset[index] = 0;
     }
     return ret;
 }
 
 bool AmpIO::WriteDoutConfigReset(void)
 {
-    return (port && (GetFirmwareVersion() >= 7)) ? port->WriteQuadlet(BoardId, 0, DOUT_CFG_RESET) : false;
+    return (port && (GetFirmwareVersion() >= 7)) ? WriteQuadletImmediate(0, DOUT_CFG_RESET) : false;
 }
 
 bool AmpIO::WriteDigitalOutput(AmpIO_UInt8 mask, AmpIO_UInt8 bits)
@@ -1010,7 +1141,7 @@ bool AmpIO::WriteDigitalOutput(AmpIO_UInt8 mask, AmpIO_UInt8 bits)
     // This way, the digital output state matches the hardware state (i.e., 0 means digital output
     // is at 0V).
     quadlet_t write_data = (mask << 8) | ((~bits)&0x0f);
-    return port->WriteQuadlet(BoardId, 6, write_data);
+    return WriteQuadletDeferrable(6, write_data);
 }
 
 bool AmpIO::WriteWaveformControl(AmpIO_UInt8 mask, AmpIO_UInt8 bits)
@@ -1018,13 +1149,13 @@ bool AmpIO::WriteWaveformControl(AmpIO_UInt8 mask, AmpIO_UInt8 bits)
     quadlet_t write_data = (mask << 8) | ((~bits)&0x0f);
     if (mask != 0)
         write_data |= VALID_BIT;  // Same valid bit as motor current
-    return port->WriteQuadlet(BoardId, 6, write_data);
+    return WriteQuadletImmediate(6, write_data);
 }
 
 bool AmpIO::WriteWatchdogPeriod(AmpIO_UInt32 counts)
 {
     // period = counts(16 bits) * 5.208333 us (0 = no timeout)
-    return port->WriteQuadlet(BoardId, 3, counts);
+    return WriteQuadletDeferrable(3, counts);
 }
 
 bool AmpIO::WriteWatchdogPeriodInSeconds(const double seconds)
@@ -1058,7 +1189,7 @@ bool AmpIO::WriteDoutControl(unsigned int index, AmpIO_UInt16 countsHigh, AmpIO_
         // Starting with Version 1.3.0 of this library, we swap the high and low times
         // because the digital outputs are inverted in hardware.
         AmpIO_UInt32 counts = (static_cast<AmpIO_UInt32>(countsLow) << 16) | countsHigh;
-        return port->WriteQuadlet(BoardId, channel | DOUT_CTRL_OFFSET, counts);
+        return WriteQuadletDeferrable(channel | DOUT_CTRL_OFFSET, counts);
     } else {
         return false;
     }
@@ -1104,7 +1235,7 @@ bool AmpIO::WriteIPv4Address(AmpIO_UInt32 IPaddr)
         std::cerr << "AmpIO::WriteIPv4Address: requires firmware 7 or above" << std::endl;
         return false;
     }
-    return (port ? port->WriteQuadlet(BoardId, 11, IPaddr) : false);
+    return (port ? WriteQuadletImmediate(11, IPaddr) : false);
 }
 
 AmpIO_UInt32 AmpIO::GetDoutCounts(double time) const
@@ -1119,30 +1250,44 @@ AmpIO_UInt32 AmpIO::GetDoutCounts(double time) const
  * WriteAmpEnable, ...), but are sent to the broadcast address (FW_NODE_BROADCAST).
  */
 
+bool AmpIO::WriteQuadletAll(BasePort *port, nodeaddr_t addr, quadlet_t data)
+{
+    if (!port) return false;
+    // Send deferred writes first, so that the broadcast write cannot overtake them
+    port->FlushDeferredWrites();
+    return port->WriteQuadlet(FW_NODE_BROADCAST, addr, data);
+}
+
 bool AmpIO::WriteRebootAll(BasePort *port)
 {
     // Note that Firmware V7+ supports the reboot command; earlier versions of
     // firmware will instead perform a limited reset.
+    if (!port) return false;
+    for (unsigned int bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+        AmpIO *board = dynamic_cast<AmpIO *>(port->GetBoard(bnum));
+        if (board)
+            board->InvalidateBoardInfo();
+    }
     AmpIO_UInt32 write_data = REBOOT_FPGA;
-    return (port ? port->WriteQuadlet(FW_NODE_BROADCAST, 0, write_data) : false);
+    return WriteQuadletAll(port, 0, write_data);
 }
 
 bool AmpIO::WritePowerEnableAll(BasePort *port, bool state)
 {
     AmpIO_UInt32 write_data = state ? PWR_ENABLE : PWR_DISABLE;
-    return (port ? port->WriteQuadlet(FW_NODE_BROADCAST, 0, write_data) : false);
+    return (port ? WriteQuadletAll(port, 0, write_data) : false);
 }
 
 bool AmpIO::WriteAmpEnableAll(BasePort *port, AmpIO_UInt8 mask, AmpIO_UInt8 state)
 {
     quadlet_t write_data = (mask << 8) | state;
-    return (port ? port->WriteQuadlet(FW_NODE_BROADCAST, 0, write_data) : false);
+    return (port ? WriteQuadletAll(port, 0, write_data) : false);
 }
 
 bool AmpIO::WriteSafetyRelayAll(BasePort *port, bool state)
 {
     AmpIO_UInt32 write_data = state ? RELAY_ON : RELAY_OFF;
-    return (port ? port->WriteQuadlet(FW_NODE_BROADCAST, 0, write_data) : false);
+    return (port ? WriteQuadletAll(port, 0, write_data) : false);
 }
 
 bool AmpIO::WriteEncoderPreloadAll(BasePort *port, unsigned int index, AmpIO_Int32 sdata)
@@ -1155,15 +1300,25 @@ bool AmpIO::WriteEncoderPreloadAll(BasePort *port, unsigned int index, AmpIO_Int
     }
     bool ret = false;
     if (port && (index < NUM_CHANNELS)) {
-        ret = port->WriteQuadlet(FW_NODE_BROADCAST, channel | ENC_LOAD_OFFSET,
-                                 static_cast<AmpIO_UInt32>(sdata + ENC_MIDRANGE));
+        ret = WriteQuadletAll(port, channel | ENC_LOAD_OFFSET,
+                              static_cast<AmpIO_UInt32>(sdata + ENC_MIDRANGE));
+    }
+    if (ret) {
+        // Extended position of all boards on the port is set to the preload value by the next read
+        for (unsigned int bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+            AmpIO *board = dynamic_cast<AmpIO *>(port->GetBoard(bnum));
+            if (board) {
+                board->encExtValid[index] = false;
+                board->encHomeOffset[index] = 0;
+            }
+        }
     }
     return ret;
 }
 
 bool AmpIO::ResetKSZ8851All(BasePort *port) {
     quadlet_t write_data = RESET_KSZ8851;
-    return (port ? port->WriteQuadlet(FW_NODE_BROADCAST, 12, write_data) : false);
+    return (port ? WriteQuadletAll(port, 12, write_data) : false);
 }
 
 /*******************************************************************************
@@ -1176,7 +1331,7 @@ AmpIO_UInt32 AmpIO::PromGetId(void)
 {
     AmpIO_UInt32 id = 0;
     quadlet_t data = 0x9f000000;
-    if (port->WriteQuadlet(BoardId, 0x08, data)) {
+    if (WriteQuadletImmediate(0x08, data)) {
         port->PromDelay();
         // Should be ready by now...
         PromGetResult(id);
@@ -1189,7 +1344,7 @@ bool AmpIO::PromGetStatus(AmpIO_UInt32 &status, PromType type)
     quadlet_t data = 0x05000000;
     nodeaddr_t address = GetPromAddress(type, true);
 
-    bool ret = port->WriteQuadlet(BoardId, address, data);
+    bool ret = WriteQuadletImmediate(address, data);
     if (ret) {
         port->PromDelay();
         // Should be ready by now...
@@ -1220,7 +1375,7 @@ bool AmpIO::PromReadData(AmpIO_UInt32 addr, AmpIO_UInt8 *data,
     while (page < nbytes) {
         const unsigned int maxReadSize = 64u;
         unsigned int bytesToRead = ((nbytes-page)<maxReadSize) ? (nbytes-page) : maxReadSize;
-        if (!port->WriteQuadlet(BoardId, 0x08, write_data))
+        if (!WriteQuadletImmediate(0x08, write_data))
             return false;
         // Read FPGA status register; if 4 LSB are 0, command has finished.
         // The IEEE-1394 clock is 24.576 MHz, so it should take
@@ -1271,21 +1426,21 @@ bool AmpIO::PromWriteEnable(PromType type)
 {
     quadlet_t write_data = 0x06000000;
     nodeaddr_t address = GetPromAddress(type, true);
-    return port->WriteQuadlet(BoardId, address, write_data);
+    return WriteQuadletImmediate(address, write_data);
 }
 
 bool AmpIO::PromWriteDisable(PromType type)
 {
     quadlet_t write_data = 0x04000000;
     nodeaddr_t address = GetPromAddress(type, true);
-    return port->WriteQuadlet(BoardId, address, write_data);
+    return WriteQuadletImmediate(address, write_data);
 }
 
 bool AmpIO::PromSectorErase(AmpIO_UInt32 addr, const ProgressCallback cb)
 {
     PromWriteEnable();
     quadlet_t write_data = 0xd8000000 | (addr&0x00ffffff);
-    if (!port->WriteQuadlet(BoardId, 0x08, write_data))
+    if (!WriteQuadletImmediate(0x08, write_data))
         return false;
     // Wait for erase to finish
     AmpIO_UInt32 status;
@@ -1325,6 +1480,7 @@ int AmpIO::PromProgramPage(AmpIO_UInt32 addr, const AmpIO_UInt8 *bytes,
     nodeaddr_t address;
     if (fver >= 4) {address = 0x2000;}
     else {address = 0xc0;}
+    FlushDeferred();
     if (!port->WriteBlock(BoardId, address, data_ptr, nbytes+sizeof(quadlet_t))) {
         std::ostringstream msg;
         msg << "AmpIO::PromProgramPage: failed to write block, nbytes = " << nbytes;
@@ -1401,7 +1557,7 @@ bool AmpIO::PromReadByte25AA128(AmpIO_UInt16 addr, AmpIO_UInt8 &data)
     quadlet_t write_data = 0x03000000|(addr << 8);
     nodeaddr_t address = GetPromAddress(PROM_25AA128, true);
 
-    if (port->WriteQuadlet(BoardId, address, write_data)) {
+    if (WriteQuadletImmediate(address, write_data)) {
         port->PromDelay();
         // Should be ready by now...
         if (!PromGetResult(result, PROM_25AA128))
@@ -1424,7 +1580,7 @@ bool AmpIO::PromWriteByte25AA128(AmpIO_UInt16 addr, const AmpIO_UInt8 &data)
     // 8-bit cmd + 16-bit addr + 8-bit data
     quadlet_t write_data = 0x02000000|(addr << 8)|data;
     nodeaddr_t address = GetPromAddress(PROM_25AA128, true);
-    if (port->WriteQuadlet(BoardId, address, write_data)) {
+    if (WriteQuadletImmediate(address, write_data)) {
         // wait 5ms for the PROM to be ready to take new commands
         Amp1394_Sleep(0.005);
         return true;
@@ -1446,8 +1602,9 @@ bool AmpIO::PromReadBlock25AA128(AmpIO_UInt16 addr, quadlet_t *data, unsigned in
     // trigger read
     quadlet_t write_data = 0xFE000000|(addr << 8)|(nquads-1);
     nodeaddr_t address = GetPromAddress(PROM_25AA128, true);
-    if (!port->WriteQuadlet(BoardId, address, write_data))
+    if (!WriteQuadletImmediate(address, write_data))
         return false;
+    port->PromDelay();
 
     // get result
     if (!port->ReadBlock(BoardId, address, data, nquads * 4))
@@ -1467,6 +1624,7 @@ bool AmpIO::PromWriteBlock25AA128(AmpIO_UInt16 addr, quadlet_t *data, unsigned i
     }
 
     // block write data to buffer
+    FlushDeferred();
     if (!port->WriteBlock(BoardId, 0x3100, data, nquads*sizeof(quadlet_t)))
         return false;
 
@@ -1476,14 +1634,14 @@ bool AmpIO::PromWriteBlock25AA128(AmpIO_UInt16 addr, quadlet_t *data, unsigned i
     // trigger write
     quadlet_t write_data = 0xFF000000|(addr << 8)|(nquads-1);
     nodeaddr_t address = GetPromAddress(PROM_25AA128, true);
-    return port->WriteQuadlet(BoardId, address, write_data);
+    return WriteQuadletImmediate(address, write_data);
 }
 
 // ********************** Dallas DS2505 (1-wire) Methods ****************************************
 bool AmpIO::DallasWriteControl(AmpIO_UInt32 ctrl)
 {
     if (GetFirmwareVersion() < 7) return false;
-    return port->WriteQuadlet(BoardId, 13, ctrl);
+    return WriteQuadletImmediate(13, ctrl);
 }
 
 
@@ -1511,6 +1669,37 @@ bool AmpIO::DallasWaitIdle()
     return (i < 500);
 }
 
+bool AmpIO::DallasWaitIdleAdaptive(unsigned int index)
+{
+    const double timeout = 0.5;      // 500 msec, same as DallasWaitIdle
+    const double pollTime = 0.0002;  // 200 usec
+    double estimate = dallasWaitEstimate[index];
+    double startTime = Amp1394_GetTime();
+    // Sleep for most of the expected time, then poll
+    Amp1394_Sleep((estimate > 0.0) ? 0.9*estimate : pollTime);
+    AmpIO_UInt32 status;
+    unsigned int numPolls = 0;
+    double waitTime;
+    for (;;) {
+        if (!DallasReadStatus(status)) return false;
+        numPolls++;
+        waitTime = Amp1394_GetTime()-startTime;
+        // Done when in idle state
+        if ((status&0x000000F0) == 0)
+            break;
+        if (waitTime > timeout)
+            return false;
+        Amp1394_Sleep(pollTime);
+    }
+    // If already idle on the first poll, the estimate may be too high, so reduce it;
+    // otherwise, use the measured time.
+    if ((numPolls == 1) && (estimate > 0.0))
+        dallasWaitEstimate[index] = 0.8*estimate;
+    else
+        dallasWaitEstimate[index] = waitTime;
+    return true;
+}
+
 bool AmpIO::DallasReadMemory(unsigned short addr, unsigned char *data, unsigned int nbytes)
 {
     if (GetFirmwareVersion() < 7) return false;
@@ -1518,7 +1707,7 @@ bool AmpIO::DallasReadMemory(unsigned short addr, unsigned char *data, unsigned
     // Check whether bi-directional I/O is available
     if ((status & 0x00300000) != 0x00300000) return false;
     if (!DallasWriteControl((addr<<16)|2)) return false;
-    if (!DallasWaitIdle()) return false;
+    if (!DallasWaitIdleAdaptive(0)) return false;
     if (!DallasReadStatus(status)) return false;
     // Check family_code, dout_cfg_bidir, ds_reset, and ds_enable
     if ((status & 0xFF00000F) != 0x0B00000B) return false;
@@ -1532,7 +1721,7 @@ bool AmpIO::DallasReadMemory(unsigned short addr, unsigned char *data, unsigned
     // Read additional blocks of data if necessary
     while (nbytes > 0) {
         if (!DallasWriteControl(3)) return false;
-        if (!DallasWaitIdle()) return false;
+        if (!DallasWaitIdleAdaptive(1)) return false;
         nb = (nbytes>256) ? 256 : nbytes;
         if (!port->ReadBlock(BoardId, address, reinterpret_cast<quadlet_t *>(ptr), nb)) return false;
         ptr += nb;
@@ -1547,28 +1736,28 @@ bool AmpIO::ResetKSZ8851()
 {
     if (GetFirmwareVersion() < 5) return false;
     quadlet_t write_data = RESET_KSZ8851;
-    return port->WriteQuadlet(BoardId, 12, write_data);
+    return WriteQuadletImmediate(12, write_data);
 }
 
 bool AmpIO::WriteKSZ8851Reg(AmpIO_UInt8 addr, const AmpIO_UInt8 &data)
 {
     if (GetFirmwareVersion() < 5) return false;
     quadlet_t write_data = 0x02000000 | (static_cast<quadlet_t>(addr) << 16) | data;
-    return port->WriteQuadlet(BoardId, 12, write_data);
+    return WriteQuadletImmediate(12, write_data);
 }
 
 bool AmpIO::WriteKSZ8851Reg(AmpIO_UInt8 addr, const AmpIO_UInt16 &data)
 {
     if (GetFirmwareVersion() < 5) return false;
     quadlet_t write_data = 0x03000000 | (static_cast<quadlet_t>(addr) << 16) | data;
-    return port->WriteQuadlet(BoardId, 12, write_data);
+    return WriteQuadletImmediate(12, write_data);
 }
 
 bool AmpIO::ReadKSZ8851Reg(AmpIO_UInt8 addr, AmpIO_UInt8 &rdata)
 {
     if (GetFirmwareVersion() < 5) return false;
     quadlet_t write_data = (static_cast<quadlet_t>(addr) << 16) | rdata;
-    if (!port->WriteQuadlet(BoardId, 12, write_data))
+    if (!WriteQuadletImmediate(12, write_data))
         return false;
     quadlet_t read_data;
     if (!port->ReadQuadlet(BoardId, 12, read_data))
@@ -1585,7 +1774,7 @@ bool AmpIO::ReadKSZ8851Reg(AmpIO_UInt8 addr, AmpIO_UInt16 &rdata)
 {
     if (GetFirmwareVersion() < 5) return false;
     quadlet_t write_data = 0x01000000 | (static_cast<quadlet_t>(addr) << 16) | rdata;
-    if (!port->WriteQuadlet(BoardId, 12, write_data)) {
+    if (!WriteQuadletImmediate(12, write_data)) {
         std::cout << "WriteQuadlet failed" << std::endl;
         return false;
     }
@@ -1610,14 +1799,14 @@ bool AmpIO::WriteKSZ8851DMA(const AmpIO_UInt16 &data)
 {
     if (GetFirmwareVersion() < 5) return false;
     quadlet_t write_data = 0x0B000000 | data;
-    return port->WriteQuadlet(BoardId, 12, write_data);
+    return WriteQuadletImmediate(12, write_data);
 }
 
 bool AmpIO::ReadKSZ8851DMA(AmpIO_UInt16 &rdata)
 {
     if (GetFirmwareVersion() < 5) return false;
     quadlet_t write_data = 0x09000000 | rdata;
-    if (!port->WriteQuadlet(BoardId, 12, write_data))
+    if (!WriteQuadletImmediate(12, write_data))
         return false;
     quadlet_t read_data;
     if (!port->ReadQuadlet(BoardId, 12, read_data))
@@ -1704,6 +1893,7 @@ bool AmpIO::WriteWaveformTable(const quadlet_t *buffer, unsigned short offset, u
     // Byteswap and invert digital output bits (see WriteDigitalOutput and GetDigitalOutput)
     for (unsigned short i = 0; i < nquads; i++)
         localBuffer[i] = bswap_32(buffer[i]^0x0000000f);
+    FlushDeferred();
     return port->WriteBlock(BoardId, address, localBuffer, nquads*sizeof(quadlet_t));
 }
 
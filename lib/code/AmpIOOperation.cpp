@@ -0,0 +1,408 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <string.h>
+#include <sstream>
+
+#include "AmpIOOperation.h"
+#include "BasePort.h"
+#include "Amp1394Time.h"
+#include "Amp1394BSwap.h"
+
+// Wait times and timeouts, in seconds
+const double PROM_DELAY           = 0.001;    // between PROM command and result (see EthBasePort::PromDelay)
+const double PROM_ERASE_TIMEOUT   = 5.0;      // sector erase (M25P16 maximum is 3 sec)
+const double PROM_PROGRAM_POLL    = 0.00005;  // 50 usec
+const double PROM_PROGRAM_TIMEOUT = 0.1;      // page program (M25P16 maximum is 5 msec)
+const double PROM_READ_POLL       = 0.00001;  // 10 usec, same as AmpIO::PromReadData
+const unsigned int PROM_READ_MAX_POLLS = 8;   // same as AmpIO::PromReadData
+const double DALLAS_POLL          = 0.001;    // same as AmpIO::DallasWaitIdle
+const double DALLAS_TIMEOUT       = 0.5;      // same as AmpIO::DallasWaitIdle
+const double KSZ8851_RESET_TIME   = 0.06;     // reset requires ~60 msec
+const double KSZ8851_POLL         = 0.01;
+const double KSZ8851_TIMEOUT      = 0.5;
+
+// Address of PROM data buffer in FPGA, based on firmware version
+static nodeaddr_t PromBufferAddress(const AmpIO *board)
+{
+    return (board->GetFirmwareVersion() >= 4) ? 0x2000 : 0xc0;
+}
+
+// ********************** AmpIOOperation ****************************************
+
+AmpIOOperation::AmpIOOperation(AmpIO *brd) : board(brd), status(OP_PENDING), state(0),
+    startTime(-1), endTime(0), wakeTime(0), waitStart(0)
+{
+}
+
+AmpIOOperation::Status AmpIOOperation::WaitFor(double sec)
+{
+    wakeTime = Amp1394_GetMonotonicTime() + static_cast<int64_t>(sec*1.0e9);
+    return OP_PENDING;
+}
+
+AmpIOOperation::Status AmpIOOperation::Done(int64_t now)
+{
+    status = OP_DONE;
+    endTime = now;
+    return status;
+}
+
+AmpIOOperation::Status AmpIOOperation::Fail(int64_t now, const std::string &msg)
+{
+    std::ostringstream str;
+    str << GetName() << ": ";
+    if (board)
+        str << "board " << static_cast<unsigned int>(board->GetBoardId()) << ", ";
+    str << msg;
+    errorMsg = str.str();
+    status = OP_FAILED;
+    endTime = now;
+    return status;
+}
+
+bool AmpIOOperation::WriteQuadlet(nodeaddr_t addr, quadlet_t data)
+{
+    return board->WriteQuadletImmediate(addr, data);
+}
+
+bool AmpIOOperation::WriteBlock(nodeaddr_t addr, quadlet_t *data, unsigned int nbytes)
+{
+    board->FlushDeferred();
+    return board->GetPort()->WriteBlock(board->GetBoardId(), addr, data, nbytes);
+}
+
+AmpIOOperation::Status AmpIOOperation::Step(void)
+{
+    if (status != OP_PENDING)
+        return status;
+    int64_t now = Amp1394_GetMonotonicTime();
+    if (startTime < 0)
+        startTime = now;
+    if (now < wakeTime)
+        return status;
+    if (!board || !board->GetPort())
+        return Fail(now, "board not added to port");
+    return Execute(now);
+}
+
+bool AmpIOOperation::Run(void)
+{
+    while (Step() == OP_PENDING)
+        Amp1394_SleepUntil(wakeTime);
+    return (status == OP_DONE);
+}
+
+double AmpIOOperation::GetElapsedTime(void) const
+{
+    if (startTime < 0)
+        return 0.0;
+    int64_t end = (status == OP_PENDING) ? Amp1394_GetMonotonicTime() : endTime;
+    return (end-startTime)*1.0e-9;
+}
+
+// ********************** PROM (M25P16) Operations ******************************
+
+AmpIOOperation::Status PromSectorEraseOp::Execute(int64_t now)
+{
+    nodeaddr_t cmdAddress = board->GetPromAddress(AmpIO::PROM_M25P16, true);
+    if (state == 0) {
+        board->PromWriteEnable();
+        quadlet_t write_data = 0xd8000000 | (addr&0x00ffffff);
+        if (!WriteQuadlet(0x08, write_data))
+            return Fail(now, "failed to write erase command");
+        StartWait(now);
+        state = 1;
+    }
+    else {
+        // Result of status command (see AmpIO::PromGetStatus)
+        AmpIO_UInt32 promStatus;
+        if (!board->PromGetResult(promStatus))
+            return Fail(now, "failed to get PROM status");
+        if (promStatus == 0)
+            return Done(now);
+        if (WaitTimedOut(now, PROM_ERASE_TIMEOUT))
+            return Fail(now, "timeout waiting for erase to finish");
+    }
+    // Request PROM status
+    if (!WriteQuadlet(cmdAddress, 0x05000000))
+        return Fail(now, "failed to write status command");
+    return WaitFor(PROM_DELAY);
+}
+
+PromProgramPageOp::PromProgramPageOp(AmpIO *brd, AmpIO_UInt32 address, const AmpIO_UInt8 *bytes,
+                                     unsigned int numBytes) : AmpIOOperation(brd), addr(address),
+                                                              nbytes(numBytes)
+{
+    // First quadlet is the "page program" instruction (0x02). Remaining quadlets are the
+    // data to be programmed, which do not need to be byte-swapped. If nbytes is too large,
+    // nothing is copied and Execute fails.
+    pageData[0] = bswap_32(0x02000000 | (addr & 0x00ffffff));
+    if (bytes && (nbytes <= MAX_PAGE))
+        memcpy(pageData+1, bytes, nbytes);
+}
+
+AmpIOOperation::Status PromProgramPageOp::Execute(int64_t now)
+{
+    BasePort *port = board->GetPort();
+    unsigned char boardId = board->GetBoardId();
+    if (state == 0) {
+        if (nbytes > MAX_PAGE) {
+            std::ostringstream msg;
+            msg << "error, nbytes = " << nbytes << " (max = " << MAX_PAGE << ")";
+            return Fail(now, msg.str());
+        }
+        board->PromWriteEnable();
+        if (!WriteBlock(PromBufferAddress(board), pageData, nbytes+sizeof(quadlet_t))) {
+            std::ostringstream msg;
+            msg << "failed to write block, nbytes = " << nbytes;
+            return Fail(now, msg.str());
+        }
+        StartWait(now);
+        state = 1;
+    }
+    // Read FPGA status register; if 4 LSB are 0, command has finished
+    quadlet_t read_data;
+    if (!port->ReadQuadlet(boardId, 0x08, read_data))
+        return Fail(now, "failed to read FPGA status");
+    if (read_data&0x000f) {
+        if (WaitTimedOut(now, PROM_PROGRAM_TIMEOUT))
+            return Fail(now, "timeout waiting for program to finish");
+        return WaitFor(PROM_PROGRAM_POLL);
+    }
+    if (read_data & 0xff000000) {  // shouldn't happen
+        std::ostringstream msg;
+        msg << "FPGA error = " << read_data;
+        return Fail(now, msg.str());
+    }
+    // Now, read result. This should be the number of quadlets written (including command).
+    AmpIO_UInt32 nWritten;
+    if (!board->PromGetResult(nWritten))
+        return Fail(now, "could not get PROM result");
+    if (nWritten > 0)
+        nWritten = 4*(nWritten-1);  // convert from quadlets to bytes
+    if (nWritten != nbytes) {
+        std::ostringstream msg;
+        msg << "wrote " << nWritten << " of " << nbytes << " bytes";
+        return Fail(now, msg.str());
+    }
+    return Done(now);
+}
+
+AmpIOOperation::Status PromReadDataOp::Execute(int64_t now)
+{
+    BasePort *port = board->GetPort();
+    unsigned char boardId = board->GetBoardId();
+    AmpIO_UInt32 addr24 = addr&0x00ffffff;
+    const unsigned int maxReadSize = 64u;
+    unsigned int bytesToRead = ((nbytes-page)<maxReadSize) ? (nbytes-page) : maxReadSize;
+    if (state == 0) {
+        if (addr24+nbytes > 0x00ffffff)
+            return Fail(now, "invalid address range");
+        if (page >= nbytes)
+            return Done(now);
+        quadlet_t write_data = 0x03000000|(addr24+page);  // 03h = Read Data Bytes
+        if (!WriteQuadlet(0x08, write_data))
+            return Fail(now, "failed to write read command");
+        numPolls = 0;
+        state = 1;
+        return WaitFor(PROM_READ_POLL);
+    }
+    // Read FPGA status register; if 4 LSB are 0, command has finished
+    quadlet_t read_data;
+    if (!port->ReadQuadlet(boardId, 0x08, read_data))
+        return Fail(now, "failed to read FPGA status");
+    if (read_data&0x000f) {
+        if (++numPolls >= PROM_READ_MAX_POLLS) {
+            std::ostringstream msg;
+            msg << "command failed to finish, status = " << std::hex << (read_data&0x000f);
+            return Fail(now, msg.str());
+        }
+        return WaitFor(PROM_READ_POLL);
+    }
+    // Now, read result. This should be the number of quadlets read (firmware always reads 256 bytes).
+    AmpIO_UInt32 nRead;
+    if (!board->PromGetResult(nRead))
+        return Fail(now, "failed to get PROM result");
+    if (nRead*4 != 256) {
+        std::ostringstream msg;
+        msg << "incorrect number of bytes = " << nRead*4;
+        return Fail(now, msg.str());
+    }
+    if (!port->ReadBlock(boardId, PromBufferAddress(board), reinterpret_cast<quadlet_t *>(data+page), bytesToRead))
+        return Fail(now, "failed to read block");
+    page += bytesToRead;
+    // Start next read at next Step, so that other boards can be serviced
+    state = 0;
+    return WaitFor(0.0);
+}
+
+// ********************** Dallas DS2505 (1-wire) Operations *********************
+
+AmpIOOperation::Status DallasReadMemoryOp::Execute(int64_t now)
+{
+    AmpIO_UInt32 dsStatus;
+    if (state == 0) {
+        if (board->GetFirmwareVersion() < 7)
+            return Fail(now, "requires firmware Rev 7+");
+        dsStatus = board->ReadStatus();
+        // Check whether bi-directional I/O is available
+        if ((dsStatus & 0x00300000) != 0x00300000)
+            return Fail(now, "bi-directional I/O not available");
+        if (!board->DallasWriteControl((addr<<16)|2))
+            return Fail(now, "failed to write control");
+        StartWait(now);
+        state = 1;
+        return WaitFor(DALLAS_POLL);
+    }
+    if (!board->DallasReadStatus(dsStatus))
+        return Fail(now, "failed to read status");
+    // Wait for idle state
+    if (dsStatus&0x000000F0) {
+        if (WaitTimedOut(now, DALLAS_TIMEOUT))
+            return Fail(now, "timeout waiting for idle");
+        return WaitFor(DALLAS_POLL);
+    }
+    // Check family_code, dout_cfg_bidir, ds_reset, and ds_enable (first block only)
+    if ((nread == 0) && ((dsStatus & 0xFF00000F) != 0x0B00000B)) {
+        std::ostringstream msg;
+        msg << "invalid status " << std::hex << dsStatus;
+        return Fail(now, msg.str());
+    }
+    // Read block of data (up to 256 bytes)
+    unsigned int nb = ((nbytes-nread)>256) ? 256 : (nbytes-nread);
+    if (!board->GetPort()->ReadBlock(board->GetBoardId(), 0x6000, reinterpret_cast<quadlet_t *>(data+nread), nb))
+        return Fail(now, "failed to read block");
+    nread += nb;
+    if (nread >= nbytes)
+        return Done(now);
+    // Read additional block
+    if (!board->DallasWriteControl(3))
+        return Fail(now, "failed to write control");
+    StartWait(now);
+    return WaitFor(DALLAS_POLL);
+}
+
+// ********************** KSZ8851 Ethernet Controller Operations ****************
+
+AmpIOOperation::Status ResetKSZ8851Op::Execute(int64_t now)
+{
+    if (state == 0) {
+        if (board->GetFirmwareVersion() < 5)
+            return Fail(now, "requires firmware Rev 5+");
+        if (!board->ResetKSZ8851())
+            return Fail(now, "failed to write reset");
+        StartWait(now);
+        state = 1;
+        return WaitFor(KSZ8851_RESET_TIME);
+    }
+    // Ready when Ethernet is present and FPGA state machine is idle
+    ethStatus = board->ReadKSZ8851Status();
+    if ((ethStatus&0x8000) && ((ethStatus&0x000f) == 0))
+        return Done(now);
+    if (WaitTimedOut(now, KSZ8851_TIMEOUT)) {
+        std::ostringstream msg;
+        msg << "not ready after reset, status = " << std::hex << ethStatus;
+        return Fail(now, msg.str());
+    }
+    return WaitFor(KSZ8851_POLL);
+}
+
+AmpIOOperation::Status ReadKSZ8851RegOp::Execute(int64_t now)
+{
+    bool ret;
+    if (is16bit) {
+        AmpIO_UInt16 rdata = 0;
+        ret = board->ReadKSZ8851Reg(addr, rdata);
+        value = rdata;
+    }
+    else {
+        AmpIO_UInt8 rdata = 0;
+        ret = board->ReadKSZ8851Reg(addr, rdata);
+        value = rdata;
+    }
+    if (!ret) {
+        std::ostringstream msg;
+        msg << "failed to read register " << std::hex << static_cast<unsigned int>(addr);
+        return Fail(now, msg.str());
+    }
+    return Done(now);
+}
+
+// ********************** AmpIOOperationQueue ***********************************
+
+void AmpIOOperationQueue::Add(AmpIOOperation *op)
+{
+    if (op)
+        ops.push_back(op);
+}
+
+void AmpIOOperationQueue::Clear(void)
+{
+    for (size_t i = 0; i < ops.size(); i++)
+        delete ops[i];
+    ops.clear();
+    numFailed = 0;
+}
+
+bool AmpIOOperationQueue::IsBlocked(size_t index) const
+{
+    for (size_t i = 0; i < index; i++) {
+        if ((ops[i]->GetBoard() == ops[index]->GetBoard()) && ops[i]->IsPending())
+            return true;
+    }
+    return false;
+}
+
+unsigned int AmpIOOperationQueue::Poll(int64_t &nextWake, const ProgressCallback cb)
+{
+    unsigned int numPending = 0;
+    bool first = true;
+    for (size_t i = 0; i < ops.size(); i++) {
+        if (!ops[i]->IsPending() || IsBlocked(i))
+            continue;
+        if (ops[i]->Step() == AmpIOOperation::OP_FAILED) {
+            numFailed++;
+            if (cb)
+                (*cb)(ops[i]->GetError().c_str());
+            else
+                outStr << ops[i]->GetError() << std::endl;
+        }
+        if (ops[i]->IsPending()) {
+            if (first || (ops[i]->GetWakeTime() < nextWake))
+                nextWake = ops[i]->GetWakeTime();
+            first = false;
+        }
+    }
+    // Count all pending operations, including those waiting for an earlier operation for the same board
+    for (size_t i = 0; i < ops.size(); i++) {
+        if (ops[i]->IsPending())
+            numPending++;
+    }
+    return numPending;
+}
+
+bool AmpIOOperationQueue::Run(const ProgressCallback cb)
+{
+    int64_t nextWake;
+    while (Poll(nextWake, cb) > 0) {
+        if (cb && !(*cb)(0)) {
+            outStr << "AmpIOOperationQueue::Run: aborted" << std::endl;
+            return false;
+        }
+        Amp1394_SleepUntil(nextWake);
+    }
+    return (numFailed == 0);
+}
@@ -19,18 +19,22 @@ http://www.cisst.org/cisst/license.txt.
 #include <iomanip>
 #include <stdio.h>
 #include <string>
-#include <algorithm>   // for std::max
+#include <sstream>
+#include <fstream>
+#include <vector>
+#include <algorithm>   // for std::max, std::sort
 
 #include <Amp1394/AmpIORevision.h>
 #include "BasePort.h"
 #include "Amp1394Time.h"
 #include "Amp1394BSwap.h"
+#include "CycleLog.h"
 
 void BasePort::BroadcastReadInfo::PrintTiming(std::ostream &outStr, bool newLine) const
 {
     outStr << "Updates (usec): ";
     for (unsigned int bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
-        if (boardInfo[bnum].inUse) {
+        if (boardInfo[bnum].inUse && (queryMask & (1 << bnum))) {
             outStr << bnum << ": " << std::fixed << std::setprecision(2) << (boardInfo[bnum].updateTime*1e6)
                    << "   ";
         }
@@ -57,12 +61,17 @@ BasePort::BasePort(int portNum, std::ostream &ostr):
         NumOfNodes_(0),
         NumOfBoards_(0),
         BoardInUseMask_(0),
+        BoardQueryMask_(0),
+        NumOfBoardsQueried_(0),
+        ReadCycle_(0),
         max_board(0),
-        HubBoard(BoardIO::MAX_BOARDS)
+        HubBoard(BoardIO::MAX_BOARDS),
+        cycleLog(0)
 {
     size_t i;
     for (i = 0; i < BoardIO::MAX_BOARDS; i++) {
         BoardList[i] = 0;
+        BoardRateDivisor_[i] = 1;
         FirmwareVersion[i] = 0;
         Board2Node[i] = MAX_NODES;
     }
@@ -75,9 +84,7 @@ BasePort::BasePort(int portNum, std::ostream &ostr):
 
 BasePort::~BasePort()
 {
-    delete [] ReadBufferBroadcast;
-    delete [] WriteBufferBroadcast;
-    delete [] GenericBuffer;
+    // Buffers are freed by Arena
 }
 
 bool BasePort::SetProtocol(ProtocolType prot) {
@@ -95,6 +102,12 @@ bool BasePort::SetProtocol(ProtocolType prot) {
             return false;
         }
     }
+    if ((prot == BasePort::PROTOCOL_BC_QRW) && (GetBroadcastReadNumBytes() > GetMaxReadDataSize())) {
+        outStr << "BasePort::SetProtocol" << std::endl
+               << "***Error: broadcast read size (" << GetBroadcastReadNumBytes() << " bytes) exceeds "
+               << "maximum read size (" << GetMaxReadDataSize() << " bytes)" << std::endl;
+        return false;
+    }
     switch (prot) {
         case BasePort::PROTOCOL_SEQ_RW:
             outStr << "BasePort::SetProtocol: system running in NON broadcast mode" << std::endl;
@@ -115,31 +128,190 @@ bool BasePort::SetProtocol(ProtocolType prot) {
     return (Protocol_ == prot);
 }
 
-void BasePort::SetGenericBuffer(void)
+std::string BasePort::ProtocolString(ProtocolType prot)
+{
+    if (prot == PROTOCOL_SEQ_RW)
+        return std::string("SEQ_RW");
+    else if (prot == PROTOCOL_SEQ_R_BC_W)
+        return std::string("SEQ_R_BC_W");
+    else if (prot == PROTOCOL_BC_QRW)
+        return std::string("BC_QRW");
+    else
+        return std::string("Unknown");
+}
+
+bool BasePort::IsProtocolSupported(ProtocolType prot) const
 {
-    if (!GenericBuffer) {
-        size_t maxWritePacket = GetWriteQuadAlign()+GetPrefixOffset(WR_FW_BDATA)+GetMaxWriteDataSize()+GetWritePostfixSize();
-        size_t maxReadPacket = GetReadQuadAlign()+GetPrefixOffset(RD_FW_BDATA)+GetMaxReadDataSize()+GetReadPostfixSize();
-        GenericBuffer = reinterpret_cast<unsigned char *>(new quadlet_t[std::max(maxWritePacket,maxReadPacket)/sizeof(quadlet_t)]);
+    if (prot == PROTOCOL_SEQ_RW)
+        return true;
+    if ((prot == PROTOCOL_BC_QRW) && (GetBroadcastReadNumBytes() > GetMaxReadDataSize()))
+        return false;
+    return IsAllBoardsBroadcastCapable_ && (IsAllBoardsRev7_ || IsNoBoardsRev7_);
+}
+
+unsigned int BasePort::GetBroadcastReadNumBytes(unsigned int queryMask) const
+{
+    // Rev 1-6: 1 seq + 16 data for every board
+    if (IsNoBoardsRev7_)
+        return BoardIO::MAX_BOARDS*17*sizeof(quadlet_t);
+    // Rev 7+: 1 seq + real-time read data for each board queried, plus 1 (timing info)
+    unsigned int numQuads = 1;
+    for (unsigned int bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+        BoardIO *board = BoardList[bnum];
+        if (bcReadInfo.boardInfo[bnum].inUse && board && (queryMask & (1 << bnum)))
+            numQuads += 1+board->GetReadNumBytes()/sizeof(quadlet_t);
     }
+    return numQuads*sizeof(quadlet_t);
 }
 
-void BasePort::SetReadBufferBroadcast(void)
+std::string BasePort::GetTopologyString(void) const
 {
-    if (!ReadBufferBroadcast) {
-        size_t numReadBytes = GetReadQuadAlign()+GetPrefixOffset(RD_FW_BDATA)+GetMaxReadDataSize()+GetReadPostfixSize();
-        quadlet_t *buf = new quadlet_t[numReadBytes/sizeof(quadlet_t)];
-        ReadBufferBroadcast = reinterpret_cast<unsigned char *>(buf);
+    std::ostringstream str;
+    str << GetPortTypeString() << ":" << NumOfNodes_;
+    for (unsigned int bnum = 0; bnum < max_board; bnum++) {
+        if (BoardList[bnum])
+            str << "," << bnum << "v" << FirmwareVersion[bnum];
     }
+    return str.str();
 }
 
-void BasePort::SetWriteBufferBroadcast(void)
+BasePort::ProtocolTrial BasePort::RunProtocolTrial(ProtocolType prot, unsigned int numCycles)
 {
-    if (!WriteBufferBroadcast) {
-        size_t numWriteBytes = GetWriteQuadAlign()+GetPrefixOffset(WR_FW_BDATA)+GetMaxWriteDataSize()+GetWritePostfixSize();
-        quadlet_t *buf = new quadlet_t[numWriteBytes/sizeof(quadlet_t)];
-        WriteBufferBroadcast = reinterpret_cast<unsigned char *>(buf);
+    const unsigned int numWarmup = 10;
+    ProtocolTrial trial;
+    std::vector<double> cycleTimes;
+    cycleTimes.reserve(numCycles);
+
+    Protocol_ = prot;
+    for (unsigned int i = 0; i < numWarmup+numCycles; i++) {
+        double startTime = Amp1394_GetTime();
+        bool ok = ReadAllBoards();
+        ok &= WriteAllBoards();
+        double cycleTime = Amp1394_GetTime()-startTime;
+        if (i < numWarmup)
+            continue;
+        if (!ok)
+            trial.numFailures++;
+        cycleTimes.push_back(cycleTime);
     }
+    std::sort(cycleTimes.begin(), cycleTimes.end());
+    trial.valid = true;
+    trial.numCycles = numCycles;
+    if (!cycleTimes.empty()) {
+        trial.p50 = cycleTimes[(cycleTimes.size()-1)*50/100];
+        trial.p99 = cycleTimes[(cycleTimes.size()-1)*99/100];
+        trial.max = cycleTimes.back();
+    }
+    return trial;
+}
+
+bool BasePort::AutoSelectProtocol(unsigned int numCycles, const std::string &cacheFile, bool forceTrial)
+{
+    if (!IsOK() || (NumOfBoards_ == 0)) {
+        outStr << "BasePort::AutoSelectProtocol: port not initialized or no boards added" << std::endl;
+        return false;
+    }
+
+    std::string topology = GetTopologyString();
+    std::vector<std::string> cacheLines;
+    if (!cacheFile.empty()) {
+        std::ifstream inFile(cacheFile.c_str());
+        std::string line;
+        while (std::getline(inFile, line)) {
+            std::istringstream lineStr(line);
+            std::string key;
+            int prot;
+            if (!(lineStr >> key >> prot))
+                continue;
+            if (key == topology) {
+                if (!forceTrial && (prot >= 0) && (prot < NUM_PROTOCOLS) &&
+                    IsProtocolSupported(static_cast<ProtocolType>(prot))) {
+                    outStr << "BasePort::AutoSelectProtocol: using cached protocol for " << topology << std::endl;
+                    return SetProtocol(static_cast<ProtocolType>(prot));
+                }
+                continue;   // will be replaced
+            }
+            cacheLines.push_back(line);
+        }
+    }
+
+    ProtocolType oldProtocol = Protocol_;
+    bool found = false;
+    ProtocolType best = PROTOCOL_SEQ_RW;
+    outStr << "BasePort::AutoSelectProtocol: " << numCycles << " cycles for " << topology
+           << " (cycle time in usec)" << std::endl;
+    for (int i = 0; i < NUM_PROTOCOLS; i++) {
+        ProtocolType prot = static_cast<ProtocolType>(i);
+        ProtocolTrials_[i] = ProtocolTrial();
+        if (!IsProtocolSupported(prot))
+            continue;
+        ProtocolTrials_[i] = RunProtocolTrial(prot, numCycles);
+        const ProtocolTrial &trial = ProtocolTrials_[i];
+        outStr << "    " << std::setw(10) << std::left << ProtocolString(prot) << std::right
+               << std::fixed << std::setprecision(1) << " p50 " << trial.p50*1e6
+               << ", p99 " << trial.p99*1e6 << ", max " << trial.max*1e6
+               << ", failures " << trial.numFailures << std::endl;
+        // Prefer fewest failures, then lowest p99
+        if (!found || (trial.numFailures < ProtocolTrials_[best].numFailures) ||
+            ((trial.numFailures == ProtocolTrials_[best].numFailures) && (trial.p99 < ProtocolTrials_[best].p99))) {
+            best = prot;
+            found = true;
+        }
+    }
+    outStr << std::resetiosflags(std::ios::fixed) << std::setprecision(6);
+    Protocol_ = oldProtocol;
+    if (!found)
+        return false;
+    outStr << "BasePort::AutoSelectProtocol: selected " << ProtocolString(best) << std::endl;
+
+    if (!cacheFile.empty()) {
+        std::ofstream outFile(cacheFile.c_str());
+        for (size_t i = 0; i < cacheLines.size(); i++)
+            outFile << cacheLines[i] << std::endl;
+        outFile << topology << " " << static_cast<int>(best) << " "
+                << ProtocolTrials_[best].p99*1e6 << std::endl;
+        if (outFile.fail())
+            outStr << "BasePort::AutoSelectProtocol: failed to write " << cacheFile << std::endl;
+    }
+    return SetProtocol(best);
+}
+
+void BasePort::AllocateBuffers(void)
+{
+    if (Arena.IsAllocated())
+        return;
+    // Real-time read and write buffers first (hot data), each on separate cache lines,
+    // with the data (after the packet prefix) aligned to a cache line.
+    size_t numReadBytes = GetReadQuadAlign()+GetPrefixOffset(RD_FW_BDATA)+GetMaxReadDataSize()+GetReadPostfixSize();
+    size_t numWriteBytes = GetWriteQuadAlign()+GetPrefixOffset(WR_FW_BDATA)+GetMaxWriteDataSize()+GetWritePostfixSize();
+    unsigned int readIndex = Arena.AddRegion(numReadBytes, GetReadQuadAlign()+GetPrefixOffset(RD_FW_BDATA));
+    unsigned int writeIndex = Arena.AddRegion(numWriteBytes, GetWriteQuadAlign()+GetPrefixOffset(WR_FW_BDATA));
+    unsigned int genericIndex = Arena.AddRegion(std::max(numReadBytes, numWriteBytes));
+    if (!Arena.Allocate()) {
+        outStr << "BasePort::AllocateBuffers: failed to allocate " << (numReadBytes+numWriteBytes) << " bytes" << std::endl;
+        return;
+    }
+    ReadBufferBroadcast = Arena.GetRegion(readIndex);
+    WriteBufferBroadcast = Arena.GetRegion(writeIndex);
+    GenericBuffer = Arena.GetRegion(genericIndex);
+}
+
+void BasePort::SetGenericBuffer(void)
+{
+    if (!GenericBuffer)
+        AllocateBuffers();
+}
+
+void BasePort::SetReadBufferBroadcast(void)
+{
+    if (!ReadBufferBroadcast)
+        AllocateBuffers();
+}
+
+void BasePort::SetWriteBufferBroadcast(void)
+{
+    if (!WriteBufferBroadcast)
+        AllocateBuffers();
 }
 
 void BasePort::SetReadInvalid(void)
@@ -274,6 +446,17 @@ bool BasePort::AddBoard(BoardIO *board)
         outStr << "BasePort::AddBoard: board number out of range: " << id << std::endl;
         return false;
     }
+    // The hub buffer of the broadcast read must hold the data of all boards
+    if ((Protocol_ == PROTOCOL_BC_QRW) && !IsNoBoardsRev7_) {
+        unsigned int numBytes = GetBroadcastReadNumBytes(BoardInUseMask_ & ~(1 << id))
+                                + sizeof(quadlet_t) + board->GetReadNumBytes();
+        if (numBytes > GetMaxReadDataSize()) {
+            outStr << "BasePort::AddBoard: cannot add board " << id << ", broadcast read size ("
+                   << numBytes << " bytes) would exceed maximum read size ("
+                   << GetMaxReadDataSize() << " bytes)" << std::endl;
+            return false;
+        }
+    }
     BoardList[id] = board;
     board->port = this;
 
@@ -287,6 +470,10 @@ bool BasePort::AddBoard(BoardIO *board)
     BoardInUseMask_ = (BoardInUseMask_ | (1 << id));
     bcReadInfo.boardInfo[id].inUse = true;
     NumOfBoards_++;   // increment board counts
+    BoardRateDivisor_[id] = 1;
+    BoardQueryMask_ = BoardInUseMask_;
+    NumOfBoardsQueried_ = NumOfBoards_;
+
 
     return true;
 }
@@ -310,6 +497,8 @@ bool BasePort::RemoveBoard(unsigned char boardId)
     BoardList[boardId] = 0;
     board->port = 0;
     NumOfBoards_--;
+    BoardQueryMask_ = BoardInUseMask_;
+    NumOfBoardsQueried_ = NumOfBoards_;
 
     if (boardId >= max_board-1) {
         // If max_board was just removed, find the new max_board
@@ -320,6 +509,33 @@ bool BasePort::RemoveBoard(unsigned char boardId)
     return true;
 }
 
+bool BasePort::SetBoardRateDivisor(unsigned char boardId, unsigned int divisor)
+{
+    if ((boardId >= BoardIO::MAX_BOARDS) || !BoardList[boardId] || (divisor == 0)) {
+        outStr << "BasePort::SetBoardRateDivisor: invalid board " << static_cast<unsigned int>(boardId)
+               << " or divisor " << divisor << std::endl;
+        return false;
+    }
+    BoardRateDivisor_[boardId] = divisor;
+    return true;
+}
+
+void BasePort::UpdateBoardQueryMask(void)
+{
+    ReadCycle_++;
+    BoardQueryMask_ = 0;
+    NumOfBoardsQueried_ = 0;
+    for (unsigned int bnum = 0; bnum < max_board; bnum++) {
+        if (BoardInUseMask_ & (1 << bnum)) {
+            // Offset by board number, so that boards with the same divisor are spread over the cycles
+            if ((BoardRateDivisor_[bnum] == 1) || ((ReadCycle_+bnum)%BoardRateDivisor_[bnum] == 0)) {
+                BoardQueryMask_ |= (1 << bnum);
+                NumOfBoardsQueried_++;
+            }
+        }
+    }
+}
+
 std::string BasePort::PortTypeString(PortType portType)
 {
     if (portType == PORT_FIREWIRE)
@@ -437,6 +653,9 @@ bool BasePort::CheckFwBusGeneration(const std::string &caller, bool doScan)
 bool BasePort::ReScanNodes(const std::string &caller)
 {
     unsigned int oldFwBusGeneration = FwBusGeneration;
+    // Only count actual bus resets (not, e.g., rescans by FailoverPort)
+    if (newFwBusGeneration != oldFwBusGeneration)
+        Counters.IncPort(PortCounters::BUS_RESETS);
     UpdateBusGeneration(newFwBusGeneration);
     bool ret = ScanNodes();
     if (!ret) {
@@ -449,13 +668,17 @@ bool BasePort::ReScanNodes(const std::string &caller)
 bool BasePort::ReadQuadlet(unsigned char boardId, nodeaddr_t addr, quadlet_t &data)
 {
     nodeid_t node = ConvertBoardToNode(boardId);
-    return (node < MAX_NODES) ? ReadQuadletNode(node, addr, data, boardId&FW_NODE_MASK) : false;
+    bool ret = (node < MAX_NODES) ? ReadQuadletNode(node, addr, data, boardId&FW_NODE_MASK) : false;
+    Counters.UpdateTransaction(boardId, true, sizeof(quadlet_t), ret);
+    return ret;
 }
 
 bool BasePort::WriteQuadlet(unsigned char boardId, nodeaddr_t addr, quadlet_t data)
 {
     nodeid_t node = ConvertBoardToNode(boardId);
-    return (node < MAX_NODES) ? WriteQuadletNode(node, addr, data, boardId&FW_NODE_FLAGS_MASK) : false;
+    bool ret = (node < MAX_NODES) ? WriteQuadletNode(node, addr, data, boardId&FW_NODE_FLAGS_MASK) : false;
+    Counters.UpdateTransaction(boardId, false, sizeof(quadlet_t), ret);
+    return ret;
 }
 
 bool BasePort::ReadBlock(unsigned char boardId, nodeaddr_t addr, quadlet_t *rdata,
@@ -474,7 +697,9 @@ bool BasePort::ReadBlock(unsigned char boardId, nodeaddr_t addr, quadlet_t *rdat
     }
 
     nodeid_t node = ConvertBoardToNode(boardId);
-    return (node < MAX_NODES) ? ReadBlockNode(node, addr, rdata, nbytes, boardId&FW_NODE_FLAGS_MASK) : false;
+    bool ret = (node < MAX_NODES) ? ReadBlockNode(node, addr, rdata, nbytes, boardId&FW_NODE_FLAGS_MASK) : false;
+    Counters.UpdateTransaction(boardId, true, nbytes, ret);
+    return ret;
 }
 
 bool BasePort::WriteBlock(unsigned char boardId, nodeaddr_t addr, quadlet_t *wdata,
@@ -494,7 +719,9 @@ bool BasePort::WriteBlock(unsigned char boardId, nodeaddr_t addr, quadlet_t *wda
     }
 
     nodeid_t node = ConvertBoardToNode(boardId);
-    return (node < MAX_NODES) ? WriteBlockNode(node, addr, wdata, nbytes, boardId&FW_NODE_FLAGS_MASK) : false;
+    bool ret = (node < MAX_NODES) ? WriteBlockNode(node, addr, wdata, nbytes, boardId&FW_NODE_FLAGS_MASK) : false;
+    Counters.UpdateTransaction(boardId, false, nbytes, ret);
+    return ret;
 }
 
 bool BasePort::ReadAllBoards(void)
@@ -518,13 +745,23 @@ bool BasePort::ReadAllBoards(void)
     bool allOK = true;
     bool noneRead = true;
 
+    UpdateBoardQueryMask();
     bool rtRead = true;
     for (unsigned int board = 0; board < max_board; board++) {
         if (BoardList[board]) {
+            BoardList[board]->readAge++;
+            if (!(BoardQueryMask_ & (1 << board))) {
+                // Not due this cycle (see SetBoardRateDivisor)
+                noneRead = false;
+                continue;
+            }
             quadlet_t *readBuffer = reinterpret_cast<quadlet_t *>(ReadBufferBroadcast + GetReadQuadAlign() + GetPrefixOffset(RD_FW_BDATA));
-            bool ret = ReadBlock(board, 0, readBuffer, BoardList[board]->GetReadNumBytes());
+            int64_t hostTimeBefore = Amp1394_GetMonotonicTime();
+            bool ret = ReadBlock(board, 0, readBuffer, BoardList[board]->GetSeqReadNumBytes());
             if (ret) {
+                BoardList[board]->SetReadHostTime(hostTimeBefore, Amp1394_GetMonotonicTime());
                 BoardList[board]->SetReadData(readBuffer);
+                BoardList[board]->readAge = 0;
                 noneRead = false;
             } else {
                 allOK = false;
@@ -580,6 +817,16 @@ bool BasePort::ReadAllBoardsBroadcast(void)
     bool allOK = true;
     bool noneRead = true;
 
+    UpdateBoardQueryMask();
+    for (unsigned int bnum = 0; bnum < max_board; bnum++) {
+        if (BoardList[bnum])
+            BoardList[bnum]->readAge++;
+    }
+    if (BoardQueryMask_ == 0) {
+        // No boards due this cycle (see SetBoardRateDivisor)
+        return true;
+    }
+
     //--- send out broadcast read request -----
 
     bool rtRead = true;
@@ -589,7 +836,12 @@ bool BasePort::ReadAllBoardsBroadcast(void)
         bcReadInfo.readSequence = 1;
     }
 
-    if (!WriteBroadcastReadRequest(bcReadInfo.readSequence)) {
+    bcReadInfo.queryMask = BoardQueryMask_;
+    Counters.IncPort(PortCounters::BROADCAST_READS);
+    int64_t hostTimeBefore = Amp1394_GetMonotonicTime();
+    bool bcReqOK = WriteBroadcastReadRequest(bcReadInfo.readSequence);
+    Counters.UpdateTransaction(FW_NODE_BROADCAST, false, sizeof(quadlet_t), bcReqOK);
+    if (!bcReqOK) {
         outStr << "BasePort::ReadAllBoardsBroadcast: failed to send broadcast read request, seq = "
                << bcReadInfo.readSequence << std::endl;
         OnNoneRead();
@@ -599,21 +851,43 @@ bool BasePort::ReadAllBoardsBroadcast(void)
     // Wait for broadcast read data
     WaitBroadcastRead();
 
-    int readSize;        // Block size per board (depends on firmware version)
-    if (IsNoBoardsRev7_)
-        readSize = 17;   // Rev 1-6: 1 seq + 16 data, unit quadlet (should actually be 1 seq + 20 data)
-    else
-        readSize = 29;   // Rev 7: 1 seq + 28 data, unit quadlet (Rev 7)
-
-    int hubReadSize;        // Actual read size (depends on firmware version)
-    if (IsNoBoardsRev7_)
-        hubReadSize = BoardIO::MAX_BOARDS*readSize;  // Rev 1-6: 16 * 17 = 272 max (though really should have been 16*21)
-    else
-        hubReadSize = readSize*NumOfBoards_+1;         // Rev 7: NumOfBoards * 29 + 1
+    // Block size per board (depends on firmware version), unit quadlet.
+    //   Rev 1-6: 1 seq + 16 data for every board (should actually be 1 seq + 20 data)
+    //   Rev 7+:  1 seq + real-time read data (e.g., 28 quadlets for QLA), only for boards in use
+    //            that were included in the broadcast query (BoardQueryMask_)
+    const unsigned int readSizeOld = 17;
+    unsigned int readSize[BoardIO::MAX_BOARDS];
+
+    // Actual read size (depends on firmware version, see GetBroadcastReadNumBytes)
+    //   Rev 1-6: 16 * 17 = 272 max (though really should have been 16*21)
+    //   Rev 7:   sum of block sizes + 1 (timing info)
+    unsigned int hubReadSize = GetBroadcastReadNumBytes(BoardQueryMask_)/sizeof(quadlet_t);
+    for (unsigned int boardNum = 0; boardNum < BoardIO::MAX_BOARDS; boardNum++) {
+        BoardIO *board = BoardList[boardNum];
+        if (IsNoBoardsRev7_)
+            readSize[boardNum] = readSizeOld;
+        else
+            readSize[boardNum] = (bcReadInfo.boardInfo[boardNum].inUse && board && (BoardQueryMask_ & (1 << boardNum))) ?
+                                 1+board->GetReadNumBytes()/sizeof(quadlet_t) : 0;
+    }
+    // Should not happen (checked by SetProtocol and AddBoard), but the hub read must fit in the buffer
+    if (hubReadSize*sizeof(quadlet_t) > GetMaxReadDataSize()) {
+        outStr << "BasePort::ReadAllBoardsBroadcast: read size " << hubReadSize*sizeof(quadlet_t)
+               << " exceeds maximum " << GetMaxReadDataSize() << std::endl;
+        SetReadInvalid();
+        OnNoneRead();
+        return false;
+    }
 
     quadlet_t *hubReadBuffer = reinterpret_cast<quadlet_t *>(ReadBufferBroadcast + GetReadQuadAlign() + GetPrefixOffset(RD_FW_BDATA));
     memset(hubReadBuffer, 0, hubReadSize*sizeof(quadlet_t));
     bool ret = ReadBlock(HubBoard, 0x1000, hubReadBuffer, hubReadSize*sizeof(quadlet_t));
+    // The boards sample their data after receiving the broadcast query, which is sometime
+    // before the hub data has been read.
+    int64_t hostTimeAfter = Amp1394_GetMonotonicTime();
+    if (cycleLog)
+        cycleLog->LogRead(hubReadBuffer, hubReadSize, readSize, bcReadInfo.readSequence,
+                          hostTimeBefore, hostTimeAfter, ret);
     if (!ret) {
         SetReadInvalid();
         OnNoneRead();
@@ -626,14 +900,14 @@ bool BasePort::ReadAllBoardsBroadcast(void)
     // Note that prior to Firmware Rev 7, we always read data for all 16 boards.
     for (unsigned int boardNum = 0; boardNum < BoardIO::MAX_BOARDS; boardNum++) {
         BoardIO *board = BoardList[boardNum];
-        if (bcReadInfo.boardInfo[boardNum].inUse && board) {
+        if (bcReadInfo.boardInfo[boardNum].inUse && board && (BoardQueryMask_ & (1 << boardNum))) {
             quadlet_t statusQuad = bswap_32(curPtr[2]);
             unsigned int numAxes = (statusQuad&0xf0000000)>>28;
             unsigned int thisBoard = (statusQuad&0x0f000000)>>24;
             bool thisOK = false;
-            if (numAxes != 4) {
-                outStr << "BasePort::ReadAllBoardsBroadcast: invalid status (not a 4 axis board): " << std::hex << statusQuad
-                       << std::dec << std::endl;
+            if (numAxes != board->GetNumChannels()) {
+                outStr << "BasePort::ReadAllBoardsBroadcast: invalid status (not a " << board->GetNumChannels()
+                       << " axis board): " << std::hex << statusQuad << std::dec << std::endl;
             }
             else if (boardNum != thisBoard) {
                 outStr << "BasePort::ReadAllBoardsBroadcast: board mismatch, expecting "
@@ -650,6 +924,11 @@ bool BasePort::ReadAllBoardsBroadcast(void)
                     thisOK = true;
                 }
                 else {
+                    Counters.IncBoard(boardNum, PortCounters::BOARD_SEQ_MISMATCHES);
+                    // Check whether data is from previous read (sequence numbers start at 1)
+                    unsigned int prevSequence = (bcReadInfo.readSequence == 1) ? 65535 : bcReadInfo.readSequence-1;
+                    if (bcReadInfo.boardInfo[boardNum].sequence == prevSequence)
+                        Counters.IncBoard(boardNum, PortCounters::BOARD_STALE_DATA);
                     outStr << "BasePort::ReadAllBoardsBroadcast: board " << boardNum
                            << ", seq = " << bcReadInfo.boardInfo[boardNum].sequence
                            << ", expected = " << bcReadInfo.readSequence
@@ -659,17 +938,19 @@ bool BasePort::ReadAllBoardsBroadcast(void)
             }
             board->SetReadValid(thisOK);
             if (thisOK) {
+                board->SetReadHostTime(hostTimeBefore, hostTimeAfter);
                 board->SetReadData(curPtr+1);
+                board->readAge = 0;
                 noneRead = false;
             }
             else {
                 allOK = false;
             }
-            curPtr += readSize;
+            curPtr += readSize[boardNum];
         }
         else if (IsNoBoardsRev7_) {
             // Skip unused boards for firmware < 7
-            curPtr += readSize;
+            curPtr += readSize[boardNum];
         }
     }
 
@@ -769,6 +1050,35 @@ bool BasePort::WriteAllBoards(void)
     }
     if (!rtWrite)
         outStr << "BasePort::WriteAllBoards: rtWrite is false" << std::endl;
+    if (!FlushDeferredWrites())
+        allOK = false;
+    return allOK;
+}
+
+bool BasePort::FlushDeferredWrites(void)
+{
+    bool allOK = true;
+    for (unsigned int board = 0; board < max_board; board++) {
+        if (BoardList[board] && !FlushDeferredWrites(BoardList[board]))
+            allOK = false;
+    }
+    return allOK;
+}
+
+bool BasePort::FlushDeferredWrites(BoardIO *board)
+{
+    if (!board)
+        return false;
+    bool allOK = true;
+    while (board->deferredCount > 0) {
+        const BoardIO::DeferredWrite &entry = board->deferredQueue[board->deferredHead];
+        if (!WriteQuadlet(board->BoardId, entry.addr, entry.data)) {
+            board->SetWriteValid(false);
+            allOK = false;
+        }
+        board->deferredHead = (board->deferredHead+1)%BoardIO::DEFERRED_QUEUE_SIZE;
+        board->deferredCount--;
+    }
     return allOK;
 }
 
@@ -823,6 +1133,9 @@ bool BasePort::WriteAllBoardsBroadcast(void)
     bool ret;
 
     ret = WriteBroadcastOutput(bcBuffer, bcBufferOffset);
+    Counters.UpdateTransaction(FW_NODE_BROADCAST, false, bcBufferOffset, ret);
+    if (cycleLog)
+        cycleLog->LogWrite(bcBuffer, bcBufferOffset, Amp1394_GetMonotonicTime(), ret);
 
     // Send out control quadlet if necessary (firmware prior to Rev 7);
     //    also check for data collection
@@ -868,6 +1181,8 @@ bool BasePort::WriteAllBoardsBroadcast(void)
     }
     if (!rtWrite)
         outStr << "BasePort::WriteAllBoardsBroadcast: rtWrite is false" << std::endl;
+    if (!FlushDeferredWrites())
+        allOK = false;
 
     // return
     return allOK;
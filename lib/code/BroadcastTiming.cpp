@@ -0,0 +1,232 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <iomanip>
+#include <algorithm>   // for std::sort
+
+#include "BroadcastTiming.h"
+
+void BroadcastTimingAnalyzer::Stats::Print(std::ostream &out, double factor) const
+{
+    out << std::fixed << std::setprecision(2)
+        << "min " << min*factor << ", mean " << mean*factor << ", p50 " << p50*factor
+        << ", p95 " << p95*factor << ", p99 " << p99*factor << ", max " << max*factor
+        << " (n = " << count << ")";
+}
+
+BroadcastTimingAnalyzer::BroadcastTimingAnalyzer(unsigned int size) : windowSize(size ? size : 1),
+                                                                      lateThreshold(0.01)
+{
+    hubFill.resize(windowSize);
+    readSlack.resize(windowSize);
+    readTime.resize(windowSize);
+    cycleFlags.resize(windowSize);
+    for (unsigned int bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+        skew[bnum].resize(windowSize);
+        flags[bnum].resize(windowSize);
+    }
+    Reset();
+}
+
+void BroadcastTimingAnalyzer::Reset(void)
+{
+    nextIndex = 0;
+    numInWindow = 0;
+    totalCycles = 0;
+    lastSequence = 0;
+    boardMask = 0;
+    for (unsigned int bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+        std::fill(flags[bnum].begin(), flags[bnum].end(), 0);
+        numGaps[bnum] = 0;
+        numLate[bnum] = 0;
+        numValid[bnum] = 0;
+        totalGaps[bnum] = 0;
+    }
+}
+
+void BroadcastTimingAnalyzer::Update(const BasePort::BroadcastReadInfo &info)
+{
+    if ((info.readSequence == 0) || (info.readSequence == lastSequence))
+        return;
+    lastSequence = info.readSequence;
+
+    unsigned int bnum;
+    // Remove oldest entry from running counts (if window is full)
+    if (numInWindow == windowSize) {
+        for (bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+            unsigned char f = flags[bnum][nextIndex];
+            if (f&FLAG_VALID) numValid[bnum]--;
+            if (f&FLAG_GAP) numGaps[bnum]--;
+            if (f&FLAG_LATE) numLate[bnum]--;
+        }
+    }
+    else {
+        numInWindow++;
+    }
+    totalCycles++;
+
+    // Find earliest and latest update times
+    double minUpdate = 0.0;
+    double maxUpdate = 0.0;
+    bool first = true;
+    for (bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+        const BasePort::BroadcastReadInfo::BroadcastBoardInfo &binfo = info.boardInfo[bnum];
+        if (binfo.inUse && (info.queryMask & (1 << bnum)) && (binfo.sequence == info.readSequence)) {
+            if (first || (binfo.updateTime < minUpdate)) minUpdate = binfo.updateTime;
+            if (first || (binfo.updateTime > maxUpdate)) maxUpdate = binfo.updateTime;
+            first = false;
+        }
+    }
+    // If no board has current data, there is no hub fill time
+    cycleFlags[nextIndex] = first ? 0 : FLAG_VALID;
+    hubFill[nextIndex] = maxUpdate;
+    readSlack[nextIndex] = info.readStartTime-maxUpdate;
+    readTime[nextIndex] = info.readFinishTime-info.readStartTime;
+
+    for (bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+        const BasePort::BroadcastReadInfo::BroadcastBoardInfo &binfo = info.boardInfo[bnum];
+        unsigned char f = 0;
+        // Boards that were not queried in this cycle (see BasePort::SetBoardRateDivisor) are ignored
+        if (binfo.inUse && (info.queryMask & (1 << bnum))) {
+            boardMask |= (1 << bnum);
+            f = FLAG_VALID;
+            numValid[bnum]++;
+            if (binfo.sequence != info.readSequence) {
+                f |= (FLAG_GAP|FLAG_LATE);
+                numGaps[bnum]++;
+                totalGaps[bnum]++;
+                numLate[bnum]++;
+                skew[bnum][nextIndex] = 0.0f;
+            }
+            else {
+                if (binfo.updateTime > info.readStartTime) {
+                    f |= FLAG_LATE;
+                    numLate[bnum]++;
+                }
+                skew[bnum][nextIndex] = static_cast<float>(binfo.updateTime-minUpdate);
+            }
+        }
+        flags[bnum][nextIndex] = f;
+    }
+
+    nextIndex = (nextIndex+1)%windowSize;
+}
+
+template <class T>
+BroadcastTimingAnalyzer::Stats BroadcastTimingAnalyzer::ComputeStats(const std::vector<T> &data,
+                                                                     const std::vector<unsigned char> *valid) const
+{
+    Stats stats;
+    std::vector<double> values;
+    values.reserve(numInWindow);
+    for (unsigned int i = 0; i < numInWindow; i++) {
+        // Skip invalid entries and sequence gaps, since there is no timing data
+        if (valid && (((*valid)[i]&FLAG_VALID) == 0 || ((*valid)[i]&FLAG_GAP)))
+            continue;
+        values.push_back(static_cast<double>(data[i]));
+    }
+    if (values.empty())
+        return stats;
+    std::sort(values.begin(), values.end());
+    stats.count = static_cast<unsigned int>(values.size());
+    stats.min = values.front();
+    stats.max = values.back();
+    double sum = 0.0;
+    for (size_t i = 0; i < values.size(); i++)
+        sum += values[i];
+    stats.mean = sum/values.size();
+    stats.p50 = values[(values.size()-1)*50/100];
+    stats.p95 = values[(values.size()-1)*95/100];
+    stats.p99 = values[(values.size()-1)*99/100];
+    return stats;
+}
+
+BroadcastTimingAnalyzer::Stats BroadcastTimingAnalyzer::GetHubFillTime(void) const
+{
+    return ComputeStats(hubFill, &cycleFlags);
+}
+
+BroadcastTimingAnalyzer::Stats BroadcastTimingAnalyzer::GetReadSlack(void) const
+{
+    return ComputeStats(readSlack, &cycleFlags);
+}
+
+BroadcastTimingAnalyzer::Stats BroadcastTimingAnalyzer::GetReadTime(void) const
+{
+    return ComputeStats(readTime);
+}
+
+BroadcastTimingAnalyzer::Stats BroadcastTimingAnalyzer::GetBoardSkew(unsigned int boardNum) const
+{
+    if (boardNum >= BoardIO::MAX_BOARDS)
+        return Stats();
+    return ComputeStats(skew[boardNum], &flags[boardNum]);
+}
+
+unsigned int BroadcastTimingAnalyzer::GetSequenceGaps(unsigned int boardNum) const
+{
+    return (boardNum < BoardIO::MAX_BOARDS) ? numGaps[boardNum] : 0;
+}
+
+unsigned long BroadcastTimingAnalyzer::GetTotalSequenceGaps(unsigned int boardNum) const
+{
+    return (boardNum < BoardIO::MAX_BOARDS) ? totalGaps[boardNum] : 0;
+}
+
+double BroadcastTimingAnalyzer::GetLateFraction(unsigned int boardNum) const
+{
+    if ((boardNum >= BoardIO::MAX_BOARDS) || (numValid[boardNum] == 0))
+        return 0.0;
+    return static_cast<double>(numLate[boardNum])/numValid[boardNum];
+}
+
+bool BroadcastTimingAnalyzer::IsBoardLate(unsigned int boardNum) const
+{
+    return (GetLateFraction(boardNum) > lateThreshold);
+}
+
+unsigned int BroadcastTimingAnalyzer::GetLateBoardMask(void) const
+{
+    unsigned int mask = 0;
+    for (unsigned int bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+        if (IsBoardLate(bnum))
+            mask |= (1 << bnum);
+    }
+    return mask;
+}
+
+void BroadcastTimingAnalyzer::Print(std::ostream &out) const
+{
+    out << "Broadcast timing over " << numInWindow << " cycles (usec):" << std::endl;
+    out << "  Hub fill:   ";
+    GetHubFillTime().Print(out);
+    out << std::endl << "  Read slack: ";
+    GetReadSlack().Print(out);
+    out << std::endl << "  Read time:  ";
+    GetReadTime().Print(out);
+    out << std::endl;
+    for (unsigned int bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+        if (!(boardMask & (1 << bnum)))
+            continue;
+        out << "  Board " << std::setw(2) << bnum << " skew: ";
+        GetBoardSkew(bnum).Print(out);
+        out << ", gaps " << numGaps[bnum] << " (total " << totalGaps[bnum] << ")"
+            << ", late " << std::setprecision(1) << GetLateFraction(bnum)*100.0 << "%";
+        if (IsBoardLate(bnum))
+            out << " ***LATE***";
+        out << std::endl;
+    }
+    out << std::resetiosflags(std::ios::fixed) << std::setprecision(6);
+}
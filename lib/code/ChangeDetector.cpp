@@ -0,0 +1,190 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <iomanip>
+
+#include "ChangeDetector.h"
+#include "BasePort.h"
+#include "AmpIO.h"
+
+ChangeDetector::ChangeDetector(BasePort *p, std::ostream &debugStream) : port(p), outStr(debugStream),
+    prevValidMask(0), eventHead(0), eventCount(0), numEvents(0), numDropped(0)
+{
+    mask[WORD_STATUS] = 0xffffffff;
+    mask[WORD_DIGITAL_INPUT] = 0x0000ffff;
+    for (unsigned int bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+        boardIO[bnum] = 0;
+        boards[bnum] = 0;
+        for (unsigned int w = 0; w < NUM_STATUS_WORDS; w++) {
+            cur[w][bnum] = 0;
+            prev[w][bnum] = 0;
+        }
+    }
+}
+
+void ChangeDetector::SetMask(StatusWord word, quadlet_t bits)
+{
+    if (word < NUM_STATUS_WORDS)
+        mask[word] = bits;
+}
+
+quadlet_t ChangeDetector::GetMask(StatusWord word) const
+{
+    return (word < NUM_STATUS_WORDS) ? mask[word] : 0;
+}
+
+bool ChangeDetector::AddCallback(EdgeCallback cb, void *userData, unsigned int boardNum,
+                                 StatusWord word, quadlet_t bits)
+{
+    if (!cb || (boardNum > ALL_BOARDS) || (word >= NUM_STATUS_WORDS)) {
+        outStr << "ChangeDetector::AddCallback: invalid parameter" << std::endl;
+        return false;
+    }
+    Subscription sub;
+    sub.callback = cb;
+    sub.userData = userData;
+    sub.boardNum = boardNum;
+    sub.word = word;
+    sub.bits = bits;
+    subscriptions.push_back(sub);
+    return true;
+}
+
+void ChangeDetector::RemoveCallback(EdgeCallback cb, void *userData)
+{
+    size_t i = 0;
+    while (i < subscriptions.size()) {
+        if ((subscriptions[i].callback == cb) && (subscriptions[i].userData == userData))
+            subscriptions.erase(subscriptions.begin()+i);
+        else
+            i++;
+    }
+}
+
+void ChangeDetector::AddEvent(const StatusEdge &edge)
+{
+    numEvents++;
+    if (eventCount >= EVENT_QUEUE_SIZE)
+        numDropped++;
+    else {
+        eventQueue[(eventHead+eventCount)%EVENT_QUEUE_SIZE] = edge;
+        eventCount++;
+    }
+    for (size_t i = 0; i < subscriptions.size(); i++) {
+        const Subscription &sub = subscriptions[i];
+        if (((sub.boardNum == ALL_BOARDS) || (sub.boardNum == edge.boardNum)) &&
+            (sub.word == edge.word) && (sub.bits & edge.Changed()))
+            sub.callback(edge, sub.userData);
+    }
+}
+
+unsigned int ChangeDetector::Update(void)
+{
+    if (!port)
+        return 0;
+
+    // Gather the words of all boards with valid data
+    unsigned int validMask = 0;
+    unsigned int bnum;
+    for (bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+        const BoardIO *board = port->GetBoard(bnum);
+        if (board != boardIO[bnum]) {
+            // Board added, removed or replaced
+            boardIO[bnum] = board;
+            boards[bnum] = dynamic_cast<const AmpIO *>(board);
+            prevValidMask &= ~(1 << bnum);
+        }
+        if (boards[bnum] && boards[bnum]->ValidRead()) {
+            cur[WORD_STATUS][bnum] = boards[bnum]->GetStatus();
+            cur[WORD_DIGITAL_INPUT][bnum] = boards[bnum]->GetDigitalInput();
+            validMask |= (1 << bnum);
+        }
+        else {
+            // Keep previous value, so that no change is detected
+            cur[WORD_STATUS][bnum] = prev[WORD_STATUS][bnum];
+            cur[WORD_DIGITAL_INPUT][bnum] = prev[WORD_DIGITAL_INPUT][bnum];
+        }
+    }
+
+    // Compare with previous values (only boards with valid previous values can have changes);
+    // this loop has no branches, so that the compiler can vectorize it
+    quadlet_t anyChange = 0;
+    unsigned int w;
+    for (w = 0; w < NUM_STATUS_WORDS; w++) {
+        for (bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+            quadlet_t boardMask = 0 - static_cast<quadlet_t>((prevValidMask >> bnum) & 1);
+            anyChange |= (cur[w][bnum]^prev[w][bnum]) & mask[w] & boardMask;
+        }
+    }
+
+    unsigned int numEdges = 0;
+    if (anyChange) {
+        for (bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+            if (!(prevValidMask & validMask & (1 << bnum)))
+                continue;
+            for (w = 0; w < NUM_STATUS_WORDS; w++) {
+                if ((cur[w][bnum]^prev[w][bnum]) & mask[w]) {
+                    StatusEdge edge;
+                    edge.boardNum = static_cast<unsigned char>(bnum);
+                    edge.word = static_cast<StatusWord>(w);
+                    edge.previous = prev[w][bnum] & mask[w];
+                    edge.current = cur[w][bnum] & mask[w];
+                    edge.firmwareTime = boards[bnum]->GetFirmwareTime();
+                    edge.hostTime = boards[bnum]->GetReadHostTimeAfter();
+                    AddEvent(edge);
+                    numEdges++;
+                }
+            }
+        }
+    }
+
+    for (w = 0; w < NUM_STATUS_WORDS; w++) {
+        for (bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++)
+            prev[w][bnum] = cur[w][bnum];
+    }
+    prevValidMask |= validMask;
+    return numEdges;
+}
+
+bool ChangeDetector::GetEvent(StatusEdge &edge)
+{
+    if (eventCount == 0)
+        return false;
+    edge = eventQueue[eventHead];
+    eventHead = (eventHead+1)%EVENT_QUEUE_SIZE;
+    eventCount--;
+    return true;
+}
+
+const char *ChangeDetector::WordString(StatusWord word)
+{
+    switch (word) {
+    case WORD_STATUS:        return "status";
+    case WORD_DIGITAL_INPUT: return "digital input";
+    default:                 break;
+    }
+    return "unknown";
+}
+
+void ChangeDetector::PrintEdge(std::ostream &outStr, const StatusEdge &edge)
+{
+    std::ios_base::fmtflags flags = outStr.flags();
+    outStr << "Board " << static_cast<unsigned int>(edge.boardNum) << " " << WordString(edge.word)
+           << " at " << std::fixed << std::setprecision(6) << edge.firmwareTime << " s: "
+           << std::hex << std::setfill('0') << std::setw(8) << edge.previous << " -> "
+           << std::setw(8) << edge.current << " (rising " << std::setw(8) << edge.Rising()
+           << ", falling " << std::setw(8) << edge.Falling() << ")" << std::setfill(' ') << std::endl;
+    outStr.flags(flags);
+}
@@ -0,0 +1,203 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <math.h>
+#include <iomanip>
+
+#include "ClockSync.h"
+#include "AmpIO.h"
+
+// Assumed maximum drift (ppm) when there are not enough points to estimate it
+static const double MaxDriftPpm = 100.0;
+
+ClockSync::ClockSync(double tickPeriod, unsigned int bSize, unsigned int numPoints) :
+    nominalSlope(tickPeriod*1e9), blockSize(bSize ? bSize : 1), maxPoints(numPoints ? numPoints : 1),
+    stepThreshold(200000)
+{
+    points.reserve(maxPoints);
+    Reset();
+}
+
+void ClockSync::Reset(void)
+{
+    lastTicks = 0;
+    blockCount = 0;
+    points.clear();
+    nextIndex = 0;
+    newestIndex = 0;
+    offset = 0.0;
+    slope = nominalSlope;
+    maxResidual = 0;
+    maxHalfWidth = 0;
+    tickSpan = 0.0;
+    numObservations = 0;
+    numRestarts = 0;
+}
+
+bool ClockSync::AddObservation(uint64_t ticks, int64_t hostBefore, int64_t hostAfter)
+{
+    if (hostAfter < hostBefore)
+        return false;
+    if (numObservations > 0) {
+        if (ticks == lastTicks)      // no new read
+            return false;
+        if (ticks < lastTicks) {     // tick counter was reset
+            points.clear();
+            nextIndex = 0;
+            blockCount = 0;
+            numRestarts++;
+        }
+    }
+    lastTicks = ticks;
+    numObservations++;
+
+    Point pt;
+    pt.ticks = ticks;
+    pt.halfWidth = (hostAfter-hostBefore)/2;
+    pt.host = hostBefore+pt.halfWidth;
+    if ((blockCount == 0) || (pt.halfWidth < blockBest.halfWidth))
+        blockBest = pt;
+    blockCount++;
+
+    // Use first observation immediately, so that conversions are possible
+    if ((blockCount >= blockSize) || points.empty()) {
+        AddPoint(blockBest);
+        blockCount = 0;
+        return true;
+    }
+    return false;
+}
+
+bool ClockSync::Update(const AmpIO &board)
+{
+    if (!board.ValidRead())
+        return false;
+    return AddObservation(board.GetFirmwareTicks(), board.GetReadHostTimeBefore(), board.GetReadHostTimeAfter());
+}
+
+void ClockSync::AddPoint(const Point &pt)
+{
+    // Check for step (e.g., lost ticks)
+    int64_t predicted, errorBound;
+    if (ToHostTime(pt.ticks, predicted, errorBound)) {
+        int64_t diff = pt.host-predicted;
+        if (diff < 0) diff = -diff;
+        if (diff > errorBound+pt.halfWidth+stepThreshold) {
+            points.clear();
+            nextIndex = 0;
+            numRestarts++;
+        }
+    }
+
+    if (points.size() < maxPoints) {
+        points.push_back(pt);
+        newestIndex = static_cast<unsigned int>(points.size()-1);
+        nextIndex = static_cast<unsigned int>(points.size()%maxPoints);
+    }
+    else {
+        points[nextIndex] = pt;
+        newestIndex = nextIndex;
+        nextIndex = (nextIndex+1)%maxPoints;
+    }
+    ComputeFit();
+}
+
+void ClockSync::ComputeFit(void)
+{
+    const Point &ref = points[newestIndex];
+    size_t i;
+    size_t n = points.size();
+
+    // Fit relative to newest point; differences are small enough to be exact as double
+    double xMean = 0.0, yMean = 0.0;
+    tickSpan = 0.0;
+    maxHalfWidth = 0;
+    for (i = 0; i < n; i++) {
+        double x = static_cast<double>(static_cast<int64_t>(points[i].ticks-ref.ticks));
+        xMean += x;
+        yMean += static_cast<double>(points[i].host-ref.host);
+        if (-x > tickSpan) tickSpan = -x;
+        if (points[i].halfWidth > maxHalfWidth) maxHalfWidth = points[i].halfWidth;
+    }
+    xMean /= n;
+    yMean /= n;
+    double sxx = 0.0, sxy = 0.0;
+    for (i = 0; i < n; i++) {
+        double dx = static_cast<double>(static_cast<int64_t>(points[i].ticks-ref.ticks))-xMean;
+        double dy = static_cast<double>(points[i].host-ref.host)-yMean;
+        sxx += dx*dx;
+        sxy += dx*dy;
+    }
+    slope = (sxx > 0.0) ? (sxy/sxx) : nominalSlope;
+    offset = yMean-slope*xMean;
+
+    double maxRes = 0.0;
+    for (i = 0; i < n; i++) {
+        double x = static_cast<double>(static_cast<int64_t>(points[i].ticks-ref.ticks));
+        double res = fabs(static_cast<double>(points[i].host-ref.host)-(offset+slope*x));
+        if (res > maxRes) maxRes = res;
+    }
+    maxResidual = static_cast<int64_t>(ceil(maxRes));
+}
+
+bool ClockSync::ToHostTime(uint64_t ticks, int64_t &hostTime, int64_t &errorBound) const
+{
+    if (points.empty())
+        return false;
+    const Point &ref = points[newestIndex];
+    double x = static_cast<double>(static_cast<int64_t>(ticks-ref.ticks));
+    hostTime = ref.host + static_cast<int64_t>(floor(offset+slope*x+0.5));
+
+    // Error within the fitted range, plus an extrapolation term for the uncertainty in the slope
+    double bound = static_cast<double>(maxHalfWidth+maxResidual);
+    double dist = (x > 0.0) ? x : ((-x > tickSpan) ? (-x-tickSpan) : 0.0);
+    double extra;
+    if (tickSpan > 0.0)
+        extra = 2.0*bound*dist/tickSpan;
+    else
+        extra = MaxDriftPpm*1e-6*nominalSlope*dist;
+    errorBound = static_cast<int64_t>(ceil(bound+extra));
+    return true;
+}
+
+bool ClockSync::GetHostTime(const AmpIO &board, int64_t &hostTime, int64_t &errorBound) const
+{
+    return ToHostTime(board.GetFirmwareTicks(), hostTime, errorBound);
+}
+
+double ClockSync::GetDrift(void) const
+{
+    return (slope/nominalSlope-1.0)*1e6;
+}
+
+int64_t ClockSync::GetMinHalfWidth(void) const
+{
+    int64_t minWidth = 0;
+    for (size_t i = 0; i < points.size(); i++) {
+        if ((i == 0) || (points[i].halfWidth < minWidth))
+            minWidth = points[i].halfWidth;
+    }
+    return minWidth;
+}
+
+void ClockSync::Print(std::ostream &out) const
+{
+    out << "Clock sync: " << points.size() << " points (" << numObservations << " observations), "
+        << std::fixed << std::setprecision(2) << "drift " << GetDrift() << " ppm, "
+        << "min half-width " << GetMinHalfWidth()*1e-3 << " usec, "
+        << "max residual " << maxResidual*1e-3 << " usec, "
+        << "restarts " << numRestarts << std::endl;
+    out << std::resetiosflags(std::ios::fixed) << std::setprecision(6);
+}
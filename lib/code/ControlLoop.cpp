@@ -0,0 +1,229 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <math.h>
+
+#include "ControlLoop.h"
+#include "Amp1394Time.h"
+
+void ControlLoopStats::Clear(void)
+{
+    numCycles = 0;
+    numReadFailures = 0;
+    numWriteFailures = 0;
+    numOverruns = 0;
+    numSkipped = 0;
+    numLateStarts = 0;
+    numDegrades = 0;
+    maxOverrun = 0.0;
+    sumOverrun = 0.0;
+    maxLatency = 0.0;
+    sumLatency = 0.0;
+    minPeriodError = 0.0;
+    maxPeriodError = 0.0;
+    sumSqPeriodError = 0.0;
+    numPeriods = 0;
+    maxCycleTime = 0.0;
+    sumCycleTime = 0.0;
+}
+
+double ControlLoopStats::GetPeriodJitter(void) const
+{
+    return numPeriods ? sqrt(sumSqPeriodError/numPeriods) : 0.0;
+}
+
+void ControlLoopStats::Print(std::ostream &outStr) const
+{
+    outStr << "Cycles: " << numCycles << ", read failures: " << numReadFailures
+           << ", write failures: " << numWriteFailures << std::endl
+           << "Overruns: " << numOverruns << " (max " << maxOverrun*1.0e6 << " us, mean "
+           << GetMeanOverrun()*1.0e6 << " us), skipped: " << numSkipped << ", late starts: " << numLateStarts
+           << ", degraded: " << numDegrades << std::endl
+           << "Cycle time: mean " << GetMeanCycleTime()*1.0e6 << " us, max " << maxCycleTime*1.0e6 << " us" << std::endl
+           << "Wakeup latency: mean " << GetMeanLatency()*1.0e6 << " us, max " << maxLatency*1.0e6 << " us" << std::endl
+           << "Period error: min " << minPeriodError*1.0e6 << " us, max " << maxPeriodError*1.0e6
+           << " us, jitter (rms) " << GetPeriodJitter()*1.0e6 << " us" << std::endl;
+}
+
+ControlLoop::ControlLoop(BasePort *p, double sec, std::ostream &debugStream) :
+    port(p),
+    outStr(debugStream),
+    callback(0),
+    callbackData(0),
+    period(0),
+    curPeriod(0),
+    policy(OVERRUN_SKIP),
+    maxCatchUp(10),
+    degradeFactor(1.25),
+    maxDegrade(4.0),
+    recoverCycles(1000),
+    goodCycles(0),
+    running(false),
+    deadline(0),
+    backlogEnd(0),
+    cycleStart(0),
+    lastStart(0)
+{
+    SetPeriod(sec);
+}
+
+void ControlLoop::SetPeriod(double sec)
+{
+    period = (sec > 0.0) ? static_cast<int64_t>(sec*1.0e9+0.5) : 0;
+    curPeriod = period;
+    goodCycles = 0;
+}
+
+void ControlLoop::SetDegradeParameters(double factor, double maxFactor, unsigned int numCycles)
+{
+    if ((factor <= 1.0) || (maxFactor < 1.0)) {
+        outStr << "ControlLoop::SetDegradeParameters: invalid factor" << std::endl;
+        return;
+    }
+    degradeFactor = factor;
+    maxDegrade = maxFactor;
+    recoverCycles = numCycles;
+}
+
+std::string ControlLoop::OverrunPolicyString(OverrunPolicy policy)
+{
+    switch (policy) {
+    case OVERRUN_SKIP:     return "skip";
+    case OVERRUN_CATCH_UP: return "catch-up";
+    case OVERRUN_DEGRADE:  return "degrade";
+    }
+    return "unknown";
+}
+
+void ControlLoop::UpdateSchedule(int64_t endTime)
+{
+    if (curPeriod == 0) {
+        // Free running
+        deadline = endTime;
+        return;
+    }
+    deadline += curPeriod;
+    if (endTime <= deadline) {
+        // No overrun
+        goodCycles++;
+        if ((policy == OVERRUN_DEGRADE) && (curPeriod > period) && (goodCycles >= recoverCycles)) {
+            curPeriod = static_cast<int64_t>(curPeriod/degradeFactor);
+            if (curPeriod < period)
+                curPeriod = period;
+            goodCycles = 0;
+        }
+        return;
+    }
+
+    // With OVERRUN_CATCH_UP, the deadlines up to backlogEnd were already counted as missed by
+    // an earlier cycle, so the catch-up cycles only count an overrun if a later deadline passed
+    int64_t firstNew = deadline;
+    if ((policy == OVERRUN_CATCH_UP) && (deadline <= backlogEnd))
+        firstNew = backlogEnd + curPeriod;
+    if (endTime > firstNew) {
+        double overrun = (endTime-firstNew)*1.0e-9;
+        stats.numOverruns++;
+        stats.sumOverrun += overrun;
+        if (overrun > stats.maxOverrun)
+            stats.maxOverrun = overrun;
+    }
+    goodCycles = 0;
+
+    // Number of deadlines that have passed (including the next one)
+    int64_t missed = (endTime-deadline)/curPeriod + 1;
+    backlogEnd = deadline + (missed-1)*curPeriod;
+    switch (policy) {
+    case OVERRUN_SKIP:
+        deadline += missed*curPeriod;
+        stats.numSkipped += static_cast<unsigned long>(missed);
+        break;
+    case OVERRUN_CATCH_UP:
+        // Keep the deadline (in the past), so that the next cycles start immediately,
+        // unless too far behind
+        if (missed > static_cast<int64_t>(maxCatchUp)) {
+            int64_t skip = missed-maxCatchUp;
+            deadline += skip*curPeriod;
+            stats.numSkipped += static_cast<unsigned long>(skip);
+        }
+        break;
+    case OVERRUN_DEGRADE:
+        if (curPeriod < static_cast<int64_t>(period*maxDegrade)) {
+            curPeriod = static_cast<int64_t>(curPeriod*degradeFactor);
+            if (curPeriod > static_cast<int64_t>(period*maxDegrade))
+                curPeriod = static_cast<int64_t>(period*maxDegrade);
+            stats.numDegrades++;
+        }
+        // Restart schedule from current time
+        deadline = endTime + curPeriod;
+        lastStart = 0;
+        break;
+    }
+}
+
+bool ControlLoop::Run(unsigned long numCycles)
+{
+    if (!port || !port->IsOK()) {
+        outStr << "ControlLoop::Run: invalid port" << std::endl;
+        return false;
+    }
+    running = true;
+    goodCycles = 0;
+    lastStart = 0;
+    deadline = Amp1394_GetMonotonicTime();
+    backlogEnd = 0;
+    unsigned long cycle = 0;
+    while (running && ((numCycles == 0) || (cycle < numCycles))) {
+        Amp1394_SleepUntil(deadline);
+        cycleStart = Amp1394_GetMonotonicTime();
+        double latency = (cycleStart-deadline)*1.0e-9;
+        if ((latency < 0.0) || (curPeriod == 0))
+            latency = 0.0;
+        if ((curPeriod > 0) && (cycleStart-deadline > curPeriod))
+            stats.numLateStarts++;
+        else {
+            stats.sumLatency += latency;
+            if (latency > stats.maxLatency)
+                stats.maxLatency = latency;
+        }
+        if ((lastStart != 0) && (curPeriod > 0)) {
+            double err = (cycleStart-lastStart-curPeriod)*1.0e-9;
+            if ((stats.numPeriods == 0) || (err < stats.minPeriodError))
+                stats.minPeriodError = err;
+            if ((stats.numPeriods == 0) || (err > stats.maxPeriodError))
+                stats.maxPeriodError = err;
+            stats.sumSqPeriodError += err*err;
+            stats.numPeriods++;
+        }
+        lastStart = cycleStart;
+
+        if (!port->ReadAllBoards())
+            stats.numReadFailures++;
+        if (callback && !callback(*this, callbackData))
+            running = false;
+        if (!port->WriteAllBoards())
+            stats.numWriteFailures++;
+
+        int64_t endTime = Amp1394_GetMonotonicTime();
+        double cycleTime = (endTime-cycleStart)*1.0e-9;
+        stats.sumCycleTime += cycleTime;
+        if (cycleTime > stats.maxCycleTime)
+            stats.maxCycleTime = cycleTime;
+        stats.numCycles++;
+        cycle++;
+        UpdateSchedule(endTime);
+    }
+    running = false;
+    return true;
+}
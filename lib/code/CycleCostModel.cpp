@@ -0,0 +1,456 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+#include "CycleCostModel.h"
+#include "BoardLayout.h"
+#include "Amp1394Time.h"
+
+// Real-time read/write sizes (quadlets), currently only QLA
+typedef QLA_Layout Layout;
+
+// Returns median of samples (which are sorted)
+static double Median(std::vector<double> &samples)
+{
+    if (samples.empty())
+        return 0.0;
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size()/2];
+}
+
+bool LinearCost::Fit(const std::vector<unsigned int> &nbytes, const std::vector<double> &times)
+{
+    size_t n = nbytes.size();
+    if ((n == 0) || (times.size() != n))
+        return false;
+    double sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        sx += nbytes[i];
+        sy += times[i];
+        sxx += static_cast<double>(nbytes[i])*nbytes[i];
+        sxy += nbytes[i]*times[i];
+    }
+    double det = n*sxx - sx*sx;
+    if (det > 0.0) {
+        perByte = (n*sxy - sx*sy)/det;
+        // Cost cannot decrease with size (e.g., due to noise)
+        if (perByte < 0.0)
+            perByte = 0.0;
+    }
+    else
+        perByte = 0.0;
+    fixed = (sy - perByte*sx)/n;
+    return true;
+}
+
+CycleCostModel::Costs::Costs() :
+    maxReadDataSize(0), maxWriteDataSize(0), quadRead(0.0), quadWrite(0.0), bcReadRequest(0.0),
+    sleepOverhead(0.0), bcWaitSleeps(true), hubFillPerBoard(0.0), decodePerBoard(0.0),
+    encodePerBoard(0.0)
+{
+}
+
+bool CycleCostModel::Measure(BasePort *port, unsigned int numSamples, std::ostream &outStr)
+{
+    isValid = false;
+    if (!port || !port->IsOK()) {
+        outStr << "CycleCostModel::Measure: invalid port" << std::endl;
+        return false;
+    }
+    if (numSamples == 0)
+        numSamples = 1;
+
+    // Boards in use
+    unsigned char boardId = BoardIO::MAX_BOARDS;
+    unsigned int numBoards = 0;
+    bool allRev7 = true;
+    unsigned int bnum;
+    for (bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+        if (port->GetBoard(bnum)) {
+            if (boardId == BoardIO::MAX_BOARDS)
+                boardId = static_cast<unsigned char>(bnum);
+            numBoards++;
+            if (port->GetFirmwareVersion(bnum) < 7)
+                allRev7 = false;
+        }
+    }
+    if (numBoards == 0) {
+        outStr << "CycleCostModel::Measure: no boards added to port" << std::endl;
+        return false;
+    }
+
+    Costs c;
+    c.portType = port->GetPortTypeString();
+    c.maxReadDataSize = port->GetMaxReadDataSize();
+    c.maxWriteDataSize = port->GetMaxWriteDataSize();
+    std::vector<quadlet_t> buffer(std::max(c.maxReadDataSize, c.maxWriteDataSize)/sizeof(quadlet_t)+1, 0);
+    std::vector<double> samples(numSamples);
+    std::vector<unsigned int> sizes;
+    std::vector<double> times;
+    unsigned int i, k;
+    int64_t t0;
+
+    // Quadlet read of status register
+    for (i = 0; i < numSamples; i++) {
+        quadlet_t data;
+        t0 = Amp1394_GetMonotonicTime();
+        if (!port->ReadQuadlet(boardId, 0, data)) {
+            outStr << "CycleCostModel::Measure: quadlet read failed" << std::endl;
+            return false;
+        }
+        samples[i] = (Amp1394_GetMonotonicTime()-t0)*1.0e-9;
+    }
+    c.quadRead = Median(samples);
+
+    // Quadlet write (no-op)
+    for (i = 0; i < numSamples; i++) {
+        t0 = Amp1394_GetMonotonicTime();
+        if (!port->WriteNoOp(boardId)) {
+            outStr << "CycleCostModel::Measure: quadlet write failed" << std::endl;
+            return false;
+        }
+        samples[i] = (Amp1394_GetMonotonicTime()-t0)*1.0e-9;
+    }
+    c.quadWrite = Median(samples);
+
+    // Block reads: real-time data and (Rev 7+) hub data with different number of boards
+    bool isRev7 = (port->GetFirmwareVersion(boardId) >= 7);
+    unsigned int rtSize = (isRev7 ? Layout::READ_SIZE : Layout::READ_SIZE_OLD)*sizeof(quadlet_t);
+    sizes.push_back(rtSize);
+    if (isRev7) {
+        for (k = 1; k <= BoardIO::MAX_BOARDS; k *= 2) {
+            unsigned int hubSize = (1+k*Layout::HUB_BLOCK_SIZE)*sizeof(quadlet_t);
+            if (hubSize <= c.maxReadDataSize)
+                sizes.push_back(hubSize);
+        }
+    }
+    for (k = 0; k < sizes.size(); k++) {
+        nodeaddr_t addr = (k == 0) ? 0 : 0x1000;
+        for (i = 0; i < numSamples; i++) {
+            t0 = Amp1394_GetMonotonicTime();
+            if (!port->ReadBlock(boardId, addr, &buffer[0], sizes[k])) {
+                outStr << "CycleCostModel::Measure: block read failed, size " << sizes[k] << std::endl;
+                return false;
+            }
+            samples[i] = (Amp1394_GetMonotonicTime()-t0)*1.0e-9;
+        }
+        times.push_back(Median(samples));
+    }
+    c.blockRead.Fit(sizes, times);
+
+    // Block write of real-time data; the buffer is all 0, so the motor currents are not
+    // valid and the control quadlet does not change anything
+    std::fill(buffer.begin(), buffer.end(), 0);
+    unsigned int wrSize = (isRev7 ? Layout::WRITE_SIZE : Layout::WRITE_SIZE-1)*sizeof(quadlet_t);
+    for (i = 0; i < numSamples; i++) {
+        t0 = Amp1394_GetMonotonicTime();
+        if (!port->WriteBlock(boardId, 0, &buffer[0], wrSize)) {
+            outStr << "CycleCostModel::Measure: block write failed" << std::endl;
+            return false;
+        }
+        samples[i] = (Amp1394_GetMonotonicTime()-t0)*1.0e-9;
+    }
+    c.blockWrite.fixed = Median(samples);
+    c.blockWrite.perByte = 0.0;
+
+    // Sleep overhead for WaitBroadcastRead
+    double wait = NominalBroadcastWait(numBoards);
+    for (i = 0; i < numSamples; i++) {
+        t0 = Amp1394_GetMonotonicTime();
+        Amp1394_Sleep(wait);
+        samples[i] = (Amp1394_GetMonotonicTime()-t0)*1.0e-9 - wait;
+    }
+    c.sleepOverhead = std::max(Median(samples), 0.0);
+    // Check whether the port actually sleeps in WaitBroadcastRead
+    for (i = 0; i < numSamples; i++) {
+        t0 = Amp1394_GetMonotonicTime();
+        port->WaitBroadcastRead();
+        samples[i] = (Amp1394_GetMonotonicTime()-t0)*1.0e-9;
+    }
+    c.bcWaitSleeps = (Median(samples) > wait/2.0);
+
+    BasePort::ProtocolType oldProtocol = port->GetProtocol();
+    if (allRev7) {
+        // Broadcast writes with different number of boards (also all 0)
+        sizes.clear();
+        times.clear();
+        for (k = 1; k <= BoardIO::MAX_BOARDS; k *= 2) {
+            unsigned int bcSize = k*Layout::WRITE_SIZE*sizeof(quadlet_t);
+            if (bcSize <= c.maxWriteDataSize)
+                sizes.push_back(bcSize);
+        }
+        for (k = 0; k < sizes.size(); k++) {
+            for (i = 0; i < numSamples; i++) {
+                t0 = Amp1394_GetMonotonicTime();
+                if (!port->WriteBroadcastOutput(&buffer[0], sizes[k])) {
+                    outStr << "CycleCostModel::Measure: broadcast write failed" << std::endl;
+                    return false;
+                }
+                samples[i] = (Amp1394_GetMonotonicTime()-t0)*1.0e-9;
+            }
+            times.push_back(Median(samples));
+        }
+        c.bcWrite.Fit(sizes, times);
+
+        // Broadcast read request (repeats last sequence number)
+        unsigned int seq = port->GetBroadcastReadInfo().readSequence;
+        for (i = 0; i < numSamples; i++) {
+            t0 = Amp1394_GetMonotonicTime();
+            if (!port->WriteBroadcastReadRequest(seq)) {
+                outStr << "CycleCostModel::Measure: broadcast read request failed" << std::endl;
+                return false;
+            }
+            samples[i] = (Amp1394_GetMonotonicTime()-t0)*1.0e-9;
+            port->WaitBroadcastRead();
+        }
+        c.bcReadRequest = Median(samples);
+
+        // Hub fill time, from the timing information in the hub data
+        if (port->SetProtocol(BasePort::PROTOCOL_BC_QRW)) {
+            for (i = 0; i < numSamples; i++) {
+                port->ReadAllBoards();
+                BasePort::BroadcastReadInfo info = port->GetBroadcastReadInfo();
+                double fill = 0.0;
+                for (bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+                    if (info.boardInfo[bnum].inUse && (info.queryMask & (1 << bnum)) &&
+                        (info.boardInfo[bnum].updateTime > fill))
+                        fill = info.boardInfo[bnum].updateTime;
+                }
+                samples[i] = fill;
+            }
+            c.hubFillPerBoard = Median(samples)/numBoards;
+        }
+    }
+
+    // Host decode time: SetReadData of all boards, replaying real-time data that was read from
+    // each board, so that no transactions are included
+    std::vector<BoardIO *> boardList;
+    std::vector<std::vector<quadlet_t> > rtData;
+    for (bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+        BoardIO *board = port->GetBoard(bnum);
+        if (!board)
+            continue;
+        std::vector<quadlet_t> data(board->GetReadNumBytes()/sizeof(quadlet_t), 0);
+        if (!port->ReadBlock(bnum, 0, &data[0], board->GetSeqReadNumBytes())) {
+            outStr << "CycleCostModel::Measure: block read failed for board " << bnum << std::endl;
+            port->SetProtocol(oldProtocol);
+            return false;
+        }
+        boardList.push_back(board);
+        rtData.push_back(data);
+    }
+    for (i = 0; i < numSamples; i++) {
+        t0 = Amp1394_GetMonotonicTime();
+        for (k = 0; k < boardList.size(); k++)
+            boardList[k]->SetReadData(&rtData[k][0]);
+        samples[i] = (Amp1394_GetMonotonicTime()-t0)*1.0e-9;
+    }
+    c.decodePerBoard = Median(samples)/numBoards;
+
+    // Host encode time: GetWriteData and InitWriteBuffer of all boards, as in WriteAllBoards
+    for (i = 0; i < numSamples; i++) {
+        t0 = Amp1394_GetMonotonicTime();
+        for (k = 0; k < boardList.size(); k++) {
+            boardList[k]->GetWriteData(&buffer[0], 0, boardList[k]->GetWriteNumBytes()/sizeof(quadlet_t));
+            boardList[k]->InitWriteBuffer();
+        }
+        samples[i] = (Amp1394_GetMonotonicTime()-t0)*1.0e-9;
+    }
+    c.encodePerBoard = Median(samples)/numBoards;
+    // Restore current data (and read valid flags)
+    port->ReadAllBoards();
+    port->SetProtocol(oldProtocol);
+
+    costs = c;
+    isValid = true;
+    return true;
+}
+
+// Predicted read and write times for one port with n7 Rev 7+ boards and nOld older boards.
+// Returns false (with reason) if the configuration is not possible.
+static bool PredictPort(const CycleCostModel::Costs &costs, unsigned int n7, unsigned int nOld,
+                        BasePort::ProtocolType protocol, double &readTime, double &writeTime,
+                        std::string &reason)
+{
+    unsigned int nb = n7+nOld;
+    readTime = 0.0;
+    writeTime = 0.0;
+    if (nb == 0)
+        return true;
+    if (nb > BoardIO::MAX_BOARDS) {
+        reason = "too many boards per port";
+        return false;
+    }
+    bool isBroadcast = (protocol != BasePort::PROTOCOL_SEQ_RW);
+    if (isBroadcast && (n7 > 0) && (nOld > 0)) {
+        reason = "broadcast requires same firmware (Rev 7+ or older) on all boards of a port";
+        return false;
+    }
+
+    // Read
+    double decode = nb*costs.decodePerBoard;
+    if (protocol == BasePort::PROTOCOL_BC_QRW) {
+        // See BasePort::ReadAllBoardsBroadcast for the hub read size
+        unsigned int hubSize = (n7 > 0) ? (1+n7*Layout::HUB_BLOCK_SIZE)*sizeof(quadlet_t)
+                                        : BoardIO::MAX_BOARDS*17*sizeof(quadlet_t);
+        if (hubSize > costs.maxReadDataSize) {
+            reason = "hub data larger than maximum read size";
+            return false;
+        }
+        double wait = costs.bcWaitSleeps ? CycleCostModel::NominalBroadcastWait(nb)+costs.sleepOverhead : 0.0;
+        wait = std::max(wait, nb*costs.hubFillPerBoard);
+        readTime = costs.bcReadRequest + wait + costs.blockRead.Eval(hubSize) + decode;
+    }
+    else {
+        readTime = n7*costs.blockRead.Eval(Layout::READ_SIZE*sizeof(quadlet_t))
+                 + nOld*costs.blockRead.Eval(Layout::READ_SIZE_OLD*sizeof(quadlet_t)) + decode;
+    }
+
+    // Write (firmware prior to Rev 7 also requires a quadlet write for the control register)
+    double encode = nb*costs.encodePerBoard;
+    unsigned int wrSize7 = Layout::WRITE_SIZE*sizeof(quadlet_t);
+    unsigned int wrSizeOld = (Layout::WRITE_SIZE-1)*sizeof(quadlet_t);
+    if (isBroadcast) {
+        unsigned int bcSize = n7*wrSize7 + nOld*wrSizeOld;
+        if (bcSize > costs.maxWriteDataSize) {
+            reason = "broadcast data larger than maximum write size";
+            return false;
+        }
+        writeTime = costs.bcWrite.Eval(bcSize) + nOld*costs.quadWrite + encode;
+    }
+    else {
+        writeTime = n7*costs.blockWrite.Eval(wrSize7)
+                  + nOld*(costs.blockWrite.Eval(wrSizeOld) + costs.quadWrite) + encode;
+    }
+    return true;
+}
+
+CyclePrediction CycleCostModel::Predict(const CyclePlanConfig &config) const
+{
+    CyclePrediction pred;
+    if (!isValid) {
+        pred.reason = "no cost model";
+        return pred;
+    }
+    if ((config.numPorts == 0) || (config.numBoards == 0) || (config.numOldBoards > config.numBoards)) {
+        pred.reason = "invalid configuration";
+        return pred;
+    }
+    // Boards are distributed evenly over the ports, with the older boards on the first ports
+    // (so that as many ports as possible have the same firmware on all boards). The ports are
+    // serviced sequentially, so the cycle time is the sum over the ports.
+    unsigned int oldLeft = config.numOldBoards;
+    for (unsigned int p = 0; p < config.numPorts; p++) {
+        unsigned int nb = config.numBoards/config.numPorts + ((p < config.numBoards%config.numPorts) ? 1 : 0);
+        unsigned int nOld = std::min(nb, oldLeft);
+        oldLeft -= nOld;
+        double readTime, writeTime;
+        if (!PredictPort(costs, nb-nOld, nOld, config.protocol, readTime, writeTime, pred.reason))
+            return pred;
+        pred.cycleTime += readTime + writeTime;
+        if (readTime + writeTime > pred.readTime + pred.writeTime) {
+            pred.readTime = readTime;
+            pred.writeTime = writeTime;
+        }
+    }
+    pred.valid = true;
+    return pred;
+}
+
+bool CycleCostModel::Save(const std::string &fileName) const
+{
+    std::ofstream file(fileName.c_str());
+    if (!file.good())
+        return false;
+    file.precision(9);
+    file << "portType " << costs.portType << std::endl
+         << "maxReadDataSize " << costs.maxReadDataSize << std::endl
+         << "maxWriteDataSize " << costs.maxWriteDataSize << std::endl
+         << "quadRead " << costs.quadRead << std::endl
+         << "quadWrite " << costs.quadWrite << std::endl
+         << "blockRead " << costs.blockRead.fixed << " " << costs.blockRead.perByte << std::endl
+         << "blockWrite " << costs.blockWrite.fixed << " " << costs.blockWrite.perByte << std::endl
+         << "bcWrite " << costs.bcWrite.fixed << " " << costs.bcWrite.perByte << std::endl
+         << "bcReadRequest " << costs.bcReadRequest << std::endl
+         << "sleepOverhead " << costs.sleepOverhead << std::endl
+         << "bcWaitSleeps " << (costs.bcWaitSleeps ? 1 : 0) << std::endl
+         << "hubFillPerBoard " << costs.hubFillPerBoard << std::endl
+         << "decodePerBoard " << costs.decodePerBoard << std::endl
+         << "encodePerBoard " << costs.encodePerBoard << std::endl;
+    return file.good();
+}
+
+bool CycleCostModel::Load(const std::string &fileName, std::ostream &outStr)
+{
+    std::ifstream file(fileName.c_str());
+    if (!file.good()) {
+        outStr << "CycleCostModel::Load: could not open " << fileName << std::endl;
+        return false;
+    }
+    Costs c;
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream str(line);
+        std::string key;
+        if (!(str >> key))
+            continue;
+        if (key == "portType") std::getline(str >> std::ws, c.portType);
+        else if (key == "maxReadDataSize") str >> c.maxReadDataSize;
+        else if (key == "maxWriteDataSize") str >> c.maxWriteDataSize;
+        else if (key == "quadRead") str >> c.quadRead;
+        else if (key == "quadWrite") str >> c.quadWrite;
+        else if (key == "blockRead") str >> c.blockRead.fixed >> c.blockRead.perByte;
+        else if (key == "blockWrite") str >> c.blockWrite.fixed >> c.blockWrite.perByte;
+        else if (key == "bcWrite") str >> c.bcWrite.fixed >> c.bcWrite.perByte;
+        else if (key == "bcReadRequest") str >> c.bcReadRequest;
+        else if (key == "sleepOverhead") str >> c.sleepOverhead;
+        else if (key == "bcWaitSleeps") str >> c.bcWaitSleeps;
+        else if (key == "hubFillPerBoard") str >> c.hubFillPerBoard;
+        else if (key == "decodePerBoard") str >> c.decodePerBoard;
+        else if (key == "encodePerBoard") str >> c.encodePerBoard;
+        else {
+            outStr << "CycleCostModel::Load: unknown key " << key << std::endl;
+            continue;
+        }
+        if (str.fail()) {
+            outStr << "CycleCostModel::Load: invalid value for " << key << std::endl;
+            return false;
+        }
+    }
+    costs = c;
+    isValid = true;
+    return true;
+}
+
+void CycleCostModel::Print(std::ostream &outStr) const
+{
+    outStr << "Transaction costs (" << costs.portType << "), in microseconds:" << std::endl
+           << "  quadlet read:          " << costs.quadRead*1.0e6 << std::endl
+           << "  quadlet write:         " << costs.quadWrite*1.0e6 << std::endl
+           << "  block read:            " << costs.blockRead.fixed*1.0e6 << " + "
+           << costs.blockRead.perByte*1.0e6 << " per byte" << std::endl
+           << "  block write:           " << costs.blockWrite.fixed*1.0e6 << std::endl
+           << "  broadcast write:       " << costs.bcWrite.fixed*1.0e6 << " + "
+           << costs.bcWrite.perByte*1.0e6 << " per byte" << std::endl
+           << "  broadcast read req:    " << costs.bcReadRequest*1.0e6 << std::endl
+           << "  sleep overhead:        " << costs.sleepOverhead*1.0e6
+           << (costs.bcWaitSleeps ? "" : " (port does not sleep in WaitBroadcastRead)") << std::endl
+           << "  hub fill per board:    " << costs.hubFillPerBoard*1.0e6 << std::endl
+           << "  decode per board:      " << costs.decodePerBoard*1.0e6 << std::endl
+           << "  encode per board:      " << costs.encodePerBoard*1.0e6 << std::endl;
+}
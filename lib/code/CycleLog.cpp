@@ -0,0 +1,224 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <string.h>   // for memcpy, memset
+
+#include "CycleLog.h"
+#include "BasePort.h"
+
+#ifndef _MSC_VER
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+const uint64_t CycleLog::CYCLE_INVALID = ~static_cast<uint64_t>(0);
+const char CycleLog::Magic[8] = { 'A', 'M', 'P', 'C', 'Y', 'C', 'L', 'E' };
+
+// Header is padded to this size, so that slots start on a page boundary
+static const size_t CycleLogPageSize = 4096;
+
+CycleLog::CycleLog(std::ostream &debugStream) : outStr(debugStream), header(0), mapSize(0),
+                                                 curEntry(0), numTruncated(0)
+{
+}
+
+CycleLog::~CycleLog()
+{
+    Close();
+}
+
+void *CycleLog::MapFile(const std::string &fileName, size_t &size, bool create, std::ostream &outStr)
+{
+#ifdef _MSC_VER
+    outStr << "CycleLog::MapFile: memory-mapped files not supported on this platform" << std::endl;
+    return 0;
+#else
+    int fd = create ? open(fileName.c_str(), O_RDWR|O_CREAT|O_TRUNC, 0644) : open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        outStr << "CycleLog::MapFile: could not open " << fileName << std::endl;
+        return 0;
+    }
+    if (create) {
+        // Preallocate disk space, so that the file system does not need to allocate
+        // blocks while logging (falls back to sparse file if not supported)
+        int ret = -1;
+#if defined(__linux__)
+        ret = posix_fallocate(fd, 0, static_cast<off_t>(size));
+#endif
+        if ((ret != 0) && (ftruncate(fd, static_cast<off_t>(size)) != 0)) {
+            outStr << "CycleLog::MapFile: could not allocate " << size << " bytes for " << fileName << std::endl;
+            close(fd);
+            return 0;
+        }
+    }
+    else {
+        struct stat st;
+        if ((fstat(fd, &st) != 0) || (st.st_size == 0)) {
+            outStr << "CycleLog::MapFile: could not get size of " << fileName << std::endl;
+            close(fd);
+            return 0;
+        }
+        size = static_cast<size_t>(st.st_size);
+    }
+    void *addr = mmap(0, size, create ? (PROT_READ|PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);   // mapping remains valid
+    if (addr == MAP_FAILED) {
+        outStr << "CycleLog::MapFile: could not map " << fileName << std::endl;
+        return 0;
+    }
+    return addr;
+#endif
+}
+
+void CycleLog::UnmapFile(void *addr, size_t size)
+{
+#ifndef _MSC_VER
+    if (addr)
+        munmap(addr, size);
+#endif
+}
+
+bool CycleLog::Open(const std::string &fileName, const BasePort &port, unsigned long numSlots,
+                    unsigned int maxReadQuads, unsigned int maxWriteQuads)
+{
+    Close();
+    if (numSlots == 0) {
+        outStr << "CycleLog::Open: number of slots must be greater than 0" << std::endl;
+        return false;
+    }
+    size_t slotSize = sizeof(CycleLogEntry)+(maxReadQuads+maxWriteQuads)*sizeof(quadlet_t);
+    slotSize = ((slotSize+63)/64)*64;   // keep slots cache-line aligned
+    size_t headerSize = ((sizeof(CycleLogHeader)+CycleLogPageSize-1)/CycleLogPageSize)*CycleLogPageSize;
+    size_t size = headerSize+numSlots*slotSize;
+    void *addr = MapFile(fileName, size, true, outStr);
+    if (!addr)
+        return false;
+
+    FileName = fileName;
+    mapSize = size;
+    header = static_cast<CycleLogHeader *>(addr);
+    memset(header, 0, sizeof(CycleLogHeader));
+    memcpy(header->magic, Magic, sizeof(header->magic));
+    header->version = VERSION;
+    header->headerSize = static_cast<uint32_t>(headerSize);
+    header->slotSize = static_cast<uint32_t>(slotSize);
+    header->numSlots = static_cast<uint32_t>(numSlots);
+    header->maxReadQuads = maxReadQuads;
+    header->maxWriteQuads = maxWriteQuads;
+    header->portType = static_cast<uint32_t>(port.GetPortType());
+    for (unsigned int bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++)
+        header->firmwareVersion[bnum] = static_cast<uint32_t>(port.GetFirmwareVersion(bnum));
+    header->numCycles = 0;
+    curEntry = 0;
+    numTruncated = 0;
+    return true;
+}
+
+void CycleLog::Close(void)
+{
+    if (header) {
+        Flush(true);
+        UnmapFile(header, mapSize);
+    }
+    header = 0;
+    mapSize = 0;
+    curEntry = 0;
+}
+
+CycleLogEntry *CycleLog::NewEntry(void)
+{
+    uint64_t cycle = header->numCycles;
+    unsigned char *slot = reinterpret_cast<unsigned char *>(header)+header->headerSize
+                          +(cycle%header->numSlots)*header->slotSize;
+    CycleLogEntry *entry = reinterpret_cast<CycleLogEntry *>(slot);
+    entry->cycle = CYCLE_INVALID;
+    entry->readStartTime = 0;
+    entry->readEndTime = 0;
+    entry->writeTime = 0;
+    entry->readQuads = 0;
+    entry->writeQuads = 0;
+    entry->sequence = 0;
+    entry->readOK = 0;
+    entry->writeOK = 0;
+    memset(entry->blockQuads, 0, sizeof(entry->blockQuads));
+    curEntry = entry;
+    return entry;
+}
+
+void CycleLog::EndEntry(CycleLogEntry *entry)
+{
+    uint64_t cycle = header->numCycles;
+    entry->cycle = cycle;
+    header->numCycles = cycle+1;
+}
+
+void CycleLog::LogRead(const quadlet_t *hubData, unsigned int numQuads, const unsigned int *blockQuads,
+                       unsigned int sequence, int64_t startTime, int64_t endTime, bool ok)
+{
+    if (!header)
+        return;
+    CycleLogEntry *entry = NewEntry();
+    if (numQuads > header->maxReadQuads) {
+        numQuads = header->maxReadQuads;
+        numTruncated++;
+    }
+    entry->readStartTime = startTime;
+    entry->readEndTime = endTime;
+    entry->readQuads = numQuads;
+    entry->sequence = sequence;
+    entry->readOK = ok ? 1 : 0;
+    for (unsigned int bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++)
+        entry->blockQuads[bnum] = static_cast<uint8_t>(blockQuads[bnum]);
+    memcpy(reinterpret_cast<unsigned char *>(entry)+sizeof(CycleLogEntry), hubData, numQuads*sizeof(quadlet_t));
+    EndEntry(entry);
+}
+
+void CycleLog::LogWrite(const quadlet_t *bcData, unsigned int nbytes, int64_t time, bool ok)
+{
+    if (!header)
+        return;
+    // Write data is added to the entry of the current cycle, unless the cycle did not
+    // start with a read (e.g., PROTOCOL_SEQ_R_BC_W).
+    CycleLogEntry *entry = curEntry;
+    bool isNew = (!entry || (entry->writeQuads != 0) || (entry->readQuads == 0));
+    if (isNew)
+        entry = NewEntry();
+    unsigned int numQuads = nbytes/sizeof(quadlet_t);
+    if (numQuads > header->maxWriteQuads) {
+        numQuads = header->maxWriteQuads;
+        numTruncated++;
+    }
+    memcpy(reinterpret_cast<unsigned char *>(entry)+sizeof(CycleLogEntry)+header->maxReadQuads*sizeof(quadlet_t),
+           bcData, numQuads*sizeof(quadlet_t));
+    entry->writeTime = time;
+    entry->writeOK = ok ? 1 : 0;
+    entry->writeQuads = numQuads;
+    if (isNew)
+        EndEntry(entry);
+}
+
+bool CycleLog::Flush(bool wait)
+{
+    if (!header)
+        return false;
+#ifdef _MSC_VER
+    return false;
+#else
+    return (msync(header, mapSize, wait ? MS_SYNC : MS_ASYNC) == 0);
+#endif
+}
@@ -0,0 +1,190 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <string.h>   // for memcmp, memset
+
+#include "CycleLogPort.h"
+#include "Amp1394BSwap.h"
+
+CycleLogPort::CycleLogPort(const std::string &fileName, std::ostream &debugStream):
+    BasePort(0, debugStream),
+    FileName(fileName),
+    header(0),
+    mapSize(0),
+    curCycle(0),
+    lastCycle(0)
+{
+    if (Init())
+        outStr << "CycleLogPort: " << (GetNumCycles()-GetFirstCycle()) << " cycles in " << FileName << std::endl;
+    else
+        outStr << "CycleLogPort: initialization failed" << std::endl;
+}
+
+CycleLogPort::~CycleLogPort()
+{
+    Cleanup();
+}
+
+bool CycleLogPort::Init(void)
+{
+    void *addr = CycleLog::MapFile(FileName, mapSize, false, outStr);
+    if (!addr)
+        return false;
+    const CycleLogHeader *hdr = static_cast<const CycleLogHeader *>(addr);
+    if ((mapSize < sizeof(CycleLogHeader)) || (memcmp(hdr->magic, CycleLog::Magic, sizeof(hdr->magic)) != 0) ||
+        (hdr->version != CycleLog::VERSION) ||
+        (mapSize < hdr->headerSize+static_cast<size_t>(hdr->numSlots)*hdr->slotSize)) {
+        outStr << "CycleLogPort: " << FileName << " is not a valid cycle log" << std::endl;
+        CycleLog::UnmapFile(addr, mapSize);
+        return false;
+    }
+    header = hdr;
+    curCycle = GetFirstCycle();
+    lastCycle = curCycle;
+    return ScanNodes();
+}
+
+void CycleLogPort::Cleanup(void)
+{
+    if (header)
+        CycleLog::UnmapFile(const_cast<CycleLogHeader *>(header), mapSize);
+    header = 0;
+    mapSize = 0;
+}
+
+bool CycleLogPort::ScanNodes(void)
+{
+    if (!header)
+        return false;
+    IsAllBoardsBroadcastCapable_ = true;
+    IsAllBoardsBroadcastShorterWait_ = true;
+    IsNoBoardsBroadcastShorterWait_ = true;
+    IsAllBoardsRev7_ = true;
+    IsNoBoardsRev7_ = true;
+    NumOfNodes_ = 0;
+    memset(Node2Board, BoardIO::MAX_BOARDS, sizeof(Node2Board));
+    // Use board number as node number
+    for (unsigned int board = 0; board < BoardIO::MAX_BOARDS; board++) {
+        unsigned long fver = header->firmwareVersion[board];
+        FirmwareVersion[board] = fver;
+        if (fver == 0) {
+            Board2Node[board] = MAX_NODES;
+            continue;
+        }
+        Board2Node[board] = board;
+        Node2Board[board] = static_cast<unsigned char>(board);
+        if (fver < 6) IsAllBoardsBroadcastShorterWait_ = false;
+        else          IsNoBoardsBroadcastShorterWait_ = false;
+        if (fver < 7) IsAllBoardsRev7_ = false;
+        else          IsNoBoardsRev7_ = false;
+        NumOfNodes_++;
+    }
+    Protocol_ = PROTOCOL_BC_QRW;
+    return (NumOfNodes_ > 0);
+}
+
+uint64_t CycleLogPort::GetFirstCycle(void) const
+{
+    if (!header || (header->numCycles <= header->numSlots))
+        return 0;
+    return header->numCycles-header->numSlots;
+}
+
+const CycleLogEntry *CycleLogPort::GetEntry(uint64_t cycle) const
+{
+    if (!header || (cycle < GetFirstCycle()) || (cycle >= header->numCycles))
+        return 0;
+    const unsigned char *slot = reinterpret_cast<const unsigned char *>(header)+header->headerSize
+                                +(cycle%header->numSlots)*header->slotSize;
+    const CycleLogEntry *entry = reinterpret_cast<const CycleLogEntry *>(slot);
+    // Entry may be invalid if the log was not closed properly
+    return (entry->cycle == cycle) ? entry : 0;
+}
+
+const quadlet_t *CycleLogPort::GetReadData(uint64_t cycle) const
+{
+    const CycleLogEntry *entry = GetEntry(cycle);
+    if (!entry)
+        return 0;
+    return reinterpret_cast<const quadlet_t *>(reinterpret_cast<const unsigned char *>(entry)+sizeof(CycleLogEntry));
+}
+
+const quadlet_t *CycleLogPort::GetWriteData(uint64_t cycle) const
+{
+    const quadlet_t *rdata = GetReadData(cycle);
+    return rdata ? rdata+header->maxReadQuads : 0;
+}
+
+bool CycleLogPort::Seek(uint64_t cycle)
+{
+    if (!GetEntry(cycle))
+        return false;
+    curCycle = cycle;
+    return true;
+}
+
+bool CycleLogPort::ReadAllBoards(void)
+{
+    const CycleLogEntry *entry = 0;
+    while (!entry && (curCycle < GetNumCycles())) {
+        entry = GetEntry(curCycle);
+        if (entry && (entry->readQuads == 0))
+            entry = 0;
+        curCycle++;
+    }
+    if (!entry) {
+        SetReadInvalid();
+        return false;
+    }
+    lastCycle = curCycle-1;
+
+    bool allOK = entry->readOK;
+    const quadlet_t *curPtr = GetReadData(lastCycle);
+    const quadlet_t *endPtr = curPtr+entry->readQuads;
+    bcReadInfo.readSequence = entry->sequence;
+    bcReadInfo.queryMask = 0;
+    for (unsigned int boardNum = 0; boardNum < BoardIO::MAX_BOARDS; boardNum++) {
+        if (BoardList[boardNum])
+            BoardList[boardNum]->readAge++;
+        unsigned int blockQuads = entry->blockQuads[boardNum];
+        if (blockQuads == 0)
+            continue;
+        // Boards with data in the log were included in the broadcast query
+        bcReadInfo.queryMask |= (1 << boardNum);
+        BoardIO *board = BoardList[boardNum];
+        if (board) {
+            bool thisOK = entry->readOK && (curPtr+blockQuads <= endPtr);
+            if (thisOK) {
+                bcReadInfo.boardInfo[boardNum].sequence = bswap_32(curPtr[0]) >> 16;
+                if (IsAllBoardsRev7_) {
+                    unsigned int quad0_lsb = bswap_32(curPtr[0])&0x0000ffff;
+                    bcReadInfo.boardInfo[boardNum].updateTime = (quad0_lsb&0x3fff)*board->GetFPGAClockPeriod();
+                }
+                thisOK = (bcReadInfo.boardInfo[boardNum].sequence == entry->sequence);
+            }
+            board->SetReadValid(thisOK);
+            if (thisOK) {
+                board->SetReadHostTime(entry->readStartTime, entry->readEndTime);
+                board->SetReadData(curPtr+1);
+                board->readAge = 0;
+            }
+            else {
+                allOK = false;
+            }
+        }
+        curPtr += blockQuads;
+    }
+    return allOK;
+}
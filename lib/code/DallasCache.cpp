@@ -0,0 +1,206 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <string.h>   // for memcmp, memcpy
+#include <iostream>
+#include <fstream>
+
+#include "DallasCache.h"
+#include "AmpIO.h"
+
+static const char DallasCacheHeader[8] = { 'D', 'S', '2', '5', '0', '5', 'C', '2' };
+
+// CRC-32 (see EthBasePort.cpp)
+uint32_t crc32(uint32_t crc, const void *buf, size_t size);
+
+DallasCache::DallasCache(const std::string &fileName) : FileName(fileName), loaded(false)
+{
+}
+
+DallasCache::~DallasCache()
+{
+}
+
+uint32_t DallasCache::ComputeChecksum(const unsigned char *data, unsigned int nbytes)
+{
+    return crc32(0U, data, nbytes);
+}
+
+void DallasCache::Load(void)
+{
+    if (loaded)
+        return;
+    loaded = true;
+    Entries.clear();
+    std::ifstream inFile(FileName.c_str(), std::ios::binary);
+    if (!inFile.good())
+        return;   // File does not exist yet
+    char header[sizeof(DallasCacheHeader)];
+    inFile.read(header, sizeof(header));
+    if (!inFile.good() || (memcmp(header, DallasCacheHeader, sizeof(header)) != 0)) {
+        std::cerr << "DallasCache: ignoring invalid cache file " << FileName << std::endl;
+        return;
+    }
+    unsigned char rec[7];
+    while (inFile.read(reinterpret_cast<char *>(rec), sizeof(rec))) {
+        Entry entry;
+        entry.familyCode = rec[0];
+        unsigned int nbytes = rec[1] | (static_cast<unsigned int>(rec[2]) << 8);
+        entry.checksum = rec[3] | (static_cast<uint32_t>(rec[4]) << 8) | (static_cast<uint32_t>(rec[5]) << 16)
+                         | (static_cast<uint32_t>(rec[6]) << 24);
+        if ((nbytes < PAGE_SIZE) || (nbytes > MEMORY_SIZE)) {
+            std::cerr << "DallasCache: invalid entry size " << nbytes << " in " << FileName << std::endl;
+            break;
+        }
+        entry.data.resize(nbytes);
+        if (!inFile.read(reinterpret_cast<char *>(&entry.data[0]), nbytes)) {
+            std::cerr << "DallasCache: truncated entry in " << FileName << std::endl;
+            break;
+        }
+        if (ComputeChecksum(&entry.data[0], nbytes) != entry.checksum) {
+            std::cerr << "DallasCache: ignoring corrupt entry " << Entries.size() << " in " << FileName << std::endl;
+            continue;
+        }
+        Entries.push_back(entry);
+    }
+}
+
+bool DallasCache::Save(void) const
+{
+    std::ofstream outFile(FileName.c_str(), std::ios::binary|std::ios::trunc);
+    if (!outFile.good()) {
+        std::cerr << "DallasCache: failed to open " << FileName << " for writing" << std::endl;
+        return false;
+    }
+    outFile.write(DallasCacheHeader, sizeof(DallasCacheHeader));
+    for (size_t i = 0; i < Entries.size(); i++) {
+        unsigned int nbytes = static_cast<unsigned int>(Entries[i].data.size());
+        uint32_t checksum = Entries[i].checksum;
+        unsigned char rec[7];
+        rec[0] = Entries[i].familyCode;
+        rec[1] = static_cast<unsigned char>(nbytes&0x00ff);
+        rec[2] = static_cast<unsigned char>((nbytes>>8)&0x00ff);
+        for (unsigned int j = 0; j < 4; j++)
+            rec[3+j] = static_cast<unsigned char>((checksum>>(8*j))&0x00ff);
+        outFile.write(reinterpret_cast<const char *>(rec), sizeof(rec));
+        outFile.write(reinterpret_cast<const char *>(&Entries[i].data[0]), nbytes);
+    }
+    return outFile.good();
+}
+
+int DallasCache::Find(unsigned char familyCode, const unsigned char *firstPage, const unsigned char *tail,
+                      unsigned int tailOffset, unsigned int tailBytes) const
+{
+    for (size_t i = 0; i < Entries.size(); i++) {
+        if ((Entries[i].familyCode != familyCode) ||
+            (memcmp(&Entries[i].data[0], firstPage, PAGE_SIZE) != 0))
+            continue;
+        if ((Entries[i].data.size() < tailOffset+tailBytes) ||
+            (memcmp(&Entries[i].data[tailOffset], tail, tailBytes) != 0))
+            continue;
+        return static_cast<int>(i);
+    }
+    return -1;
+}
+
+int DallasCache::FindImage(unsigned char familyCode, const unsigned char *data, unsigned int nbytes,
+                           uint32_t checksum) const
+{
+    for (size_t i = 0; i < Entries.size(); i++) {
+        if ((Entries[i].familyCode == familyCode) && (Entries[i].checksum == checksum) &&
+            (Entries[i].data.size() == nbytes) && (memcmp(&Entries[i].data[0], data, nbytes) == 0))
+            return static_cast<int>(i);
+    }
+    return -1;
+}
+
+bool DallasCache::Lookup(unsigned char familyCode, const unsigned char *firstPage, const unsigned char *lastPage,
+                         unsigned char *data, unsigned int nbytes)
+{
+    if ((nbytes < PAGE_SIZE) || (nbytes > MEMORY_SIZE))
+        return false;
+    Load();
+    unsigned int tailOffset = GetLastPageOffset(nbytes);
+    int index = Find(familyCode, firstPage, lastPage, tailOffset, nbytes-tailOffset);
+    if (index < 0)
+        return false;
+    memcpy(data, &Entries[index].data[0], nbytes);
+    return true;
+}
+
+bool DallasCache::Store(unsigned char familyCode, const unsigned char *data, unsigned int nbytes)
+{
+    if ((nbytes < PAGE_SIZE) || (nbytes > MEMORY_SIZE))
+        return false;
+    Load();
+    uint32_t checksum = ComputeChecksum(data, nbytes);
+    if (FindImage(familyCode, data, nbytes, checksum) >= 0)
+        return true;
+    Entries.push_back(Entry());
+    Entries.back().familyCode = familyCode;
+    Entries.back().checksum = checksum;
+    Entries.back().data.assign(data, data+nbytes);
+    return Save();
+}
+
+bool DallasCache::Clear(void)
+{
+    Entries.clear();
+    loaded = true;
+    return Save();
+}
+
+unsigned int DallasCache::GetNumEntries(void)
+{
+    Load();
+    return static_cast<unsigned int>(Entries.size());
+}
+
+bool DallasCache::ReadMemory(AmpIO &board, unsigned char *data, unsigned int nbytes, bool *fromCache)
+{
+    if (fromCache)
+        *fromCache = false;
+    if (nbytes > MEMORY_SIZE)
+        return false;
+    if (nbytes <= PAGE_SIZE)
+        return board.DallasReadMemory(0, data, nbytes);
+
+    // Identity read (first page only)
+    if (!board.DallasReadMemory(0, data, PAGE_SIZE))
+        return false;
+    AmpIO_UInt32 status;
+    if (!board.DallasReadStatus(status))
+        return false;
+    unsigned char familyCode = static_cast<unsigned char>((status&0xFF000000)>>24);
+    Load();
+    if (Find(familyCode, data, data, 0, 0) >= 0) {
+        // Validate cached entry by reading the last (possibly partial) page
+        unsigned int tailOffset = GetLastPageOffset(nbytes);
+        std::vector<unsigned char> lastPage(nbytes-tailOffset);
+        if (!board.DallasReadMemory(static_cast<unsigned short>(tailOffset), &lastPage[0], nbytes-tailOffset))
+            return false;
+        if (Lookup(familyCode, data, &lastPage[0], data, nbytes)) {
+            if (fromCache)
+                *fromCache = true;
+            return true;
+        }
+    }
+
+    // Not in cache (or cached entry too small or does not match), so read entire memory
+    if (!board.DallasReadMemory(0, data, nbytes))
+        return false;
+    Store(familyCode, data, nbytes);
+    return true;
+}
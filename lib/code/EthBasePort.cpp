@@ -496,8 +496,10 @@ bool EthBasePort::ReadQuadletNode(nodeid_t node, nodeaddr_t addr, quadlet_t &dat
 
     // Flush before reading
     int numFlushed = PacketFlushAll();
-    if (numFlushed > 0)
+    if (numFlushed > 0) {
+        Counters.IncPort(PortCounters::FLUSHED_PACKETS, numFlushed);
         outStr << "ReadQuadlet: flushed " << numFlushed << " packets" << std::endl;
+    }
 
     // Increment transaction label
     fw_tl = (fw_tl+1)&FW_TL_MASK;
@@ -527,6 +529,7 @@ bool EthBasePort::ReadQuadletNode(nodeid_t node, nodeaddr_t addr, quadlet_t &dat
     unsigned int recvPacketSize = GetPrefixOffset(RD_FW_HEADER)+FW_QRESPONSE_SIZE+FW_EXTRA_SIZE;
     int nRecv = PacketReceive(recvPacket, recvPacketSize);
     if (nRecv != static_cast<int>(recvPacketSize)) {
+        Counters.IncPort(PortCounters::TIMEOUTS);
         // Only print message if Node2Board contains valid board number, to avoid unnecessary error messages during ScanNodes.
         unsigned int boardId = Node2Board[node];
         if (boardId < BoardIO::MAX_BOARDS) {
@@ -578,8 +581,10 @@ bool EthBasePort::ReadBlockNode(nodeid_t node, nodeaddr_t addr, quadlet_t *rdata
 
     // Flush before reading
     int numFlushed = PacketFlushAll();
-    if (numFlushed > 0)
+    if (numFlushed > 0) {
+        Counters.IncPort(PortCounters::FLUSHED_PACKETS, numFlushed);
         outStr << "ReadBlock: flushed " << numFlushed << " packets" << std::endl;
+    }
 
     // Create buffer that is large enough for Firewire packet
     SetGenericBuffer();   // Make sure buffer is allocated
@@ -616,6 +621,7 @@ bool EthBasePort::ReadBlockNode(nodeid_t node, nodeaddr_t addr, quadlet_t *rdata
 
     int nRecv = PacketReceive(packet, packetSize);
     if (nRecv != static_cast<int>(packetSize)) {
+        Counters.IncPort(PortCounters::TIMEOUTS);
         unsigned char boardId = Node2Board[node];
         outStr << "ReadBlock: failed to receive read response from board " << (boardId&FW_NODE_MASK)
                << ": return value = " << nRecv
@@ -690,16 +696,16 @@ bool EthBasePort::WriteBroadcastOutput(quadlet_t *buffer, unsigned int size)
 
 bool EthBasePort::WriteBroadcastReadRequest(unsigned int seq)
 {
-    quadlet_t bcReqData = (seq << 16) | BoardInUseMask_;
+    quadlet_t bcReqData = (seq << 16) | BoardQueryMask_;
     return WriteQuadlet(FW_NODE_BROADCAST, 0x1800, bcReqData);
 }
 
 void EthBasePort::WaitBroadcastRead(void)
 {
     // Wait for all boards to respond with data
-    // Shorter wait: 10 + 5 * Nb us, where Nb is number of boards used in this configuration
+    // Shorter wait: 10 + 5 * Nb us, where Nb is number of boards queried in this cycle
     // Standard wait: 5 + 5 * Nn us, where Nn is the total number of nodes on the FireWire bus
-    double waitTime_uS = 10.0 + 5.0*NumOfBoards_;
+    double waitTime_uS = 10.0 + 5.0*NumOfBoardsQueried_;
     Amp1394_Sleep(waitTime_uS*1e-6);
 }
 
@@ -807,14 +813,21 @@ bool EthBasePort::checkCRC(const unsigned char *packet)
     // because Ethernet already includes CRC.
 #if 0
     // Note that FW_QREPONSE_SIZE == FW_BRESPONSE_HEADER_SIZE
-    uint32_t crc_check = BitReverse32(crc32(0U, packet, FW_QRESPONSE_SIZE-FW_CRC_SIZE));
-    uint32_t crc_original = bswap_32(*reinterpret_cast<const uint32_t *>(packet+FW_QRESPONSE_SIZE-FW_CRC_SIZE));
-    return (crc_check == crc_original);
+    return checkCRC32(packet, FW_QRESPONSE_SIZE-FW_CRC_SIZE);
 #else
     return true;
 #endif
 }
 
+bool EthBasePort::checkCRC32(const unsigned char *data, size_t nbytes)
+{
+    uint32_t crc_check = BitReverse32(crc32(0U, data, nbytes));
+    // CRC is not necessarily quadlet-aligned (e.g., in captured frames)
+    uint32_t crc_original;
+    memcpy(&crc_original, data+nbytes, sizeof(crc_original));
+    return (crc_check == bswap_32(crc_original));
+}
+
 //  -----------  CRC ----------------
 //source: http://www.opensource.apple.com/source/xnu/xnu-1456.1.26/bsd/libkern/crc32.c
 //online check: http://www.lammertbies.nl/comm/info/crc-calculation.html
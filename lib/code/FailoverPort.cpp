@@ -0,0 +1,147 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include "FailoverPort.h"
+#include "BasePort.h"
+#include "Amp1394Time.h"
+
+FailoverPort::FailoverPort(BasePort *primary, BasePort *standby, std::ostream &debugStream) :
+    outStr(debugStream), activeIndex(0), inactiveFailed(false), failureThreshold(2), consecutiveFailures(0),
+    recoveryPeriod(0.5), lastRecoveryTime(0.0), autoFailback(false), numSwitches(0), numRecoveries(0)
+{
+    ports[0] = primary;
+    ports[1] = standby;
+    for (unsigned int bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++)
+        BoardList[bnum] = 0;
+}
+
+FailoverPort::~FailoverPort()
+{
+    // Remove boards from the inactive port, so that it does not keep references to them
+    BasePort *inactive = ports[1-activeIndex];
+    for (unsigned int bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+        if (BoardList[bnum] && inactive) {
+            inactive->RemoveBoard(bnum);
+            BoardList[bnum]->port = ports[activeIndex];
+        }
+    }
+}
+
+bool FailoverPort::AddBoard(BoardIO *board)
+{
+    if (!board || !board->IsValid() || !ports[0] || !ports[1])
+        return false;
+    if (!ports[0]->AddBoard(board))
+        return false;
+    if (!ports[1]->AddBoard(board)) {
+        ports[0]->RemoveBoard(board->GetBoardId());
+        return false;
+    }
+    BoardList[board->GetBoardId()] = board;
+    board->port = ports[activeIndex];
+    return true;
+}
+
+bool FailoverPort::RemoveBoard(unsigned char boardId)
+{
+    if ((boardId >= BoardIO::MAX_BOARDS) || !BoardList[boardId])
+        return false;
+    bool ret = ports[0]->RemoveBoard(boardId);
+    ret &= ports[1]->RemoveBoard(boardId);
+    BoardList[boardId] = 0;
+    return ret;
+}
+
+void FailoverPort::SetActive(unsigned int index)
+{
+    activeIndex = index;
+    for (unsigned int bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+        if (BoardList[bnum])
+            BoardList[bnum]->port = ports[activeIndex];
+    }
+}
+
+bool FailoverPort::SwitchPort(void)
+{
+    if (inactiveFailed) {
+        outStr << "FailoverPort::SwitchPort: " << (IsFailedOver() ? "primary" : "standby")
+               << " port has not recovered" << std::endl;
+        return false;
+    }
+    SetActive(1-activeIndex);
+    consecutiveFailures = 0;
+    numSwitches++;
+    return true;
+}
+
+bool FailoverPort::ReadAllBoards(void)
+{
+    bool ret = ports[activeIndex]->ReadAllBoards();
+    if (ret) {
+        consecutiveFailures = 0;
+        return true;
+    }
+    consecutiveFailures++;
+    if ((consecutiveFailures >= failureThreshold) && !inactiveFailed) {
+        outStr << "FailoverPort: " << consecutiveFailures << " failed reads on "
+               << ports[activeIndex]->GetPortTypeString() << " port, switching to "
+               << ports[1-activeIndex]->GetPortTypeString() << " port" << std::endl;
+        SetActive(1-activeIndex);
+        inactiveFailed = true;
+        lastRecoveryTime = Amp1394_GetTime();
+        consecutiveFailures = 0;
+        numSwitches++;
+        // Repeat read on new port, so that this cycle has valid data
+        ret = ports[activeIndex]->ReadAllBoards();
+        if (!ret)
+            consecutiveFailures++;
+    }
+    return ret;
+}
+
+bool FailoverPort::WriteAllBoards(void)
+{
+    return ports[activeIndex]->WriteAllBoards();
+}
+
+bool FailoverPort::CheckPort(BasePort *port)
+{
+    if (!port->IsOK() || !port->ReScanNodes("FailoverPort"))
+        return false;
+    for (unsigned int bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+        quadlet_t data;
+        if (BoardList[bnum] && !port->ReadQuadlet(bnum, 0, data))
+            return false;
+    }
+    return true;
+}
+
+void FailoverPort::Service(void)
+{
+    if (!inactiveFailed)
+        return;
+    double curTime = Amp1394_GetTime();
+    if (curTime-lastRecoveryTime < recoveryPeriod)
+        return;
+    lastRecoveryTime = curTime;
+    BasePort *failed = ports[1-activeIndex];
+    if (!CheckPort(failed))
+        return;
+    outStr << "FailoverPort: " << failed->GetPortTypeString() << " port recovered" << std::endl;
+    inactiveFailed = false;
+    numRecoveries++;
+    if (autoFailback && IsFailedOver())
+        SwitchPort();
+}
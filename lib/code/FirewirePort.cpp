@@ -268,7 +268,7 @@ bool FirewirePort::WriteBroadcastReadRequest(unsigned int seq)
 {
     quadlet_t bcReqData = (seq << 16);
     if (IsAllBoardsBroadcastShorterWait_ || IsNoBoardsBroadcastShorterWait_)
-        bcReqData += BoardInUseMask_;
+        bcReqData += BoardQueryMask_;
     else
         // For a mixed set of boards, disable the shorter wait capability by "tricking" the system into thinking
         // that all nodes are used in this configuration. Otherwise, boards with the shorter wait capability may
@@ -295,9 +295,9 @@ bool FirewirePort::WriteBroadcastReadRequest(unsigned int seq)
 void FirewirePort::WaitBroadcastRead(void)
 {
     // Wait for all boards to respond with data
-    // Shorter wait: 10 + 5 * Nb us, where Nb is number of boards used in this configuration
+    // Shorter wait: 10 + 5 * Nb us, where Nb is number of boards queried in this cycle
     // Standard wait: 5 + 5 * Nn us, where Nn is the total number of nodes on the FireWire bus
-    double waitTime_uS = IsAllBoardsBroadcastShorterWait_ ? (10.0 + 5.0*NumOfBoards_) : (5.0 + 5.0*NumOfNodes_);
+    double waitTime_uS = IsAllBoardsBroadcastShorterWait_ ? (10.0 + 5.0*NumOfBoardsQueried_) : (5.0 + 5.0*NumOfNodes_);
     Amp1394_Sleep(waitTime_uS*1e-6);
 }
 
@@ -0,0 +1,396 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifdef _MSC_VER   // Windows
+#define _USE_MATH_DEFINES
+#endif
+
+#include <math.h>
+#include <string.h>   // for memcpy
+
+#include "ImpairedPort.h"
+#include "PortTrace.h"
+#include "Amp1394Time.h"
+
+ImpairmentProfile::ImpairmentProfile() :
+    delayMean(0.0),
+    delayJitter(0.0),
+    delayDist(DELAY_UNIFORM),
+    timeout(0.001),
+    lossProb(0.0),
+    duplicateProb(0.0),
+    reorderProb(0.0),
+    corruptProb(0.0)
+{
+}
+
+ImpairedPort::ImpairedPort(BasePort *innerPort, std::ostream &debugStream):
+    BasePort(innerPort ? innerPort->GetPortNum() : 0, debugStream),
+    inner(innerPort),
+    totalDelay(0.0),
+    haveHeldWrite(false)
+{
+    SetSeed(1);
+    ClearImpairmentCounters();
+    if (Init())
+        outStr << "ImpairedPort: initialization succeeded" << std::endl;
+    else
+        outStr << "ImpairedPort: initialization failed" << std::endl;
+}
+
+ImpairedPort::~ImpairedPort()
+{
+    // Do not call Cleanup, which forwards any held write, because the inner port may
+    // already have been deleted
+}
+
+bool ImpairedPort::Init(void)
+{
+    if (!IsOK())
+        return false;
+    bool ret = ScanNodes();
+    if (ret)
+        SetDefaultProtocol();
+    return ret;
+}
+
+void ImpairedPort::Cleanup(void)
+{
+    // Forward any held write
+    if (haveHeldWrite && inner) {
+        haveHeldWrite = false;
+        ForwardWrite(heldWrite);
+    }
+}
+
+void ImpairedPort::SetProfile(const ImpairmentProfile &newProfile)
+{
+    Cleanup();
+    profile = newProfile;
+    lastResponse.clear();
+    dupResponse.clear();
+}
+
+void ImpairedPort::SetSeed(uint64_t seed)
+{
+    // State of xorshift generator must not be 0
+    rngState = seed ? seed : 0x9e3779b97f4a7c15ULL;
+}
+
+void ImpairedPort::ClearImpairmentCounters(void)
+{
+    memset(counters, 0, sizeof(counters));
+    totalDelay = 0.0;
+}
+
+const char *ImpairedPort::GetCounterName(CounterType type)
+{
+    static const char *names[NUM_COUNTERS] = { "FORWARDED", "DELAYED", "LOST", "LATE",
+                                               "DUPLICATED", "REORDERED", "CORRUPTED" };
+    return (type < NUM_COUNTERS) ? names[type] : "UNKNOWN";
+}
+
+double ImpairedPort::Random(void)
+{
+    // xorshift64* generator
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    uint64_t r = rngState*0x2545f4914f6cdd1dULL;
+    // Use upper 53 bits
+    return (r >> 11)*(1.0/9007199254740992.0);
+}
+
+bool ImpairedPort::Chance(double prob)
+{
+    return (prob > 0.0) && (Random() < prob);
+}
+
+double ImpairedPort::GetDelay(void)
+{
+    double delay = profile.delayMean;
+    if (profile.delayJitter > 0.0) {
+        switch (profile.delayDist) {
+        case ImpairmentProfile::DELAY_UNIFORM:
+            delay += profile.delayJitter*(2.0*Random()-1.0);
+            break;
+        case ImpairmentProfile::DELAY_NORMAL:
+            // Box-Muller transform
+            delay += profile.delayJitter*sqrt(-2.0*log(1.0-Random()))*cos(2.0*M_PI*Random());
+            break;
+        case ImpairmentProfile::DELAY_EXPONENTIAL:
+            delay -= profile.delayJitter*log(1.0-Random());
+            break;
+        }
+    }
+    return (delay > 0.0) ? delay : 0.0;
+}
+
+void ImpairedPort::CorruptData(quadlet_t *data, unsigned int numQuads)
+{
+    if (numQuads == 0)
+        return;
+    unsigned int bit = static_cast<unsigned int>(Random()*numQuads*32);
+    data[bit/32] ^= (1UL << (bit%32));
+}
+
+nodeid_t ImpairedPort::InitNodes(void)
+{
+    nodeid_t numNodes = inner->InitNodes();
+    // Hub board and bus generation are determined by the inner port
+    HubBoard = inner->HubBoard;
+    FwBusGeneration = inner->FwBusGeneration;
+    newFwBusGeneration = inner->newFwBusGeneration;
+    return numNodes;
+}
+
+bool ImpairedPort::ImpairRead(unsigned int type, nodeid_t node, nodeaddr_t addr, quadlet_t *rdata,
+                              unsigned int nbytes, unsigned char flags)
+{
+    double delay = GetDelay();
+    bool late = (profile.timeout > 0.0) && (delay > profile.timeout);
+    bool lost = Chance(profile.lossProb);
+
+    // The request is forwarded even if the response is lost or late, since the
+    // read may have side effects on the board (e.g., clearing the timestamp)
+    bool ret;
+    if (type == PortTrace::READ_QUADLET)
+        ret = inner->ReadQuadletNode(node, addr, *rdata, flags);
+    else
+        ret = inner->ReadBlockNode(node, addr, rdata, nbytes, flags);
+    counters[FORWARDED]++;
+
+    if (lost || late) {
+        counters[lost ? LOST : LATE]++;
+        Amp1394_Sleep(profile.timeout);
+        totalDelay += profile.timeout;
+        return false;
+    }
+    if (delay > 0.0) {
+        counters[DELAYED]++;
+        Amp1394_Sleep(delay);
+        totalDelay += delay;
+    }
+    if (!ret)
+        return false;
+
+    unsigned int numQuads = (nbytes+sizeof(quadlet_t)-1)/sizeof(quadlet_t);
+    uint64_t key = ResponseKey(node, addr);
+    std::vector<quadlet_t> cur(rdata, rdata+numQuads);
+    ResponseMap::iterator it = dupResponse.find(key);
+    if (it != dupResponse.end()) {
+        // Duplicate of previous response is received instead of current response
+        if (it->second.size() == numQuads)
+            memcpy(rdata, &(it->second[0]), nbytes);
+        dupResponse.erase(it);
+    }
+    else if (Chance(profile.reorderProb)) {
+        // Previous response is received after current response
+        it = lastResponse.find(key);
+        if ((it != lastResponse.end()) && (it->second.size() == numQuads)) {
+            memcpy(rdata, &(it->second[0]), nbytes);
+            counters[REORDERED]++;
+        }
+    }
+    if (Chance(profile.duplicateProb)) {
+        dupResponse[key] = cur;
+        counters[DUPLICATED]++;
+    }
+    if (Chance(profile.corruptProb)) {
+        CorruptData(rdata, nbytes/sizeof(quadlet_t));
+        counters[CORRUPTED]++;
+    }
+    lastResponse[key] = cur;
+    return true;
+}
+
+bool ImpairedPort::ForwardWrite(WriteTransaction &wr)
+{
+    bool ret = false;
+    quadlet_t *data = wr.data.empty() ? 0 : &(wr.data[0]);
+    switch (wr.type) {
+    case PortTrace::WRITE_QUADLET:
+        ret = inner->WriteQuadletNode(wr.node, wr.addr, *data, wr.flags);
+        break;
+    case PortTrace::WRITE_BLOCK:
+        ret = inner->WriteBlockNode(wr.node, wr.addr, data, wr.nbytes, wr.flags);
+        break;
+    case PortTrace::BC_OUTPUT:
+        ret = inner->WriteBroadcastOutput(data, wr.nbytes);
+        break;
+    case PortTrace::BC_READ_REQUEST:
+        // Boards queried when the request was issued (see BasePort::SetBoardRateDivisor),
+        // which may be an earlier cycle if the request was held back
+        inner->BoardQueryMask_ = wr.queryMask;
+        inner->NumOfBoardsQueried_ = wr.numQueried;
+        ret = inner->WriteBroadcastReadRequest(wr.seq);
+        break;
+    default:
+        outStr << "ImpairedPort::ForwardWrite: invalid transaction type " << wr.type << std::endl;
+        return false;
+    }
+    counters[FORWARDED]++;
+    return ret;
+}
+
+bool ImpairedPort::ImpairWrite(WriteTransaction &wr)
+{
+    double delay = GetDelay();
+    if (delay > 0.0) {
+        counters[DELAYED]++;
+        Amp1394_Sleep(delay);
+        totalDelay += delay;
+    }
+    if (Chance(profile.lossProb)) {
+        counters[LOST]++;
+        return true;
+    }
+    if (Chance(profile.corruptProb)) {
+        if (wr.type == PortTrace::BC_READ_REQUEST)
+            wr.seq ^= (1 << static_cast<unsigned int>(Random()*16));
+        else
+            CorruptData(wr.data.empty() ? 0 : &(wr.data[0]), wr.nbytes/sizeof(quadlet_t));
+        counters[CORRUPTED]++;
+    }
+    if (!haveHeldWrite && Chance(profile.reorderProb)) {
+        // Hold this write until after the next write
+        heldWrite = wr;
+        haveHeldWrite = true;
+        counters[REORDERED]++;
+        return true;
+    }
+    bool ret = ForwardWrite(wr);
+    if (Chance(profile.duplicateProb)) {
+        ForwardWrite(wr);
+        counters[DUPLICATED]++;
+    }
+    if (haveHeldWrite) {
+        haveHeldWrite = false;
+        ForwardWrite(heldWrite);
+    }
+    return ret;
+}
+
+bool ImpairedPort::ReadQuadletNode(nodeid_t node, nodeaddr_t addr, quadlet_t &data, unsigned char flags)
+{
+    return ImpairRead(PortTrace::READ_QUADLET, node, addr, &data, sizeof(quadlet_t), flags);
+}
+
+bool ImpairedPort::WriteQuadletNode(nodeid_t node, nodeaddr_t addr, quadlet_t data, unsigned char flags)
+{
+    WriteTransaction wr;
+    wr.type = PortTrace::WRITE_QUADLET;
+    wr.node = node;
+    wr.addr = addr;
+    wr.flags = flags;
+    wr.data.assign(1, data);
+    wr.nbytes = sizeof(quadlet_t);
+    wr.seq = 0;
+    wr.queryMask = 0;
+    wr.numQueried = 0;
+    return ImpairWrite(wr);
+}
+
+bool ImpairedPort::ReadBlockNode(nodeid_t node, nodeaddr_t addr, quadlet_t *rdata, unsigned int nbytes,
+                                 unsigned char flags)
+{
+    return ImpairRead(PortTrace::READ_BLOCK, node, addr, rdata, nbytes, flags);
+}
+
+bool ImpairedPort::WriteBlockNode(nodeid_t node, nodeaddr_t addr, quadlet_t *wdata, unsigned int nbytes,
+                                  unsigned char flags)
+{
+    WriteTransaction wr;
+    wr.type = PortTrace::WRITE_BLOCK;
+    wr.node = node;
+    wr.addr = addr;
+    wr.flags = flags;
+    wr.data.assign(wdata, wdata+(nbytes+sizeof(quadlet_t)-1)/sizeof(quadlet_t));
+    wr.nbytes = nbytes;
+    wr.seq = 0;
+    wr.queryMask = 0;
+    wr.numQueried = 0;
+    return ImpairWrite(wr);
+}
+
+bool ImpairedPort::WriteBroadcastOutput(quadlet_t *buffer, unsigned int size)
+{
+    WriteTransaction wr;
+    wr.type = PortTrace::BC_OUTPUT;
+    wr.node = FW_NODE_BROADCAST;
+    wr.addr = 0;
+    wr.flags = 0;
+    wr.data.assign(buffer, buffer+(size+sizeof(quadlet_t)-1)/sizeof(quadlet_t));
+    wr.nbytes = size;
+    wr.seq = 0;
+    wr.queryMask = 0;
+    wr.numQueried = 0;
+    return ImpairWrite(wr);
+}
+
+bool ImpairedPort::WriteBroadcastReadRequest(unsigned int seq)
+{
+    WriteTransaction wr;
+    wr.type = PortTrace::BC_READ_REQUEST;
+    wr.node = FW_NODE_BROADCAST;
+    wr.addr = 0;
+    wr.flags = 0;
+    wr.nbytes = 0;
+    wr.seq = seq;
+    wr.queryMask = BoardQueryMask_;
+    wr.numQueried = NumOfBoardsQueried_;
+    return ImpairWrite(wr);
+}
+
+void ImpairedPort::UpdateInnerBoards(void)
+{
+    inner->NumOfBoards_ = NumOfBoards_;
+    inner->BoardInUseMask_ = BoardInUseMask_;
+    inner->BoardQueryMask_ = BoardQueryMask_;
+    inner->NumOfBoardsQueried_ = NumOfBoardsQueried_;
+    inner->max_board = max_board;
+}
+
+bool ImpairedPort::AddBoard(BoardIO *board)
+{
+    bool ret = BasePort::AddBoard(board);
+    if (ret) {
+        // For FireWire, the hub board is the last added board (see FirewirePort::AddBoard)
+        if (GetPortType() == PORT_FIREWIRE)
+            HubBoard = board->GetBoardId();
+        UpdateInnerBoards();
+    }
+    return ret;
+}
+
+bool ImpairedPort::RemoveBoard(unsigned char boardId)
+{
+    bool ret = BasePort::RemoveBoard(boardId);
+    UpdateInnerBoards();
+    return ret;
+}
+
+bool ImpairedPort::CheckFwBusGeneration(const std::string &caller, bool doScan)
+{
+    // The bus generation is updated by the inner port (e.g., on bus reset)
+    newFwBusGeneration = inner->newFwBusGeneration;
+    return BasePort::CheckFwBusGeneration(caller, doScan);
+}
+
+void ImpairedPort::UpdateBusGeneration(unsigned int gen)
+{
+    inner->UpdateBusGeneration(gen);
+    FwBusGeneration = gen;
+}
@@ -0,0 +1,342 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <stdio.h>     // for rename, remove
+#include <fstream>
+#include <sstream>
+
+#include "MetricsExporter.h"
+#include "BasePort.h"
+#include "EthBasePort.h"
+#include "AmpIO.h"
+#include "Amp1394Time.h"
+
+#ifndef _MSC_VER
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0   // Mac OS X does not support MSG_NOSIGNAL
+#endif
+
+static const char *MetricPrefix = "amp1394_";
+
+MetricsExporter::MetricsExporter(std::ostream &debugStream) : outStr(debugStream), SocketFd(-1), period(1.0),
+                                                              lastExportTime(0.0)
+{
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    Close();
+}
+
+void MetricsExporter::AddPort(BasePort *port, const std::string &label)
+{
+    if (!port) return;
+    PortEntry entry;
+    entry.port = port;
+    if (label.empty()) {
+        std::ostringstream str;
+        switch (port->GetPortType()) {
+            case BasePort::PORT_FIREWIRE: str << "fw";  break;
+            case BasePort::PORT_ETH_RAW:  str << "eth"; break;
+            case BasePort::PORT_ETH_UDP:  str << "udp"; break;
+            default:                      str << "port"; break;
+        }
+        str << port->GetPortNum();
+        entry.label = str.str();
+    }
+    else {
+        entry.label = label;
+    }
+    Ports.push_back(entry);
+}
+
+bool MetricsExporter::OpenFile(const std::string &fileName)
+{
+    Close();
+    FileName = fileName;
+    return true;
+}
+
+bool MetricsExporter::OpenUnixSocket(const std::string &path)
+{
+    Close();
+#ifdef _MSC_VER
+    outStr << "MetricsExporter::OpenUnixSocket: not supported on this platform" << std::endl;
+    return false;
+#else
+    struct sockaddr_un addr;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        outStr << "MetricsExporter::OpenUnixSocket: path too long: " << path << std::endl;
+        return false;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        outStr << "MetricsExporter::OpenUnixSocket: failed to create socket: " << strerror(errno) << std::endl;
+        return false;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path)-1);
+    unlink(path.c_str());   // remove stale socket
+    if ((bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0) || (listen(fd, 4) != 0)) {
+        outStr << "MetricsExporter::OpenUnixSocket: failed to bind " << path << ": " << strerror(errno) << std::endl;
+        close(fd);
+        return false;
+    }
+    // Non-blocking, so that Update does not wait for clients
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0)|O_NONBLOCK);
+    SocketFd = fd;
+    SocketPath = path;
+    return true;
+#endif
+}
+
+void MetricsExporter::CloseClients(void)
+{
+#ifndef _MSC_VER
+    for (size_t i = 0; i < Clients.size(); i++)
+        close(Clients[i].fd);
+#endif
+    Clients.clear();
+}
+
+void MetricsExporter::Close(void)
+{
+    CloseClients();
+#ifndef _MSC_VER
+    if (SocketFd >= 0) {
+        close(SocketFd);
+        unlink(SocketPath.c_str());
+    }
+#endif
+    SocketFd = -1;
+    SocketPath.clear();
+    FileName.clear();
+}
+
+bool MetricsExporter::Update(void)
+{
+    if ((SocketFd < 0) && FileName.empty())
+        return true;
+    double curTime = Amp1394_GetTime();
+    if (curTime-lastExportTime < period)
+        return true;
+    lastExportTime = curTime;
+    return (SocketFd >= 0) ? ExportSocket() : ExportFile();
+}
+
+bool MetricsExporter::Export(void)
+{
+    lastExportTime = Amp1394_GetTime();
+    if (SocketFd >= 0)
+        return ExportSocket();
+    if (!FileName.empty())
+        return ExportFile();
+    return false;
+}
+
+bool MetricsExporter::ExportFile(void)
+{
+    // Write to a temporary file and then rename, so that readers never see a partial file
+    std::string tmpName = FileName + ".tmp";
+    std::ofstream outFile(tmpName.c_str());
+    if (!outFile.good()) {
+        outStr << "MetricsExporter: failed to open " << tmpName << std::endl;
+        return false;
+    }
+    WritePrometheus(outFile);
+    outFile.close();
+    if (outFile.fail()) {
+        outStr << "MetricsExporter: failed to write " << tmpName << std::endl;
+        return false;
+    }
+#ifdef _MSC_VER
+    remove(FileName.c_str());   // rename does not replace existing file on Windows
+#endif
+    if (rename(tmpName.c_str(), FileName.c_str()) != 0) {
+        outStr << "MetricsExporter: failed to rename " << tmpName << " to " << FileName << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool MetricsExporter::SendToClient(ClientEntry &client, bool &error)
+{
+#ifdef _MSC_VER
+    error = true;
+    return true;
+#else
+    while (client.offset < client.text.size()) {
+        ssize_t n = send(client.fd, client.text.data()+client.offset, client.text.size()-client.offset,
+                         MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+                return false;   // try again at next export
+        }
+        if (n <= 0) {
+            error = true;
+            return true;
+        }
+        client.offset += static_cast<size_t>(n);
+    }
+    return true;
+#endif
+}
+
+bool MetricsExporter::ExportSocket(void)
+{
+#ifdef _MSC_VER
+    return false;
+#else
+    bool error = false;
+    // Continue sending to clients from previous exports
+    size_t i = 0;
+    while (i < Clients.size()) {
+        if (SendToClient(Clients[i], error)) {
+            close(Clients[i].fd);
+            Clients.erase(Clients.begin()+i);
+        }
+        else
+            i++;
+    }
+    // Accept new clients; all receive the same output
+    std::string text;
+    int clientFd;
+    while ((Clients.size() < MAX_CLIENTS) && ((clientFd = accept(SocketFd, 0, 0)) >= 0)) {
+        // Accepted sockets do not inherit O_NONBLOCK on Linux
+        fcntl(clientFd, F_SETFL, fcntl(clientFd, F_GETFL, 0)|O_NONBLOCK);
+        if (text.empty()) {
+            std::ostringstream str;
+            WritePrometheus(str);
+            text = str.str();
+        }
+        ClientEntry client;
+        client.fd = clientFd;
+        client.text = text;
+        client.offset = 0;
+        if (SendToClient(client, error))
+            close(clientFd);
+        else
+            Clients.push_back(client);
+    }
+    return !error;
+#endif
+}
+
+void MetricsExporter::WritePrometheus(std::ostream &out) const
+{
+    size_t i;
+    unsigned int bnum;
+
+    // Port counters
+    for (int type = 0; type < PortCounters::NUM_PORT_COUNTERS; type++) {
+        PortCounters::PortCounterType ptype = static_cast<PortCounters::PortCounterType>(type);
+        out << "# HELP " << MetricPrefix << "port_" << PortCounters::GetName(ptype) << "_total "
+            << PortCounters::GetDescription(ptype) << std::endl
+            << "# TYPE " << MetricPrefix << "port_" << PortCounters::GetName(ptype) << "_total counter" << std::endl;
+        for (i = 0; i < Ports.size(); i++) {
+            out << MetricPrefix << "port_" << PortCounters::GetName(ptype) << "_total{port=\""
+                << Ports[i].label << "\"} " << Ports[i].port->GetCounters().GetPort(ptype) << std::endl;
+        }
+    }
+
+    // Board counters
+    for (int type = 0; type < PortCounters::NUM_BOARD_COUNTERS; type++) {
+        PortCounters::BoardCounterType btype = static_cast<PortCounters::BoardCounterType>(type);
+        out << "# HELP " << MetricPrefix << "board_" << PortCounters::GetName(btype) << "_total "
+            << PortCounters::GetDescription(btype) << std::endl
+            << "# TYPE " << MetricPrefix << "board_" << PortCounters::GetName(btype) << "_total counter" << std::endl;
+        for (i = 0; i < Ports.size(); i++) {
+            for (bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+                if (!Ports[i].port->GetBoard(bnum)) continue;
+                out << MetricPrefix << "board_" << PortCounters::GetName(btype) << "_total{port=\""
+                    << Ports[i].label << "\",board=\"" << bnum << "\"} "
+                    << Ports[i].port->GetCounters().GetBoard(bnum, btype) << std::endl;
+            }
+        }
+    }
+
+    // Real-time read/write errors (BoardIO), which can be cleared by the application
+    const char *rtNames[2] = { "rt_read_errors", "rt_write_errors" };
+    for (int rw = 0; rw < 2; rw++) {
+        out << "# HELP " << MetricPrefix << "board_" << rtNames[rw]
+            << " Real-time " << (rw == 0 ? "read" : "write") << " errors since last cleared" << std::endl
+            << "# TYPE " << MetricPrefix << "board_" << rtNames[rw] << " gauge" << std::endl;
+        for (i = 0; i < Ports.size(); i++) {
+            for (bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+                const BoardIO *board = Ports[i].port->GetBoard(bnum);
+                if (!board) continue;
+                out << MetricPrefix << "board_" << rtNames[rw] << "{port=\"" << Ports[i].label
+                    << "\",board=\"" << bnum << "\"} "
+                    << ((rw == 0) ? board->GetReadErrors() : board->GetWriteErrors()) << std::endl;
+            }
+        }
+    }
+
+    // Encoder errors (AmpIO)
+    out << "# HELP " << MetricPrefix << "encoder_errors Encoder errors since last cleared" << std::endl
+        << "# TYPE " << MetricPrefix << "encoder_errors gauge" << std::endl;
+    for (i = 0; i < Ports.size(); i++) {
+        for (bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+            const AmpIO *board = dynamic_cast<const AmpIO *>(Ports[i].port->GetBoard(bnum));
+            if (!board) continue;
+            for (unsigned int axis = 0; axis < board->GetNumChannels(); axis++) {
+                out << MetricPrefix << "encoder_errors{port=\"" << Ports[i].label << "\",board=\"" << bnum
+                    << "\",axis=\"" << axis << "\"} " << board->GetEncoderErrorCount(axis) << std::endl;
+            }
+        }
+    }
+
+    // FPGA status reported with each Ethernet response
+    out << "# HELP " << MetricPrefix << "fpga_packet_errors Ethernet packet errors reported by FPGA (8-bit counter)" << std::endl
+        << "# TYPE " << MetricPrefix << "fpga_packet_errors gauge" << std::endl;
+    for (i = 0; i < Ports.size(); i++) {
+        const EthBasePort *ethPort = dynamic_cast<const EthBasePort *>(Ports[i].port);
+        if (!ethPort) continue;
+        EthBasePort::FPGA_Status status;
+        ethPort->GetFpgaStatus(status);
+        out << MetricPrefix << "fpga_packet_errors{port=\"" << Ports[i].label << "\"} "
+            << status.numPacketError << std::endl;
+    }
+    out << "# HELP " << MetricPrefix << "fpga_fw_packet_dropped FireWire packet dropped by FPGA (last response)" << std::endl
+        << "# TYPE " << MetricPrefix << "fpga_fw_packet_dropped gauge" << std::endl;
+    for (i = 0; i < Ports.size(); i++) {
+        const EthBasePort *ethPort = dynamic_cast<const EthBasePort *>(Ports[i].port);
+        if (!ethPort) continue;
+        EthBasePort::FPGA_Status status;
+        ethPort->GetFpgaStatus(status);
+        out << MetricPrefix << "fpga_fw_packet_dropped{port=\"" << Ports[i].label << "\"} "
+            << (status.FwPacketDropped ? 1 : 0) << std::endl;
+    }
+    out << "# HELP " << MetricPrefix << "fpga_eth_summary_error Ethernet summary error reported by FPGA (last response)" << std::endl
+        << "# TYPE " << MetricPrefix << "fpga_eth_summary_error gauge" << std::endl;
+    for (i = 0; i < Ports.size(); i++) {
+        const EthBasePort *ethPort = dynamic_cast<const EthBasePort *>(Ports[i].port);
+        if (!ethPort) continue;
+        EthBasePort::FPGA_Status status;
+        ethPort->GetFpgaStatus(status);
+        out << MetricPrefix << "fpga_eth_summary_error{port=\"" << Ports[i].label << "\"} "
+            << (status.EthSummaryError ? 1 : 0) << std::endl;
+    }
+}
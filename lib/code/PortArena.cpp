@@ -0,0 +1,128 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "PortArena.h"
+
+#ifdef _MSC_VER
+#include <malloc.h>    // for _aligned_malloc
+#else
+#include <sys/mman.h>
+#endif
+
+bool PortArena::useHugePages = false;
+
+#if defined(MAP_HUGETLB)
+// Huge page size used for mmap (Linux default)
+static const size_t HugePageSize = 2*1024*1024;
+#endif
+
+PortArena::PortArena() : block(0), blockSize(0), hugePage(false)
+{
+}
+
+PortArena::~PortArena()
+{
+    Free();
+}
+
+unsigned int PortArena::AddRegion(size_t nbytes, size_t alignOffset)
+{
+    Region region;
+    region.size = nbytes;
+    region.alignOffset = alignOffset%CACHE_LINE_SIZE;
+    region.offset = 0;
+    regions.push_back(region);
+    return static_cast<unsigned int>(regions.size()-1);
+}
+
+bool PortArena::Allocate(void)
+{
+    if (block)
+        return true;
+
+    // Compute region offsets. Each region starts on a new cache line, shifted so that
+    // the byte at alignOffset is on a cache line boundary.
+    size_t offset = 0;
+    for (size_t i = 0; i < regions.size(); i++) {
+        size_t shift = (CACHE_LINE_SIZE-regions[i].alignOffset)%CACHE_LINE_SIZE;
+        regions[i].offset = offset+shift;
+        size_t used = shift+regions[i].size;
+        offset += ((used+CACHE_LINE_SIZE-1)/CACHE_LINE_SIZE)*CACHE_LINE_SIZE;
+    }
+    if (offset == 0)
+        return false;
+
+#if defined(MAP_HUGETLB)
+    if (useHugePages) {
+        size_t hugeSize = ((offset+HugePageSize-1)/HugePageSize)*HugePageSize;
+        void *mem = mmap(0, hugeSize, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+        if (mem != MAP_FAILED) {
+            block = static_cast<unsigned char *>(mem);   // already zero-filled
+            blockSize = hugeSize;
+            hugePage = true;
+            return true;
+        }
+    }
+#endif
+
+#ifdef _MSC_VER
+    block = static_cast<unsigned char *>(_aligned_malloc(offset, CACHE_LINE_SIZE));
+#else
+    void *mem = 0;
+    if (posix_memalign(&mem, CACHE_LINE_SIZE, offset) == 0)
+        block = static_cast<unsigned char *>(mem);
+#endif
+    if (!block)
+        return false;
+    memset(block, 0, offset);
+    blockSize = offset;
+    hugePage = false;
+    return true;
+}
+
+void PortArena::Free(void)
+{
+    if (block) {
+#if defined(MAP_HUGETLB)
+        if (hugePage)
+            munmap(block, blockSize);
+        else
+            free(block);
+#elif defined(_MSC_VER)
+        _aligned_free(block);
+#else
+        free(block);
+#endif
+    }
+    block = 0;
+    blockSize = 0;
+    hugePage = false;
+    regions.clear();
+}
+
+unsigned char *PortArena::GetRegion(unsigned int index) const
+{
+    if (!block || (index >= regions.size()))
+        return 0;
+    return block+regions[index].offset;
+}
+
+size_t PortArena::GetRegionSize(unsigned int index) const
+{
+    return (index < regions.size()) ? regions[index].size : 0;
+}
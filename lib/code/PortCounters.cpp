@@ -0,0 +1,103 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include "PortCounters.h"
+#include "BasePort.h"     // for FW_NODE_MASK
+
+static const char *PortCounterNames[PortCounters::NUM_PORT_COUNTERS] = {
+    "transactions", "tx_bytes", "rx_bytes", "failures", "timeouts",
+    "flushed_packets", "bus_resets", "broadcast_reads"
+};
+
+static const char *PortCounterDescriptions[PortCounters::NUM_PORT_COUNTERS] = {
+    "Number of read/write transactions",
+    "Data bytes written",
+    "Data bytes read",
+    "Failed transactions",
+    "Read responses not received",
+    "Unexpected packets flushed before a read",
+    "Bus resets handled by rescanning nodes",
+    "Broadcast read cycles"
+};
+
+static const char *BoardCounterNames[PortCounters::NUM_BOARD_COUNTERS] = {
+    "reads", "writes", "rx_bytes", "tx_bytes", "read_failures", "write_failures",
+    "seq_mismatches", "stale_data"
+};
+
+static const char *BoardCounterDescriptions[PortCounters::NUM_BOARD_COUNTERS] = {
+    "Read transactions",
+    "Write transactions",
+    "Data bytes read",
+    "Data bytes written",
+    "Failed read transactions",
+    "Failed write transactions",
+    "Broadcast read sequence number mismatches",
+    "Broadcast read data from the previous cycle"
+};
+
+void PortCounters::Clear(void)
+{
+    unsigned int i, j;
+    for (i = 0; i < NUM_PORT_COUNTERS; i++)
+        portCounters[i] = 0;
+    for (j = 0; j < BoardIO::MAX_BOARDS; j++)
+        for (i = 0; i < NUM_BOARD_COUNTERS; i++)
+            boardCounters[j][i] = 0;
+}
+
+void PortCounters::UpdateTransaction(unsigned char boardId, bool isRead, unsigned int nbytes, bool ok)
+{
+    portCounters[TRANSACTIONS]++;
+    if (ok)
+        portCounters[isRead ? RX_BYTES : TX_BYTES] += nbytes;
+    else
+        portCounters[FAILURES]++;
+
+    unsigned int boardNum = boardId&FW_NODE_MASK;
+    if (boardNum < BoardIO::MAX_BOARDS) {
+        CounterType *counters = boardCounters[boardNum];
+        if (isRead) {
+            counters[BOARD_READS]++;
+            if (ok) counters[BOARD_RX_BYTES] += nbytes;
+            else    counters[BOARD_READ_FAILURES]++;
+        }
+        else {
+            counters[BOARD_WRITES]++;
+            if (ok) counters[BOARD_TX_BYTES] += nbytes;
+            else    counters[BOARD_WRITE_FAILURES]++;
+        }
+    }
+}
+
+const char *PortCounters::GetName(PortCounterType type)
+{
+    return (type < NUM_PORT_COUNTERS) ? PortCounterNames[type] : "";
+}
+
+const char *PortCounters::GetDescription(PortCounterType type)
+{
+    return (type < NUM_PORT_COUNTERS) ? PortCounterDescriptions[type] : "";
+}
+
+const char *PortCounters::GetName(BoardCounterType type)
+{
+    return (type < NUM_BOARD_COUNTERS) ? BoardCounterNames[type] : "";
+}
+
+const char *PortCounters::GetDescription(BoardCounterType type)
+{
+    return (type < NUM_BOARD_COUNTERS) ? BoardCounterDescriptions[type] : "";
+}
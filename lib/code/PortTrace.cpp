@@ -0,0 +1,138 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <string.h>   // for memcmp, memcpy, memset
+#include <fstream>
+#include <iomanip>
+
+#include "PortTrace.h"
+
+const char PortTrace::Magic[8] = { 'A', 'M', 'P', '1', '3', '9', '4', 'T' };
+
+std::string PortTrace::RecordTypeString(unsigned int type)
+{
+    static const char *names[] = { "READ_QUADLET", "WRITE_QUADLET", "READ_BLOCK", "WRITE_BLOCK",
+                                   "BC_OUTPUT", "BC_READ_REQUEST", "INIT_NODES", "BUS_GENERATION" };
+    if (type < sizeof(names)/sizeof(names[0]))
+        return std::string(names[type]);
+    return std::string("UNKNOWN");
+}
+
+PortTrace::PortTrace()
+{
+    memset(&header, 0, sizeof(header));
+}
+
+PortTrace::~PortTrace()
+{
+}
+
+bool PortTrace::Load(const std::string &fileName, std::ostream &outStr)
+{
+    buffer.clear();
+    offsets.clear();
+    records.clear();
+    std::ifstream inFile(fileName.c_str(), std::ios::binary);
+    if (!inFile.good()) {
+        outStr << "PortTrace::Load: could not open " << fileName << std::endl;
+        return false;
+    }
+    inFile.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (!inFile.good() || (memcmp(header.magic, Magic, sizeof(Magic)) != 0)) {
+        outStr << "PortTrace::Load: " << fileName << " is not a trace file" << std::endl;
+        return false;
+    }
+    if (header.version != VERSION) {
+        outStr << "PortTrace::Load: unsupported version " << header.version << " in " << fileName << std::endl;
+        return false;
+    }
+    // Read rest of file
+    inFile.seekg(0, std::ios::end);
+    std::streamoff fileSize = inFile.tellg();
+    std::streamoff dataSize = fileSize-static_cast<std::streamoff>(sizeof(header));
+    if (dataSize <= 0)
+        return false;
+    buffer.resize(static_cast<size_t>(dataSize));
+    inFile.seekg(sizeof(header), std::ios::beg);
+    inFile.read(reinterpret_cast<char *>(&buffer[0]), dataSize);
+    if (!inFile.good()) {
+        outStr << "PortTrace::Load: error reading " << fileName << std::endl;
+        buffer.clear();
+        return false;
+    }
+    // Build record index. A truncated record at the end (e.g., if the recording program
+    // was terminated) is ignored.
+    size_t offset = 0;
+    PortTraceRecord rec;
+    while (offset+sizeof(PortTraceRecord) <= buffer.size()) {
+        memcpy(&rec, &buffer[offset], sizeof(PortTraceRecord));
+        size_t recSize = sizeof(PortTraceRecord)+rec.nbytes;
+        if (offset+recSize > buffer.size()) {
+            outStr << "PortTrace::Load: ignoring truncated record " << offsets.size() << std::endl;
+            break;
+        }
+        offsets.push_back(offset);
+        records.push_back(rec);
+        offset += recSize;
+    }
+    return !offsets.empty();
+}
+
+const PortTraceRecord *PortTrace::GetRecord(size_t i) const
+{
+    if (i >= offsets.size())
+        return 0;
+    return &records[i];
+}
+
+const unsigned char *PortTrace::GetRecordData(size_t i) const
+{
+    if (i >= offsets.size())
+        return 0;
+    return &buffer[offsets[i]+sizeof(PortTraceRecord)];
+}
+
+double PortTrace::GetDuration(void) const
+{
+    if (offsets.empty())
+        return 0.0;
+    return (GetRecord(offsets.size()-1)->endTime-GetRecord(0)->startTime)*1e-9;
+}
+
+void PortTrace::PrintSummary(std::ostream &outStr) const
+{
+    unsigned int numType[BUS_GENERATION+1];
+    unsigned int numFailed[BUS_GENERATION+1];
+    memset(numType, 0, sizeof(numType));
+    memset(numFailed, 0, sizeof(numFailed));
+    for (size_t i = 0; i < offsets.size(); i++) {
+        const PortTraceRecord *rec = GetRecord(i);
+        if (rec->type <= BUS_GENERATION) {
+            numType[rec->type]++;
+            if (!rec->ok) numFailed[rec->type]++;
+        }
+    }
+    outStr << "Trace of " << GetNumRecords() << " records, duration " << std::fixed << std::setprecision(3)
+           << GetDuration() << " s, port " << header.portType << " (" << header.portNum << ")" << std::endl;
+    for (unsigned int t = 0; t <= BUS_GENERATION; t++) {
+        if (numType[t] > 0) {
+            outStr << "  " << std::setw(16) << std::left << RecordTypeString(t) << std::right
+                   << std::setw(10) << numType[t];
+            if (numFailed[t] > 0)
+                outStr << " (" << numFailed[t] << " failed)";
+            outStr << std::endl;
+        }
+    }
+}
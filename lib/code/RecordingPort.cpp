@@ -0,0 +1,226 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <string.h>   // for memcpy, memset
+
+#include "RecordingPort.h"
+#include "Amp1394Time.h"
+
+RecordingPort::RecordingPort(BasePort *innerPort, const std::string &fileName, std::ostream &debugStream):
+    BasePort(innerPort ? innerPort->GetPortNum() : 0, debugStream),
+    inner(innerPort),
+    FileName(fileName),
+    numRecords(0),
+    lastBusGeneration(0)
+{
+    traceFile.open(FileName.c_str(), std::ios::binary|std::ios::trunc);
+    if (!traceFile.good())
+        outStr << "RecordingPort: could not open trace file " << FileName << std::endl;
+    else if (inner) {
+        PortTraceHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, PortTrace::Magic, sizeof(header.magic));
+        header.version = PortTrace::VERSION;
+        header.portType = static_cast<uint32_t>(inner->GetPortType());
+        header.portNum = inner->GetPortNum();
+        header.maxReadDataSize = inner->GetMaxReadDataSize();
+        header.maxWriteDataSize = inner->GetMaxWriteDataSize();
+        traceFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    }
+    if (Init())
+        outStr << "RecordingPort: recording to " << FileName << std::endl;
+    else
+        outStr << "RecordingPort: initialization failed" << std::endl;
+}
+
+RecordingPort::~RecordingPort()
+{
+    Cleanup();
+    traceFile.close();
+}
+
+bool RecordingPort::Init(void)
+{
+    if (!IsOK())
+        return false;
+    bool ret = ScanNodes();
+    if (ret)
+        SetDefaultProtocol();
+    return ret;
+}
+
+void RecordingPort::Cleanup(void)
+{
+    Flush();
+}
+
+void RecordingPort::Flush(void)
+{
+    if (traceFile.is_open())
+        traceFile.flush();
+}
+
+bool RecordingPort::IsOK(void)
+{
+    return (inner && inner->IsOK() && traceFile.good());
+}
+
+void RecordingPort::WriteRecord(unsigned int type, bool ok, nodeid_t node, nodeaddr_t addr, unsigned char flags,
+                                const void *data, unsigned int nbytes, unsigned int value,
+                                int64_t startTime, int64_t endTime)
+{
+    if (!traceFile.good())
+        return;
+    PortTraceRecord rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.type = static_cast<uint8_t>(type);
+    rec.ok = ok ? 1 : 0;
+    rec.flags = flags;
+    rec.node = node;
+    rec.addr = addr;
+    rec.nbytes = data ? nbytes : 0;
+    rec.value = value;
+    rec.startTime = startTime;
+    rec.endTime = endTime;
+    traceFile.write(reinterpret_cast<const char *>(&rec), sizeof(rec));
+    if (rec.nbytes > 0)
+        traceFile.write(reinterpret_cast<const char *>(data), rec.nbytes);
+    numRecords++;
+}
+
+nodeid_t RecordingPort::InitNodes(void)
+{
+    int64_t startTime = Amp1394_GetMonotonicTime();
+    nodeid_t numNodes = inner->InitNodes();
+    int64_t endTime = Amp1394_GetMonotonicTime();
+    // Hub board and bus generation are determined by the inner port
+    HubBoard = inner->HubBoard;
+    FwBusGeneration = inner->FwBusGeneration;
+    newFwBusGeneration = inner->newFwBusGeneration;
+    lastBusGeneration = newFwBusGeneration;
+    WriteRecord(PortTrace::INIT_NODES, numNodes > 0, numNodes, HubBoard, 0, 0, 0, FwBusGeneration,
+                startTime, endTime);
+    return numNodes;
+}
+
+bool RecordingPort::ReadQuadletNode(nodeid_t node, nodeaddr_t addr, quadlet_t &data, unsigned char flags)
+{
+    int64_t startTime = Amp1394_GetMonotonicTime();
+    bool ret = inner->ReadQuadletNode(node, addr, data, flags);
+    int64_t endTime = Amp1394_GetMonotonicTime();
+    quadlet_t rdata = ret ? data : 0;
+    WriteRecord(PortTrace::READ_QUADLET, ret, node, addr, flags, &rdata, sizeof(quadlet_t), 0,
+                startTime, endTime);
+    return ret;
+}
+
+bool RecordingPort::WriteQuadletNode(nodeid_t node, nodeaddr_t addr, quadlet_t data, unsigned char flags)
+{
+    int64_t startTime = Amp1394_GetMonotonicTime();
+    bool ret = inner->WriteQuadletNode(node, addr, data, flags);
+    int64_t endTime = Amp1394_GetMonotonicTime();
+    WriteRecord(PortTrace::WRITE_QUADLET, ret, node, addr, flags, &data, sizeof(quadlet_t), 0,
+                startTime, endTime);
+    return ret;
+}
+
+bool RecordingPort::ReadBlockNode(nodeid_t node, nodeaddr_t addr, quadlet_t *rdata, unsigned int nbytes,
+                                  unsigned char flags)
+{
+    int64_t startTime = Amp1394_GetMonotonicTime();
+    bool ret = inner->ReadBlockNode(node, addr, rdata, nbytes, flags);
+    int64_t endTime = Amp1394_GetMonotonicTime();
+    if (!ret)
+        memset(rdata, 0, nbytes);
+    WriteRecord(PortTrace::READ_BLOCK, ret, node, addr, flags, rdata, nbytes, 0, startTime, endTime);
+    return ret;
+}
+
+bool RecordingPort::WriteBlockNode(nodeid_t node, nodeaddr_t addr, quadlet_t *wdata, unsigned int nbytes,
+                                   unsigned char flags)
+{
+    int64_t startTime = Amp1394_GetMonotonicTime();
+    bool ret = inner->WriteBlockNode(node, addr, wdata, nbytes, flags);
+    int64_t endTime = Amp1394_GetMonotonicTime();
+    WriteRecord(PortTrace::WRITE_BLOCK, ret, node, addr, flags, wdata, nbytes, 0, startTime, endTime);
+    return ret;
+}
+
+bool RecordingPort::WriteBroadcastOutput(quadlet_t *buffer, unsigned int size)
+{
+    int64_t startTime = Amp1394_GetMonotonicTime();
+    bool ret = inner->WriteBroadcastOutput(buffer, size);
+    int64_t endTime = Amp1394_GetMonotonicTime();
+    WriteRecord(PortTrace::BC_OUTPUT, ret, FW_NODE_BROADCAST, 0, 0, buffer, size, 0, startTime, endTime);
+    return ret;
+}
+
+bool RecordingPort::WriteBroadcastReadRequest(unsigned int seq)
+{
+    // Boards queried in this cycle (see BasePort::SetBoardRateDivisor)
+    inner->BoardQueryMask_ = BoardQueryMask_;
+    inner->NumOfBoardsQueried_ = NumOfBoardsQueried_;
+    int64_t startTime = Amp1394_GetMonotonicTime();
+    bool ret = inner->WriteBroadcastReadRequest(seq);
+    int64_t endTime = Amp1394_GetMonotonicTime();
+    WriteRecord(PortTrace::BC_READ_REQUEST, ret, FW_NODE_BROADCAST, 0, 0, 0, 0, seq, startTime, endTime);
+    return ret;
+}
+
+void RecordingPort::UpdateInnerBoards(void)
+{
+    inner->NumOfBoards_ = NumOfBoards_;
+    inner->BoardInUseMask_ = BoardInUseMask_;
+    inner->BoardQueryMask_ = BoardQueryMask_;
+    inner->NumOfBoardsQueried_ = NumOfBoardsQueried_;
+    inner->max_board = max_board;
+}
+
+bool RecordingPort::AddBoard(BoardIO *board)
+{
+    bool ret = BasePort::AddBoard(board);
+    if (ret) {
+        // For FireWire, the hub board is the last added board (see FirewirePort::AddBoard)
+        if (GetPortType() == PORT_FIREWIRE)
+            HubBoard = board->GetBoardId();
+        UpdateInnerBoards();
+    }
+    return ret;
+}
+
+bool RecordingPort::RemoveBoard(unsigned char boardId)
+{
+    bool ret = BasePort::RemoveBoard(boardId);
+    UpdateInnerBoards();
+    return ret;
+}
+
+bool RecordingPort::CheckFwBusGeneration(const std::string &caller, bool doScan)
+{
+    // The bus generation is updated by the inner port (e.g., on bus reset)
+    newFwBusGeneration = inner->newFwBusGeneration;
+    if (newFwBusGeneration != lastBusGeneration) {
+        int64_t now = Amp1394_GetMonotonicTime();
+        WriteRecord(PortTrace::BUS_GENERATION, true, 0, 0, 0, 0, 0, newFwBusGeneration, now, now);
+        lastBusGeneration = newFwBusGeneration;
+    }
+    return BasePort::CheckFwBusGeneration(caller, doScan);
+}
+
+void RecordingPort::UpdateBusGeneration(unsigned int gen)
+{
+    inner->UpdateBusGeneration(gen);
+    FwBusGeneration = gen;
+}
@@ -0,0 +1,211 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <string.h>   // for memcpy, memcmp
+
+#include "ReplayPort.h"
+#include "Amp1394Time.h"
+
+ReplayPort::ReplayPort(const std::string &fileName, std::ostream &debugStream):
+    BasePort(0, debugStream),
+    FileName(fileName),
+    curRecord(0),
+    realTime(false),
+    traceStartTime(0),
+    replayStartTime(0),
+    numMismatches(0),
+    numWriteDataMismatches(0),
+    endReported(false)
+{
+    if (Trace.Load(FileName, outStr))
+        PortNum = Trace.GetHeader().portNum;
+    if (Init())
+        outStr << "ReplayPort: replaying " << Trace.GetNumRecords() << " records from " << FileName << std::endl;
+    else
+        outStr << "ReplayPort: initialization failed" << std::endl;
+}
+
+ReplayPort::~ReplayPort()
+{
+}
+
+bool ReplayPort::Init(void)
+{
+    if (!IsOK())
+        return false;
+    bool ret = ScanNodes();
+    if (ret)
+        SetDefaultProtocol();
+    return ret;
+}
+
+void ReplayPort::Rewind(void)
+{
+    curRecord = 0;
+    replayStartTime = 0;
+    numMismatches = 0;
+    numWriteDataMismatches = 0;
+    endReported = false;
+    Init();
+}
+
+void ReplayPort::ApplyMetaRecords(void)
+{
+    const PortTraceRecord *rec = Trace.GetRecord(curRecord);
+    while (rec && (rec->type == PortTrace::BUS_GENERATION)) {
+        newFwBusGeneration = rec->value;
+        rec = Trace.GetRecord(++curRecord);
+    }
+}
+
+void ReplayPort::WaitRecordTime(const PortTraceRecord *rec)
+{
+    if (replayStartTime == 0) {
+        replayStartTime = Amp1394_GetMonotonicTime();
+        traceStartTime = rec->startTime;
+    }
+    if (!realTime)
+        return;
+    int64_t delay = (rec->endTime-traceStartTime)-(Amp1394_GetMonotonicTime()-replayStartTime);
+    if (delay > 0)
+        Amp1394_Sleep(delay*1e-9);
+}
+
+const PortTraceRecord *ReplayPort::NextRecord(unsigned int type, nodeid_t node, nodeaddr_t addr, unsigned int nbytes,
+                                              const unsigned char *&data)
+{
+    ApplyMetaRecords();
+    const PortTraceRecord *rec = Trace.GetRecord(curRecord);
+    if (!rec) {
+        if (!endReported) {
+            outStr << "ReplayPort: end of trace reached (" << PortTrace::RecordTypeString(type) << ")" << std::endl;
+            endReported = true;
+        }
+        return 0;
+    }
+    if ((rec->type != type) || (rec->node != node) || (rec->addr != addr) || (rec->nbytes != nbytes)) {
+        if (numMismatches == 0) {
+            outStr << "ReplayPort: transaction " << PortTrace::RecordTypeString(type)
+                   << " (node " << node << ", addr " << std::hex << addr << std::dec << ", " << nbytes
+                   << " bytes) does not match record " << curRecord << ": "
+                   << PortTrace::RecordTypeString(rec->type) << " (node " << rec->node << ", addr "
+                   << std::hex << rec->addr << std::dec << ", " << rec->nbytes << " bytes)" << std::endl;
+        }
+        numMismatches++;
+        return 0;
+    }
+    data = Trace.GetRecordData(curRecord);
+    curRecord++;
+    WaitRecordTime(rec);
+    return rec;
+}
+
+void ReplayPort::CheckWriteData(const PortTraceRecord *rec, const unsigned char *recData, const void *wdata)
+{
+    if (memcmp(recData, wdata, rec->nbytes) != 0)
+        numWriteDataMismatches++;
+}
+
+nodeid_t ReplayPort::InitNodes(void)
+{
+    const unsigned char *data;
+    // For INIT_NODES, node and addr are results (number of nodes and hub board), so they are
+    // not matched; just check the record type.
+    ApplyMetaRecords();
+    const PortTraceRecord *rec = Trace.GetRecord(curRecord);
+    if (!rec || (rec->type != PortTrace::INIT_NODES)) {
+        NextRecord(PortTrace::INIT_NODES, 0, 0, 0, data);   // reports mismatch
+        return 0;
+    }
+    NextRecord(PortTrace::INIT_NODES, rec->node, rec->addr, 0, data);
+    HubBoard = static_cast<unsigned char>(rec->addr);
+    FwBusGeneration = rec->value;
+    newFwBusGeneration = rec->value;
+    return static_cast<nodeid_t>(rec->node);
+}
+
+bool ReplayPort::ReadQuadletNode(nodeid_t node, nodeaddr_t addr, quadlet_t &data, unsigned char)
+{
+    const unsigned char *recData;
+    const PortTraceRecord *rec = NextRecord(PortTrace::READ_QUADLET, node, addr, sizeof(quadlet_t), recData);
+    if (!rec)
+        return false;
+    memcpy(&data, recData, sizeof(quadlet_t));
+    return rec->ok;
+}
+
+bool ReplayPort::WriteQuadletNode(nodeid_t node, nodeaddr_t addr, quadlet_t data, unsigned char)
+{
+    const unsigned char *recData;
+    const PortTraceRecord *rec = NextRecord(PortTrace::WRITE_QUADLET, node, addr, sizeof(quadlet_t), recData);
+    if (!rec)
+        return false;
+    CheckWriteData(rec, recData, &data);
+    return rec->ok;
+}
+
+bool ReplayPort::ReadBlockNode(nodeid_t node, nodeaddr_t addr, quadlet_t *rdata, unsigned int nbytes,
+                               unsigned char)
+{
+    const unsigned char *recData;
+    const PortTraceRecord *rec = NextRecord(PortTrace::READ_BLOCK, node, addr, nbytes, recData);
+    if (!rec)
+        return false;
+    memcpy(rdata, recData, nbytes);
+    return rec->ok;
+}
+
+bool ReplayPort::WriteBlockNode(nodeid_t node, nodeaddr_t addr, quadlet_t *wdata, unsigned int nbytes,
+                                unsigned char)
+{
+    const unsigned char *recData;
+    const PortTraceRecord *rec = NextRecord(PortTrace::WRITE_BLOCK, node, addr, nbytes, recData);
+    if (!rec)
+        return false;
+    CheckWriteData(rec, recData, wdata);
+    return rec->ok;
+}
+
+bool ReplayPort::WriteBroadcastOutput(quadlet_t *buffer, unsigned int size)
+{
+    const unsigned char *recData;
+    const PortTraceRecord *rec = NextRecord(PortTrace::BC_OUTPUT, FW_NODE_BROADCAST, 0, size, recData);
+    if (!rec)
+        return false;
+    CheckWriteData(rec, recData, buffer);
+    return rec->ok;
+}
+
+bool ReplayPort::WriteBroadcastReadRequest(unsigned int)
+{
+    const unsigned char *recData;
+    const PortTraceRecord *rec = NextRecord(PortTrace::BC_READ_REQUEST, FW_NODE_BROADCAST, 0, 0, recData);
+    return rec ? rec->ok : false;
+}
+
+bool ReplayPort::AddBoard(BoardIO *board)
+{
+    bool ret = BasePort::AddBoard(board);
+    // For FireWire, the hub board is the last added board (see FirewirePort::AddBoard)
+    if (ret && (GetPortType() == PORT_FIREWIRE))
+        HubBoard = board->GetBoardId();
+    return ret;
+}
+
+bool ReplayPort::CheckFwBusGeneration(const std::string &caller, bool doScan)
+{
+    ApplyMetaRecords();
+    return BasePort::CheckFwBusGeneration(caller, doScan);
+}
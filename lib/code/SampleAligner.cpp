@@ -0,0 +1,203 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <iomanip>
+
+#include "SampleAligner.h"
+#include "BasePort.h"
+#include "AmpIO.h"
+#include "ClockSync.h"
+
+SampleAligner::SampleAligner(BasePort *p) : port(p), targetType(ALIGN_LATEST), useAccel(true), source(SOURCE_NONE), boardMask(0), skew(0.0), residualSkew(0.0)
+{
+    for (unsigned int bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+        clockSync[bnum] = 0;
+        timeShift[bnum] = 0.0;
+        numAxes[bnum] = 0;
+        for (unsigned int axis = 0; axis < BoardIO::MAX_CHANNELS; axis++) {
+            position[bnum][axis] = 0.0;
+            velocity[bnum][axis] = 0.0;
+        }
+    }
+}
+
+void SampleAligner::SetClockSync(unsigned int boardNum, const ClockSync *sync)
+{
+    if (boardNum < BoardIO::MAX_BOARDS)
+        clockSync[boardNum] = sync;
+}
+
+SampleAligner::SourceType SampleAligner::GetSampleTimes(const BoardIO *boards[], int64_t sampleTime[],
+                                                        int64_t uncertainty[]) const
+{
+    unsigned int bnum;
+
+    // ClockSync, if available for all boards (requires the firmware tick count of AmpIO)
+    const AmpIO *ampBoards[BoardIO::MAX_BOARDS];
+    bool allSync = true;
+    for (bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+        if (!(boardMask & (1 << bnum)))
+            continue;
+        ampBoards[bnum] = dynamic_cast<const AmpIO *>(boards[bnum]);
+        if (!(ampBoards[bnum] && clockSync[bnum] && clockSync[bnum]->IsValid())) {
+            allSync = false;
+            break;
+        }
+    }
+    if (allSync) {
+        for (bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+            if (boardMask & (1 << bnum))
+                clockSync[bnum]->GetHostTime(*ampBoards[bnum], sampleTime[bnum], uncertainty[bnum]);
+        }
+        return SOURCE_CLOCK_SYNC;
+    }
+
+    // Broadcast update time (Rev 7+), relative to broadcast query
+    bool allRev7 = (port->GetProtocol() == BasePort::PROTOCOL_BC_QRW);
+    for (bnum = 0; allRev7 && (bnum < BoardIO::MAX_BOARDS); bnum++) {
+        if ((boardMask & (1 << bnum)) && (port->GetFirmwareVersion(bnum) < 7))
+            allRev7 = false;
+    }
+    if (allRev7) {
+        BasePort::BroadcastReadInfo bcInfo = port->GetBroadcastReadInfo();
+        for (bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+            if (boardMask & (1 << bnum)) {
+                sampleTime[bnum] = static_cast<int64_t>(bcInfo.boardInfo[bnum].updateTime*1e9+0.5);
+                // Resolution of updateTime is one FPGA clock
+                uncertainty[bnum] = static_cast<int64_t>(boards[bnum]->GetFPGAClockPeriod()*1e9+0.5);
+            }
+        }
+        return SOURCE_BROADCAST;
+    }
+
+    // Host time interval of read
+    for (bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+        if (boardMask & (1 << bnum)) {
+            int64_t before = boards[bnum]->GetReadHostTimeBefore();
+            int64_t after = boards[bnum]->GetReadHostTimeAfter();
+            uncertainty[bnum] = (after-before)/2;
+            sampleTime[bnum] = before+uncertainty[bnum];
+        }
+    }
+    return SOURCE_HOST;
+}
+
+bool SampleAligner::Update(void)
+{
+    const BoardIO *boards[BoardIO::MAX_BOARDS];
+    unsigned int bnum, axis;
+
+    // With PROTOCOL_BC_QRW, only the boards in the broadcast query have new data
+    unsigned int queryMask = 0xffff;
+    if (port->GetProtocol() == BasePort::PROTOCOL_BC_QRW)
+        queryMask = port->GetBroadcastReadInfo().queryMask;
+
+    boardMask = 0;
+    skew = 0.0;
+    residualSkew = 0.0;
+    for (bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+        boards[bnum] = port->GetBoard(bnum);
+        numAxes[bnum] = 0;
+        if (boards[bnum] && boards[bnum]->ValidRead() && !boards[bnum]->IsReadStale() &&
+            (queryMask & (1 << bnum))) {
+            boardMask |= (1 << bnum);
+            numAxes[bnum] = boards[bnum]->GetNumChannels();
+        }
+    }
+    if (boardMask == 0) {
+        source = SOURCE_NONE;
+        return false;
+    }
+
+    int64_t sampleTime[BoardIO::MAX_BOARDS];
+    int64_t uncertainty[BoardIO::MAX_BOARDS];
+    source = GetSampleTimes(boards, sampleTime, uncertainty);
+
+    // Determine common instant. Sample times are relative to the first board to avoid
+    // overflow when computing the mean.
+    int64_t first = 0, minTime = 0, maxTime = 0, sumTime = 0;
+    int64_t unc1 = 0, unc2 = 0;   // two largest uncertainties
+    unsigned int num = 0;
+    for (bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+        if (!(boardMask & (1 << bnum)))
+            continue;
+        if (num == 0)
+            first = sampleTime[bnum];
+        int64_t t = sampleTime[bnum]-first;
+        if ((num == 0) || (t < minTime)) minTime = t;
+        if ((num == 0) || (t > maxTime)) maxTime = t;
+        sumTime += t;
+        if (uncertainty[bnum] > unc1) {
+            unc2 = unc1;
+            unc1 = uncertainty[bnum];
+        }
+        else if (uncertainty[bnum] > unc2) {
+            unc2 = uncertainty[bnum];
+        }
+        num++;
+    }
+    int64_t target;
+    if (targetType == ALIGN_EARLIEST)
+        target = minTime;
+    else if (targetType == ALIGN_MEAN)
+        target = sumTime/static_cast<int64_t>(num);
+    else
+        target = maxTime;
+    skew = (maxTime-minTime)*1e-9;
+    residualSkew = ((num > 1) ? (unc1+unc2) : 0)*1e-9;
+
+    // Extrapolate encoder data to common instant
+    for (bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+        if (!(boardMask & (1 << bnum)))
+            continue;
+        double dt = (target-(sampleTime[bnum]-first))*1e-9;
+        timeShift[bnum] = dt;
+        for (axis = 0; axis < numAxes[bnum]; axis++) {
+            double pos = static_cast<double>(boards[bnum]->GetEncoderPosition(axis));
+            double vel = boards[bnum]->GetEncoderVelocityPredicted(axis);
+            double acc = useAccel ? boards[bnum]->GetEncoderAcceleration(axis) : 0.0;
+            position[bnum][axis] = pos + vel*dt + 0.5*acc*dt*dt;
+            velocity[bnum][axis] = vel + acc*dt;
+        }
+    }
+    return true;
+}
+
+double SampleAligner::GetPosition(unsigned int boardNum, unsigned int axis) const
+{
+    return ((boardNum < BoardIO::MAX_BOARDS) && (axis < numAxes[boardNum])) ? position[boardNum][axis] : 0.0;
+}
+
+double SampleAligner::GetVelocity(unsigned int boardNum, unsigned int axis) const
+{
+    return ((boardNum < BoardIO::MAX_BOARDS) && (axis < numAxes[boardNum])) ? velocity[boardNum][axis] : 0.0;
+}
+
+double SampleAligner::GetTimeShift(unsigned int boardNum) const
+{
+    return (boardNum < BoardIO::MAX_BOARDS) ? timeShift[boardNum] : 0.0;
+}
+
+void SampleAligner::Print(std::ostream &out) const
+{
+    static const char *sourceNames[] = { "none", "clock sync", "broadcast", "host" };
+    out << "Sample alignment (" << sourceNames[source] << "): skew " << std::fixed << std::setprecision(2)
+        << skew*1e6 << " usec, residual " << residualSkew*1e6 << " usec" << std::endl;
+    for (unsigned int bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+        if (boardMask & (1 << bnum))
+            out << "  Board " << std::setw(2) << bnum << " shift: " << timeShift[bnum]*1e6 << " usec" << std::endl;
+    }
+    out << std::resetiosflags(std::ios::fixed) << std::setprecision(6);
+}
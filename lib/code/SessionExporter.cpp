@@ -0,0 +1,98 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <sstream>
+
+#include "SessionExporter.h"
+#include "AmpIO.h"
+
+SessionExporter::SessionExporter(std::ostream &debugStream) : outStr(debugStream), writer(debugStream)
+{
+}
+
+SessionExporter::~SessionExporter()
+{
+    Close();
+}
+
+bool SessionExporter::AddBoard(const AmpIO *board)
+{
+    if (!board || writer.IsOpen())
+        return false;
+    boards.push_back(board);
+    return true;
+}
+
+void SessionExporter::AddColumn(unsigned int boardNum, const char *signal, int chan)
+{
+    std::ostringstream name;
+    name << "b" << boardNum << "." << signal;
+    if (chan >= 0)
+        name << "[" << chan << "]";
+    columnNames.push_back(name.str());
+}
+
+bool SessionExporter::Open(const std::string &fileName, unsigned int chunkRows)
+{
+    columnNames.clear();
+    columnNames.push_back("time");
+    for (size_t i = 0; i < boards.size(); i++) {
+        unsigned int bnum = boards[i]->GetBoardId();
+        AddColumn(bnum, "valid");
+        AddColumn(bnum, "timestamp");
+        AddColumn(bnum, "status");
+        AddColumn(bnum, "digio");
+        const char *chanSignals[] = { "enc_pos", "enc_vel", "enc_acc", "motor_curr", "analog" };
+        for (size_t s = 0; s < sizeof(chanSignals)/sizeof(chanSignals[0]); s++) {
+            for (unsigned int chan = 0; chan < boards[i]->GetNumChannels(); chan++)
+                AddColumn(bnum, chanSignals[s], chan);
+        }
+    }
+    row.assign(columnNames.size(), 0.0);
+    return writer.Open(fileName, columnNames, chunkRows);
+}
+
+bool SessionExporter::Update(double time)
+{
+    if (!writer.IsOpen())
+        return false;
+    size_t col = 0;
+    row[col++] = time;
+    for (size_t i = 0; i < boards.size(); i++) {
+        const AmpIO *board = boards[i];
+        unsigned int numChan = board->GetNumChannels();
+        unsigned int chan;
+        row[col++] = board->ValidRead() ? 1.0 : 0.0;
+        row[col++] = board->GetTimestamp();
+        row[col++] = board->GetStatus();
+        row[col++] = board->GetDigitalInput();
+        for (chan = 0; chan < numChan; chan++)
+            row[col++] = board->GetEncoderPosition(chan);
+        for (chan = 0; chan < numChan; chan++)
+            row[col++] = board->GetEncoderVelocityPredicted(chan);
+        for (chan = 0; chan < numChan; chan++)
+            row[col++] = board->GetEncoderAcceleration(chan);
+        for (chan = 0; chan < numChan; chan++)
+            row[col++] = board->GetMotorCurrent(chan);
+        for (chan = 0; chan < numChan; chan++)
+            row[col++] = board->GetAnalogInput(chan);
+    }
+    return writer.AddRow(&row[0]);
+}
+
+bool SessionExporter::Close(void)
+{
+    return writer.IsOpen() ? writer.Close() : false;
+}
@@ -0,0 +1,355 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <string.h>   // for memcmp
+#include <algorithm>  // for std::lower_bound, std::upper_bound
+
+#include "SessionFile.h"
+
+static const char SessionMagic[8] = { 'A', 'M', 'P', 'S', 'E', 'S', '0', '1' };
+
+// Helper functions for binary I/O
+template <class T>
+static void WriteValue(std::ostream &os, const T &value)
+{
+    os.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <class T>
+static bool ReadValue(std::istream &is, T &value)
+{
+    is.read(reinterpret_cast<char *>(&value), sizeof(T));
+    return !is.fail();
+}
+
+// ------------------------------------------------------------------------
+// SessionWriter
+// ------------------------------------------------------------------------
+
+SessionWriter::SessionWriter(std::ostream &debugStream) : outStr(debugStream), chunkRows(0), curRows(0), numRows(0),
+                                                           lastTime(0.0)
+{
+}
+
+SessionWriter::~SessionWriter()
+{
+    Close();
+}
+
+bool SessionWriter::Open(const std::string &fileName, const std::vector<std::string> &columns,
+                         unsigned int nRows)
+{
+    Close();
+    if (columns.empty() || (nRows == 0)) {
+        outStr << "SessionWriter::Open: invalid parameters" << std::endl;
+        return false;
+    }
+    outFile.open(fileName.c_str(), std::ios::binary|std::ios::trunc);
+    if (!outFile.good()) {
+        outStr << "SessionWriter::Open: could not create " << fileName << std::endl;
+        return false;
+    }
+    columnNames = columns;
+    chunkRows = nRows;
+    chunkData.assign(columnNames.size()*chunkRows, 0.0);
+    curRows = 0;
+    numRows = 0;
+    lastTime = 0.0;
+    chunks.clear();
+    outFile.write(SessionMagic, sizeof(SessionMagic));
+    WriteValue(outFile, static_cast<uint32_t>(columnNames.size()));
+    WriteValue(outFile, static_cast<uint32_t>(chunkRows));
+    return outFile.good();
+}
+
+bool SessionWriter::AddRow(const double *values)
+{
+    if (!outFile.is_open())
+        return false;
+    // Time must be non-decreasing, for the time-indexed chunk lookup (also rejects NaN)
+    if (!((numRows == 0) || (values[0] >= lastTime))) {
+        outStr << "SessionWriter::AddRow: time " << values[0] << " is before previous time "
+               << lastTime << std::endl;
+        return false;
+    }
+    lastTime = values[0];
+    for (size_t col = 0; col < columnNames.size(); col++)
+        chunkData[col*chunkRows+curRows] = values[col];
+    curRows++;
+    numRows++;
+    if (curRows == chunkRows)
+        return WriteChunk();
+    return true;
+}
+
+bool SessionWriter::WriteChunk(void)
+{
+    if (curRows == 0)
+        return true;
+    SessionChunkInfo chunk;
+    chunk.offset = static_cast<uint64_t>(outFile.tellp());
+    chunk.numRows = curRows;
+    chunk.tStart = chunkData[0];
+    chunk.tEnd = chunkData[curRows-1];
+    chunk.minValue.resize(columnNames.size());
+    chunk.maxValue.resize(columnNames.size());
+    for (size_t col = 0; col < columnNames.size(); col++) {
+        const double *colData = &chunkData[col*chunkRows];
+        double minValue = colData[0];
+        double maxValue = colData[0];
+        for (unsigned int row = 1; row < curRows; row++) {
+            if (colData[row] < minValue) minValue = colData[row];
+            if (colData[row] > maxValue) maxValue = colData[row];
+        }
+        chunk.minValue[col] = minValue;
+        chunk.maxValue[col] = maxValue;
+        outFile.write(reinterpret_cast<const char *>(colData), curRows*sizeof(double));
+    }
+    chunks.push_back(chunk);
+    curRows = 0;
+    return outFile.good();
+}
+
+bool SessionWriter::Close(void)
+{
+    if (!outFile.is_open())
+        return false;
+    bool ret = WriteChunk();
+    uint64_t indexOffset = static_cast<uint64_t>(outFile.tellp());
+    size_t col;
+    for (col = 0; col < columnNames.size(); col++) {
+        WriteValue(outFile, static_cast<uint32_t>(columnNames[col].size()));
+        outFile.write(columnNames[col].c_str(), columnNames[col].size());
+    }
+    WriteValue(outFile, static_cast<uint32_t>(chunks.size()));
+    for (size_t i = 0; i < chunks.size(); i++) {
+        WriteValue(outFile, chunks[i].offset);
+        WriteValue(outFile, chunks[i].numRows);
+        WriteValue(outFile, chunks[i].tStart);
+        WriteValue(outFile, chunks[i].tEnd);
+        for (col = 0; col < columnNames.size(); col++) {
+            WriteValue(outFile, chunks[i].minValue[col]);
+            WriteValue(outFile, chunks[i].maxValue[col]);
+        }
+    }
+    WriteValue(outFile, indexOffset);
+    outFile.write(SessionMagic, sizeof(SessionMagic));
+    ret &= outFile.good();
+    outFile.close();
+    chunks.clear();
+    chunkData.clear();
+    return ret;
+}
+
+// ------------------------------------------------------------------------
+// SessionReader
+// ------------------------------------------------------------------------
+
+SessionReader::SessionReader(std::ostream &debugStream) : outStr(debugStream)
+{
+}
+
+SessionReader::~SessionReader()
+{
+    Close();
+}
+
+bool SessionReader::Open(const std::string &fileName)
+{
+    Close();
+    inFile.open(fileName.c_str(), std::ios::binary);
+    if (!inFile.good()) {
+        outStr << "SessionReader::Open: could not open " << fileName << std::endl;
+        return false;
+    }
+    char magic[sizeof(SessionMagic)];
+    uint32_t numColumns, chunkRows;
+    inFile.read(magic, sizeof(magic));
+    if (!inFile.good() || (memcmp(magic, SessionMagic, sizeof(magic)) != 0) ||
+        !ReadValue(inFile, numColumns) || !ReadValue(inFile, chunkRows)) {
+        outStr << "SessionReader::Open: " << fileName << " is not a session file" << std::endl;
+        Close();
+        return false;
+    }
+    // Read trailer
+    uint64_t indexOffset;
+    inFile.seekg(0, std::ios::end);
+    uint64_t fileSize = static_cast<uint64_t>(inFile.tellg());
+    inFile.seekg(-static_cast<std::streamoff>(sizeof(indexOffset)+sizeof(magic)), std::ios::end);
+    if (!ReadValue(inFile, indexOffset) || !inFile.read(magic, sizeof(magic)) ||
+        (memcmp(magic, SessionMagic, sizeof(magic)) != 0) || (indexOffset > fileSize)) {
+        outStr << "SessionReader::Open: " << fileName << " is incomplete (no index)" << std::endl;
+        Close();
+        return false;
+    }
+    // Read index
+    inFile.seekg(static_cast<std::streamoff>(indexOffset), std::ios::beg);
+    unsigned int col;
+    for (col = 0; col < numColumns; col++) {
+        uint32_t len;
+        if (!ReadValue(inFile, len) || (len > 1024))
+            break;
+        std::string name(len, ' ');
+        if ((len > 0) && !inFile.read(&name[0], len))
+            break;
+        columnNames.push_back(name);
+    }
+    uint32_t numChunks = 0;
+    if ((numColumns == 0) || (columnNames.size() != numColumns) || !ReadValue(inFile, numChunks)) {
+        outStr << "SessionReader::Open: invalid index in " << fileName << std::endl;
+        Close();
+        return false;
+    }
+    // Check number of chunks against the size of the index, before allocating
+    uint64_t chunkInfoSize = sizeof(uint64_t)+sizeof(uint32_t)+2*sizeof(double)+2*numColumns*sizeof(double);
+    uint64_t indexPos = static_cast<uint64_t>(inFile.tellg());
+    if ((indexPos > fileSize) || (numChunks > (fileSize-indexPos)/chunkInfoSize)) {
+        outStr << "SessionReader::Open: truncated index in " << fileName << std::endl;
+        Close();
+        return false;
+    }
+    chunks.resize(numChunks);
+    for (uint32_t i = 0; i < numChunks; i++) {
+        SessionChunkInfo &chunk = chunks[i];
+        ReadValue(inFile, chunk.offset);
+        ReadValue(inFile, chunk.numRows);
+        ReadValue(inFile, chunk.tStart);
+        ReadValue(inFile, chunk.tEnd);
+        chunk.minValue.resize(numColumns);
+        chunk.maxValue.resize(numColumns);
+        for (col = 0; col < numColumns; col++) {
+            ReadValue(inFile, chunk.minValue[col]);
+            ReadValue(inFile, chunk.maxValue[col]);
+        }
+        // Chunk data must be within the file, before the index (numRows is used to allocate
+        // the buffers in ReadColumns)
+        if ((chunk.offset > indexOffset) ||
+            (chunk.numRows > (indexOffset-chunk.offset)/(numColumns*sizeof(double)))) {
+            outStr << "SessionReader::Open: invalid chunk " << i << " in " << fileName << std::endl;
+            Close();
+            return false;
+        }
+    }
+    if (!inFile.good()) {
+        outStr << "SessionReader::Open: truncated index in " << fileName << std::endl;
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void SessionReader::Close(void)
+{
+    if (inFile.is_open())
+        inFile.close();
+    inFile.clear();
+    columnNames.clear();
+    chunks.clear();
+}
+
+int SessionReader::FindColumn(const std::string &name) const
+{
+    for (size_t col = 0; col < columnNames.size(); col++) {
+        if (columnNames[col] == name)
+            return static_cast<int>(col);
+    }
+    return -1;
+}
+
+unsigned long SessionReader::GetNumRows(void) const
+{
+    unsigned long num = 0;
+    for (size_t i = 0; i < chunks.size(); i++)
+        num += chunks[i].numRows;
+    return num;
+}
+
+double SessionReader::GetStartTime(void) const
+{
+    return chunks.empty() ? 0.0 : chunks.front().tStart;
+}
+
+double SessionReader::GetEndTime(void) const
+{
+    return chunks.empty() ? 0.0 : chunks.back().tEnd;
+}
+
+bool SessionReader::ReadChunkColumn(const SessionChunkInfo &chunk, unsigned int col, unsigned int row,
+                                    unsigned int numValues, double *values)
+{
+    std::streamoff offset = static_cast<std::streamoff>(chunk.offset)
+                            +(static_cast<std::streamoff>(col)*chunk.numRows+row)*sizeof(double);
+    inFile.seekg(offset, std::ios::beg);
+    inFile.read(reinterpret_cast<char *>(values), numValues*sizeof(double));
+    return !inFile.fail();
+}
+
+bool SessionReader::ReadColumns(const std::vector<unsigned int> &cols, double t0, double t1,
+                                std::vector<double> &time, std::vector<std::vector<double> > &data)
+{
+    time.clear();
+    data.assign(cols.size(), std::vector<double>());
+    size_t i;
+    for (i = 0; i < cols.size(); i++) {
+        if (cols[i] >= columnNames.size()) {
+            outStr << "SessionReader::ReadColumns: invalid column " << cols[i] << std::endl;
+            return false;
+        }
+    }
+    std::vector<double> chunkTime;
+    for (size_t c = 0; c < chunks.size(); c++) {
+        const SessionChunkInfo &chunk = chunks[c];
+        if ((chunk.tEnd < t0) || (chunk.tStart > t1))
+            continue;
+        // Find rows within time range
+        chunkTime.resize(chunk.numRows);
+        if (!ReadChunkColumn(chunk, 0, 0, chunk.numRows, &chunkTime[0]))
+            return false;
+        unsigned int row0 = static_cast<unsigned int>(std::lower_bound(chunkTime.begin(), chunkTime.end(), t0)
+                                                      -chunkTime.begin());
+        unsigned int row1 = static_cast<unsigned int>(std::upper_bound(chunkTime.begin(), chunkTime.end(), t1)
+                                                      -chunkTime.begin());
+        if (row1 <= row0)
+            continue;
+        unsigned int num = row1-row0;
+        time.insert(time.end(), chunkTime.begin()+row0, chunkTime.begin()+row1);
+        for (i = 0; i < cols.size(); i++) {
+            std::vector<double> &colData = data[i];
+            size_t start = colData.size();
+            colData.resize(start+num);
+            if (!ReadChunkColumn(chunk, cols[i], row0, num, &colData[start]))
+                return false;
+        }
+    }
+    return true;
+}
+
+bool SessionReader::GetColumnRange(unsigned int col, double t0, double t1, double &minValue, double &maxValue) const
+{
+    bool found = false;
+    if (col >= columnNames.size())
+        return false;
+    for (size_t c = 0; c < chunks.size(); c++) {
+        const SessionChunkInfo &chunk = chunks[c];
+        if ((chunk.tEnd < t0) || (chunk.tStart > t1))
+            continue;
+        if (!found || (chunk.minValue[col] < minValue))
+            minValue = chunk.minValue[col];
+        if (!found || (chunk.maxValue[col] > maxValue))
+            maxValue = chunk.maxValue[col];
+        found = true;
+    }
+    return found;
+}
@@ -0,0 +1,601 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifdef _MSC_VER   // Windows
+#define _USE_MATH_DEFINES
+#endif
+
+#include <math.h>
+#include <string.h>   // for memset
+
+#include "SimulatedPort.h"
+#include "Amp1394Time.h"
+#include "Amp1394BSwap.h"
+
+// Following are the same as in AmpIO.cpp (Firmware Rev 7)
+const double FPGA_sysclk_MHz = 49.152;              /* FPGA sysclk in MHz, also used for velocity measurements */
+const double FPGA_ClockRate  = FPGA_sysclk_MHz*1.0e6;
+
+const quadlet_t VALID_BIT         = 0x80000000;     /* Valid bit for motor current command */
+const quadlet_t DAC_MASK          = 0x0000ffff;     /* Mask for 16-bit DAC values */
+const quadlet_t ADC_MIDRANGE      = 0x00008000;     /* Midrange value of DAC/ADC */
+const int32_t   ENC_MIDRANGE      = 0x00800000;     /* Encoder position midrange value */
+const quadlet_t ENC_POS_MASK      = 0x00ffffff;     /* Encoder position mask (24 bits) */
+const quadlet_t ENC_OVER_MASK     = 0x01000000;     /* Encoder bit overflow mask */
+const quadlet_t ENC_PERIOD_MASK   = 0x03ffffff;     /* Mask for velocity, quarter-cycle and running counter periods */
+const quadlet_t ENC_VEL_OVER_MASK = 0x80000000;     /* Period overflow */
+const quadlet_t ENC_DIR_MASK      = 0x40000000;     /* Direction (set for positive direction) */
+const quadlet_t ENC_DIR_CHANGE    = 0x20000000;     /* Direction change during velocity period */
+const quadlet_t ENC_PARTIAL_CYCLE = 0x08000000;     /* Not enough edges for velocity period */
+
+// Hardware device address offsets for quadlet transactions (see AmpIO.h)
+enum { ADC_DATA_OFFSET = 0, DAC_CTRL_OFFSET = 1, ENC_LOAD_OFFSET = 4, POS_DATA_OFFSET = 5 };
+
+SimAxisModel::SimAxisModel() :
+    inertia(1.4e-5),
+    damping(1.0e-4),
+    friction(2.0e-3),
+    stiffness(0.0),
+    torqueConstant(0.0438),
+    currentTimeConstant(1.0e-4),
+    countsPerRev(2000.0),
+    ampsPerBit(6.25/32768.0),
+    potBitsPerRev(0.0)
+{
+}
+
+SimAxisState::SimAxisState() :
+    time(0.0), position(0.0), velocity(0.0), acceleration(0.0), current(0.0), commandedCurrent(0.0),
+    encoderPosition(0.0), encoderVelocity(0.0), encoderAcceleration(0.0)
+{
+}
+
+SimulatedPort::SimulatedPort(unsigned int boardMask, std::ostream &debugStream):
+    BasePort(0, debugStream),
+    numSimNodes(0),
+    timeStep(0.0),
+    maxIntegrationStep(1.0e-5),
+    simTime(0.0),
+    startTime(Amp1394_GetMonotonicTime()),
+    isInitialized(false)
+{
+    memset(simNodeBoard, BoardIO::MAX_BOARDS, sizeof(simNodeBoard));
+    for (unsigned int bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+        SimBoard &board = simBoards[bnum];
+        board.present = (boardMask & (1 << bnum));
+        board.node = MAX_NODES;
+        board.powerEnable = false;
+        board.relay = false;
+        board.ampEnableMask = 0;
+        board.lastSampleTicks = 0;
+        board.lastSampleTime = -1.0;
+        memset(board.readBuffer, 0, sizeof(board.readBuffer));
+        board.bcSequence = 0;
+        for (unsigned int chan = 0; chan < NUM_CHANNELS; chan++)
+            SetAxisModel(bnum, chan, SimAxisModel());
+    }
+    if (Init())
+        outStr << "SimulatedPort: simulating " << numSimNodes << " boards" << std::endl;
+    else
+        outStr << "SimulatedPort: initialization failed" << std::endl;
+}
+
+SimulatedPort::~SimulatedPort()
+{
+}
+
+bool SimulatedPort::Init(void)
+{
+    isInitialized = ScanNodes();
+    if (isInitialized)
+        SetDefaultProtocol();
+    return isInitialized;
+}
+
+nodeid_t SimulatedPort::InitNodes(void)
+{
+    // Nodes are assigned in order of board number; the first board is the hub
+    numSimNodes = 0;
+    for (unsigned int bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+        if (simBoards[bnum].present) {
+            if (numSimNodes == 0)
+                HubBoard = static_cast<unsigned char>(bnum);
+            simBoards[bnum].node = numSimNodes;
+            simNodeBoard[numSimNodes++] = static_cast<unsigned char>(bnum);
+        }
+    }
+    return numSimNodes;
+}
+
+bool SimulatedPort::SetAxisModel(unsigned char boardId, unsigned int chan, const SimAxisModel &model)
+{
+    if ((boardId >= BoardIO::MAX_BOARDS) || (chan >= NUM_CHANNELS))
+        return false;
+    if ((model.inertia <= 0.0) || (model.countsPerRev <= 0.0) || (model.ampsPerBit <= 0.0)) {
+        outStr << "SimulatedPort::SetAxisModel: invalid model parameters" << std::endl;
+        return false;
+    }
+    SimAxis &axis = simBoards[boardId].axis[chan];
+    axis.model = model;
+    axis.state = SimAxisState();
+    axis.state.time = simTime;
+    axis.countsPerRad = model.countsPerRev/(2.0*M_PI);
+    axis.encoderOffset = 0;
+    axis.encoderPreload = static_cast<quadlet_t>(ENC_MIDRANGE);
+    axis.dac = static_cast<uint16_t>(ADC_MIDRANGE);
+    memset(axis.edgeTicks, 0, sizeof(axis.edgeTicks));
+    memset(axis.edgeDir, 0, sizeof(axis.edgeDir));
+    memset(axis.edgeType, 0, sizeof(axis.edgeType));
+    axis.numEdges = 0;
+    axis.sameDirEdges = 0;
+    axis.sampledState = axis.state;
+    return true;
+}
+
+bool SimulatedPort::GetAxisModel(unsigned char boardId, unsigned int chan, SimAxisModel &model) const
+{
+    if ((boardId >= BoardIO::MAX_BOARDS) || (chan >= NUM_CHANNELS))
+        return false;
+    model = simBoards[boardId].axis[chan].model;
+    return true;
+}
+
+bool SimulatedPort::SetAxisPosition(unsigned char boardId, unsigned int chan, double position)
+{
+    if ((boardId >= BoardIO::MAX_BOARDS) || (chan >= NUM_CHANNELS))
+        return false;
+    SimAxis &axis = simBoards[boardId].axis[chan];
+    axis.state.position = position;
+    axis.state.velocity = 0.0;
+    axis.state.acceleration = 0.0;
+    // Edge history is no longer valid
+    axis.numEdges = 0;
+    axis.sameDirEdges = 0;
+    return true;
+}
+
+bool SimulatedPort::GetAxisState(unsigned char boardId, unsigned int chan, SimAxisState &state) const
+{
+    if ((boardId >= BoardIO::MAX_BOARDS) || (chan >= NUM_CHANNELS))
+        return false;
+    const SimAxis &axis = simBoards[boardId].axis[chan];
+    state = axis.state;
+    state.encoderPosition = axis.state.position*axis.countsPerRad + axis.encoderOffset;
+    state.encoderVelocity = axis.state.velocity*axis.countsPerRad;
+    state.encoderAcceleration = axis.state.acceleration*axis.countsPerRad;
+    return true;
+}
+
+bool SimulatedPort::GetSampledAxisState(unsigned char boardId, unsigned int chan, SimAxisState &state) const
+{
+    if ((boardId >= BoardIO::MAX_BOARDS) || (chan >= NUM_CHANNELS))
+        return false;
+    state = simBoards[boardId].axis[chan].sampledState;
+    return true;
+}
+
+void SimulatedPort::AdvanceTo(double t)
+{
+    while (t-simTime > 1.0e-12) {
+        double h = t-simTime;
+        if (h > maxIntegrationStep)
+            h = maxIntegrationStep;
+        for (unsigned int bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+            if (simBoards[bnum].present) {
+                for (unsigned int chan = 0; chan < NUM_CHANNELS; chan++)
+                    StepAxis(simBoards[bnum], chan, h);
+            }
+        }
+        simTime += h;
+    }
+}
+
+void SimulatedPort::StepAxis(SimBoard &board, unsigned int chan, double h)
+{
+    SimAxis &axis = board.axis[chan];
+    const SimAxisModel &model = axis.model;
+    SimAxisState &state = axis.state;
+
+    bool ampOn = board.powerEnable && (board.ampEnableMask & (1 << chan));
+    state.commandedCurrent = ampOn ? (static_cast<int>(axis.dac)-static_cast<int>(ADC_MIDRANGE))*model.ampsPerBit : 0.0;
+    if (model.currentTimeConstant > 0.0)
+        state.current += (state.commandedCurrent-state.current)*(1.0-exp(-h/model.currentTimeConstant));
+    else
+        state.current = state.commandedCurrent;
+
+    double torque = model.torqueConstant*state.current - model.damping*state.velocity - model.stiffness*state.position;
+    double acc = 0.0;
+    if ((state.velocity != 0.0) || (fabs(torque) > model.friction)) {
+        // Coulomb friction opposes the motion (or the applied torque, when starting to move)
+        double dir = (state.velocity != 0.0) ? state.velocity : torque;
+        acc = (torque - ((dir > 0.0) ? model.friction : -model.friction))/model.inertia;
+    }
+    double v0 = state.velocity;
+    double v1 = v0 + acc*h;
+    // Friction can stop the motor, but not reverse its direction
+    if ((model.friction > 0.0) && (v0 != 0.0) && ((v1 > 0.0) != (v0 > 0.0)))
+        v1 = 0.0;
+    double p0 = state.position*axis.countsPerRad;
+    state.position += v1*h;
+    state.velocity = v1;
+    state.acceleration = (v1-v0)/h;
+    AddEdges(axis, state.time, h, p0, state.position*axis.countsPerRad);
+    state.time += h;
+}
+
+void SimulatedPort::AddEdges(SimAxis &axis, double t0, double h, double p0, double p1)
+{
+    double c0 = floor(p0);
+    double c1 = floor(p1);
+    if (c0 == c1)
+        return;
+    bool up = (c1 > c0);
+    unsigned long n = static_cast<unsigned long>(fabs(c1-c0));
+    // Only the last EDGE_HISTORY edges are needed; the others are just counted
+    unsigned long first = (n > EDGE_HISTORY) ? n-EDGE_HISTORY : 0;
+    if (first > 0) {
+        if ((axis.numEdges > 0) && (axis.edgeDir[(axis.numEdges-1)%EDGE_HISTORY] != up))
+            axis.sameDirEdges = 0;
+        axis.sameDirEdges += first;
+        axis.numEdges += first;
+    }
+    for (unsigned long k = first; k < n; k++) {
+        // Encoder count crosses boundary (i.e., changes from boundary-1 to boundary, or vice-versa)
+        double boundary = up ? c0+1.0+k : c0-k;
+        double t = t0 + h*(boundary-p0)/(p1-p0);
+        if ((axis.numEdges > 0) && (axis.edgeDir[(axis.numEdges-1)%EDGE_HISTORY] != up))
+            axis.sameDirEdges = 0;
+        unsigned int idx = axis.numEdges%EDGE_HISTORY;
+        axis.edgeTicks[idx] = static_cast<int64_t>(floor(t*FPGA_ClockRate));
+        axis.edgeDir[idx] = up;
+        // Quadrature edge type (A rising, B rising, A falling, B falling)
+        axis.edgeType[idx] = static_cast<unsigned char>(static_cast<int64_t>(boundary)&0x03);
+        axis.numEdges++;
+        axis.sameDirEdges++;
+    }
+}
+
+void SimulatedPort::UpdateTime(bool newCycle)
+{
+    if (timeStep > 0.0) {
+        if (newCycle)
+            AdvanceTo(simTime+timeStep);
+    }
+    else {
+        AdvanceTo((Amp1394_GetMonotonicTime()-startTime)*1.0e-9);
+    }
+}
+
+int32_t SimulatedPort::GetEncoderCount(const SimAxis &axis) const
+{
+    return static_cast<int32_t>(floor(axis.state.position*axis.countsPerRad)) + axis.encoderOffset;
+}
+
+quadlet_t SimulatedPort::GetStatusQuadlet(unsigned int boardNum) const
+{
+    const SimBoard &board = simBoards[boardNum];
+    quadlet_t status = (static_cast<quadlet_t>(NUM_CHANNELS) << 28) | ((boardNum & 0x0f) << 24);
+    if (board.powerEnable)
+        status |= 0x000c0000;   // power enable (bit 18) and MV_GOOD (bit 19)
+    if (board.relay)
+        status |= 0x00030000;   // safety relay (bit 16) and relay status (bit 17)
+    status |= board.ampEnableMask;
+    if (board.powerEnable)
+        status |= static_cast<quadlet_t>(board.ampEnableMask) << 8;   // amplifier status
+    return status;
+}
+
+quadlet_t SimulatedPort::GetDigitalQuadlet(const SimBoard &board) const
+{
+    // Encoder A/B channels, based on quadrature state (count modulo 4)
+    static const quadlet_t chanA[4] = { 0, 1, 1, 0 };
+    static const quadlet_t chanB[4] = { 0, 0, 1, 1 };
+    quadlet_t digio = 0;
+    for (unsigned int chan = 0; chan < NUM_CHANNELS; chan++) {
+        const SimAxis &axis = board.axis[chan];
+        unsigned int quad = static_cast<unsigned int>(static_cast<int64_t>(floor(axis.state.position*axis.countsPerRad))&0x03);
+        digio |= (chanA[quad] << (24+chan)) | (chanB[quad] << (20+chan));
+    }
+    return digio;
+}
+
+quadlet_t SimulatedPort::GetAdcQuadlet(const SimAxis &axis) const
+{
+    double curr = ADC_MIDRANGE + floor(axis.state.current/axis.model.ampsPerBit+0.5);
+    double pot = ADC_MIDRANGE + floor(axis.state.position/(2.0*M_PI)*axis.model.potBitsPerRev+0.5);
+    if (curr < 0.0) curr = 0.0;
+    if (curr > static_cast<double>(DAC_MASK)) curr = static_cast<double>(DAC_MASK);
+    if (pot < 0.0) pot = 0.0;
+    if (pot > static_cast<double>(DAC_MASK)) pot = static_cast<double>(DAC_MASK);
+    return (static_cast<quadlet_t>(pot) << 16) | static_cast<quadlet_t>(curr);
+}
+
+// Returns period field (in ticks), including overflow bit
+static quadlet_t PeriodField(int64_t ticks)
+{
+    if ((ticks < 0) || (ticks > static_cast<int64_t>(ENC_PERIOD_MASK)))
+        return ENC_VEL_OVER_MASK | ENC_PERIOD_MASK;
+    return static_cast<quadlet_t>(ticks);
+}
+
+void SimulatedPort::SampleBoard(unsigned int boardNum)
+{
+    SimBoard &board = simBoards[boardNum];
+    quadlet_t *buf = board.readBuffer;
+    int64_t ticks = static_cast<int64_t>(floor(simTime*FPGA_ClockRate));
+
+    // Block read clears the timestamp counter, so timestamp is one less than elapsed ticks
+    int64_t elapsed = ticks-board.lastSampleTicks-1;
+    buf[Layout::TIMESTAMP_OFFSET] = (elapsed > 0) ? static_cast<quadlet_t>(elapsed) : 0;
+    buf[Layout::STATUS_OFFSET] = GetStatusQuadlet(boardNum);
+    buf[Layout::DIGIO_OFFSET] = GetDigitalQuadlet(board);
+    buf[Layout::TEMP_OFFSET] = 0x00001e1e;   // 30 degrees C
+    for (unsigned int chan = 0; chan < NUM_CHANNELS; chan++) {
+        SimAxis &axis = board.axis[chan];
+        buf[Layout::MOTOR_CURR_OFFSET+chan] = GetAdcQuadlet(axis);
+
+        int64_t encRaw = static_cast<int64_t>(GetEncoderCount(axis)) + ENC_MIDRANGE;
+        quadlet_t encPos = static_cast<quadlet_t>(encRaw) & ENC_POS_MASK;
+        if ((encRaw < 0) || (encRaw > static_cast<int64_t>(ENC_POS_MASK)))
+            encPos |= ENC_OVER_MASK;
+        buf[Layout::ENC_POS_OFFSET+chan] = encPos;
+
+        // Indices of most recent edge (n), and of edges n-1, n-4 and n-5
+        unsigned long n = axis.numEdges;
+        unsigned int e0 = (n+EDGE_HISTORY-1)%EDGE_HISTORY;
+        unsigned int e1 = (n+EDGE_HISTORY-2)%EDGE_HISTORY;
+        unsigned int e4 = (n+EDGE_HISTORY-5)%EDGE_HISTORY;
+        unsigned int e5 = (n+EDGE_HISTORY-6)%EDGE_HISTORY;
+
+        // Velocity: period of full cycle (4 quarter-cycles), i.e., between edges of the same type
+        quadlet_t vel = ENC_VEL_OVER_MASK | ENC_PERIOD_MASK | ENC_PARTIAL_CYCLE;
+        if (n >= 5) {
+            vel = PeriodField(axis.edgeTicks[e0]-axis.edgeTicks[e4]);
+            if (axis.sameDirEdges < 5)
+                vel |= ENC_DIR_CHANGE;
+        }
+        if ((n > 0) && axis.edgeDir[e0])
+            vel |= ENC_DIR_MASK;
+        buf[Layout::ENC_VEL_OFFSET+chan] = vel;
+
+        // Most recent quarter-cycle (QTR1) and the previous one of the same type (QTR5)
+        quadlet_t qtr1 = ENC_VEL_OVER_MASK | ENC_PERIOD_MASK;
+        if (n >= 2)
+            qtr1 = PeriodField(axis.edgeTicks[e0]-axis.edgeTicks[e1]);
+        if (n >= 1)
+            qtr1 |= (axis.edgeDir[e0] ? ENC_DIR_MASK : 0) | ((1 << axis.edgeType[e0]) << 26);
+        buf[Layout::ENC_QTR1_OFFSET+chan] = qtr1;
+        quadlet_t qtr5 = ENC_VEL_OVER_MASK | ENC_PERIOD_MASK;
+        if (n >= 6)
+            qtr5 = PeriodField(axis.edgeTicks[e4]-axis.edgeTicks[e5]);
+        if (n >= 5)
+            qtr5 |= (axis.edgeDir[e4] ? ENC_DIR_MASK : 0) | ((1 << axis.edgeType[e4]) << 26);
+        buf[Layout::ENC_QTR5_OFFSET+chan] = qtr5;
+
+        // Running counter: time since most recent edge
+        buf[Layout::ENC_RUN_OFFSET+chan] = (n > 0) ? PeriodField(ticks-axis.edgeTicks[e0])
+                                                   : (ENC_VEL_OVER_MASK | ENC_PERIOD_MASK);
+
+        GetAxisState(static_cast<unsigned char>(boardNum), chan, axis.sampledState);
+    }
+    board.lastSampleTicks = ticks;
+    board.lastSampleTime = simTime;
+}
+
+void SimulatedPort::WriteMotorCurrent(SimBoard &board, unsigned int chan, quadlet_t data)
+{
+    if ((chan < NUM_CHANNELS) && (data & VALID_BIT))
+        board.axis[chan].dac = static_cast<uint16_t>(data & DAC_MASK);
+}
+
+void SimulatedPort::WriteControl(SimBoard &board, quadlet_t ctrl)
+{
+    // Same bit assignments as AmpIO::SetPowerEnable, SetSafetyRelay and SetAmpEnableMask
+    if (ctrl & 0x00080000) {
+        board.powerEnable = (ctrl & 0x00040000);
+        if (!board.powerEnable)
+            board.ampEnableMask = 0;
+    }
+    if (ctrl & 0x00020000)
+        board.relay = (ctrl & 0x00010000);
+    // As in the firmware, amplifiers can only be enabled when board power is enabled
+    unsigned char enableMask = static_cast<unsigned char>((ctrl >> 8) & 0x0f);
+    unsigned char stateMask = board.powerEnable ? static_cast<unsigned char>(ctrl & 0x0f) : 0;
+    board.ampEnableMask = (board.ampEnableMask & ~enableMask) | (stateMask & enableMask);
+}
+
+bool SimulatedPort::WriteBoardQuadlet(unsigned int boardNum, nodeaddr_t addr, quadlet_t data)
+{
+    SimBoard &board = simBoards[boardNum];
+    if (addr == 0) {
+        WriteControl(board, data);
+        return true;
+    }
+    unsigned int chan = static_cast<unsigned int>((addr >> 4) & 0x0f);
+    unsigned int dev = static_cast<unsigned int>(addr & 0x0f);
+    if ((addr < 0x100) && (chan >= 1) && (chan <= NUM_CHANNELS)) {
+        SimAxis &axis = board.axis[chan-1];
+        if (dev == DAC_CTRL_OFFSET) {
+            axis.dac = static_cast<uint16_t>(data & DAC_MASK);
+        }
+        else if (dev == ENC_LOAD_OFFSET) {
+            axis.encoderPreload = data;
+            axis.encoderOffset = static_cast<int32_t>(data & ENC_POS_MASK) - ENC_MIDRANGE
+                                 - static_cast<int32_t>(floor(axis.state.position*axis.countsPerRad));
+        }
+    }
+    // Other registers (e.g., watchdog period) are accepted, but ignored
+    return true;
+}
+
+bool SimulatedPort::ReadQuadletNode(nodeid_t node, nodeaddr_t addr, quadlet_t &data, unsigned char)
+{
+    if (node >= numSimNodes)
+        return false;
+    unsigned int boardNum = simNodeBoard[node];
+    const SimBoard &board = simBoards[boardNum];
+    UpdateTime(false);
+    if (addr == 0) {
+        data = GetStatusQuadlet(boardNum);
+        return true;
+    }
+    else if (addr == 4) {
+        data = QLA1_String;
+        return true;
+    }
+    else if (addr == 7) {
+        data = 7;           // Firmware Rev 7
+        return true;
+    }
+    else if (addr == 11) {
+        data = 0;           // safety amp disable
+        return true;
+    }
+    unsigned int chan = static_cast<unsigned int>((addr >> 4) & 0x0f);
+    unsigned int dev = static_cast<unsigned int>(addr & 0x0f);
+    if ((addr < 0x100) && (chan >= 1) && (chan <= NUM_CHANNELS)) {
+        const SimAxis &axis = board.axis[chan-1];
+        switch (dev) {
+        case ADC_DATA_OFFSET:
+            data = GetAdcQuadlet(axis);
+            return true;
+        case DAC_CTRL_OFFSET:
+            data = axis.dac;
+            return true;
+        case ENC_LOAD_OFFSET:
+            data = axis.encoderPreload;
+            return true;
+        case POS_DATA_OFFSET:
+            data = static_cast<quadlet_t>(GetEncoderCount(axis) + ENC_MIDRANGE) & ENC_POS_MASK;
+            return true;
+        default:
+            break;
+        }
+    }
+    return false;
+}
+
+bool SimulatedPort::WriteQuadletNode(nodeid_t node, nodeaddr_t addr, quadlet_t data, unsigned char)
+{
+    UpdateTime(false);
+    if (node == FW_NODE_BROADCAST) {
+        for (nodeid_t i = 0; i < numSimNodes; i++)
+            WriteBoardQuadlet(simNodeBoard[i], addr, data);
+        return true;
+    }
+    if (node >= numSimNodes)
+        return false;
+    return WriteBoardQuadlet(simNodeBoard[node], addr, data);
+}
+
+bool SimulatedPort::ReadBlockNode(nodeid_t node, nodeaddr_t addr, quadlet_t *rdata, unsigned int nbytes, unsigned char)
+{
+    if (node >= numSimNodes)
+        return false;
+    unsigned int numQuads = nbytes/sizeof(quadlet_t);
+    unsigned int i = 0;
+    if (addr == 0) {
+        // Real-time block read (sequential protocol)
+        unsigned int boardNum = simNodeBoard[node];
+        UpdateTime(simBoards[boardNum].lastSampleTime >= simTime);
+        SampleBoard(boardNum);
+        for (i = 0; (i < numQuads) && (i < Layout::READ_SIZE); i++)
+            rdata[i] = bswap_32(simBoards[boardNum].readBuffer[i]);
+    }
+    else if (addr == 0x1000) {
+        // Hub data (broadcast protocol), sampled by WriteBroadcastReadRequest
+        for (unsigned int bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+            // BoardQueryMask_ rather than BoardList, which is not set when this port is
+            // used by another port (e.g., RecordingPort)
+            if (!(BoardQueryMask_ & (1 << bnum)))
+                continue;
+            if (i+1+Layout::READ_SIZE > numQuads)
+                break;
+            const SimBoard &board = simBoards[bnum];
+            if (board.present) {
+                rdata[i++] = bswap_32(board.bcSequence << 16);
+                for (unsigned int j = 0; j < Layout::READ_SIZE; j++)
+                    rdata[i++] = bswap_32(board.readBuffer[j]);
+            }
+            else {
+                for (unsigned int j = 0; j < 1+Layout::READ_SIZE; j++)
+                    rdata[i++] = 0;
+            }
+        }
+    }
+    else {
+        return false;
+    }
+    // Zero the rest (e.g., timing information at end of hub data)
+    for (; i < numQuads; i++)
+        rdata[i] = 0;
+    return true;
+}
+
+bool SimulatedPort::WriteBlockNode(nodeid_t node, nodeaddr_t addr, quadlet_t *wdata, unsigned int nbytes, unsigned char)
+{
+    if ((node >= numSimNodes) || (addr != 0))
+        return false;
+    UpdateTime(false);
+    SimBoard &board = simBoards[simNodeBoard[node]];
+    unsigned int numQuads = nbytes/sizeof(quadlet_t);
+    for (unsigned int chan = 0; (chan < numQuads) && (chan < NUM_CHANNELS); chan++)
+        WriteMotorCurrent(board, chan, bswap_32(wdata[Layout::WB_CURR_OFFSET+chan]));
+    if (numQuads > Layout::WB_CTRL_OFFSET)
+        WriteControl(board, bswap_32(wdata[Layout::WB_CTRL_OFFSET]));
+    return true;
+}
+
+bool SimulatedPort::WriteBroadcastOutput(quadlet_t *buffer, unsigned int size)
+{
+    UpdateTime(false);
+    // Same order as in WriteAllBoardsBroadcast; all boards are Rev 7, so the control
+    // quadlet is included
+    unsigned int numQuads = size/sizeof(quadlet_t);
+    unsigned int offset = 0;
+    for (unsigned int bnum = 0; bnum < max_board; bnum++) {
+        if (!(BoardInUseMask_ & (1 << bnum)))
+            continue;
+        if (offset+Layout::WRITE_SIZE > numQuads)
+            break;
+        if (simBoards[bnum].present) {
+            SimBoard &board = simBoards[bnum];
+            for (unsigned int chan = 0; chan < NUM_CHANNELS; chan++)
+                WriteMotorCurrent(board, chan, bswap_32(buffer[offset+Layout::WB_CURR_OFFSET+chan]));
+            WriteControl(board, bswap_32(buffer[offset+Layout::WB_CTRL_OFFSET]));
+        }
+        offset += Layout::WRITE_SIZE;
+    }
+    return true;
+}
+
+bool SimulatedPort::WriteBroadcastReadRequest(unsigned int seq)
+{
+    bool newCycle = false;
+    unsigned int bnum;
+    for (bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+        if (simBoards[bnum].present && (simBoards[bnum].lastSampleTime >= simTime))
+            newCycle = true;
+    }
+    UpdateTime(newCycle);
+    // The queried boards sample their data when they receive the broadcast read request
+    for (bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+        if (simBoards[bnum].present && (BoardQueryMask_ & (1 << bnum))) {
+            SampleBoard(bnum);
+            simBoards[bnum].bcSequence = seq;
+        }
+    }
+    return true;
+}
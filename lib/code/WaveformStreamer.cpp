@@ -0,0 +1,171 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <iostream>
+
+#include "WaveformStreamer.h"
+#include "BasePort.h"
+
+WaveformStreamer::WaveformStreamer(AmpIO *board) : Board(board), srcSamples(0), srcSize(0), srcIndex(0),
+                                                   srcRepeat(false), active(false), srcDone(false), doutMask(0),
+                                                   readPos(0), writePos(0), endPos(0), fillRemaining(0),
+                                                   tableIndex(0), numUnderruns(0)
+{
+}
+
+WaveformStreamer::~WaveformStreamer()
+{
+}
+
+void WaveformStreamer::SetSource(const quadlet_t *samples, unsigned int numSamples, bool repeat)
+{
+    srcSamples = samples;
+    srcSize = samples ? numSamples : 0;
+    srcIndex = 0;
+    srcRepeat = repeat;
+}
+
+unsigned int WaveformStreamer::GetSamples(quadlet_t *buf, unsigned int nquads)
+{
+    unsigned int i;
+    for (i = 0; i < nquads; i++) {
+        if (srcIndex >= srcSize) {
+            if (!srcRepeat || (srcSize == 0))
+                break;
+            srcIndex = 0;
+        }
+        buf[i] = srcSamples[srcIndex++];
+    }
+    return i;
+}
+
+unsigned int WaveformStreamer::GetMaxChunk(void) const
+{
+    BasePort *port = Board ? Board->GetPort() : 0;
+    unsigned int maxChunk = port ? port->GetMaxWriteDataSize()/sizeof(quadlet_t) : 0;
+    return (maxChunk < HALF_SIZE) ? maxChunk : static_cast<unsigned int>(HALF_SIZE);
+}
+
+bool WaveformStreamer::WriteEntries(unsigned int nquads)
+{
+    unsigned int numValid = 0;
+    if (!srcDone) {
+        numValid = GetSamples(writeBuf, nquads);
+        if (numValid < nquads) {
+            // Source exhausted: terminate waveform with an invalid (zero) entry
+            srcDone = true;
+            endPos = writePos + numValid;
+        }
+    }
+    for (unsigned int i = numValid; i < nquads; i++)
+        writeBuf[i] = 0;
+    unsigned short offset = static_cast<unsigned short>(writePos%TABLE_SIZE);
+    if (!Board->WriteWaveformTable(writeBuf, offset, static_cast<unsigned short>(nquads))) {
+        std::cerr << "WaveformStreamer: failed to write waveform table, offset = " << offset
+                  << ", size = " << nquads << std::endl;
+        return false;
+    }
+    writePos += nquads;
+    return true;
+}
+
+bool WaveformStreamer::Start(AmpIO_UInt8 mask)
+{
+    if (!Board || (Board->GetFirmwareVersion() < 7)) {
+        std::cerr << "WaveformStreamer::Start: requires firmware 7 or above" << std::endl;
+        return false;
+    }
+    unsigned int maxChunk = GetMaxChunk();
+    if (maxChunk == 0)
+        return false;
+
+    active = false;
+    srcDone = false;
+    readPos = 0;
+    writePos = 0;
+    endPos = 0;
+    fillRemaining = 0;
+    tableIndex = 0;
+    numUnderruns = 0;
+    doutMask = mask;
+
+    // Fill entire table before starting
+    while (writePos < TABLE_SIZE) {
+        unsigned int n = TABLE_SIZE-static_cast<unsigned int>(writePos);
+        if (n > maxChunk) n = maxChunk;
+        if (!WriteEntries(n))
+            return false;
+    }
+    if (!Board->WriteWaveformControl(doutMask, doutMask))
+        return false;
+    active = true;
+    return true;
+}
+
+bool WaveformStreamer::Stop(AmpIO_UInt8 bits)
+{
+    active = false;
+    if (!Board) return false;
+    if (!Board->WriteWaveformControl(0, 0))
+        return false;
+    return Board->WriteDigitalOutput(doutMask, bits);
+}
+
+bool WaveformStreamer::Service(void)
+{
+    if (!active)
+        return true;
+
+    bool fpgaActive;
+    AmpIO_UInt32 newIndex;
+    if (!Board->ReadWaveformStatus(fpgaActive, newIndex))
+        return false;
+
+    // Advance the (unwrapped) read position. This assumes that the FPGA has played
+    // fewer than TABLE_SIZE entries since the last call (see WaveformStreamer.h).
+    unsigned int delta = (newIndex+TABLE_SIZE-tableIndex)%TABLE_SIZE;
+    tableIndex = newIndex;
+    readPos += delta;
+
+    if (!fpgaActive || (srcDone && (readPos >= endPos))) {
+        active = false;
+        return true;
+    }
+
+    if (readPos >= writePos) {
+        // The FPGA has wrapped into data that was not refilled; restart refilling
+        // at the next half-table boundary.
+        numUnderruns++;
+        writePos = ((readPos/HALF_SIZE)+1)*HALF_SIZE;
+        fillRemaining = 0;
+    }
+
+    if (srcDone)
+        return true;
+
+    // Start refilling a half once the FPGA has finished playing it
+    if ((fillRemaining == 0) && (writePos+HALF_SIZE-readPos <= TABLE_SIZE))
+        fillRemaining = HALF_SIZE;
+
+    if (fillRemaining > 0) {
+        // Write at most one block per call, to bound the time added to the cycle
+        unsigned int n = GetMaxChunk();
+        if (n > fillRemaining) n = fillRemaining;
+        if (!WriteEntries(n))
+            return false;
+        fillRemaining -= n;
+    }
+    return true;
+}
@@ -0,0 +1,247 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/******************************************************************************
+ *
+ * (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+ *
+ * This program measures the cost of the individual transactions on the current
+ * host and port (see CycleCostModel), compares the predicted cycle time with a
+ * measured run for each protocol, and predicts the cycle time of other
+ * configurations (number of boards, firmware mix, protocol, number of ports).
+ *
+ * Usage: cycleplan [-pP] [-sN] [-nN] [-wE] [-oFile] [-iFile] [-cB[:O[:N]]] ...
+ *        where -p is the port (see PortFactory, default 0),
+ *        -s uses a simulated port with N boards instead,
+ *        -n is the number of samples per measurement (default 200),
+ *        -w warns if the verification error exceeds E percent (default 20),
+ *        -o saves the measured costs to File,
+ *        -i loads the costs from File (no measurement), and
+ *        -c adds a configuration with B boards, O of which have firmware
+ *           prior to Rev 7 (default 0), on N ports (default 1); can be
+ *           repeated (default 1, 2, 4, 8 and 16 Rev 7+ boards on 1 port)
+ *
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+
+#include "PortFactory.h"
+#include "SimulatedPort.h"
+#include "CycleCostModel.h"
+#include "AmpIO.h"
+#include "Amp1394Time.h"
+
+void PrintUsage(void)
+{
+    std::cerr << "Usage: cycleplan [-pP] [-sN] [-nN] [-wE] [-oFile] [-iFile] [-cB[:O[:N]]] ..." << std::endl
+              << "       where -p = port (default 0), can also specify -pfwP, -pethP or -pudp" << std::endl
+              << "             -s = use simulated port with N boards" << std::endl
+              << "             -n = number of samples per measurement (default 200)" << std::endl
+              << "             -w = warn if verification error exceeds E percent (default 20)" << std::endl
+              << "             -o = save measured costs to File" << std::endl
+              << "             -i = load costs from File (no measurement)" << std::endl
+              << "             -c = configuration with B boards, O with firmware prior to Rev 7" << std::endl
+              << "                  (default 0), on N ports (default 1); can be repeated" << std::endl;
+}
+
+const BasePort::ProtocolType Protocols[] = { BasePort::PROTOCOL_SEQ_RW, BasePort::PROTOCOL_SEQ_R_BC_W,
+                                             BasePort::PROTOCOL_BC_QRW };
+const unsigned int NumProtocols = sizeof(Protocols)/sizeof(Protocols[0]);
+
+// Run the read/write cycle with the current protocol and return the median cycle time
+double MeasureCycle(BasePort *port, unsigned int numCycles)
+{
+    std::vector<double> samples(numCycles);
+    for (unsigned int i = 0; i < numCycles; i++) {
+        int64_t t0 = Amp1394_GetMonotonicTime();
+        port->ReadAllBoards();
+        port->WriteAllBoards();
+        samples[i] = (Amp1394_GetMonotonicTime()-t0)*1.0e-9;
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[numCycles/2];
+}
+
+int main(int argc, char** argv)
+{
+    const char *portDescription = "";
+    unsigned int numSim = 0;
+    unsigned int numSamples = 200;
+    double maxError = 20.0;       // verification error (percent) above which a warning is printed
+    const char *saveFile = 0;
+    const char *loadFile = 0;
+    std::vector<CyclePlanConfig> configs;
+
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] != '-') {
+            PrintUsage();
+            return 0;
+        }
+        if (argv[i][1] == 'p')
+            portDescription = argv[i]+2;
+        else if (argv[i][1] == 's')
+            numSim = atoi(argv[i]+2);
+        else if (argv[i][1] == 'n')
+            numSamples = atoi(argv[i]+2);
+        else if (argv[i][1] == 'w')
+            maxError = atof(argv[i]+2);
+        else if (argv[i][1] == 'o')
+            saveFile = argv[i]+2;
+        else if (argv[i][1] == 'i')
+            loadFile = argv[i]+2;
+        else if (argv[i][1] == 'c') {
+            unsigned int boards = 0, oldBoards = 0, ports = 1;
+            if ((sscanf(argv[i]+2, "%u:%u:%u", &boards, &oldBoards, &ports) < 1) || (boards == 0) ||
+                (ports == 0) || (oldBoards > boards)) {
+                std::cerr << "Invalid configuration: " << argv[i]+2 << std::endl;
+                return -1;
+            }
+            configs.push_back(CyclePlanConfig(boards, oldBoards, ports));
+        }
+        else {
+            PrintUsage();
+            return 0;
+        }
+    }
+    if ((numSim > BoardIO::MAX_BOARDS) || (numSamples == 0) || (maxError <= 0.0)) {
+        PrintUsage();
+        return -1;
+    }
+    if (configs.empty()) {
+        for (unsigned int n = 1; n <= BoardIO::MAX_BOARDS; n *= 2)
+            configs.push_back(CyclePlanConfig(n));
+    }
+
+    CycleCostModel model;
+    if (loadFile) {
+        if (!model.Load(loadFile)) {
+            std::cerr << "Failed to load costs from " << loadFile << std::endl;
+            return -1;
+        }
+        model.Print(std::cout);
+    }
+    else {
+        BasePort *port;
+        if (numSim > 0)
+            port = new SimulatedPort((1 << numSim)-1);
+        else
+            port = PortFactory(portDescription);
+        if (!port) {
+            std::cerr << "Failed to create port using: " << portDescription << std::endl;
+            return -1;
+        }
+        if (!port->IsOK()) {
+            std::cerr << "Failed to initialize " << port->GetPortTypeString() << std::endl;
+            delete port;
+            return -1;
+        }
+
+        std::vector<AmpIO *> boards;
+        unsigned int numOld = 0;
+        unsigned int bnum;
+        for (bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+            unsigned long fver = port->GetFirmwareVersion(bnum);
+            if (fver != 0) {
+                AmpIO *board = new AmpIO(bnum);
+                port->AddBoard(board);
+                boards.push_back(board);
+                if (fver < 7)
+                    numOld++;
+            }
+        }
+
+        bool ok = !boards.empty();
+        if (!ok)
+            std::cerr << "No boards found" << std::endl;
+        else {
+            std::cout << "Measuring " << port->GetPortTypeString() << " with " << boards.size()
+                      << " boards (" << numOld << " with firmware prior to Rev 7)" << std::endl;
+            ok = model.Measure(port, numSamples);
+        }
+        if (ok) {
+            model.Print(std::cout);
+            if (saveFile && !model.Save(saveFile))
+                std::cerr << "Failed to save costs to " << saveFile << std::endl;
+
+            // Compare prediction with measured cycle, for the current configuration
+            std::cout << std::endl << "Verification (" << boards.size() << " boards, median of "
+                      << numSamples << " cycles):" << std::endl
+                      << "  protocol        predicted (us)   measured (us)   error (%)" << std::endl;
+            BasePort::ProtocolType oldProtocol = port->GetProtocol();
+            std::vector<std::string> inaccurate;
+            for (unsigned int p = 0; p < NumProtocols; p++) {
+                CyclePrediction pred = model.Predict(CyclePlanConfig(boards.size(), numOld, 1, Protocols[p]));
+                bool supported = pred.valid && port->SetProtocol(Protocols[p]);
+                std::cout << "  " << std::setw(14) << std::left << BasePort::ProtocolString(Protocols[p]) << std::right;
+                if (!supported) {
+                    std::cout << "  not supported" << std::endl;
+                    continue;
+                }
+                double measured = MeasureCycle(port, numSamples);
+                double error = 100.0*(pred.cycleTime-measured)/measured;
+                std::cout << std::fixed << std::setprecision(1)
+                          << std::setw(16) << pred.cycleTime*1.0e6 << std::setw(16) << measured*1.0e6
+                          << std::setw(12) << error << std::endl;
+                std::cout.unsetf(std::ios_base::floatfield);
+                std::cout << std::setprecision(6);
+                if ((error > maxError) || (error < -maxError))
+                    inaccurate.push_back(BasePort::ProtocolString(Protocols[p]));
+            }
+            port->SetProtocol(oldProtocol);
+            if (!inaccurate.empty()) {
+                std::cout << "Warning: verification error exceeds " << maxError << "% for";
+                for (size_t n = 0; n < inaccurate.size(); n++)
+                    std::cout << " " << inaccurate[n];
+                std::cout << "; the predictions below may not be accurate" << std::endl;
+            }
+        }
+
+        for (bnum = 0; bnum < boards.size(); bnum++) {
+            port->RemoveBoard(boards[bnum]);
+            delete boards[bnum];
+        }
+        delete port;
+        if (!ok)
+            return -1;
+    }
+
+    // Predictions
+    std::cout << std::endl << "Predicted cycle time in us (maximum rate in Hz):" << std::endl
+              << "  boards  old  ports";
+    unsigned int p;
+    for (p = 0; p < NumProtocols; p++)
+        std::cout << std::setw(22) << BasePort::ProtocolString(Protocols[p]);
+    std::cout << std::endl;
+    std::vector<std::string> reasons;
+    for (size_t c = 0; c < configs.size(); c++) {
+        std::cout << std::setw(8) << configs[c].numBoards << std::setw(5) << configs[c].numOldBoards
+                  << std::setw(7) << configs[c].numPorts;
+        for (p = 0; p < NumProtocols; p++) {
+            configs[c].protocol = Protocols[p];
+            CyclePrediction pred = model.Predict(configs[c]);
+            std::ostringstream str;
+            if (pred.valid) {
+                str << std::fixed << std::setprecision(1) << pred.cycleTime*1.0e6
+                    << " (" << std::setprecision(0) << 1.0/pred.cycleTime << ")";
+            }
+            else {
+                // Print reason below table
+                size_t r = std::find(reasons.begin(), reasons.end(), pred.reason) - reasons.begin();
+                if (r == reasons.size())
+                    reasons.push_back(pred.reason);
+                str << "n/a [" << r+1 << "]";
+            }
+            std::cout << std::setw(22) << str.str();
+        }
+        std::cout << std::endl;
+    }
+    for (size_t r = 0; r < reasons.size(); r++)
+        std::cout << "  [" << r+1 << "] " << reasons[r] << std::endl;
+    return 0;
+}
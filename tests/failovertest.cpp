@@ -0,0 +1,206 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/******************************************************************************
+ *
+ * (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+ *
+ * This program tests FailoverPort with two emulated links to the same simulated
+ * boards: the primary link is an ImpairedPort (on a SimulatedPort) and the standby
+ * link is another SimulatedPort. The primary link is dropped (all transactions lost)
+ * for a range of cycles and then restored. The program reports when the standby port
+ * took over, how many cycles failed, when the primary port recovered, and the cycle
+ * times, with Service (which rescans the failed port) timed separately from the
+ * real-time cycle. It returns a non-zero value if the failover did not behave as
+ * expected.
+ *
+ * Usage: failovertest [-bN] [-nN] [-dN] [-rN] [-sN] [-a]
+ *        where -b is the number of boards (default 2),
+ *        -n is the number of cycles (default 1000),
+ *        -d is the cycle at which the primary link is dropped (default 200),
+ *        -r is the cycle at which the primary link is restored (default 500),
+ *        -s is the number of cycles between calls to Service (default 10), and
+ *        -a enables auto-failback to the primary port
+ *
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "SimulatedPort.h"
+#include "ImpairedPort.h"
+#include "FailoverPort.h"
+#include "AmpIO.h"
+#include "Amp1394Time.h"
+
+void PrintUsage(void)
+{
+    std::cerr << "Usage: failovertest [-bN] [-nN] [-dN] [-rN] [-sN] [-a]" << std::endl
+              << "       where -b = number of boards (default 2)" << std::endl
+              << "             -n = number of cycles (default 1000)" << std::endl
+              << "             -d = cycle at which primary link is dropped (default 200)" << std::endl
+              << "             -r = cycle at which primary link is restored (default 500)" << std::endl
+              << "             -s = cycles between calls to Service (default 10)" << std::endl
+              << "             -a enables auto-failback" << std::endl;
+}
+
+// Returns "cycle N", or "no" if cycle is negative
+std::string CycleString(int cycle)
+{
+    if (cycle < 0)
+        return "no";
+    std::ostringstream str;
+    str << "cycle " << cycle;
+    return str.str();
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int numBoards = 2;
+    unsigned int numCycles = 1000;
+    unsigned int dropCycle = 200;
+    unsigned int restoreCycle = 500;
+    unsigned int servicePeriod = 10;
+    bool autoFailback = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] != '-') {
+            PrintUsage();
+            return 0;
+        }
+        if (argv[i][1] == 'b')
+            numBoards = atoi(argv[i]+2);
+        else if (argv[i][1] == 'n')
+            numCycles = atoi(argv[i]+2);
+        else if (argv[i][1] == 'd')
+            dropCycle = atoi(argv[i]+2);
+        else if (argv[i][1] == 'r')
+            restoreCycle = atoi(argv[i]+2);
+        else if (argv[i][1] == 's')
+            servicePeriod = atoi(argv[i]+2);
+        else if (argv[i][1] == 'a')
+            autoFailback = true;
+        else {
+            PrintUsage();
+            return 0;
+        }
+    }
+    if ((numBoards < 1) || (numBoards > BoardIO::MAX_BOARDS) || (servicePeriod < 1) ||
+        (dropCycle >= restoreCycle) || (restoreCycle >= numCycles)) {
+        PrintUsage();
+        return -1;
+    }
+
+    std::stringstream debugStream(std::stringstream::out|std::stringstream::in);
+    unsigned int boardMask = (1 << numBoards)-1;
+    SimulatedPort simPrimary(boardMask, debugStream);
+    SimulatedPort simStandby(boardMask, debugStream);
+    ImpairedPort primary(&simPrimary, debugStream);
+    if (!primary.IsOK() || !simStandby.IsOK()) {
+        std::cerr << debugStream.str();
+        return -1;
+    }
+    // Fixed simulation step, so that the simulated motion does not depend on the host timing
+    simPrimary.SetTimeStep(1.0e-3);
+    simStandby.SetTimeStep(1.0e-3);
+
+    std::ostringstream failoverStream;
+    FailoverPort failover(&primary, &simStandby, failoverStream);
+    // Rescan on every call to Service; the rate is set by servicePeriod
+    failover.SetRecoveryPeriod(0.0);
+    failover.SetAutoFailback(autoFailback);
+
+    std::vector<AmpIO *> boards;
+    unsigned int bnum;
+    for (bnum = 0; bnum < numBoards; bnum++) {
+        AmpIO *board = new AmpIO(bnum);
+        failover.AddBoard(board);
+        boards.push_back(board);
+    }
+    std::cout << numBoards << " boards, " << numCycles << " cycles, primary link dropped at cycle "
+              << dropCycle << " and restored at cycle " << restoreCycle << std::endl;
+
+    // Drop all transactions; the timeout is the time for a lost read to be reported
+    ImpairmentProfile dropProfile;
+    dropProfile.lossProb = 1.0;
+    dropProfile.timeout = 100.0e-6;
+
+    unsigned long numFailed = 0;        // cycles where ReadAllBoards returned false
+    unsigned long numInvalid = 0;       // cycles with at least one invalid board read
+    int switchCycle = -1;               // cycle at which standby port became active
+    int recoverCycle = -1;              // cycle at which primary port recovered
+    int failbackCycle = -1;             // cycle at which primary port became active again
+    double maxCycleTime = 0.0;
+    double maxServiceTime = 0.0;
+    unsigned long numService = 0;
+    for (unsigned int cycle = 0; cycle < numCycles; cycle++) {
+        if (cycle == dropCycle)
+            primary.SetProfile(dropProfile);
+        else if (cycle == restoreCycle)
+            primary.SetProfile(ImpairmentProfile());
+
+        double t0 = Amp1394_GetTime();
+        bool ok = failover.ReadAllBoards();
+        bool allValid = true;
+        for (bnum = 0; bnum < numBoards; bnum++) {
+            if (!boards[bnum]->ValidRead())
+                allValid = false;
+            boards[bnum]->SetMotorCurrent(0, 0x8000);
+        }
+        failover.WriteAllBoards();
+        double cycleTime = Amp1394_GetTime()-t0;
+        if (cycleTime > maxCycleTime)
+            maxCycleTime = cycleTime;
+        if (!ok)
+            numFailed++;
+        if (!allValid)
+            numInvalid++;
+        if ((switchCycle < 0) && failover.IsFailedOver())
+            switchCycle = cycle;
+
+        // Non-real-time part of the cycle
+        if ((cycle % servicePeriod) == 0) {
+            bool wasFailed = failover.IsInactiveFailed();
+            t0 = Amp1394_GetTime();
+            failover.Service();
+            double serviceTime = Amp1394_GetTime()-t0;
+            if (serviceTime > maxServiceTime)
+                maxServiceTime = serviceTime;
+            numService++;
+            if (wasFailed && !failover.IsInactiveFailed() && (recoverCycle < 0))
+                recoverCycle = cycle;
+            if ((recoverCycle >= 0) && (failbackCycle < 0) && !failover.IsFailedOver())
+                failbackCycle = cycle;
+        }
+    }
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "  switched to standby:  " << CycleString(switchCycle) << std::endl
+              << "  failed cycles:        " << numFailed << " (invalid data: " << numInvalid << ")" << std::endl
+              << "  primary recovered:    " << CycleString(recoverCycle) << std::endl
+              << "  failback to primary:  " << CycleString(failbackCycle) << std::endl
+              << "  switches/recoveries:  " << failover.GetNumSwitches() << "/" << failover.GetNumRecoveries() << std::endl
+              << "  max cycle time:       " << maxCycleTime*1.0e6 << " usec" << std::endl
+              << "  max Service time:     " << maxServiceTime*1.0e6 << " usec (" << numService << " calls)" << std::endl;
+    std::cout.unsetf(std::ios::fixed);
+
+    // With the default failure threshold (2), only the first read after the drop fails; the
+    // second failed read switches to the standby port and is repeated there.
+    bool pass = (switchCycle >= static_cast<int>(dropCycle)) &&
+                (numFailed <= failover.GetFailureThreshold()-1) &&
+                (recoverCycle >= static_cast<int>(restoreCycle)) &&
+                (autoFailback == (failbackCycle >= 0));
+    std::cout << (pass ? "PASS" : "FAIL") << std::endl;
+    if (!pass)
+        std::cout << failoverStream.str();
+
+    for (bnum = 0; bnum < numBoards; bnum++) {
+        failover.RemoveBoard(boards[bnum]->GetBoardId());
+        delete boards[bnum];
+    }
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,262 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/******************************************************************************
+ *
+ * (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+ *
+ * This program runs the read/write cycle on simulated boards (see SimulatedPort)
+ * through an ImpairedPort, for a set of impairment profiles (delay, jitter, loss,
+ * duplication, reordering, corruption), and reports the cycle time percentiles
+ * and how the cycle recovers from failed or invalid reads.
+ *
+ * Usage: impairtest [-bN] [-nN] [-pP] [-sS] [-v]
+ *        where -b is the number of boards (default 2),
+ *        -n is the number of cycles per profile (default 2000),
+ *        -p is the protocol: 0 = SEQ_RW, 1 = SEQ_R_BC_W, 2 = BC_QRW (default),
+ *        -s is the random seed (default 1), and
+ *        -v prints the impairment counters for each profile
+ *
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+
+#include "SimulatedPort.h"
+#include "ImpairedPort.h"
+#include "AmpIO.h"
+#include "Amp1394Time.h"
+
+void PrintUsage(void)
+{
+    std::cerr << "Usage: impairtest [-bN] [-nN] [-pP] [-sS] [-v]" << std::endl
+              << "       where -b = number of boards (default 2)" << std::endl
+              << "             -n = number of cycles per profile (default 2000)" << std::endl
+              << "             -p = protocol: 0 = SEQ_RW, 1 = SEQ_R_BC_W, 2 = BC_QRW (default)" << std::endl
+              << "             -s = random seed (default 1)" << std::endl
+              << "             -v prints the impairment counters for each profile" << std::endl;
+}
+
+struct NamedProfile {
+    const char *name;
+    ImpairmentProfile profile;
+};
+
+std::vector<NamedProfile> GetProfiles(void)
+{
+    std::vector<NamedProfile> profiles;
+    NamedProfile np;
+
+    np.name = "none";
+    profiles.push_back(np);
+
+    np.name = "jitter";
+    np.profile = ImpairmentProfile();
+    np.profile.delayMean = 50.0e-6;
+    np.profile.delayJitter = 50.0e-6;
+    profiles.push_back(np);
+
+    np.name = "tail";
+    np.profile = ImpairmentProfile();
+    np.profile.delayMean = 20.0e-6;
+    np.profile.delayJitter = 100.0e-6;
+    np.profile.delayDist = ImpairmentProfile::DELAY_EXPONENTIAL;
+    np.profile.timeout = 500.0e-6;
+    profiles.push_back(np);
+
+    np.name = "loss";
+    np.profile = ImpairmentProfile();
+    np.profile.lossProb = 0.01;
+    profiles.push_back(np);
+
+    np.name = "duplicate";
+    np.profile = ImpairmentProfile();
+    np.profile.duplicateProb = 0.01;
+    profiles.push_back(np);
+
+    np.name = "reorder";
+    np.profile = ImpairmentProfile();
+    np.profile.reorderProb = 0.01;
+    profiles.push_back(np);
+
+    np.name = "corrupt";
+    np.profile = ImpairmentProfile();
+    np.profile.corruptProb = 0.01;
+    profiles.push_back(np);
+
+    np.name = "combined";
+    np.profile = ImpairmentProfile();
+    np.profile.delayMean = 20.0e-6;
+    np.profile.delayJitter = 20.0e-6;
+    np.profile.delayDist = ImpairmentProfile::DELAY_NORMAL;
+    np.profile.lossProb = 0.005;
+    np.profile.duplicateProb = 0.005;
+    np.profile.reorderProb = 0.005;
+    np.profile.corruptProb = 0.005;
+    profiles.push_back(np);
+
+    return profiles;
+}
+
+// Returns percentile (0-100) of sorted values
+double Percentile(const std::vector<double> &sorted, double pct)
+{
+    if (sorted.empty())
+        return 0.0;
+    size_t i = static_cast<size_t>(pct/100.0*(sorted.size()-1)+0.5);
+    return sorted[i];
+}
+
+int main(int argc, char** argv)
+{
+    unsigned int numBoards = 2;
+    unsigned int numCycles = 2000;
+    int protocol = BasePort::PROTOCOL_BC_QRW;
+    unsigned long seed = 1;
+    bool verbose = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] != '-') {
+            PrintUsage();
+            return 0;
+        }
+        if (argv[i][1] == 'b')
+            numBoards = atoi(argv[i]+2);
+        else if (argv[i][1] == 'n')
+            numCycles = atoi(argv[i]+2);
+        else if (argv[i][1] == 'p')
+            protocol = atoi(argv[i]+2);
+        else if (argv[i][1] == 's')
+            seed = strtoul(argv[i]+2, 0, 10);
+        else if (argv[i][1] == 'v')
+            verbose = true;
+        else {
+            PrintUsage();
+            return 0;
+        }
+    }
+    if ((numBoards < 1) || (numBoards > BoardIO::MAX_BOARDS) || (numCycles < 1) ||
+        (protocol < BasePort::PROTOCOL_SEQ_RW) || (protocol > BasePort::PROTOCOL_BC_QRW)) {
+        PrintUsage();
+        return -1;
+    }
+
+    std::stringstream debugStream(std::stringstream::out|std::stringstream::in);
+    SimulatedPort simPort((1 << numBoards)-1, debugStream);
+    ImpairedPort port(&simPort, debugStream);
+    if (!port.IsOK()) {
+        std::cerr << debugStream.str();
+        return -1;
+    }
+    // Fixed simulation step, so that the simulated motion does not depend on the delays
+    simPort.SetTimeStep(1.0e-3);
+    port.SetSeed(seed);
+
+    std::vector<AmpIO *> boards;
+    unsigned int bnum;
+    for (bnum = 0; bnum < numBoards; bnum++) {
+        AmpIO *board = new AmpIO(bnum);
+        port.AddBoard(board);
+        boards.push_back(board);
+    }
+    if (!port.SetProtocol(static_cast<BasePort::ProtocolType>(protocol)))
+        std::cerr << "Failed to set protocol" << std::endl;
+    std::cout << "Protocol: " << BasePort::ProtocolString(port.GetProtocol()) << ", "
+              << numBoards << " boards, " << numCycles << " cycles per profile" << std::endl;
+
+    for (bnum = 0; bnum < numBoards; bnum++)
+        boards[bnum]->WritePowerEnable(true);
+
+    std::cout << std::endl << std::setw(10) << "profile"
+              << std::setw(10) << "p50(us)" << std::setw(10) << "p90(us)" << std::setw(10) << "p99(us)"
+              << std::setw(10) << "max(us)" << std::setw(8) << "failed" << std::setw(8) << "invalid"
+              << std::setw(8) << "seqerr" << std::setw(8) << "stale" << std::setw(8) << "streak"
+              << std::setw(10) << "recovery" << std::endl;
+
+    std::vector<NamedProfile> profiles = GetProfiles();
+    for (size_t p = 0; p < profiles.size(); p++) {
+        port.SetProfile(profiles[p].profile);
+        port.ClearImpairmentCounters();
+        port.ClearCounters();
+
+        std::vector<double> cycleTimes;
+        cycleTimes.reserve(numCycles);
+        unsigned long numFailed = 0;       // ReadAllBoards or WriteAllBoards returned false
+        unsigned long numInvalid = 0;      // cycles with at least one invalid board read
+        unsigned long streak = 0;          // current number of consecutive bad cycles
+        unsigned long maxStreak = 0;
+        unsigned long numRecoveries = 0;
+        unsigned long recoveryCycles = 0;  // sum of bad cycles before each recovery
+        for (unsigned int cycle = 0; cycle < numCycles; cycle++) {
+            double t0 = Amp1394_GetTime();
+            bool ok = port.ReadAllBoards();
+            bool allValid = true;
+            for (bnum = 0; bnum < numBoards; bnum++) {
+                if (!boards[bnum]->ValidRead())
+                    allValid = false;
+                boards[bnum]->SetMotorCurrent(0, 0x8000);
+            }
+            if (!port.WriteAllBoards())
+                ok = false;
+            cycleTimes.push_back(Amp1394_GetTime()-t0);
+            if (!ok)
+                numFailed++;
+            if (!allValid)
+                numInvalid++;
+            if (!ok || !allValid) {
+                streak++;
+                if (streak > maxStreak)
+                    maxStreak = streak;
+            }
+            else if (streak > 0) {
+                numRecoveries++;
+                recoveryCycles += streak;
+                streak = 0;
+            }
+        }
+        // Disable impairments for next profile (and for other transactions)
+        port.SetProfile(ImpairmentProfile());
+
+        unsigned long seqErrors = 0;
+        unsigned long staleData = 0;
+        const PortCounters &counters = port.GetCounters();
+        for (bnum = 0; bnum < numBoards; bnum++) {
+            seqErrors += counters.GetBoard(bnum, PortCounters::BOARD_SEQ_MISMATCHES);
+            staleData += counters.GetBoard(bnum, PortCounters::BOARD_STALE_DATA);
+        }
+        std::sort(cycleTimes.begin(), cycleTimes.end());
+        std::cout << std::setw(10) << profiles[p].name << std::fixed << std::setprecision(1)
+                  << std::setw(10) << Percentile(cycleTimes, 50.0)*1.0e6
+                  << std::setw(10) << Percentile(cycleTimes, 90.0)*1.0e6
+                  << std::setw(10) << Percentile(cycleTimes, 99.0)*1.0e6
+                  << std::setw(10) << cycleTimes.back()*1.0e6
+                  << std::setw(8) << numFailed << std::setw(8) << numInvalid
+                  << std::setw(8) << seqErrors << std::setw(8) << staleData << std::setw(8) << maxStreak
+                  << std::setw(10) << std::setprecision(2)
+                  << ((numRecoveries > 0) ? static_cast<double>(recoveryCycles)/numRecoveries : 0.0)
+                  << std::endl;
+        if (verbose) {
+            std::cout << "          ";
+            for (unsigned int i = 0; i < ImpairedPort::NUM_COUNTERS; i++) {
+                ImpairedPort::CounterType type = static_cast<ImpairedPort::CounterType>(i);
+                std::cout << " " << ImpairedPort::GetCounterName(type) << "=" << port.GetCounter(type);
+            }
+            std::cout << std::endl;
+        }
+        std::cout.unsetf(std::ios::fixed);
+    }
+    std::cout << std::endl << "failed: cycles with failed transactions, invalid: cycles with invalid board data" << std::endl
+              << "streak: longest run of bad cycles, recovery: mean bad cycles before recovery" << std::endl;
+
+    for (bnum = 0; bnum < numBoards; bnum++)
+        boards[bnum]->WritePowerEnable(false);
+    for (bnum = 0; bnum < numBoards; bnum++) {
+        port.RemoveBoard(boards[bnum]->GetBoardId());
+        delete boards[bnum];
+    }
+    return 0;
+}
@@ -10,9 +10,10 @@
  * using bi-redirection digital port DOUT3, available with QLA Rev 1.4+.
  * It depends on the AmpIO library (which depends on libraw1394 and/or pcap).
  *
- * Usage: instrument [-pP] <board num>
+ * Usage: instrument [-pP] [-cFile] <board num>
  *        where P is the Firewire port number (default 0),
  *        or a string such as ethP and fwP, where P is the port number
+ *        File is the cache file (see DallasCache); if not specified, the cache is not used
  *
  ******************************************************************************/
 
@@ -30,6 +31,8 @@
 #endif
 #include "EthUdpPort.h"
 #include "AmpIO.h"
+#include "DallasCache.h"
+#include "Amp1394Time.h"
 
 void PrintDebugStream(std::stringstream &debugStream)
 {
@@ -51,6 +54,7 @@ int main(int argc, char** argv)
     int port = 0;
     int board = 0;
     std::string IPaddr(ETH_UDP_DEFAULT_IP);
+    std::string cacheFile;      // empty if cache not used
 
     if (argc > 1) {
         int args_found = 0;
@@ -63,11 +67,20 @@ int main(int argc, char** argv)
                     }
                     std::cerr << "Selected port: " << BasePort::PortTypeString(desiredPort) << std::endl;
                 }
+                else if (argv[i][1] == 'c') {
+                    cacheFile = std::string(argv[i]+2);
+                    if (cacheFile.empty()) {
+                        std::cerr << "Cache file not specified: " << argv[i] << std::endl;
+                        return 0;
+                    }
+                }
                 else {
-                    std::cerr << "Usage: instrument <board-num> [-pP]" << std::endl
+                    std::cerr << "Usage: instrument <board-num> [-pP] [-cFile]" << std::endl
                               << "       where <board-num> = rotary switch setting (0-15)" << std::endl
                               << "             P = port number (default 0)" << std::endl
-                              << "       can also specify -pfwP, -pethP or -pudp" << std::endl;
+                              << "       can also specify -pfwP, -pethP or -pudp" << std::endl
+                              << "             File = cache file, to read only the first and last pages" << std::endl
+                              << "                    of a cached instrument (default: no cache)" << std::endl;
                     return 0;
                 }
             }
@@ -122,7 +135,17 @@ int main(int argc, char** argv)
 
     // Now, we try to read the Dallas chip. This will also populate the status field.
     unsigned char buffer[2048];  // Buffer for entire contents of DS2505 memory (2 Kbytes)
-    bool ret = Board.DallasReadMemory(0, (unsigned char *) buffer, sizeof(buffer));
+    bool ret;
+    bool fromCache = false;
+    double startTime = Amp1394_GetTime();
+    if (!cacheFile.empty()) {
+        DallasCache cache(cacheFile);
+        ret = cache.ReadMemory(Board, buffer, sizeof(buffer), &fromCache);
+    }
+    else {
+        ret = Board.DallasReadMemory(0, buffer, sizeof(buffer));
+    }
+    double readTime = Amp1394_GetTime()-startTime;
     if (!Board.DallasReadStatus(status)) {
         std::cerr << "Failed to read DS2505 status" << std::endl;
         return -1;
@@ -152,6 +175,8 @@ int main(int argc, char** argv)
         std::cerr << "Failed to read instrument memory" << std::endl;
         return -1;
     }
+    std::cout << "Read instrument memory in " << readTime*1000.0 << " milliseconds"
+              << (fromCache ? " (from cache)" : "") << std::endl;
     std::ofstream outFile("instrument.txt", std::ios::binary);
     if (outFile.good()) {
         outFile.write((char *)buffer, sizeof(buffer));
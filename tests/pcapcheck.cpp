@@ -0,0 +1,761 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/******************************************************************************
+ *
+ * (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+ *
+ * This program reads a capture file (pcap or pcapng) of the Ethernet traffic between the PC
+ * and the FPGA boards (raw Ethernet or UDP), and runs every frame through the EthBasePort
+ * parsing and validation methods (ProcessExtraData, CheckFirewirePacket, FireWire CRC check,
+ * PrintFirewirePacket/PrintEthernetPacket). It reports the protocol anomalies found in the
+ * capture (CRC errors, tl mismatches, FPGA status flags, missing responses) and the throughput
+ * of each processing stage, measured over repeated passes through the frames in memory.
+ *
+ * Supported link types are Ethernet, Linux cooked capture (UDP only) and raw IPv4 (UDP only).
+ *
+ * Usage: pcapcheck [-v] [-nN] <capture file>
+ *        where N is the number of timed passes (default 10) and -v prints each anomaly
+ *
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <vector>
+
+#include "EthBasePort.h"
+#include "Amp1394Time.h"
+#include "Amp1394BSwap.h"
+
+// Link types (see http://www.tcpdump.org/linktypes.html)
+const unsigned int LINKTYPE_ETHERNET = 1;
+const unsigned int LINKTYPE_RAW = 101;
+const unsigned int LINKTYPE_LINUX_SLL = 113;
+const unsigned int LINKTYPE_IPV4 = 228;
+
+const unsigned int ETH_HEADER_SIZE = 14;
+const unsigned int SLL_HEADER_SIZE = 16;
+const unsigned short FPGA_UDP_PORT = 1394;
+
+// Frame from capture file
+struct CaptureFrame {
+    double time;                  // capture time, in seconds
+    unsigned int linkType;
+    const unsigned char *data;    // start of link-layer frame
+    unsigned int length;          // captured length
+};
+
+// FireWire packet extracted from CaptureFrame
+struct FwFrame {
+    unsigned int index;           // index of CaptureFrame
+    const unsigned char *eth;     // Ethernet header (0 if not available)
+    unsigned int ethLength;       // captured length of Ethernet frame
+    const unsigned char *fw;      // FireWire packet (0 if only extra data)
+    unsigned int fwLength;        // number of bytes in FireWire packet
+    const unsigned char *extra;   // extra data from FPGA (0 for requests)
+    bool isUDP;
+    bool isRequest;               // true if from PC, false if from FPGA
+    // Following set by analysis of responses (CheckFirewirePacket parameters)
+    bool hasRequest;
+    nodeid_t expNode;
+    unsigned int expTcode;
+    unsigned int expTl;
+    unsigned int expLength;
+};
+
+// Stream buffer that discards all output (but still requires all output to be formatted)
+class NullBuffer : public std::streambuf
+{
+protected:
+    int overflow(int c) { return traits_type::not_eof(c); }
+    std::streamsize xsputn(const char *, std::streamsize n) { return n; }
+};
+
+// Ethernet port without any network interface; used to call the EthBasePort methods
+// that process received packets.
+class OfflineEthPort : public EthBasePort
+{
+protected:
+    unsigned int numBusResets;
+
+    bool PacketSend(unsigned char *, size_t, bool) { return false; }
+    int PacketReceive(unsigned char *, size_t) { return 0; }
+    int PacketFlushAll(void) { return 0; }
+    nodeid_t InitNodes(void) { return 0; }
+
+    // Called by ProcessExtraData when FPGA bus generation changes
+    void OnFwBusReset(unsigned int FwBusGeneration_FPGA)
+    {
+        numBusResets++;
+        FwBusGeneration = FwBusGeneration_FPGA;
+    }
+
+public:
+    OfflineEthPort(std::ostream &debugStream) : EthBasePort(0, debugStream), numBusResets(0) {}
+    ~OfflineEthPort() {}
+
+    bool Init(void) { return true; }
+    void Cleanup(void) {}
+    PortType GetPortType(void) const { return PORT_ETH_UDP; }
+    bool IsOK(void) { return true; }
+    unsigned int GetPrefixOffset(MsgType) const { return 0; }
+    unsigned int GetWritePostfixSize(void) const { return 0; }
+    unsigned int GetReadPostfixSize(void) const { return 0; }
+    unsigned int GetWriteQuadAlign(void) const { return 0; }
+    unsigned int GetReadQuadAlign(void) const { return 0; }
+    unsigned int GetMaxReadDataSize(void) const { return MAX_POSSIBLE_DATA_SIZE; }
+    unsigned int GetMaxWriteDataSize(void) const { return MAX_POSSIBLE_DATA_SIZE; }
+
+    unsigned int GetNumBusResets(void) const { return numBusResets; }
+};
+
+// Helper functions for reading capture file fields (swap indicates that the file
+// byte order is different from the host byte order)
+uint32_t Get32(const unsigned char *p, bool swap)
+{
+    uint32_t val;
+    memcpy(&val, p, sizeof(val));
+    return swap ? bswap_32(val) : val;
+}
+
+uint16_t Get16(const unsigned char *p, bool swap)
+{
+    uint16_t val;
+    memcpy(&val, p, sizeof(val));
+    return swap ? bswap_16(val) : val;
+}
+
+// Network byte order
+inline unsigned int GetNet16(const unsigned char *p)
+{
+    return (static_cast<unsigned int>(p[0]) << 8) | p[1];
+}
+
+// Parse classic pcap file
+bool ParsePcap(const std::vector<unsigned char> &buffer, std::vector<CaptureFrame> &frames)
+{
+    if (buffer.size() < 24)
+        return false;
+    const unsigned char *base = &buffer[0];
+    uint32_t magic = Get32(base, false);
+    bool swap = ((magic == 0xd4c3b2a1) || (magic == 0x4d3cb2a1));
+    double tsUnit = ((magic == 0xa1b23c4d) || (magic == 0x4d3cb2a1)) ? 1.0e-9 : 1.0e-6;
+    unsigned int linkType = Get32(base+20, swap)&0x0fffffff;
+    size_t offset = 24;
+    while (offset+16 <= buffer.size()) {
+        const unsigned char *rec = base+offset;
+        uint32_t capLen = Get32(rec+8, swap);
+        if (offset+16+capLen > buffer.size()) {
+            std::cerr << "Truncated capture file (frame " << frames.size() << ")" << std::endl;
+            break;
+        }
+        CaptureFrame frame;
+        frame.time = Get32(rec, swap) + Get32(rec+4, swap)*tsUnit;
+        frame.linkType = linkType;
+        frame.data = rec+16;
+        frame.length = capLen;
+        frames.push_back(frame);
+        offset += 16+capLen;
+    }
+    return true;
+}
+
+// Parse pcapng file (Enhanced and Simple Packet Blocks)
+bool ParsePcapng(const std::vector<unsigned char> &buffer, std::vector<CaptureFrame> &frames)
+{
+    const uint32_t BLOCK_SHB = 0x0a0d0d0a;
+    const uint32_t BLOCK_IDB = 0x00000001;
+    const uint32_t BLOCK_SPB = 0x00000003;
+    const uint32_t BLOCK_EPB = 0x00000006;
+    const unsigned char *base = &buffer[0];
+    std::vector<unsigned int> ifLinkType;
+    std::vector<double> ifTsUnit;
+    bool swap = false;
+    double lastTime = 0.0;
+    size_t offset = 0;
+    while (offset+12 <= buffer.size()) {
+        const unsigned char *block = base+offset;
+        uint32_t blockType = Get32(block, swap);
+        if (blockType == BLOCK_SHB) {
+            // Byte order magic determines byte order of this section
+            uint32_t bom = Get32(block+8, false);
+            if (bom == 0x1a2b3c4d) swap = false;
+            else if (bom == 0x4d3c2b1a) swap = true;
+            else return false;
+            ifLinkType.clear();
+            ifTsUnit.clear();
+        }
+        uint32_t blockLen = Get32(block+4, swap);
+        if ((blockLen < 12) || (offset+blockLen > buffer.size())) {
+            std::cerr << "Truncated or invalid capture file (frame " << frames.size() << ")" << std::endl;
+            break;
+        }
+        if ((blockType == BLOCK_IDB) && (blockLen >= 20)) {
+            ifLinkType.push_back(Get16(block+8, swap));
+            double tsUnit = 1.0e-6;
+            // Options (look for if_tsresol)
+            size_t opt = 16;
+            while (opt+4 <= blockLen-4) {
+                unsigned int code = Get16(block+opt, swap);
+                unsigned int len = Get16(block+opt+2, swap);
+                if (code == 0)
+                    break;
+                if ((code == 9) && (len >= 1)) {
+                    unsigned char res = block[opt+4];
+                    unsigned int exp = res&0x7f;
+                    tsUnit = 1.0;
+                    for (unsigned int i = 0; i < exp; i++)
+                        tsUnit /= (res&0x80) ? 2.0 : 10.0;
+                }
+                opt += 4+((len+3)&~3u);
+            }
+            ifTsUnit.push_back(tsUnit);
+        }
+        else if ((blockType == BLOCK_EPB) && (blockLen >= 32)) {
+            uint32_t ifId = Get32(block+8, swap);
+            uint32_t capLen = Get32(block+20, swap);
+            if ((ifId < ifLinkType.size()) && (28+capLen <= blockLen)) {
+                uint64_t ts = (static_cast<uint64_t>(Get32(block+12, swap)) << 32) | Get32(block+16, swap);
+                CaptureFrame frame;
+                frame.time = ts*ifTsUnit[ifId];
+                frame.linkType = ifLinkType[ifId];
+                frame.data = block+28;
+                frame.length = capLen;
+                frames.push_back(frame);
+                lastTime = frame.time;
+            }
+        }
+        else if ((blockType == BLOCK_SPB) && (blockLen >= 16) && !ifLinkType.empty()) {
+            // Simple Packet Block does not have timestamp
+            uint32_t origLen = Get32(block+8, swap);
+            CaptureFrame frame;
+            frame.time = lastTime;
+            frame.linkType = ifLinkType[0];
+            frame.data = block+12;
+            frame.length = (origLen < blockLen-16) ? origLen : blockLen-16;
+            frames.push_back(frame);
+        }
+        offset += blockLen;
+    }
+    return true;
+}
+
+bool LoadCapture(const char *fileName, std::vector<unsigned char> &buffer, std::vector<CaptureFrame> &frames)
+{
+    std::ifstream file(fileName, std::ios::binary);
+    if (!file.good()) {
+        std::cerr << "Failed to open " << fileName << std::endl;
+        return false;
+    }
+    file.seekg(0, std::ios::end);
+    std::streamoff fileSize = file.tellg();
+    file.seekg(0, std::ios::beg);
+    if (fileSize < 24) {
+        std::cerr << fileName << " is not a capture file" << std::endl;
+        return false;
+    }
+    buffer.resize(static_cast<size_t>(fileSize));
+    if (!file.read(reinterpret_cast<char *>(&buffer[0]), fileSize)) {
+        std::cerr << "Failed to read " << fileName << std::endl;
+        return false;
+    }
+    uint32_t magic = Get32(&buffer[0], false);
+    if (magic == 0x0a0d0d0a)
+        return ParsePcapng(buffer, frames);
+    if ((magic == 0xa1b2c3d4) || (magic == 0xd4c3b2a1) || (magic == 0xa1b23c4d) || (magic == 0x4d3cb2a1))
+        return ParsePcap(buffer, frames);
+    std::cerr << fileName << " is not a pcap or pcapng file" << std::endl;
+    return false;
+}
+
+// Set FireWire packet from Ethernet or UDP payload
+bool SetPayload(const unsigned char *payload, unsigned int length, bool isRequest, FwFrame &fw)
+{
+    fw.isRequest = isRequest;
+    fw.extra = 0;
+    if (isRequest) {
+        // Control word followed by FireWire packet
+        if (length < FW_CTRL_SIZE+FW_QREAD_SIZE)
+            return false;
+        fw.fw = payload+FW_CTRL_SIZE;
+        fw.fwLength = length-FW_CTRL_SIZE;
+    }
+    else {
+        // FireWire packet (if any) followed by extra data
+        if (length < FW_EXTRA_SIZE)
+            return false;
+        fw.fwLength = length-FW_EXTRA_SIZE;
+        if (fw.fwLength == 0)
+            fw.fw = 0;
+        else if (fw.fwLength >= FW_QRESPONSE_SIZE)
+            fw.fw = payload;
+        else
+            return false;
+        fw.extra = payload+fw.fwLength;
+    }
+    return true;
+}
+
+// Decode UDP packet to/from FPGA
+bool DecodeIPv4(const unsigned char *ip, unsigned int length, FwFrame &fw)
+{
+    if ((length < 20) || ((ip[0]>>4) != 4) || (ip[9] != 17))
+        return false;
+    unsigned int ihl = (ip[0]&0x0f)*4;
+    unsigned int ipLength = GetNet16(ip+2);
+    // Ignore fragments (not used by FPGA)
+    if ((GetNet16(ip+6)&0x3fff) != 0)
+        return false;
+    if (ipLength < length)
+        length = ipLength;
+    if (length < ihl+8)
+        return false;
+    const unsigned char *udp = ip+ihl;
+    unsigned int udpLength = GetNet16(udp+4);
+    if ((udpLength < 8) || (udpLength > length-ihl))
+        return false;
+    fw.isUDP = true;
+    if (GetNet16(udp+2) == FPGA_UDP_PORT)
+        return SetPayload(udp+8, udpLength-8, true, fw);
+    if (GetNet16(udp) == FPGA_UDP_PORT)
+        return SetPayload(udp+8, udpLength-8, false, fw);
+    return false;
+}
+
+// Returns true if MAC address is FPGA (FA:61:0E:13:94:xx), or multicast (FB:61:0E:13:94:xx)
+inline bool IsFpgaMac(const unsigned char *mac, bool allowMulticast)
+{
+    return (((mac[0] == 0xFA) || (allowMulticast && (mac[0] == 0xFB))) &&
+            (mac[1] == 0x61) && (mac[2] == 0x0E) && (mac[3] == 0x13) && (mac[4] == 0x94));
+}
+
+// Decode captured frame; returns false if not traffic to/from FPGA
+bool DecodeFrame(const CaptureFrame &frame, FwFrame &fw)
+{
+    const unsigned char *p = frame.data;
+    unsigned int len = frame.length;
+    fw.eth = 0;
+    fw.ethLength = 0;
+    fw.isUDP = false;
+    fw.hasRequest = false;
+    if (frame.linkType == LINKTYPE_ETHERNET) {
+        if (len < ETH_HEADER_SIZE)
+            return false;
+        fw.eth = p;
+        fw.ethLength = len;
+        unsigned int etherType = GetNet16(p+12);
+        unsigned int offset = ETH_HEADER_SIZE;
+        if ((etherType == 0x8100) && (len >= ETH_HEADER_SIZE+4)) {
+            etherType = GetNet16(p+16);
+            offset += 4;
+        }
+        if (etherType == 0x0800)
+            return DecodeIPv4(p+offset, len-offset, fw);
+        if (etherType > 1500)
+            return false;
+        // Raw Ethernet: length field contains payload length (frame may be padded)
+        if (etherType > len-offset)
+            etherType = len-offset;
+        if (IsFpgaMac(p, true))
+            return SetPayload(p+offset, etherType, true, fw);
+        if (IsFpgaMac(p+6, false))
+            return SetPayload(p+offset, etherType, false, fw);
+        return false;
+    }
+    else if (frame.linkType == LINKTYPE_LINUX_SLL) {
+        if ((len < SLL_HEADER_SIZE) || (GetNet16(p+14) != 0x0800))
+            return false;
+        return DecodeIPv4(p+SLL_HEADER_SIZE, len-SLL_HEADER_SIZE, fw);
+    }
+    else if ((frame.linkType == LINKTYPE_RAW) || (frame.linkType == LINKTYPE_IPV4)) {
+        return DecodeIPv4(p, len, fw);
+    }
+    return false;
+}
+
+// FireWire header size (including header CRC), based on tcode
+inline unsigned int GetHeaderSize(const unsigned char *fw)
+{
+    return ((fw[3]>>4) == EthBasePort::QREAD) ? FW_QREAD_SIZE : FW_QRESPONSE_SIZE;
+}
+
+// Returns true if the packet has block data (BWRITE or BRESPONSE), with nbytes set to data length
+inline bool GetBlockDataLength(const unsigned char *fw, unsigned int fwLength, unsigned int &nbytes)
+{
+    unsigned int tcode = fw[3]>>4;
+    if ((tcode != EthBasePort::BWRITE) && (tcode != EthBasePort::BRESPONSE))
+        return false;
+    nbytes = GetNet16(fw+12);
+    return (FW_BRESPONSE_HEADER_SIZE+nbytes+FW_CRC_SIZE <= fwLength);
+}
+
+// Statistics from analysis pass
+struct CaptureStats {
+    unsigned long numRequests;
+    unsigned long numResponses;
+    unsigned long numUDP;
+    unsigned long numRaw;
+    unsigned long numExtraOnly;         // responses with only extra data
+    unsigned long numHeaderCrcErrors;
+    unsigned long numDataCrcErrors;
+    unsigned long numTruncated;         // block data length larger than packet
+    unsigned long numCheckErrors;       // CheckFirewirePacket failed
+    unsigned long numTlMismatch;
+    unsigned long numUnmatched;         // response without read request
+    unsigned long numNoResponse;        // read request without response
+    unsigned long numFwBusReset;
+    unsigned long numFwPacketDropped;
+    unsigned long numEthInternalError;
+    unsigned long numEthSummaryError;
+    unsigned int maxPacketError;
+    unsigned int numBusResets;          // changes of FPGA bus generation
+    double minTotalTime;
+    double maxTotalTime;
+    double sumTotalTime;
+    unsigned long numTotalTime;
+
+    CaptureStats() { memset(this, 0, sizeof(CaptureStats)); }
+};
+
+void PrintAnomaly(bool verbose, const FwFrame &fw, const std::vector<CaptureFrame> &frames, const char *msg)
+{
+    if (verbose)
+        std::cout << "Frame " << (fw.index+1) << " (t = " << std::fixed << std::setprecision(6)
+                  << frames[fw.index].time << "): " << msg << std::endl;
+}
+
+// Untimed pass: match responses to requests and count anomalies
+void AnalyzeFrames(std::vector<FwFrame> &fwFrames, const std::vector<CaptureFrame> &frames,
+                   bool verbose, CaptureStats &stats)
+{
+    std::ostream &debugStream = std::cout;
+    NullBuffer nullBuffer;
+    std::ostream nullStream(&nullBuffer);
+    OfflineEthPort port(verbose ? debugStream : nullStream);
+    FwFrame *pending = 0;          // last read request without response
+    bool firstExtra = true;
+    for (size_t i = 0; i < fwFrames.size(); i++) {
+        FwFrame &fw = fwFrames[i];
+        if (fw.isUDP) stats.numUDP++;
+        else stats.numRaw++;
+        if (fw.fw) {
+            if (!EthBasePort::checkCRC32(fw.fw, GetHeaderSize(fw.fw)-FW_CRC_SIZE)) {
+                stats.numHeaderCrcErrors++;
+                PrintAnomaly(verbose, fw, frames, "header CRC error");
+            }
+            unsigned int nbytes;
+            if (GetBlockDataLength(fw.fw, fw.fwLength, nbytes)) {
+                if ((nbytes > 0) && !EthBasePort::checkCRC32(fw.fw+FW_BRESPONSE_HEADER_SIZE, nbytes)) {
+                    stats.numDataCrcErrors++;
+                    PrintAnomaly(verbose, fw, frames, "data CRC error");
+                }
+            }
+            else if (((fw.fw[3]>>4) == EthBasePort::BWRITE) || ((fw.fw[3]>>4) == EthBasePort::BRESPONSE)) {
+                stats.numTruncated++;
+                PrintAnomaly(verbose, fw, frames, "block data truncated");
+            }
+        }
+        if (fw.isRequest) {
+            stats.numRequests++;
+            unsigned int tcode = fw.fw[3]>>4;
+            if ((tcode == EthBasePort::QREAD) || (tcode == EthBasePort::BREAD)) {
+                if (pending) {
+                    stats.numNoResponse++;
+                    PrintAnomaly(verbose, *pending, frames, "no response to read request");
+                }
+                pending = &fw;
+            }
+            continue;
+        }
+        stats.numResponses++;
+        if (firstExtra) {
+            port.UpdateBusGeneration(fw.extra[1]);
+            firstExtra = false;
+        }
+        port.ProcessExtraData(fw.extra);
+        EthBasePort::FPGA_Status status;
+        port.GetFpgaStatus(status);
+        if (status.FwBusReset) {
+            stats.numFwBusReset++;
+            PrintAnomaly(verbose, fw, frames, "FPGA status: Firewire bus reset");
+        }
+        if (status.FwPacketDropped) {
+            stats.numFwPacketDropped++;
+            PrintAnomaly(verbose, fw, frames, "FPGA status: Firewire packet dropped");
+        }
+        if (status.EthInternalError) {
+            stats.numEthInternalError++;
+            PrintAnomaly(verbose, fw, frames, "FPGA status: Ethernet internal error");
+        }
+        if (status.EthSummaryError) {
+            stats.numEthSummaryError++;
+            PrintAnomaly(verbose, fw, frames, "FPGA status: Ethernet summary error");
+        }
+        if (status.numPacketError > stats.maxPacketError)
+            stats.maxPacketError = status.numPacketError;
+        double totalTime = port.GetFpgaTotalTime();
+        if ((stats.numTotalTime == 0) || (totalTime < stats.minTotalTime))
+            stats.minTotalTime = totalTime;
+        if (totalTime > stats.maxTotalTime)
+            stats.maxTotalTime = totalTime;
+        stats.sumTotalTime += totalTime;
+        stats.numTotalTime++;
+
+        if (!fw.fw) {
+            stats.numExtraOnly++;
+            continue;
+        }
+        if (!pending) {
+            stats.numUnmatched++;
+            PrintAnomaly(verbose, fw, frames, "response without read request");
+            continue;
+        }
+        fw.hasRequest = true;
+        fw.expNode = pending->fw[1]&FW_NODE_MASK;
+        fw.expTcode = ((pending->fw[3]>>4) == EthBasePort::QREAD) ? EthBasePort::QRESPONSE : EthBasePort::BRESPONSE;
+        fw.expTl = pending->fw[2]>>2;
+        fw.expLength = ((pending->fw[3]>>4) == EthBasePort::BREAD) ? GetNet16(pending->fw+12) : 0;
+        pending = 0;
+        if ((fw.fw[2]>>2) != fw.expTl) {
+            stats.numTlMismatch++;
+            PrintAnomaly(verbose, fw, frames, "tl mismatch");
+        }
+        if (!port.CheckFirewirePacket(fw.fw, fw.expLength, fw.expNode, fw.expTcode, fw.expTl)) {
+            stats.numCheckErrors++;
+            PrintAnomaly(verbose, fw, frames, "CheckFirewirePacket failed");
+        }
+    }
+    if (pending) {
+        stats.numNoResponse++;
+        PrintAnomaly(verbose, *pending, frames, "no response to read request");
+    }
+    stats.numBusResets = port.GetNumBusResets();
+}
+
+// Timed stages
+enum Stage { STAGE_DECODE, STAGE_EXTRA, STAGE_CHECK, STAGE_CRC, STAGE_PRINT, NUM_STAGES };
+
+const char *StageName[NUM_STAGES] = { "decode", "ProcessExtraData", "CheckFirewirePacket", "CRC check", "print" };
+
+struct StageResult {
+    unsigned long numFrames;       // frames processed per pass
+    unsigned long numBytes;        // bytes processed per pass
+    double time;                   // total time for all passes
+    StageResult() : numFrames(0), numBytes(0), time(0.0) {}
+};
+
+// Runs one pass of specified stage; returns number of successful operations (to
+// make sure that the result is used)
+unsigned long RunStage(Stage stage, const std::vector<CaptureFrame> &frames, const std::vector<FwFrame> &fwFrames,
+                       OfflineEthPort &port, std::ostream &nullStream, std::vector<quadlet_t> &printBuffer,
+                       StageResult &result)
+{
+    unsigned long numOK = 0;
+    unsigned long numFrames = 0;
+    unsigned long numBytes = 0;
+    size_t i;
+    FwFrame fw;
+    switch (stage) {
+    case STAGE_DECODE:
+        for (i = 0; i < frames.size(); i++) {
+            if (DecodeFrame(frames[i], fw))
+                numOK++;
+            numBytes += frames[i].length;
+        }
+        numFrames = frames.size();
+        break;
+    case STAGE_EXTRA:
+        for (i = 0; i < fwFrames.size(); i++) {
+            if (fwFrames[i].extra) {
+                port.ProcessExtraData(fwFrames[i].extra);
+                numOK += port.GetFpgaReceiveTime() > 0.0;
+                numFrames++;
+                numBytes += FW_EXTRA_SIZE;
+            }
+        }
+        break;
+    case STAGE_CHECK:
+        for (i = 0; i < fwFrames.size(); i++) {
+            const FwFrame &cur = fwFrames[i];
+            if (cur.hasRequest) {
+                numOK += port.CheckFirewirePacket(cur.fw, cur.expLength, cur.expNode, cur.expTcode, cur.expTl);
+                numFrames++;
+                numBytes += FW_BRESPONSE_HEADER_SIZE;
+            }
+        }
+        break;
+    case STAGE_CRC:
+        for (i = 0; i < fwFrames.size(); i++) {
+            const FwFrame &cur = fwFrames[i];
+            if (cur.fw) {
+                unsigned int hdrSize = GetHeaderSize(cur.fw);
+                numOK += EthBasePort::checkCRC32(cur.fw, hdrSize-FW_CRC_SIZE);
+                numBytes += hdrSize;
+                unsigned int nbytes;
+                if (GetBlockDataLength(cur.fw, cur.fwLength, nbytes) && (nbytes > 0)) {
+                    numOK += EthBasePort::checkCRC32(cur.fw+FW_BRESPONSE_HEADER_SIZE, nbytes);
+                    numBytes += nbytes+FW_CRC_SIZE;
+                }
+                numFrames++;
+            }
+        }
+        break;
+    case STAGE_PRINT:
+        for (i = 0; i < fwFrames.size(); i++) {
+            const FwFrame &cur = fwFrames[i];
+            size_t q;
+            // PrintEthernetPacket expects 16-bit words in host byte order (as read from FPGA)
+            if (cur.eth) {
+                unsigned int nwords = (cur.ethLength < 64) ? cur.ethLength/2 : 32;
+                memset(&printBuffer[0], 0, 64);
+                uint16_t *words = reinterpret_cast<uint16_t *>(&printBuffer[0]);
+                for (q = 0; q < nwords; q++)
+                    words[q] = static_cast<uint16_t>(GetNet16(cur.eth+2*q));
+                EthBasePort::PrintEthernetPacket(nullStream, &printBuffer[0], 16);
+                numBytes += 2*nwords;
+            }
+            // PrintFirewirePacket expects quadlets in host byte order
+            if (cur.fw) {
+                unsigned int nquads = cur.fwLength/sizeof(quadlet_t);
+                if (nquads > printBuffer.size())
+                    nquads = printBuffer.size();
+                memcpy(&printBuffer[0], cur.fw, nquads*sizeof(quadlet_t));
+                for (q = 0; q < nquads; q++)
+                    printBuffer[q] = bswap_32(printBuffer[q]);
+                EthBasePort::PrintFirewirePacket(nullStream, &printBuffer[0], nquads);
+                numBytes += nquads*sizeof(quadlet_t);
+            }
+            numOK++;
+            numFrames++;
+        }
+        break;
+    default:
+        break;
+    }
+    result.numFrames = numFrames;
+    result.numBytes = numBytes;
+    return numOK;
+}
+
+void PrintUsage(void)
+{
+    std::cerr << "Usage: pcapcheck [-v] [-nN] <capture file>" << std::endl
+              << "       where N = number of timed passes (default 10)" << std::endl
+              << "             -v prints each anomaly" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned int numPasses = 10;
+    bool verbose = false;
+    const char *fileName = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] == '-') {
+            if (argv[i][1] == 'n') {
+                numPasses = atoi(argv[i]+2);
+            }
+            else if (argv[i][1] == 'v') {
+                verbose = true;
+            }
+            else {
+                PrintUsage();
+                return 0;
+            }
+        }
+        else {
+            fileName = argv[i];
+        }
+    }
+    if (!fileName || (numPasses == 0)) {
+        PrintUsage();
+        return 0;
+    }
+
+    std::vector<unsigned char> buffer;
+    std::vector<CaptureFrame> frames;
+    if (!LoadCapture(fileName, buffer, frames))
+        return -1;
+
+    std::vector<FwFrame> fwFrames;
+    for (size_t i = 0; i < frames.size(); i++) {
+        FwFrame fw;
+        if (DecodeFrame(frames[i], fw)) {
+            fw.index = static_cast<unsigned int>(i);
+            fwFrames.push_back(fw);
+        }
+    }
+    std::cout << fileName << ": " << frames.size() << " frames, " << fwFrames.size()
+              << " FPGA frames" << std::endl;
+    if (fwFrames.empty())
+        return 0;
+
+    CaptureStats stats;
+    AnalyzeFrames(fwFrames, frames, verbose, stats);
+
+    std::cout << std::endl << "Traffic:" << std::endl
+              << "  requests:            " << stats.numRequests << std::endl
+              << "  responses:           " << stats.numResponses << " (" << stats.numExtraOnly
+              << " with only extra data)" << std::endl
+              << "  UDP/raw Ethernet:    " << stats.numUDP << "/" << stats.numRaw << std::endl;
+    std::cout << "Anomalies:" << std::endl
+              << "  header CRC errors:   " << stats.numHeaderCrcErrors << std::endl
+              << "  data CRC errors:     " << stats.numDataCrcErrors << std::endl
+              << "  truncated blocks:    " << stats.numTruncated << std::endl
+              << "  check failures:      " << stats.numCheckErrors << std::endl
+              << "  tl mismatches:       " << stats.numTlMismatch << std::endl
+              << "  unmatched responses: " << stats.numUnmatched << std::endl
+              << "  missing responses:   " << stats.numNoResponse << std::endl
+              << "  bus generation changes: " << stats.numBusResets << std::endl;
+    std::cout << "FPGA status flags:" << std::endl
+              << "  FwBusReset:          " << stats.numFwBusReset << std::endl
+              << "  FwPacketDropped:     " << stats.numFwPacketDropped << std::endl
+              << "  EthInternalError:    " << stats.numEthInternalError << std::endl
+              << "  EthSummaryError:     " << stats.numEthSummaryError << std::endl
+              << "  max numPacketError:  " << stats.maxPacketError << std::endl;
+    if (stats.numTotalTime > 0) {
+        std::cout << "FPGA total time (us): min " << std::fixed << std::setprecision(2)
+                  << stats.minTotalTime*1.0e6 << ", avg " << (stats.sumTotalTime/stats.numTotalTime)*1.0e6
+                  << ", max " << stats.maxTotalTime*1.0e6 << std::endl;
+    }
+
+    // Timed passes
+    NullBuffer nullBuffer;
+    std::ostream nullStream(&nullBuffer);
+    OfflineEthPort port(nullStream);
+    port.UpdateBusGeneration(fwFrames[0].extra ? fwFrames[0].extra[1] : 0);
+    std::vector<quadlet_t> printBuffer(MAX_POSSIBLE_DATA_SIZE/sizeof(quadlet_t));
+    StageResult results[NUM_STAGES];
+    unsigned long numOK = 0;
+    int s;
+    for (s = 0; s < NUM_STAGES; s++) {
+        double startTime = Amp1394_GetTime();
+        for (unsigned int pass = 0; pass < numPasses; pass++)
+            numOK += RunStage(static_cast<Stage>(s), frames, fwFrames, port, nullStream, printBuffer, results[s]);
+        results[s].time = Amp1394_GetTime()-startTime;
+    }
+
+    std::cout << std::endl << "Throughput (" << numPasses << " passes):" << std::endl;
+    std::cout << std::setw(22) << std::left << "  stage" << std::right << std::setw(10) << "frames"
+              << std::setw(12) << "ns/frame" << std::setw(14) << "frames/s" << std::setw(10) << "MB/s" << std::endl;
+    for (s = 0; s < NUM_STAGES; s++) {
+        const StageResult &res = results[s];
+        double totalFrames = static_cast<double>(res.numFrames)*numPasses;
+        double totalBytes = static_cast<double>(res.numBytes)*numPasses;
+        std::cout << "  " << std::setw(20) << std::left << StageName[s] << std::right
+                  << std::setw(10) << res.numFrames << std::fixed;
+        if ((res.numFrames > 0) && (res.time > 0.0)) {
+            std::cout << std::setprecision(1) << std::setw(12) << (res.time/totalFrames)*1.0e9
+                      << std::setprecision(0) << std::setw(14) << totalFrames/res.time
+                      << std::setprecision(1) << std::setw(10) << totalBytes/res.time/1.0e6;
+        }
+        std::cout << std::endl;
+    }
+    if (verbose)
+        std::cout << "(" << numOK << " successful operations)" << std::endl;
+    return 0;
+}
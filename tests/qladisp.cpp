@@ -21,10 +21,12 @@ http://www.cisst.org/cisst/license.txt.
  * board. It relies on the curses library and the AmpIO library (which
  * depends on libraw1394 and/or pcap).
  *
- * Usage: qladisp [-pP] [-b<r|w>] [-v] <board num> [<board_num>]
+ * Usage: qladisp [-pP] [-b<r|w|a>] [-v] <board num> [<board_num>]
  *        where P is the Firewire port number (default 0),
  *        or a string such as ethP and fwP, where P is the port number
  *        -br or -bw specify to use a broadcast protocol
+ *        -ba selects the fastest protocol by timed trial; the result is stored in
+ *            a cache file (default $HOME/.qladisp-protocol, or specify -ba:file)
  *        -v specifies to display full velocity feedback
  *
  ******************************************************************************/
@@ -172,6 +174,8 @@ int main(int argc, char** argv)
     BasePort::ProtocolType protocol = BasePort::PROTOCOL_SEQ_RW;
     bool fullvel = false;  // whether to display full velocity feedback
     bool showTime = false; // whether to display time information
+    bool autoProtocol = false; // whether to select protocol by timed trial
+    std::string protocolCache; // cache file for selected protocol (see -ba)
 
     std::vector<AmpIO*> BoardList;
     std::vector<AmpIO_UInt32> BoardStatusList;
@@ -194,10 +198,16 @@ int main(int argc, char** argv)
             else if (argv[i][1] == 'b') {
                 // -br -- enable broadcast read/write
                 // -bw -- enable broadcast write (sequential read)
+                // -ba -- select protocol by timed trial (-ba:file to specify cache file)
                 if (argv[i][2] == 'r')
                     protocol = BasePort::PROTOCOL_BC_QRW;
                 else if (argv[i][2] == 'w')
                     protocol = BasePort::PROTOCOL_SEQ_R_BC_W;
+                else if (argv[i][2] == 'a') {
+                    autoProtocol = true;
+                    if (argv[i][3] == ':')
+                        protocolCache = argv[i]+4;
+                }
             }
             else if (argv[i][1] == 'v')
                 fullvel = true;
@@ -217,11 +227,12 @@ int main(int argc, char** argv)
 
     if (BoardList.size() < 1) {
         // usage
-        std::cerr << "Usage: qladisp <board-num> [<board-num>] [-pP] [-b<r|w>] [-v] [-t]" << std::endl
+        std::cerr << "Usage: qladisp <board-num> [<board-num>] [-pP] [-b<r|w|a[:file]>] [-v] [-t]" << std::endl
                   << "       where P = port number (default 0)" << std::endl
                   << "                 can also specify -pfw[:P], -peth:P or -pudp[:xx.xx.xx.xx]" << std::endl
                   << "            -br enables broadcast read/write" << std::endl
                   << "            -bw enables broadcast write" << std::endl
+                  << "            -ba selects fastest protocol (result cached in file, default $HOME/.qladisp-protocol)" << std::endl
                   << "            -v  displays full velocity feedback" << std::endl
                   << "            -t  displays time information" << std::endl
                   << std::endl
@@ -281,7 +292,17 @@ int main(int argc, char** argv)
         std::cerr << "Setting protocol to broadcast read/write" << std::endl;
     else if (protocol == BasePort::PROTOCOL_SEQ_R_BC_W)
         std::cerr << "Setting protocol to broadcast write" << std::endl;
-    if (!Port->SetProtocol(protocol))
+    if (autoProtocol) {
+        // Cache the result, so that the timed trial is only run when the topology changes
+        if (protocolCache.empty()) {
+            const char *home = getenv("HOME");
+            if (home)
+                protocolCache = std::string(home) + "/.qladisp-protocol";
+        }
+        Port->AutoSelectProtocol(500, protocolCache);
+        protocol = Port->GetProtocol();
+    }
+    else if (!Port->SetProtocol(protocol))
         protocol = Port->GetProtocol();  // on failure, get current protocol
 
     // Number of boards to display (currently 1 or 2)
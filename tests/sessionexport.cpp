@@ -0,0 +1,192 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/******************************************************************************
+ *
+ * (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+ *
+ * This program exports the decoded signals from a cycle log (see CycleLog) to a
+ * columnar session file (see SessionFile), and queries session files.
+ *
+ * Usage: sessionexport [-cN] <cycle log> <session file>
+ *        sessionexport -i <session file>
+ *        sessionexport -tT0:T1 <session file> <signal> [<signal> ...]
+ *        where N is the number of rows per chunk (default 4096),
+ *        -i prints the signals and chunk index, and
+ *        -t prints the signals between times T0 and T1 (in seconds) as CSV
+ *
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+#include "CycleLogPort.h"
+#include "SessionExporter.h"
+#include "AmpIO.h"
+
+void PrintUsage(void)
+{
+    std::cerr << "Usage: sessionexport [-cN] <cycle log> <session file>" << std::endl
+              << "       sessionexport -i <session file>" << std::endl
+              << "       sessionexport -tT0:T1 <session file> <signal> [<signal> ...]" << std::endl
+              << "       where N = number of rows per chunk (default 4096)" << std::endl
+              << "             -i prints the signals and chunk index" << std::endl
+              << "             -t prints the signals between times T0 and T1 (seconds) as CSV" << std::endl;
+}
+
+int ExportLog(const std::string &logFile, const std::string &sessionFile, unsigned int chunkRows)
+{
+    std::stringstream debugStream(std::stringstream::out|std::stringstream::in);
+    CycleLogPort port(logFile, debugStream);
+    if (!port.IsOK()) {
+        std::cerr << debugStream.str();
+        return -1;
+    }
+
+    std::vector<AmpIO *> boards;
+    SessionExporter exporter;
+    for (unsigned int bnum = 0; bnum < BoardIO::MAX_BOARDS; bnum++) {
+        if (port.GetFirmwareVersion(bnum) != 0) {
+            AmpIO *board = new AmpIO(bnum);
+            port.AddBoard(board);
+            exporter.AddBoard(board);
+            boards.push_back(board);
+        }
+    }
+    if (!exporter.Open(sessionFile, chunkRows)) {
+        std::cerr << "Failed to create " << sessionFile << std::endl;
+        return -1;
+    }
+    std::cout << "Exporting " << boards.size() << " boards, " << (port.GetNumCycles()-port.GetFirstCycle())
+              << " cycles, " << exporter.GetColumnNames().size() << " signals" << std::endl;
+
+    bool firstTime = true;
+    int64_t startTime = 0;
+    uint64_t lastCycle = CycleLog::CYCLE_INVALID;
+    while (!port.IsEndOfLog()) {
+        port.ReadAllBoards();
+        // Current cycle is not updated if there were no more cycles with read data
+        uint64_t cycle = port.GetCurrentCycle();
+        if (cycle == lastCycle)
+            break;
+        lastCycle = cycle;
+        const CycleLogEntry *entry = port.GetEntry(cycle);
+        if (!entry)
+            continue;
+        // Time is the midpoint of the host read interval, relative to the first cycle
+        int64_t readTime = entry->readStartTime+(entry->readEndTime-entry->readStartTime)/2;
+        if (firstTime) {
+            startTime = readTime;
+            firstTime = false;
+        }
+        exporter.Update((readTime-startTime)*1e-9);
+    }
+    bool ret = exporter.Close();
+    std::cout << "Wrote " << exporter.GetNumRows() << " rows to " << sessionFile << std::endl;
+
+    for (size_t i = 0; i < boards.size(); i++) {
+        port.RemoveBoard(boards[i]);
+        delete boards[i];
+    }
+    return ret ? 0 : -1;
+}
+
+int PrintInfo(const std::string &sessionFile)
+{
+    SessionReader reader;
+    if (!reader.Open(sessionFile))
+        return -1;
+    std::cout << sessionFile << ": " << reader.GetNumRows() << " rows, " << reader.GetNumChunks()
+              << " chunks, time " << reader.GetStartTime() << " to " << reader.GetEndTime() << std::endl;
+    for (unsigned int col = 0; col < reader.GetNumColumns(); col++) {
+        double minValue = 0.0, maxValue = 0.0;
+        reader.GetColumnRange(col, reader.GetStartTime(), reader.GetEndTime(), minValue, maxValue);
+        std::cout << "  " << std::setw(20) << std::left << reader.GetColumnName(col) << std::right
+                  << "  min " << std::setw(14) << minValue << "  max " << std::setw(14) << maxValue << std::endl;
+    }
+    for (size_t i = 0; i < reader.GetNumChunks(); i++) {
+        const SessionChunkInfo &chunk = reader.GetChunkInfo(i);
+        std::cout << "  chunk " << i << ": " << chunk.numRows << " rows, time " << chunk.tStart
+                  << " to " << chunk.tEnd << std::endl;
+    }
+    return 0;
+}
+
+int PrintSignals(const std::string &sessionFile, double t0, double t1, const std::vector<std::string> &signals)
+{
+    SessionReader reader;
+    if (!reader.Open(sessionFile))
+        return -1;
+    std::vector<unsigned int> cols;
+    for (size_t i = 0; i < signals.size(); i++) {
+        int col = reader.FindColumn(signals[i]);
+        if (col < 0) {
+            std::cerr << "Signal not found: " << signals[i] << std::endl;
+            return -1;
+        }
+        cols.push_back(static_cast<unsigned int>(col));
+    }
+    std::vector<double> time;
+    std::vector<std::vector<double> > data;
+    if (!reader.ReadColumns(cols, t0, t1, time, data))
+        return -1;
+    std::cout << "time";
+    for (size_t i = 0; i < signals.size(); i++)
+        std::cout << "," << signals[i];
+    std::cout << std::endl << std::setprecision(9);
+    for (size_t row = 0; row < time.size(); row++) {
+        std::cout << time[row];
+        for (size_t i = 0; i < data.size(); i++)
+            std::cout << "," << data[i][row];
+        std::cout << std::endl;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned int chunkRows = 4096;
+    bool doInfo = false;
+    bool doQuery = false;
+    double t0 = 0.0;
+    double t1 = 0.0;
+    std::vector<std::string> args;
+
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] == '-') {
+            if (argv[i][1] == 'c') {
+                chunkRows = atoi(argv[i]+2);
+            }
+            else if (argv[i][1] == 'i') {
+                doInfo = true;
+            }
+            else if (argv[i][1] == 't') {
+                if (sscanf(argv[i]+2, "%lf:%lf", &t0, &t1) != 2) {
+                    std::cerr << "Invalid time range: " << argv[i] << std::endl;
+                    return -1;
+                }
+                doQuery = true;
+            }
+            else {
+                PrintUsage();
+                return 0;
+            }
+        }
+        else {
+            args.push_back(argv[i]);
+        }
+    }
+
+    if (doInfo && (args.size() == 1))
+        return PrintInfo(args[0]);
+    if (doQuery && (args.size() >= 2))
+        return PrintSignals(args[0], t0, t1, std::vector<std::string>(args.begin()+1, args.end()));
+    if (!doInfo && !doQuery && (args.size() == 2) && (chunkRows > 0))
+        return ExportLog(args[0], args[1], chunkRows);
+    PrintUsage();
+    return 0;
+}
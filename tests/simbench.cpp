@@ -0,0 +1,211 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/******************************************************************************
+ *
+ * (C) Copyright 2021 Johns Hopkins University (JHU), All Rights Reserved.
+ *
+ * This program runs the read/write cycle on simulated boards (see SimulatedPort),
+ * with a sinusoidal motor current command on each channel, using ControlLoop,
+ * and reports the cycle statistics and the accuracy of the velocity estimates
+ * with respect to the simulated (true) encoder velocity.
+ *
+ * Usage: simbench [-bN] [-rR] [-tT] [-aA] [-s] [-pP] [-oO]
+ *        where N is the number of boards (default 2),
+ *        R is the cycle rate in Hz (default 0, i.e., as fast as possible),
+ *        T is the duration in seconds (default 2.0),
+ *        A is the amplitude of the motor current command in A (default 1.0),
+ *        -s uses a fixed simulation time step (1/R, or 1 ms if R is 0),
+ *        P is the protocol: 0 = SEQ_RW, 1 = SEQ_R_BC_W, 2 = BC_QRW (default),
+ *        O is the overrun policy: 0 = skip (default), 1 = catch up, 2 = degrade
+ *
+ ******************************************************************************/
+
+#ifdef _MSC_VER   // Windows
+#define _USE_MATH_DEFINES
+#endif
+
+#include <stdlib.h>
+#include <math.h>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+
+#include "SimulatedPort.h"
+#include "ControlLoop.h"
+#include "AmpIO.h"
+#include "Amp1394Time.h"
+
+void PrintUsage(void)
+{
+    std::cerr << "Usage: simbench [-bN] [-rR] [-tT] [-aA] [-s] [-pP] [-oO]" << std::endl
+              << "       where N = number of boards (default 2)" << std::endl
+              << "             R = cycle rate in Hz (default 0, as fast as possible)" << std::endl
+              << "             T = duration in seconds (default 2.0)" << std::endl
+              << "             A = amplitude of motor current command in A (default 1.0)" << std::endl
+              << "             -s uses a fixed simulation time step (1/R, or 1 ms if R is 0)" << std::endl
+              << "             P = protocol: 0 = SEQ_RW, 1 = SEQ_R_BC_W, 2 = BC_QRW (default)" << std::endl
+              << "             O = overrun policy: 0 = skip (default), 1 = catch up, 2 = degrade" << std::endl;
+}
+
+// Velocity error statistics (counts/sec)
+struct VelError {
+    double sumSq;
+    double maxAbs;
+    double sumSqTrue;
+    unsigned long num;
+
+    VelError() : sumSq(0.0), maxAbs(0.0), sumSqTrue(0.0), num(0) {}
+
+    void Add(double est, double actual)
+    {
+        double err = est-actual;
+        sumSq += err*err;
+        sumSqTrue += actual*actual;
+        if (fabs(err) > maxAbs) maxAbs = fabs(err);
+        num++;
+    }
+
+    void Print(const char *name) const
+    {
+        double rms = (num > 0) ? sqrt(sumSq/num) : 0.0;
+        double rmsTrue = (num > 0) ? sqrt(sumSqTrue/num) : 0.0;
+        std::cout << "  " << std::setw(10) << std::left << name << std::right
+                  << "  rms error " << std::setw(10) << rms
+                  << "  max error " << std::setw(10) << maxAbs
+                  << "  (" << ((rmsTrue > 0.0) ? 100.0*rms/rmsTrue : 0.0) << "% of rms velocity)" << std::endl;
+    }
+};
+
+// Data for BenchCycle
+struct BenchData {
+    SimulatedPort *port;
+    std::vector<AmpIO *> boards;
+    SimAxisModel model;
+    double amplitude;
+    double duration;
+    bool fixedStep;
+    double tStart;       // host start time
+    double tSim0;        // simulation start time
+    VelError errVel, errPred;
+};
+
+// Called by ControlLoop between ReadAllBoards and WriteAllBoards
+bool BenchCycle(ControlLoop &loop, void *userData)
+{
+    BenchData *data = static_cast<BenchData *>(userData);
+    double t = data->fixedStep ? (data->port->GetSimulationTime()-data->tSim0) : (Amp1394_GetTime()-data->tStart);
+    for (unsigned int bnum = 0; bnum < data->boards.size(); bnum++) {
+        AmpIO *board = data->boards[bnum];
+        for (unsigned int chan = 0; chan < SimulatedPort::NUM_CHANNELS; chan++) {
+            // Different frequency (1-4 Hz) on each channel
+            double amps = data->amplitude*sin(2.0*M_PI*(chan+1)*t);
+            board->SetMotorCurrent(chan, 0x8000 + static_cast<AmpIO_Int32>(amps/data->model.ampsPerBit));
+            SimAxisState state;
+            data->port->GetSampledAxisState(board->GetBoardId(), chan, state);
+            // Skip first cycles, before velocity data is available
+            if (loop.GetCycleNumber() > 10) {
+                data->errVel.Add(board->GetEncoderVelocity(chan), state.encoderVelocity);
+                data->errPred.Add(board->GetEncoderVelocityPredicted(chan), state.encoderVelocity);
+            }
+        }
+    }
+    return (t < data->duration);
+}
+
+int main(int argc, char** argv)
+{
+    unsigned int numBoards = 2;
+    double rate = 0.0;
+    double duration = 2.0;
+    double amplitude = 1.0;
+    bool fixedStep = false;
+    int protocol = BasePort::PROTOCOL_BC_QRW;
+    int policy = ControlLoop::OVERRUN_SKIP;
+
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] != '-') {
+            PrintUsage();
+            return 0;
+        }
+        if (argv[i][1] == 'b')
+            numBoards = atoi(argv[i]+2);
+        else if (argv[i][1] == 'r')
+            rate = atof(argv[i]+2);
+        else if (argv[i][1] == 't')
+            duration = atof(argv[i]+2);
+        else if (argv[i][1] == 'a')
+            amplitude = atof(argv[i]+2);
+        else if (argv[i][1] == 's')
+            fixedStep = true;
+        else if (argv[i][1] == 'p')
+            protocol = atoi(argv[i]+2);
+        else if (argv[i][1] == 'o')
+            policy = atoi(argv[i]+2);
+        else {
+            PrintUsage();
+            return 0;
+        }
+    }
+    if ((numBoards < 1) || (numBoards > BoardIO::MAX_BOARDS) || (duration <= 0.0) || (rate < 0.0) ||
+        (protocol < BasePort::PROTOCOL_SEQ_RW) || (protocol > BasePort::PROTOCOL_BC_QRW) ||
+        (policy < ControlLoop::OVERRUN_SKIP) || (policy > ControlLoop::OVERRUN_DEGRADE)) {
+        PrintUsage();
+        return -1;
+    }
+
+    SimulatedPort port((1 << numBoards)-1);
+    if (!port.IsOK())
+        return -1;
+    if (fixedStep)
+        port.SetTimeStep((rate > 0.0) ? 1.0/rate : 1.0e-3);
+
+    std::vector<AmpIO *> boards;
+    unsigned int bnum;
+    for (bnum = 0; bnum < numBoards; bnum++) {
+        AmpIO *board = new AmpIO(bnum);
+        port.AddBoard(board);
+        boards.push_back(board);
+    }
+    if (!port.SetProtocol(static_cast<BasePort::ProtocolType>(protocol)))
+        std::cerr << "Failed to set protocol, using " << BasePort::ProtocolString(port.GetProtocol()) << std::endl;
+    std::cout << "Protocol: " << BasePort::ProtocolString(port.GetProtocol()) << std::endl;
+
+    for (bnum = 0; bnum < numBoards; bnum++)
+        boards[bnum]->WritePowerEnable(true);
+    for (bnum = 0; bnum < numBoards; bnum++)
+        boards[bnum]->WriteAmpEnable(0x0f, 0x0f);
+
+    BenchData data;
+    data.port = &port;
+    data.boards = boards;
+    data.amplitude = amplitude;
+    data.duration = duration;
+    data.fixedStep = fixedStep;
+    port.GetAxisModel(0, 0, data.model);
+    data.tSim0 = port.GetSimulationTime();
+    data.tStart = Amp1394_GetTime();
+
+    ControlLoop loop(&port, (rate > 0.0) ? 1.0/rate : 0.0);
+    loop.SetOverrunPolicy(static_cast<ControlLoop::OverrunPolicy>(policy));
+    loop.SetCallback(BenchCycle, &data);
+    loop.Run();
+    double tTotal = Amp1394_GetTime()-data.tStart;
+
+    const ControlLoopStats &stats = loop.GetStats();
+    std::cout << stats.numCycles << " cycles in " << tTotal << " seconds: " << stats.numCycles/tTotal << " Hz"
+              << " (overrun policy: " << ControlLoop::OverrunPolicyString(loop.GetOverrunPolicy()) << ")" << std::endl;
+    stats.Print(std::cout);
+    std::cout << "Simulation time " << port.GetSimulationTime()-data.tSim0 << " seconds" << std::endl;
+    std::cout << "Velocity estimation error (counts/sec):" << std::endl;
+    data.errVel.Print("measured");
+    data.errPred.Print("predicted");
+
+    for (bnum = 0; bnum < numBoards; bnum++)
+        boards[bnum]->WritePowerEnable(false);
+    for (bnum = 0; bnum < numBoards; bnum++) {
+        port.RemoveBoard(boards[bnum]);
+        delete boards[bnum];
+    }
+    return 0;
+}